@@ -177,6 +177,7 @@ endif()
 
 add_compile_definitions(
   "$<$<BOOL:${USE_OPENMP}>:USE_OPENMP>" "$<$<BOOL:${USE_PARALLEL_STL}>:USE_PARALLEL_STL>"
+  "$<$<BOOL:${USE_THREAD_POOL}>:USE_THREAD_POOL>"
   "$<$<BOOL:${VERSION_INFO}>:VERSION_INFO=${VERSION_INFO}>"
   "$<$<OR:$<CONFIG:RELEASE>,$<CONFIG:RELWITHDEBINFO>>:_FORTIFY_SOURCE=2>")
 
@@ -64,12 +64,15 @@ if("x${CMAKE_CXX_COMPILER_ID}" STREQUAL "xMSVC"
 endif()
 option(USE_PARALLEL_STL "Use parallel STL algorithms (GCC, Intel, IntelLLVM and MSVC only for now)"
        ${_USE_PARALLEL_STL})
+option(USE_THREAD_POOL "Use a persistent thread pool (instead of OpenMP or parallel STL) for the parallel loops" OFF)
 
 # ------------------------------------------------------------------------------
 
 option(USE_INTRINSICS "Enable/disable the use of compiler intrinsics" ON)
 option(USE_NATIVE_INTRINSICS "Use -march=native (or equivalent compiler flag)" ON)
 
+option(USE_LAPACK "Use LAPACK (if available) for the SVDs of the MPS simulator" ON)
+
 # ------------------------------------------------------------------------------
 
 option(ENABLE_PROFILING "Enable compilation with profiling flags." OFF)
@@ -90,6 +93,8 @@ option(LINKER_STRIP_ALL "Use --strip-all during linking" ON)
 # Other CMake related options
 
 option(BUILD_TESTING "Build the test suite?" OFF)
+option(BUILD_BENCHMARKS "Build the C++ microbenchmarks of the simulator?" OFF)
+option(BUILD_SIM_LIBRARY "Build the standalone simulator library (C API, without Python)?" OFF)
 
 # NB: most if not all of our libraries have the type explicitly specified.
 option(BUILD_SHARED_LIBS "Build shared libs" OFF)
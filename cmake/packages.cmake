@@ -70,6 +70,17 @@ endif()
 
 # ==============================================================================
 
+find_package(Threads REQUIRED)
+
+# ==============================================================================
+# LAPACK (optional, the MPS simulator falls back to its own SVD otherwise)
+
+if(USE_LAPACK)
+  find_package(LAPACK)
+endif()
+
+# ==============================================================================
+
 if(ENABLE_CUDA)
   if(CMAKE_VERSION VERSION_GREATER_EQUAL 3.17)
     find_package(CUDAToolkit REQUIRED)
@@ -17,7 +17,30 @@
 """ProjectQ module dedicated to simulation"""
 
 from ._classical_simulator import ClassicalSimulator
+from ._density_simulator import DensityMatrixSimulator
+from ._mps_simulator import MPSSimulator
+from ._noise import (
+    AmplitudeDampingChannel,
+    DepolarizingChannel,
+    KrausChannel,
+    NoiseModel,
+    run_trajectories,
+)
 from ._simulator import SimBackend, Simulator
+from ._stabilizer_simulator import StabilizerSimulator
 from ._unitary import UnitarySimulator
 
-__all__ = ['Simulator', 'SimBackend', 'ClassicalSimulator', 'UnitarySimulator']
+__all__ = [
+    'Simulator',
+    'SimBackend',
+    'ClassicalSimulator',
+    'DensityMatrixSimulator',
+    'StabilizerSimulator',
+    'MPSSimulator',
+    'UnitarySimulator',
+    'KrausChannel',
+    'DepolarizingChannel',
+    'AmplitudeDampingChannel',
+    'NoiseModel',
+    'run_trajectories',
+]
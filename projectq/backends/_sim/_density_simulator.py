@@ -0,0 +1,316 @@
+# -*- coding: utf-8 -*-
+#   Copyright 2021 <Huawei Technologies Co., Ltd>
+#
+#   Licensed under the Apache License, Version 2.0 (the "License");
+#   you may not use this file except in compliance with the License.
+#   You may obtain a copy of the License at
+#
+#       http://www.apache.org/licenses/LICENSE-2.0
+#
+#   Unless required by applicable law or agreed to in writing, software
+#   distributed under the License is distributed on an "AS IS" BASIS,
+#   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+#   See the License for the specific language governing permissions and
+#   limitations under the License.
+
+"""
+Contains a compiler engine which simulates mixed states using density matrices.
+
+The C++ implementation reuses the state vector kernels of the Simulator. If it is not available, a (slow) Python
+implementation is used instead.
+"""
+
+# pylint: disable=no-name-in-module
+
+import math
+import random
+
+from projectq.cengines import BasicEngine
+from projectq.meta import LogicalQubitIDTag, get_control_count, has_negative_control
+from projectq.ops import Allocate, Deallocate, FlushGate, Measure
+from projectq.types import WeakQubitRef
+
+try:
+    from ._cppsim import DensityMatrixSimulator as DensityMatrixSimulatorBackend
+except ImportError:  # pragma: no cover
+    from ._pydensity import DensityMatrixSimulator as DensityMatrixSimulatorBackend
+
+
+class DensityMatrixSimulator(BasicEngine):
+    """
+    Compiler engine simulating a quantum computer in a mixed state.
+
+    The state of n qubits is described by a 2^n x 2^n density matrix, which requires the same amount of memory as a
+    state vector of 2n qubits. Deallocating a qubit traces it out, regardless of whether it is entangled with the
+    remaining qubits.
+    """
+
+    def __init__(self, gate_fusion=False, rnd_seed=None):
+        """
+        Construct the density matrix simulator and initialize it with a random seed.
+
+        Args:
+            gate_fusion (bool): If True, gates are cached and only executed once a certain gate-size has been reached
+                (only has an effect for the c++ simulator).
+            rnd_seed (int): Random seed (uses random.randint(0, 4294967295) by default).
+        """
+        if rnd_seed is None:
+            rnd_seed = random.randint(0, 4294967295)
+        super().__init__()
+        self._simulator = DensityMatrixSimulatorBackend(rnd_seed)
+        self._gate_fusion = gate_fusion
+
+    def is_available(self, cmd):
+        """
+        Test whether a Command is supported by a compiler engine.
+
+        Specialized implementation of is_available: The simulator can deal with all arbitrarily-controlled gates which
+        provide a gate-matrix (via gate.matrix) and acts on 5 or less qubits (not counting the control qubits).
+
+        Args:
+            cmd (Command): Command for which to check availability (single- qubit gate, arbitrary controls)
+
+        Returns:
+            True if it can be simulated and False otherwise.
+        """
+        if has_negative_control(cmd):
+            return False
+
+        if cmd.gate == Measure or cmd.gate == Allocate or cmd.gate == Deallocate:
+            return True
+
+        if cmd.gate.is_parametric():
+            return False
+
+        try:
+            # Allow up to 5-qubit gates
+            return cmd.gate.matrix.shape[0] <= 2 ** 5
+        except AttributeError:
+            return False
+
+    def _convert_logical_to_mapped_qureg(self, qureg):
+        """
+        Convert a qureg from logical to mapped qubits if there is a mapper.
+
+        Args:
+            qureg (list[Qubit],Qureg): Logical quantum bits
+        """
+        mapper = self.main_engine.mapper
+        if mapper is not None:
+            mapped_qureg = []
+            for qubit in qureg:
+                if qubit.id not in mapper.current_mapping:
+                    raise RuntimeError("Unknown qubit id. Please make sure you have called eng.flush().")
+                new_qubit = WeakQubitRef(qubit.engine, mapper.current_mapping[qubit.id])
+                mapped_qureg.append(new_qubit)
+            return mapped_qureg
+        return qureg
+
+    def get_expectation_value(self, qubit_operator, qureg):
+        """
+        Return the expectation value Tr(rho H) of a qubit operator H.
+
+        Args:
+            qubit_operator (projectq.ops.QubitOperator): Operator to measure.
+            qureg (list[Qubit],Qureg): Quantum bits to measure.
+
+        Returns:
+            Expectation value
+
+        Note:
+            Make sure all previous commands (especially allocations) have passed through the compilation chain (call
+            main_engine.flush() to make sure).
+
+        Note:
+            If there is a mapper present in the compiler, this function automatically converts from logical qubits to
+            mapped qubits for the qureg argument.
+
+        Raises:
+            Exception: If `qubit_operator` acts on more qubits than present in the `qureg` argument.
+        """
+        qureg = self._convert_logical_to_mapped_qureg(qureg)
+        num_qubits = len(qureg)
+        for term, _ in qubit_operator.terms.items():
+            if not term == () and term[-1][0] >= num_qubits:
+                raise Exception("qubit_operator acts on more qubits than contained in the qureg.")
+        operator = [(list(term), coeff) for (term, coeff) in qubit_operator.terms.items()]
+        return self._simulator.get_expectation_value(operator, [qb.id for qb in qureg])
+
+    def get_probability(self, bit_string, qureg):
+        """
+        Return the probability of the outcome `bit_string` when measuring the quantum register `qureg`.
+
+        Args:
+            bit_string (list[bool|int]|string[0|1]): Measurement outcome.
+            qureg (Qureg|list[Qubit]): Quantum register.
+
+        Returns:
+            Probability of measuring the provided bit string.
+
+        Note:
+            Make sure all previous commands (especially allocations) have passed through the compilation chain (call
+            main_engine.flush() to make sure).
+
+        Note:
+            If there is a mapper present in the compiler, this function automatically converts from logical qubits to
+            mapped qubits for the qureg argument.
+        """
+        qureg = self._convert_logical_to_mapped_qureg(qureg)
+        bit_string = [bool(int(b)) for b in bit_string]
+        return self._simulator.get_probability(bit_string, [qb.id for qb in qureg])
+
+    def get_probabilities(self, qureg):
+        """
+        Return the probabilities of all the outcomes when measuring the quantum register `qureg`.
+
+        Args:
+            qureg (Qureg|list[Qubit]): Quantum register.
+
+        Returns:
+            Numpy array of length 2**len(qureg) whose k-th entry is the probability of measuring bit j of k for the
+            qubit qureg[j].
+
+        Note:
+            If there is a mapper present in the compiler, this function automatically converts from logical qubits to
+            mapped qubits for the qureg argument.
+        """
+        qureg = self._convert_logical_to_mapped_qureg(qureg)
+        return self._simulator.get_probabilities([qb.id for qb in qureg])
+
+    def get_reduced_density_matrix(self, qureg):
+        """
+        Return the density matrix of the quantum register `qureg`, tracing out all the other qubits.
+
+        Args:
+            qureg (Qureg|list[Qubit]): Quantum register determining the ordering.
+
+        Returns:
+            Numpy array of shape (2**len(qureg), 2**len(qureg)) where bit j of the row/column index corresponds to the
+            qubit qureg[j].
+
+        Note:
+            If there is a mapper present in the compiler, this function automatically converts from logical qubits to
+            mapped qubits for the qureg argument.
+        """
+        qureg = self._convert_logical_to_mapped_qureg(qureg)
+        return self._simulator.get_reduced_density_matrix([qb.id for qb in qureg])
+
+    def get_purity(self):
+        """
+        Return the purity Tr(rho^2) of the state (1 for pure states).
+
+        Note:
+            Make sure all previous commands have passed through the compilation chain (call main_engine.flush() to
+            make sure).
+        """
+        return self._simulator.get_purity()
+
+    def collapse_wavefunction(self, qureg, values):
+        """
+        Collapse a quantum register onto a classical basis state.
+
+        Args:
+            qureg (Qureg|list[Qubit]): Qubits to collapse.
+            values (list[bool|int]|string[0|1]): Measurement outcome for each of the qubits in `qureg`.
+
+        Raises:
+            RuntimeError: If an outcome has probability (approximately) 0 or if unknown qubits are provided (see
+                note).
+
+        Note:
+            If there is a mapper present in the compiler, this function automatically converts from logical qubits to
+            mapped qubits for the qureg argument.
+        """
+        qureg = self._convert_logical_to_mapped_qureg(qureg)
+        return self._simulator.collapse_wavefunction([qb.id for qb in qureg], [bool(int(v)) for v in values])
+
+    def cheat(self):
+        """
+        Access the ordering of the qubits and the density matrix.
+
+        Returns:
+            A tuple where the first entry is a dictionary mapping qubit indices to bit-locations and the second entry is
+            a copy of the 2^n x 2^n density matrix (bit p of the row/column index is the qubit at location p).
+
+        Note:
+            If there is a mapper present in the compiler, this function DOES NOT automatically convert from logical
+            qubits to mapped qubits.
+        """
+        return self._simulator.cheat()
+
+    def select_backend(self, backend_type):
+        """
+        Select a particular type of simulator backend (see Simulator.select_backend).
+
+        Args:
+            backend_type (SimBackend): enum value describing the backend type
+        """
+        self._simulator.select_backend(backend_type)
+
+    def _handle(self, cmd):
+        """
+        Handle all commands.
+
+        Args:
+            cmd (Command): Command to handle.
+
+        Raises:
+            Exception: If a gate acting on more than 5 qubits needs to be processed (which should never happen due to
+                is_available).
+        """
+        if cmd.gate == Measure:
+            if get_control_count(cmd) != 0:
+                raise ValueError('Cannot have control qubits with a measurement gate!')
+            ids = [qb.id for qr in cmd.qubits for qb in qr]
+            out = self._simulator.measure_qubits(ids)
+            i = 0
+            for qureg in cmd.qubits:
+                for qb in qureg:
+                    # Check if a mapper assigned a different logical id
+                    for tag in cmd.tags:
+                        if isinstance(tag, LogicalQubitIDTag):
+                            qb = WeakQubitRef(qb.engine, tag.logical_qubit_id)
+                    self.main_engine.set_measurement_result(qb, out[i])
+                    i += 1
+        elif cmd.gate == Allocate:
+            self._simulator.allocate_qubit(cmd.qubits[0][0].id)
+        elif cmd.gate == Deallocate:
+            self._simulator.deallocate_qubit(cmd.qubits[0][0].id)
+        elif len(cmd.gate.matrix) <= 2 ** 5:
+            matrix = cmd.gate.matrix
+            ids = [qb.id for qureg in cmd.qubits for qb in qureg]
+            if not 2 ** len(ids) == len(cmd.gate.matrix):
+                raise Exception(
+                    "DensityMatrixSimulator: Error applying {} gate: {}-qubit gate applied to {} qubits.".format(
+                        str(cmd.gate), int(math.log(len(cmd.gate.matrix), 2)), len(ids)
+                    )
+                )
+            self._simulator.apply_controlled_gate(
+                [item for sublist in matrix.tolist() for item in sublist], ids, [qb.id for qb in cmd.control_qubits]
+            )
+
+            if not self._gate_fusion:
+                self._simulator.run()
+        else:
+            raise Exception(
+                "This simulator only supports controlled k-qubit gates with k < 6!\n"
+                "Please add an auto-replacer engine to your list of compiler engines."
+            )
+
+    def receive(self, command_list):
+        """
+        Receive a list of commands.
+
+        Receive a list of commands from the previous engine and handle them (simulate them classically) prior to
+        sending them on to the next engine.
+
+        Args:
+            command_list (list<Command>): List of commands to execute on the simulator.
+        """
+        for cmd in command_list:
+            if not cmd.gate == FlushGate():
+                self._handle(cmd)
+            else:
+                self._simulator.run()  # flush gate --> run all saved gates
+            if not self.is_last_engine:
+                self.send([cmd])
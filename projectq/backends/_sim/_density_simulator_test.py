@@ -0,0 +1,262 @@
+# -*- coding: utf-8 -*-
+#   Copyright 2021 <Huawei Technologies Co., Ltd>
+#
+#   Licensed under the Apache License, Version 2.0 (the "License");
+#   you may not use this file except in compliance with the License.
+#   You may obtain a copy of the License at
+#
+#       http://www.apache.org/licenses/LICENSE-2.0
+#
+#   Unless required by applicable law or agreed to in writing, software
+#   distributed under the License is distributed on an "AS IS" BASIS,
+#   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+#   See the License for the specific language governing permissions and
+#   limitations under the License.
+"""
+Tests for projectq.backends._sim._density_simulator.py, using both the Python and the C++ implementations.
+"""
+
+import math
+
+import numpy
+import pytest
+
+from projectq import MainEngine
+from projectq.backends import DensityMatrixSimulator, Simulator
+from projectq.cengines import BasicMapperEngine, DummyEngine
+from projectq.meta import Control
+from projectq.ops import (
+    CNOT,
+    All,
+    BasicGate,
+    H,
+    MatrixGate,
+    Measure,
+    QubitOperator,
+    Rx,
+    Ry,
+    Rz,
+    S,
+    Toffoli,
+    X,
+    Y,
+)
+
+
+def get_available_simulators():
+    result = ["py_simulator"]
+    try:
+        from projectq.backends._sim._cppsim import (  # noqa: F401
+            DensityMatrixSimulator as CppDensitySim,
+        )
+
+        result.append("cpp_simulator")
+    except ImportError:
+        # The C++ simulator was either not installed or is misconfigured. Skip.
+        pass
+    return result
+
+
+@pytest.fixture(params=get_available_simulators())
+def sim(request):
+    if request.param == "py_simulator":
+        from projectq.backends._sim._pydensity import (
+            DensityMatrixSimulator as PyDensitySim,
+        )
+
+        sim = DensityMatrixSimulator()
+        sim._simulator = PyDensitySim(1)
+        return sim
+    else:
+        from projectq.backends._sim._cppsim import (
+            DensityMatrixSimulator as CppDensitySim,
+        )
+
+        sim = DensityMatrixSimulator(gate_fusion=True)
+        sim._simulator = CppDensitySim(1)
+        return sim
+
+
+@pytest.fixture(params=["mapper", "no_mapper"])
+def mapper(request):
+    """
+    Adds a mapper which changes qubit ids by adding 1
+    """
+    if request.param == "mapper":
+
+        class TrivialMapper(BasicMapperEngine):
+            def __init__(self):
+                super().__init__()
+                self.current_mapping = {}
+
+            def receive(self, command_list):
+                for cmd in command_list:
+                    for qureg in cmd.all_qubits:
+                        for qubit in qureg:
+                            if qubit.id == -1:
+                                continue
+                            elif qubit.id not in self.current_mapping:
+                                previous_map = self.current_mapping
+                                previous_map[qubit.id] = qubit.id + 1
+                                self.current_mapping = previous_map
+                    self._send_cmd_with_mapped_ids(cmd)
+
+        return TrivialMapper()
+    if request.param == "no_mapper":
+        return None
+
+
+def test_density_simulator_is_available(sim):
+    backend = DummyEngine(save_commands=True)
+    eng = MainEngine(backend, [])
+    qubit = eng.allocate_qureg(6)
+    Measure | qubit[0]
+    H | qubit[0]
+    MatrixGate(numpy.eye(2 ** 6)) | qubit
+    Rx(0.3) | qubit[0]
+    eng.flush()
+    cmds = backend.received_commands
+    assert sim.is_available(cmds[6])
+    assert sim.is_available(cmds[7])
+    assert not sim.is_available(cmds[8])
+    assert sim.is_available(cmds[9])
+    cmds[9].gate = BasicGate()
+    assert not sim.is_available(cmds[9])
+
+
+def test_density_simulator_pure_state(sim, mapper):
+    """Without any measurement, rho is the projector onto the state of the regular simulator."""
+    engine_list = [] if mapper is None else [mapper]
+    eng = MainEngine(sim, engine_list=engine_list)
+    ref_eng = MainEngine(Simulator(), engine_list=[])
+    qureg = eng.allocate_qureg(4)
+    ref_qureg = ref_eng.allocate_qureg(4)
+    for engine, qubits in ((eng, qureg), (ref_eng, ref_qureg)):
+        H | qubits[0]
+        CNOT | (qubits[0], qubits[2])
+        Ry(0.7) | qubits[1]
+        Toffoli | (qubits[1], qubits[2], qubits[3])
+        with Control(engine, qubits[3]):
+            Rz(0.4) | qubits[0]
+        S | qubits[2]
+        Y | qubits[1]
+        engine.flush()
+
+    ref_map = ref_eng.backend.cheat()[0]
+    ref_qubits = sorted(ref_qureg, key=lambda qb: ref_map[qb.id])
+    psi = numpy.array([ref_eng.backend.get_amplitude(bin(k)[2:].zfill(4)[::-1], ref_qubits) for k in range(16)])
+
+    # density matrix in the ordering of ref_qubits
+    ordering = [qureg[ref_qureg.index(qb)] for qb in ref_qubits]
+    rho = eng.backend.get_reduced_density_matrix(ordering)
+    assert rho == pytest.approx(numpy.outer(psi, psi.conj()))
+    assert eng.backend.get_purity() == pytest.approx(1.0)
+
+    op = QubitOperator('X0 Y2', 0.7) + QubitOperator('Z1 Z3', -1.3) + QubitOperator('', 0.2)
+    assert eng.backend.get_expectation_value(op, qureg) == pytest.approx(
+        ref_eng.backend.get_expectation_value(op, ref_qureg)
+    )
+    assert eng.backend.get_probability('10', [qureg[2], qureg[1]]) == pytest.approx(
+        ref_eng.backend.get_probability('10', [ref_qureg[2], ref_qureg[1]])
+    )
+    assert eng.backend.get_probabilities([qureg[3], qureg[0]]) == pytest.approx(
+        ref_eng.backend.get_probabilities([ref_qureg[3], ref_qureg[0]])
+    )
+    All(Measure) | qureg
+    All(Measure) | ref_qureg
+
+
+def test_density_simulator_partial_trace(sim):
+    eng = MainEngine(sim, engine_list=[])
+    qureg = eng.allocate_qureg(2)
+    H | qureg[0]
+    CNOT | (qureg[0], qureg[1])
+    eng.flush()
+
+    # Each half of a Bell pair is maximally mixed
+    assert eng.backend.get_reduced_density_matrix([qureg[0]]) == pytest.approx(numpy.eye(2) / 2)
+    assert eng.backend.get_reduced_density_matrix([qureg[1], qureg[0]]) == pytest.approx(
+        numpy.array([[0.5, 0, 0, 0.5], [0, 0, 0, 0], [0, 0, 0, 0], [0.5, 0, 0, 0.5]])
+    )
+
+    # Deallocating a qubit traces it out (no error even though it is entangled)
+    qureg[1].__del__()
+    eng.flush()
+    mapping, rho = eng.backend.cheat()
+    assert list(mapping) == [qureg[0].id]
+    assert rho == pytest.approx(numpy.eye(2) / 2)
+    assert eng.backend.get_purity() == pytest.approx(0.5)
+    # Gates act on the mixed state
+    X | qureg[0]
+    H | qureg[0]
+    eng.flush()
+    assert eng.backend.cheat()[1] == pytest.approx(numpy.eye(2) / 2)
+    assert eng.backend.get_expectation_value(QubitOperator('Z0'), [qureg[0]]) == pytest.approx(0.0)
+
+    with pytest.raises(RuntimeError):
+        eng.backend.get_reduced_density_matrix([qureg[1]])
+    Measure | qureg[0]
+
+
+def test_density_simulator_measure(sim, mapper):
+    engine_list = [] if mapper is None else [mapper]
+    eng = MainEngine(sim, engine_list=engine_list)
+    qureg = eng.allocate_qureg(3)
+    H | qureg[0]
+    CNOT | (qureg[0], qureg[1])
+    X | qureg[2]
+    Measure | qureg[0]
+    eng.flush()
+    first = int(qureg[0])
+    Measure | qureg[1]
+    Measure | qureg[2]
+    assert int(qureg[1]) == first
+    assert int(qureg[2]) == 1
+    assert eng.backend.get_purity() == pytest.approx(1.0)
+    assert eng.backend.get_probability([first, first, 1], qureg) == pytest.approx(1.0)
+
+
+def test_density_simulator_measure_mixed(sim):
+    eng = MainEngine(sim, engine_list=[])
+    outcomes = []
+    for _ in range(40):
+        qureg = eng.allocate_qureg(2)
+        H | qureg[0]
+        CNOT | (qureg[0], qureg[1])
+        qureg[0].__del__()
+        Measure | qureg[1]
+        eng.flush()
+        outcomes.append(int(qureg[1]))
+        del qureg
+    assert 0 in outcomes and 1 in outcomes
+
+
+def test_density_simulator_collapse_wavefunction(sim):
+    eng = MainEngine(sim, engine_list=[])
+    qureg = eng.allocate_qureg(2)
+    eng.flush()
+    with pytest.raises(ValueError):
+        eng.backend.collapse_wavefunction(qureg, [0])
+    Ry(2 * math.acos(math.sqrt(0.3))) | qureg[0]
+    CNOT | (qureg[0], qureg[1])
+    eng.flush()
+    assert eng.backend.get_probability('11', qureg) == pytest.approx(0.7)
+    with pytest.raises(RuntimeError):
+        eng.backend.collapse_wavefunction(qureg, [0, 1])
+    eng.backend.collapse_wavefunction([qureg[0]], [1])
+    assert eng.backend.get_probability('11', qureg) == pytest.approx(1.0)
+    All(Measure) | qureg
+
+
+def test_density_simulator_histogram(sim):
+    pytest.importorskip('matplotlib')
+    from projectq.libs.hist import histogram
+
+    eng = MainEngine(sim, engine_list=[])
+    qureg = eng.allocate_qureg(2)
+    X | qureg[1]
+    eng.flush()
+    _, _, probabilities = histogram(eng.backend, qureg)
+    assert probabilities['01'] == pytest.approx(1.0)
+    assert probabilities['10'] == pytest.approx(0.0)
+    All(Measure) | qureg
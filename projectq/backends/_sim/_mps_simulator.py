@@ -0,0 +1,272 @@
+# -*- coding: utf-8 -*-
+#   Copyright 2021 <Huawei Technologies Co., Ltd>
+#
+#   Licensed under the Apache License, Version 2.0 (the "License");
+#   you may not use this file except in compliance with the License.
+#   You may obtain a copy of the License at
+#
+#       http://www.apache.org/licenses/LICENSE-2.0
+#
+#   Unless required by applicable law or agreed to in writing, software
+#   distributed under the License is distributed on an "AS IS" BASIS,
+#   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+#   See the License for the specific language governing permissions and
+#   limitations under the License.
+
+"""
+Contains a compiler engine which simulates low-entanglement circuits using matrix product states.
+
+The C++ implementation uses LAPACK for the singular value decompositions if it was found at compile time. If it is not
+available, a (slow) Python implementation is used instead.
+"""
+
+# pylint: disable=no-name-in-module
+
+import random
+
+from projectq.cengines import BasicEngine
+from projectq.meta import LogicalQubitIDTag, get_control_count, has_negative_control
+from projectq.ops import Allocate, Deallocate, FlushGate, Measure
+from projectq.types import WeakQubitRef
+
+try:
+    from ._cppsim import MPSSimulator as MPSSimulatorBackend
+except ImportError:  # pragma: no cover
+    from ._pymps import MPSSimulator as MPSSimulatorBackend
+
+
+class MPSSimulator(BasicEngine):
+    """
+    Compiler engine simulating a quantum computer using a matrix product state (MPS).
+
+    The memory and time requirements grow with the bond dimension (i.e. with the entanglement between the two halves of
+    the qubit chain) rather than exponentially with the number of qubits, so that shallow or nearest-neighbour circuits
+    on a hundred qubits or more can be simulated. The bond dimension can be capped, in which case the state is
+    approximated and the discarded weight is reported by get_truncation_error().
+
+    Only gates acting on at most two qubits (including the control qubits) are supported; gates acting on qubits which
+    are not neighbours in the chain are applied by swapping the qubits next to each other first.
+    """
+
+    def __init__(self, max_bond_dimension=None, truncation_threshold=0.0, rnd_seed=None):
+        """
+        Construct the MPS simulator and initialize it with a random seed.
+
+        Args:
+            max_bond_dimension (int): Maximal bond dimension kept by the truncations (None for no limit, i.e. exact
+                simulation).
+            truncation_threshold (float): Maximal weight (sum of the squared singular values, relative to the norm of
+                the state) discarded by each truncation.
+            rnd_seed (int): Random seed (uses random.randint(0, 4294967295) by default).
+        """
+        if rnd_seed is None:
+            rnd_seed = random.randint(0, 4294967295)
+        if max_bond_dimension is None:
+            max_bond_dimension = 0
+        elif max_bond_dimension < 1:
+            raise ValueError("MPSSimulator: the maximal bond dimension must be at least 1.")
+        super().__init__()
+        self._simulator = MPSSimulatorBackend(rnd_seed, max_bond_dimension, truncation_threshold)
+
+    def is_available(self, cmd):
+        """
+        Test whether a Command is supported by a compiler engine.
+
+        Specialized implementation of is_available: The MPS simulator can deal with all gates which provide a
+        gate-matrix (via gate.matrix) and act on at most two qubits (including the control qubits).
+
+        Args:
+            cmd (Command): Command for which to check availability
+
+        Returns:
+            True if it can be simulated and False otherwise.
+        """
+        if has_negative_control(cmd):
+            return False
+
+        if cmd.gate == Measure or cmd.gate == Allocate or cmd.gate == Deallocate:
+            return True
+
+        if cmd.gate.is_parametric():
+            return False
+
+        try:
+            num_targets = sum(len(qureg) for qureg in cmd.qubits)
+            return cmd.gate.matrix.shape[0] == 2 ** num_targets and num_targets + get_control_count(cmd) <= 2
+        except AttributeError:
+            return False
+
+    def _convert_logical_to_mapped_qureg(self, qureg):
+        """
+        Convert a qureg from logical to mapped qubits if there is a mapper.
+
+        Args:
+            qureg (list[Qubit],Qureg): Logical quantum bits
+        """
+        mapper = self.main_engine.mapper
+        if mapper is not None:
+            mapped_qureg = []
+            for qubit in qureg:
+                if qubit.id not in mapper.current_mapping:
+                    raise RuntimeError("Unknown qubit id. Please make sure you have called eng.flush().")
+                new_qubit = WeakQubitRef(qubit.engine, mapper.current_mapping[qubit.id])
+                mapped_qureg.append(new_qubit)
+            return mapped_qureg
+        return qureg
+
+    def get_expectation_value(self, qubit_operator, qureg):
+        """
+        Return the expectation value of a qubit operator.
+
+        Args:
+            qubit_operator (projectq.ops.QubitOperator): Operator to measure.
+            qureg (list[Qubit],Qureg): Quantum bits to measure.
+
+        Returns:
+            Expectation value
+
+        Note:
+            If there is a mapper present in the compiler, this function automatically converts from logical qubits to
+            mapped qubits for the qureg argument.
+
+        Raises:
+            Exception: If `qubit_operator` acts on more qubits than present in the `qureg` argument.
+        """
+        qureg = self._convert_logical_to_mapped_qureg(qureg)
+        num_qubits = len(qureg)
+        for term, _ in qubit_operator.terms.items():
+            if not term == () and term[-1][0] >= num_qubits:
+                raise Exception("qubit_operator acts on more qubits than contained in the qureg.")
+        operator = [(list(term), coeff) for (term, coeff) in qubit_operator.terms.items()]
+        return self._simulator.get_expectation_value(operator, [qb.id for qb in qureg])
+
+    def get_probability(self, bit_string, qureg):
+        """
+        Return the probability of the outcome `bit_string` when measuring the quantum register `qureg`.
+
+        Args:
+            bit_string (list[bool|int]|string[0|1]): Measurement outcome.
+            qureg (Qureg|list[Qubit]): Quantum register.
+
+        Returns:
+            Probability of measuring the provided bit string.
+
+        Note:
+            If there is a mapper present in the compiler, this function automatically converts from logical qubits to
+            mapped qubits for the qureg argument.
+        """
+        qureg = self._convert_logical_to_mapped_qureg(qureg)
+        bit_string = [bool(int(b)) for b in bit_string]
+        return self._simulator.get_probability(bit_string, [qb.id for qb in qureg])
+
+    def get_amplitude(self, bit_string, qureg):
+        """
+        Return the probability amplitude of the supplied `bit_string`.
+
+        The ordering is given by the quantum register `qureg`, which must contain all allocated qubits.
+
+        Args:
+            bit_string (list[bool|int]|string[0|1]): Computational basis state
+            qureg (Qureg|list[Qubit]): Quantum register determining the ordering. Must contain all allocated qubits.
+
+        Returns:
+            Probability amplitude of the provided bit string.
+
+        Note:
+            If there is a mapper present in the compiler, this function automatically converts from logical qubits to
+            mapped qubits for the qureg argument.
+        """
+        qureg = self._convert_logical_to_mapped_qureg(qureg)
+        bit_string = [bool(int(b)) for b in bit_string]
+        return self._simulator.get_amplitude(bit_string, [qb.id for qb in qureg])
+
+    def get_bond_dimensions(self):
+        """
+        Return the bond dimensions of the matrix product state.
+
+        Returns:
+            List of the bond dimensions between neighbouring locations of the qubit chain (see cheat()).
+        """
+        return list(self._simulator.get_bond_dimensions())
+
+    def get_truncation_error(self):
+        """
+        Return the total weight discarded by the truncations.
+
+        The fidelity of the simulated state with the exact state is approximately 1 - get_truncation_error() as long as
+        the error is small. The error is 0 for an exact simulation (no bond dimension limit and no threshold).
+        """
+        return self._simulator.get_truncation_error()
+
+    def cheat(self):
+        """
+        Access the ordering of the qubits and the (dense) wavefunction.
+
+        Returns:
+            A tuple where the first entry is a dictionary mapping qubit indices to bit-locations and the second entry is
+            the corresponding state vector (bit p of the index is the qubit at location p). Only use this for small
+            numbers of qubits!
+
+        Note:
+            If there is a mapper present in the compiler, this function DOES NOT automatically convert from logical
+            qubits to mapped qubits.
+        """
+        return self._simulator.cheat()
+
+    def _handle(self, cmd):
+        """
+        Handle all commands.
+
+        Args:
+            cmd (Command): Command to handle.
+
+        Raises:
+            Exception: If a gate acting on more than two qubits needs to be processed (which should never happen due to
+                is_available).
+        """
+        if cmd.gate == Measure:
+            if get_control_count(cmd) != 0:
+                raise ValueError('Cannot have control qubits with a measurement gate!')
+            ids = [qb.id for qr in cmd.qubits for qb in qr]
+            out = self._simulator.measure_qubits(ids)
+            i = 0
+            for qureg in cmd.qubits:
+                for qb in qureg:
+                    # Check if a mapper assigned a different logical id
+                    for tag in cmd.tags:
+                        if isinstance(tag, LogicalQubitIDTag):
+                            qb = WeakQubitRef(qb.engine, tag.logical_qubit_id)
+                    self.main_engine.set_measurement_result(qb, out[i])
+                    i += 1
+        elif cmd.gate == Allocate:
+            self._simulator.allocate_qubit(cmd.qubits[0][0].id)
+        elif cmd.gate == Deallocate:
+            self._simulator.deallocate_qubit(cmd.qubits[0][0].id)
+        else:
+            ids = [qb.id for qureg in cmd.qubits for qb in qureg]
+            ctrlids = [qb.id for qb in cmd.control_qubits]
+            matrix = cmd.gate.matrix
+            if len(ids) + len(ctrlids) > 2 or not 2 ** len(ids) == len(matrix):
+                raise Exception(
+                    "MPSSimulator only supports gates acting on at most two qubits (including the control qubits)!\n"
+                    "Please add an auto-replacer engine to your list of compiler engines."
+                )
+            self._simulator.apply_controlled_gate(
+                [item for sublist in matrix.tolist() for item in sublist], ids, ctrlids
+            )
+
+    def receive(self, command_list):
+        """
+        Receive a list of commands.
+
+        Receive a list of commands from the previous engine and handle them (simulate them classically) prior to
+        sending them on to the next engine.
+
+        Args:
+            command_list (list<Command>): List of commands to execute on the simulator.
+        """
+        for cmd in command_list:
+            if not cmd.gate == FlushGate():
+                self._handle(cmd)
+            if not self.is_last_engine:
+                self.send([cmd])
@@ -0,0 +1,288 @@
+# -*- coding: utf-8 -*-
+#   Copyright 2021 <Huawei Technologies Co., Ltd>
+#
+#   Licensed under the Apache License, Version 2.0 (the "License");
+#   you may not use this file except in compliance with the License.
+#   You may obtain a copy of the License at
+#
+#       http://www.apache.org/licenses/LICENSE-2.0
+#
+#   Unless required by applicable law or agreed to in writing, software
+#   distributed under the License is distributed on an "AS IS" BASIS,
+#   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+#   See the License for the specific language governing permissions and
+#   limitations under the License.
+"""
+Tests for projectq.backends._sim._mps_simulator.py, using both the Python and the C++ implementations.
+"""
+
+import math
+import random
+
+import numpy as np
+import pytest
+
+from projectq import MainEngine
+from projectq.backends import MPSSimulator, Simulator
+from projectq.cengines import BasicMapperEngine, DummyEngine
+from projectq.meta import Control
+from projectq.ops import (
+    CNOT,
+    All,
+    BasicGate,
+    H,
+    Measure,
+    QubitOperator,
+    Rx,
+    Ry,
+    Rz,
+    Swap,
+    T,
+    Toffoli,
+    X,
+)
+
+
+def get_available_simulators():
+    result = ["py_simulator"]
+    try:
+        from projectq.backends._sim._cppsim import (  # noqa: F401
+            MPSSimulator as CppMPSSim,
+        )
+
+        result.append("cpp_simulator")
+    except ImportError:
+        # The C++ simulator was either not installed or is misconfigured. Skip.
+        pass
+    return result
+
+
+def make_sim(kind, max_bond_dimension=None, truncation_threshold=0.0):
+    sim = MPSSimulator(max_bond_dimension, truncation_threshold)
+    if kind == "py_simulator":
+        from projectq.backends._sim._pymps import MPSSimulator as PyMPSSim
+
+        sim._simulator = PyMPSSim(1, max_bond_dimension or 0, truncation_threshold)
+    else:
+        from projectq.backends._sim._cppsim import MPSSimulator as CppMPSSim
+
+        sim._simulator = CppMPSSim(1, max_bond_dimension or 0, truncation_threshold)
+    return sim
+
+
+@pytest.fixture(params=get_available_simulators())
+def sim_kind(request):
+    return request.param
+
+
+@pytest.fixture
+def sim(sim_kind):
+    return make_sim(sim_kind)
+
+
+@pytest.fixture(params=["mapper", "no_mapper"])
+def mapper(request):
+    """
+    Adds a mapper which changes qubit ids by adding 1
+    """
+    if request.param == "mapper":
+
+        class TrivialMapper(BasicMapperEngine):
+            def __init__(self):
+                super().__init__()
+                self.current_mapping = {}
+
+            def receive(self, command_list):
+                for cmd in command_list:
+                    for qureg in cmd.all_qubits:
+                        for qubit in qureg:
+                            if qubit.id == -1:
+                                continue
+                            elif qubit.id not in self.current_mapping:
+                                previous_map = self.current_mapping
+                                previous_map[qubit.id] = qubit.id + 1
+                                self.current_mapping = previous_map
+                    self._send_cmd_with_mapped_ids(cmd)
+
+        return TrivialMapper()
+    if request.param == "no_mapper":
+        return None
+
+
+class RandomGate(BasicGate):
+    def __init__(self, num_qubits, rng):
+        super().__init__()
+        dim = 2 ** num_qubits
+        matrix = np.array([[rng.gauss(0, 1) + 1j * rng.gauss(0, 1) for _ in range(dim)] for _ in range(dim)])
+        self._matrix = np.linalg.qr(matrix)[0]
+
+    @property
+    def matrix(self):
+        return self._matrix
+
+
+def test_mps_simulator_is_available(sim):
+    backend = DummyEngine(save_commands=True)
+    eng = MainEngine(backend, [])
+    qureg = eng.allocate_qureg(3)
+    H | qureg[0]
+    Measure | qureg[0]
+    CNOT | (qureg[0], qureg[1])
+    Swap | (qureg[0], qureg[1])
+    Rx(0.3) | qureg[0]
+    Toffoli | (qureg[0], qureg[1], qureg[2])
+    with Control(eng, qureg[0]):
+        Swap | (qureg[1], qureg[2])
+    eng.flush()
+    cmds = backend.received_commands[3:-1]
+    assert [sim.is_available(cmd) for cmd in cmds] == [True] * 5 + [False] * 2
+
+
+def test_mps_simulator_invalid_bond_dimension():
+    with pytest.raises(ValueError):
+        MPSSimulator(max_bond_dimension=0)
+
+
+@pytest.mark.parametrize("seed", range(6))
+def test_mps_simulator_random_circuit(sim, mapper, seed):
+    """Compare random circuits (including gates on non-neighbouring qubits) with the state vector simulator."""
+    engine_list = [] if mapper is None else [mapper]
+    eng = MainEngine(sim, engine_list=engine_list)
+    ref_eng = MainEngine(Simulator(), engine_list=[])
+    num_qubits = 5
+    qureg = eng.allocate_qureg(num_qubits)
+    ref_qureg = ref_eng.allocate_qureg(num_qubits)
+
+    rng = random.Random(seed)
+    for _ in range(25):
+        kind = rng.choice(['single', 'two', 'cnot', 'controlled'])
+        if kind == 'single':
+            gate, qubits = RandomGate(1, rng), rng.sample(range(num_qubits), 1)
+        elif kind == 'two':
+            gate, qubits = RandomGate(2, rng), rng.sample(range(num_qubits), 2)
+        elif kind == 'cnot':
+            gate, qubits = CNOT, rng.sample(range(num_qubits), 2)
+        else:
+            gate, qubits = None, rng.sample(range(num_qubits), 2)
+        for engine, qubits_of in ((eng, qureg), (ref_eng, ref_qureg)):
+            if gate is None:
+                with Control(engine, qubits_of[qubits[0]]):
+                    Ry(0.1 + seed) | qubits_of[qubits[1]]
+            else:
+                gate | tuple(qubits_of[i] for i in qubits)
+    eng.flush()
+    ref_eng.flush()
+
+    bits = [rng.randint(0, 1) for _ in range(num_qubits)]
+    assert eng.backend.get_amplitude(bits, qureg) == pytest.approx(ref_eng.backend.get_amplitude(bits, ref_qureg))
+    assert eng.backend.get_probability(bits[:3], qureg[1:4]) == pytest.approx(
+        ref_eng.backend.get_probability(bits[:3], ref_qureg[1:4])
+    )
+    op = QubitOperator('X0 Z2 Y4', 0.5) + QubitOperator('Z1 X3', -0.25) + QubitOperator('', 0.1)
+    assert eng.backend.get_expectation_value(op, qureg) == pytest.approx(
+        ref_eng.backend.get_expectation_value(op, ref_qureg)
+    )
+    assert eng.backend.get_truncation_error() == pytest.approx(0.0, abs=1e-12)
+
+    All(Measure) | qureg
+    eng.flush()
+    assert ref_eng.backend.get_probability([int(qb) for qb in qureg], ref_qureg) > 1e-8
+    All(Measure) | ref_qureg
+
+
+def test_mps_simulator_cheat(sim):
+    eng = MainEngine(sim, engine_list=[])
+    qureg = eng.allocate_qureg(3)
+    X | qureg[0]
+    H | qureg[2]
+    eng.flush()
+    mapping, wavefunction = eng.backend.cheat()
+    assert sorted(mapping) == [qb.id for qb in qureg]
+    expected = np.zeros(8)
+    for bit2 in (0, 1):
+        expected[(1 << mapping[qureg[0].id]) | (bit2 << mapping[qureg[2].id])] = 1 / math.sqrt(2)
+    assert np.allclose(np.asarray(wavefunction), expected)
+    All(Measure) | qureg
+
+
+def test_mps_simulator_ghz(sim):
+    eng = MainEngine(sim, engine_list=[])
+    num_qubits = 60
+    qureg = eng.allocate_qureg(num_qubits)
+    H | qureg[0]
+    for i in range(1, num_qubits):
+        CNOT | (qureg[i - 1], qureg[i])
+    Rz(0.3) | qureg[7]
+    T | qureg[30]
+    eng.flush()
+
+    assert max(eng.backend.get_bond_dimensions()) == 2
+    assert eng.backend.get_probability('0' * num_qubits, qureg) == pytest.approx(0.5)
+    assert eng.backend.get_probability('01', qureg[3:5]) == pytest.approx(0.0)
+    assert eng.backend.get_expectation_value(QubitOperator('Z3 Z50'), qureg) == pytest.approx(1.0)
+    assert abs(eng.backend.get_amplitude('1' * num_qubits, qureg)) == pytest.approx(1 / math.sqrt(2))
+
+    # Long-range gate: the qubit order is restored afterwards
+    CNOT | (qureg[0], qureg[num_qubits - 1])
+    eng.flush()
+    assert eng.backend.get_probability('00', [qureg[0], qureg[num_qubits - 1]]) == pytest.approx(0.5)
+    assert eng.backend.get_probability('10', [qureg[0], qureg[num_qubits - 1]]) == pytest.approx(0.5)
+
+    All(Measure) | qureg
+    eng.flush()
+    outcomes = [int(qb) for qb in qureg]
+    assert len(set(outcomes[:-1])) == 1 and outcomes[-1] == 0
+
+
+def test_mps_simulator_truncation(sim_kind):
+    exact = make_sim(sim_kind)
+    truncated = make_sim(sim_kind, max_bond_dimension=1)
+    results = []
+    for sim in (exact, truncated):
+        eng = MainEngine(sim, engine_list=[])
+        qureg = eng.allocate_qureg(2)
+        Ry(0.4) | qureg[0]
+        CNOT | (qureg[0], qureg[1])
+        eng.flush()
+        results.append((sim.get_bond_dimensions(), sim.get_truncation_error()))
+        All(Measure) | qureg
+        eng.flush()
+    assert results[0] == ([2], pytest.approx(0.0, abs=1e-12))
+    # The discarded weight is the smaller Schmidt coefficient squared: sin(0.2)^2
+    assert results[1] == ([1], pytest.approx(math.sin(0.2) ** 2))
+
+
+def test_mps_simulator_deallocate(sim):
+    eng = MainEngine(sim, engine_list=[])
+    qubit = eng.allocate_qubit()
+    qureg = eng.allocate_qureg(2)
+    X | qubit
+    H | qureg[0]
+    CNOT | (qureg[0], qureg[1])
+    CNOT | (qubit, qureg[1])
+    eng.flush()
+    qubit_id = qubit[0].id
+    del qubit
+    eng.flush()
+    mapping, wavefunction = eng.backend.cheat()
+    assert qubit_id not in mapping
+    assert len(wavefunction) == 4
+    assert eng.backend.get_probability('01', qureg) == pytest.approx(0.5)
+
+    with pytest.raises(RuntimeError):
+        eng.backend._simulator.deallocate_qubit(qureg[0].id)
+    All(Measure) | qureg
+
+
+def test_mps_simulator_errors(sim):
+    eng = MainEngine(sim, engine_list=[])
+    qureg = eng.allocate_qureg(3)
+    eng.flush()
+    with pytest.raises(Exception):
+        Toffoli | (qureg[0], qureg[1], qureg[2])
+        eng.flush()
+    with pytest.raises(Exception):
+        eng.backend.get_expectation_value(QubitOperator('Z3'), qureg)
+    with pytest.raises(Exception):
+        eng.backend.get_amplitude('01', qureg[:2])
+    All(Measure) | qureg
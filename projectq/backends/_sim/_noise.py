@@ -0,0 +1,204 @@
+# -*- coding: utf-8 -*-
+#   Copyright 2021 <Huawei Technologies Co., Ltd>
+#
+#   Licensed under the Apache License, Version 2.0 (the "License");
+#   you may not use this file except in compliance with the License.
+#   You may obtain a copy of the License at
+#
+#       http://www.apache.org/licenses/LICENSE-2.0
+#
+#   Unless required by applicable law or agreed to in writing, software
+#   distributed under the License is distributed on an "AS IS" BASIS,
+#   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+#   See the License for the specific language governing permissions and
+#   limitations under the License.
+
+"""
+Noise models for the Simulator.
+
+Noise is simulated using quantum trajectories: each time a channel is applied, one of its Kraus operators is sampled
+according to its probability on the current state and applied to the state vector. Averaging the results of many runs
+(see run_trajectories) then reproduces the statistics of the noisy (mixed state) evolution.
+"""
+
+import functools
+import itertools
+import math
+
+import numpy as np
+
+from projectq.cengines import MainEngine
+
+from ._simulator import Simulator
+
+_PAULI_MATRICES = (
+    np.array([[1, 0], [0, 1]], dtype=complex),
+    np.array([[0, 1], [1, 0]], dtype=complex),
+    np.array([[0, -1j], [1j, 0]], dtype=complex),
+    np.array([[1, 0], [0, -1]], dtype=complex),
+)
+
+
+class KrausChannel:
+    """Quantum channel given by a list of Kraus operators."""
+
+    def __init__(self, kraus_operators):
+        """
+        Initialize a KrausChannel object.
+
+        Args:
+            kraus_operators (list[numpy.ndarray]): 2^k x 2^k Kraus operators K_i acting on k qubits, which must
+                satisfy sum_i K_i^dagger K_i = 1. The qubit ordering is the same as for gate matrices.
+
+        Raises:
+            ValueError: If the operators do not all have the same (valid) size or do not form a valid channel.
+        """
+        operators = [np.array(op, dtype=complex) for op in kraus_operators]
+        if not operators:
+            raise ValueError('At least one Kraus operator is required!')
+        dim = operators[0].shape[0]
+        num_qubits = int(round(math.log2(dim))) if dim > 0 else -1
+        if num_qubits < 1 or 2 ** num_qubits != dim or any(op.shape != (dim, dim) for op in operators):
+            raise ValueError('Kraus operators must all be 2^k x 2^k matrices!')
+        if not np.allclose(sum(op.conj().T @ op for op in operators), np.eye(dim)):
+            raise ValueError('Kraus operators do not preserve the trace (sum_i K_i^dagger K_i != 1)!')
+        self.kraus_operators = operators
+        self.num_qubits = num_qubits
+
+    def __str__(self):
+        """Return a short string representation of the channel."""
+        return '{}({} operators)'.format(self.__class__.__name__, len(self.kraus_operators))
+
+
+class DepolarizingChannel(KrausChannel):
+    """
+    Depolarizing channel on one or more qubits.
+
+    With probability p, one of the 4^k - 1 non-trivial Pauli strings (chosen uniformly) is applied to the qubits.
+    """
+
+    def __init__(self, probability, num_qubits=1):
+        """
+        Initialize a DepolarizingChannel object.
+
+        Args:
+            probability (float): Error probability p.
+            num_qubits (int): Number of qubits the channel acts on.
+        """
+        if not 0 <= probability <= 1:
+            raise ValueError('The error probability must be in [0, 1]!')
+        num_errors = 4 ** num_qubits - 1
+        operators = []
+        for paulis in itertools.product(_PAULI_MATRICES, repeat=num_qubits):
+            # Last factor of the Kronecker product acts on the first qubit
+            pauli = functools.reduce(np.kron, reversed(paulis))
+            is_identity = all(p is _PAULI_MATRICES[0] for p in paulis)
+            weight = 1 - probability if is_identity else probability / num_errors
+            operators.append(math.sqrt(weight) * pauli)
+        super().__init__(operators)
+        self.probability = probability
+
+
+class AmplitudeDampingChannel(KrausChannel):
+    """Amplitude damping channel (energy relaxation from |1> to |0> with probability gamma)."""
+
+    def __init__(self, gamma):
+        """
+        Initialize an AmplitudeDampingChannel object.
+
+        Args:
+            gamma (float): Decay probability.
+        """
+        if not 0 <= gamma <= 1:
+            raise ValueError('The decay probability must be in [0, 1]!')
+        super().__init__([np.array([[1, 0], [0, math.sqrt(1 - gamma)]]), np.array([[0, math.sqrt(gamma)], [0, 0]])])
+        self.gamma = gamma
+
+
+class NoiseModel:
+    """
+    Collection of noise channels attached to gate types and/or qubits.
+
+    Example:
+        .. code-block:: python
+
+            noise = NoiseModel()
+            noise.add_gate_noise(CNOT, DepolarizingChannel(0.01, num_qubits=2))
+            noise.add_gate_noise(H, DepolarizingChannel(0.001))
+            noise.add_qubit_noise(AmplitudeDampingChannel(0.002))
+            eng = MainEngine(Simulator(noise_model=noise))
+    """
+
+    def __init__(self):
+        """Initialize an empty NoiseModel object."""
+        self.gate_noise = []
+        self.qubit_noise = []
+
+    def add_gate_noise(self, gate, channel):
+        """
+        Apply a channel after every occurrence of a gate.
+
+        Args:
+            gate (BasicGate|type): Either a gate instance (compared using ==) or a gate class (matched using
+                isinstance). Controlled gates such as CNOT match the commands with the corresponding number of control
+                qubits and the channel then acts on the control qubits followed by the target qubits.
+            channel (KrausChannel): Channel applied after the gate. Single-qubit channels are applied to each of the
+                qubits, otherwise the channel must act on as many qubits as the gate.
+        """
+        self.gate_noise.append((gate, channel))
+
+    def add_qubit_noise(self, channel, qubit_ids=None):
+        """
+        Apply a single-qubit channel to a qubit after every gate acting on it (either as target or as control).
+
+        Args:
+            channel (KrausChannel): Single-qubit channel.
+            qubit_ids (list[int]): IDs of the qubits subject to the noise (all qubits if None).
+        """
+        if channel.num_qubits != 1:
+            raise ValueError('Qubit noise requires single-qubit channels!')
+        self.qubit_noise.append((None if qubit_ids is None else set(qubit_ids), channel))
+
+    def get_gate_channels(self, gate):
+        """Return the channels to apply after a gate."""
+        channels = []
+        for noisy_gate, channel in self.gate_noise:
+            if (isinstance(noisy_gate, type) and isinstance(gate, noisy_gate)) or (
+                not isinstance(noisy_gate, type) and gate == noisy_gate
+            ):
+                channels.append(channel)
+        return channels
+
+    def get_qubit_channels(self, qubit_id):
+        """Return the channels to apply after every gate acting on a qubit."""
+        return [channel for qubit_ids, channel in self.qubit_noise if qubit_ids is None or qubit_id in qubit_ids]
+
+
+def run_trajectories(circuit, num_trajectories, noise_model=None, engine_list=None, **kwargs):
+    """
+    Run a noisy circuit several times (quantum trajectories) and collect the results.
+
+    All the trajectories are simulated by the same Simulator, so that the noise channels are only set up once and the
+    memory of the state vector is recycled from one trajectory to the next.
+
+    Args:
+        circuit (callable): Function called with the MainEngine as only argument for each trajectory. All the qubits it
+            allocates must be measured (or uncomputed) before it returns, as usual.
+        num_trajectories (int): Number of trajectories.
+        noise_model (NoiseModel): Noise model of the simulator.
+        engine_list (list[BasicEngine]): Compiler engines (the default setup is used if None).
+        kwargs: Additional arguments for the Simulator (e.g. rnd_seed or gate_fusion).
+
+    Returns:
+        List of the values returned by circuit for each trajectory.
+    """
+    backend = Simulator(noise_model=noise_model, **kwargs)
+    if engine_list is None:
+        eng = MainEngine(backend)
+    else:
+        eng = MainEngine(backend, engine_list=engine_list)
+    results = []
+    for _ in range(num_trajectories):
+        results.append(circuit(eng))
+        eng.flush()
+    return results
@@ -0,0 +1,214 @@
+# -*- coding: utf-8 -*-
+#   Copyright 2021 <Huawei Technologies Co., Ltd>
+#
+#   Licensed under the Apache License, Version 2.0 (the "License");
+#   you may not use this file except in compliance with the License.
+#   You may obtain a copy of the License at
+#
+#       http://www.apache.org/licenses/LICENSE-2.0
+#
+#   Unless required by applicable law or agreed to in writing, software
+#   distributed under the License is distributed on an "AS IS" BASIS,
+#   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+#   See the License for the specific language governing permissions and
+#   limitations under the License.
+"""Tests for projectq.backends._sim._noise.py."""
+
+import numpy
+import pytest
+
+from projectq import MainEngine
+from projectq.backends import (
+    AmplitudeDampingChannel,
+    DepolarizingChannel,
+    KrausChannel,
+    NoiseModel,
+    Simulator,
+    run_trajectories,
+)
+from projectq.ops import CNOT, All, H, Measure, QubitOperator, X, XGate
+
+
+def get_available_simulators():
+    result = ["py_simulator"]
+    try:
+        import projectq.backends._sim._cppsim  # noqa: F401
+
+        result.append("cpp_simulator")
+    except ImportError:
+        # The C++ simulator was either not installed or is misconfigured. Skip.
+        pass
+    return result
+
+
+def make_simulator(kind, noise_model, rnd_seed=42):
+    sim = Simulator(rnd_seed=rnd_seed, noise_model=noise_model)
+    if kind == "py_simulator":
+        from projectq.backends._sim._pysim import Simulator as PySim
+
+        sim._simulator = PySim(rnd_seed)
+        sim._channel_handles = {}
+        for _, channel in noise_model.gate_noise + noise_model.qubit_noise:
+            if id(channel) not in sim._channel_handles:
+                sim._channel_handles[id(channel)] = sim._simulator.add_channel(
+                    [[item for row in op.tolist() for item in row] for op in channel.kraus_operators]
+                )
+    return sim
+
+
+def test_kraus_channel_validation():
+    with pytest.raises(ValueError):
+        KrausChannel([])
+    with pytest.raises(ValueError):
+        KrausChannel([numpy.eye(3)])
+    with pytest.raises(ValueError):
+        KrausChannel([numpy.eye(2), numpy.eye(4)])
+    with pytest.raises(ValueError):
+        KrausChannel([numpy.eye(2), numpy.eye(2)])
+    with pytest.raises(ValueError):
+        DepolarizingChannel(1.5)
+    with pytest.raises(ValueError):
+        AmplitudeDampingChannel(-0.1)
+    with pytest.raises(ValueError):
+        NoiseModel().add_qubit_noise(DepolarizingChannel(0.1, num_qubits=2))
+
+    channel = DepolarizingChannel(0.3, num_qubits=2)
+    assert channel.num_qubits == 2
+    assert len(channel.kraus_operators) == 16
+    assert 'DepolarizingChannel' in str(channel)
+
+
+def test_noise_model_gate_matching():
+    depolarizing = DepolarizingChannel(0.1)
+    damping = AmplitudeDampingChannel(0.1)
+    noise = NoiseModel()
+    noise.add_gate_noise(XGate, depolarizing)
+    noise.add_gate_noise(H, damping)
+    noise.add_qubit_noise(damping, qubit_ids=[3])
+    assert noise.get_gate_channels(X) == [depolarizing]
+    assert noise.get_gate_channels(H) == [damping]
+    assert noise.get_gate_channels(CNOT) == []
+    assert noise.get_qubit_channels(3) == [damping]
+    assert noise.get_qubit_channels(2) == []
+
+
+@pytest.mark.parametrize("kind", get_available_simulators())
+def test_noise_amplitude_damping(kind):
+    gamma = 0.3
+    noise = NoiseModel()
+    noise.add_gate_noise(XGate, AmplitudeDampingChannel(gamma))
+    eng = MainEngine(make_simulator(kind, noise), engine_list=[])
+    num_ones = 0
+    num_trajectories = 400
+    for _ in range(num_trajectories):
+        qubit = eng.allocate_qubit()
+        X | qubit
+        Measure | qubit
+        eng.flush()
+        num_ones += int(qubit)
+        del qubit
+    assert num_ones / num_trajectories == pytest.approx(1 - gamma, abs=0.08)
+
+
+@pytest.mark.parametrize("kind", get_available_simulators())
+def test_noise_depolarizing_two_qubits(kind):
+    noise = NoiseModel()
+    noise.add_gate_noise(CNOT, DepolarizingChannel(1.0, num_qubits=2))
+    eng = MainEngine(make_simulator(kind, noise), engine_list=[])
+    outcomes = set()
+    for _ in range(100):
+        qureg = eng.allocate_qureg(2)
+        CNOT | (qureg[0], qureg[1])
+        All(Measure) | qureg
+        eng.flush()
+        outcomes.add((int(qureg[0]), int(qureg[1])))
+        del qureg
+    # Any non-trivial Pauli string is applied after the CNOT
+    assert outcomes == {(0, 0), (0, 1), (1, 0), (1, 1)}
+
+
+@pytest.mark.parametrize("kind", get_available_simulators())
+def test_noise_qubit_noise(kind):
+    noise = NoiseModel()
+    # Full decay after every gate acting on qubit 1 (either as target or control)
+    noise.add_qubit_noise(AmplitudeDampingChannel(1.0), qubit_ids=[1])
+    eng = MainEngine(make_simulator(kind, noise), engine_list=[])
+    qureg = eng.allocate_qureg(3)
+    X | qureg[0]
+    X | qureg[1]
+    X | qureg[2]
+    eng.flush()
+    assert eng.backend.get_probability('101', qureg) == pytest.approx(1.0)
+    CNOT | (qureg[0], qureg[1])
+    eng.flush()
+    assert eng.backend.get_probability('101', qureg) == pytest.approx(1.0)
+    All(Measure) | qureg
+
+
+@pytest.mark.parametrize("kind", get_available_simulators())
+def test_noise_exact_expectation_values(kind):
+    noise = NoiseModel()
+    noise.add_qubit_noise(AmplitudeDampingChannel(1.0), qubit_ids=[0, 1])
+    eng = MainEngine(make_simulator(kind, noise), engine_list=[])
+    qureg = eng.allocate_qureg(2)
+    eng.flush()
+    eng.backend.set_wavefunction([0, 0, 0, 1], qureg)
+    # The operators of expectation values and qubit operators are applied without noise
+    for _ in range(3):
+        assert eng.backend.get_expectation_value(QubitOperator('Z0 Z1') + QubitOperator('X0'), qureg) == pytest.approx(
+            1.0
+        )
+    eng.backend.apply_qubit_operator(QubitOperator('X0 X1'), qureg)
+    assert eng.backend.get_probability('00', qureg) == pytest.approx(1.0)
+    All(Measure) | qureg
+
+
+def test_noise_zero_probability_operators(monkeypatch):
+    from projectq.backends._sim import _pysim
+
+    # Even if the random number exceeds the sum of the probabilities, an operator with probability 0 is never picked
+    monkeypatch.setattr(_pysim.random, 'random', lambda: 1.0)
+    channel = KrausChannel([numpy.eye(2) / numpy.sqrt(2), numpy.eye(2) / numpy.sqrt(2), numpy.zeros((2, 2))])
+    noise = NoiseModel()
+    noise.add_gate_noise(XGate, channel)
+    eng = MainEngine(make_simulator("py_simulator", noise), engine_list=[])
+    qubit = eng.allocate_qubit()
+    X | qubit
+    eng.flush()
+    assert numpy.allclose(eng.backend.cheat()[1], [0, 1])
+    Measure | qubit
+
+
+@pytest.mark.parametrize("kind", get_available_simulators())
+def test_noise_invalid_channel_size(kind):
+    noise = NoiseModel()
+    noise.add_gate_noise(CNOT, DepolarizingChannel(0.1, num_qubits=3))
+    eng = MainEngine(make_simulator(kind, noise), engine_list=[])
+    qureg = eng.allocate_qureg(2)
+    with pytest.raises(ValueError):
+        CNOT | (qureg[0], qureg[1])
+        eng.flush()
+
+
+def test_noise_not_in_out_of_core_mode(tmp_path):
+    with pytest.raises((ValueError, RuntimeError)):
+        Simulator(storage_dir=tmp_path, noise_model=NoiseModel())
+
+
+def test_run_trajectories():
+    noise = NoiseModel()
+    noise.add_gate_noise(H, DepolarizingChannel(0.2))
+
+    def circuit(eng):
+        qureg = eng.allocate_qureg(2)
+        H | qureg[0]
+        CNOT | (qureg[0], qureg[1])
+        All(Measure) | qureg
+        eng.flush()
+        return [int(qb) for qb in qureg]
+
+    results = run_trajectories(circuit, 50, noise_model=noise, engine_list=[], rnd_seed=1)
+    assert len(results) == 50
+    # Pauli errors after H do not break the correlation introduced by the CNOT
+    assert all(result[0] == result[1] for result in results)
+    assert {result[0] for result in results} == {0, 1}
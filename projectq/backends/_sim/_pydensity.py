@@ -0,0 +1,292 @@
+# -*- coding: utf-8 -*-
+#   Copyright 2021 <Huawei Technologies Co., Ltd>
+#
+#   Licensed under the Apache License, Version 2.0 (the "License");
+#   you may not use this file except in compliance with the License.
+#   You may obtain a copy of the License at
+#
+#       http://www.apache.org/licenses/LICENSE-2.0
+#
+#   Unless required by applicable law or agreed to in writing, software
+#   distributed under the License is distributed on an "AS IS" BASIS,
+#   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+#   See the License for the specific language governing permissions and
+#   limitations under the License.
+
+"""
+A (slow) Python density matrix simulator.
+
+Please compile the c++ simulator for large-scale simulations.
+"""
+
+import random
+
+import numpy as _np
+
+
+class DensityMatrixSimulator:
+    """
+    Python implementation of a density matrix simulator.
+
+    Used as a backup if the c++ simulator is not available. The density matrix is stored as a 2^n x 2^n array where bit
+    p of the row/column index corresponds to the qubit at position p.
+    """
+
+    def __init__(self, rnd_seed, *args, **kwargs):  # pylint: disable=unused-argument
+        """
+        Initialize the simulator.
+
+        Args:
+            rnd_seed (int): Seed to initialize the random number generator.
+            args: Dummy argument to allow an interface identical to the c++ simulator.
+            kwargs: Same as args.
+        """
+        random.seed(rnd_seed)
+        self._rho = _np.ones((1, 1), dtype=_np.complex128)
+        self._map = {}
+        self._num_qubits = 0
+        print("(Note: This is the (slow) Python density matrix simulator.)")
+
+    def _check_ids(self, ids, function_name):
+        for qubit_id in ids:
+            if qubit_id not in self._map:
+                raise RuntimeError(
+                    "{}(): Unknown qubit id. Please make sure you have called eng.flush().".format(function_name)
+                )
+
+    def _diagonal(self):
+        return _np.real(_np.diagonal(self._rho))
+
+    def _mask_and_value(self, ids, values):
+        mask = 0
+        val = 0
+        for i, qubit_id in enumerate(ids):
+            pos = self._map[qubit_id]
+            mask |= 1 << pos
+            val |= int(values[i]) << pos
+        return mask, val
+
+    def _apply_to_rows(self, matrix, positions, rho):
+        """Multiply rho from the left by the k-qubit matrix acting on the qubits at `positions`."""
+        num_qubits = self._num_qubits
+        k = len(positions)
+        tensor = rho.reshape([2] * num_qubits + [-1])
+        axes = [num_qubits - 1 - pos for pos in reversed(positions)]
+        gate = _np.asarray(matrix).reshape([2] * (2 * k))
+        tensor = _np.tensordot(gate, tensor, axes=(list(range(k, 2 * k)), axes))
+        return _np.moveaxis(tensor, list(range(k)), axes).reshape(rho.shape)
+
+    def _project(self, mask, val, scale):
+        indices = _np.arange(len(self._rho))
+        keep = (indices & mask) == val
+        self._rho[~keep, :] = 0.0
+        self._rho[:, ~keep] = 0.0
+        self._rho *= scale
+
+    def allocate_qubit(self, qubit_id):
+        """
+        Allocate a qubit.
+
+        Args:
+            qubit_id (int): ID of the qubit which is being allocated.
+        """
+        if qubit_id in self._map:
+            raise RuntimeError("AllocateQubit: ID already exists. Qubit IDs should be unique.")
+        dim = len(self._rho)
+        rho = _np.zeros((2 * dim, 2 * dim), dtype=_np.complex128)
+        rho[:dim, :dim] = self._rho
+        self._rho = rho
+        self._map[qubit_id] = self._num_qubits
+        self._num_qubits += 1
+
+    def deallocate_qubit(self, qubit_id):
+        """
+        Deallocate a qubit by tracing it out.
+
+        Args:
+            qubit_id (int): ID of the qubit being deallocated.
+        """
+        if qubit_id not in self._map:
+            raise RuntimeError("DeallocateQubit: Qubit IDs is not known!")
+        num_qubits = self._num_qubits
+        pos = self._map.pop(qubit_id)
+        axis = num_qubits - 1 - pos
+        tensor = self._rho.reshape([2] * (2 * num_qubits))
+        dim = len(self._rho) // 2
+        self._rho = _np.trace(tensor, axis1=axis, axis2=num_qubits + axis).reshape(dim, dim)
+        for key, value in self._map.items():
+            if value > pos:
+                self._map[key] = value - 1
+        self._num_qubits -= 1
+
+    def measure_qubits(self, ids):
+        """
+        Measure the qubits with IDs ids and return a list of measurement outcomes (True/False).
+
+        Args:
+            ids (list<int>): List of qubit IDs to measure.
+
+        Returns:
+            List of measurement results (containing either True or False).
+        """
+        probabilities = self._diagonal()
+        random_outcome = random.random()
+        picked = min(int(_np.searchsorted(_np.cumsum(probabilities), random_outcome)), len(probabilities) - 1)
+        res = [bool((picked >> self._map[qubit_id]) & 1) for qubit_id in ids]
+        mask, val = self._mask_and_value(ids, res)
+        indices = _np.arange(len(probabilities))
+        self._project(mask, val, 1.0 / _np.sum(probabilities[(indices & mask) == val]))
+        return res
+
+    def apply_controlled_gate(self, matrix, ids, ctrlids):
+        """
+        Apply the k-qubit gate matrix m to the qubits with indices ids, using ctrlids as control qubits.
+
+        Args:
+            matrix (list[list]): 2^k x 2^k complex matrix describing the k-qubit gate.
+            ids (list): A list containing the qubit IDs to which to apply the gate.
+            ctrlids (list): A list of control qubit IDs (i.e., the gate is only applied where these qubits are 1).
+        """
+        dim = 1 << len(ids)
+        matrix = _np.array(matrix, dtype=_np.complex128).reshape(dim, dim)
+        if ctrlids:
+            # controls are the most significant bits of the extended matrix
+            full = _np.identity(dim << len(ctrlids), dtype=_np.complex128)
+            full[-dim:, -dim:] = matrix
+            matrix = full
+        positions = [self._map[qubit_id] for qubit_id in list(ids) + list(ctrlids)]
+        rho = self._apply_to_rows(matrix, positions, self._rho)
+        self._rho = self._apply_to_rows(matrix, positions, rho.conj().T).conj().T
+
+    def get_expectation_value(self, terms_dict, ids):
+        """
+        Return the expectation value of a qubit operator w.r.t. qubit ids.
+
+        Args:
+            terms_dict (dict): Operator dictionary (see QubitOperator.terms)
+            ids (list[int]): List of qubit ids upon which the operator acts.
+
+        Returns:
+            Expectation value
+        """
+        self._check_ids(ids, 'get_expectation_value')
+        paulis = {
+            'X': _np.array([[0.0, 1.0], [1.0, 0.0]]),
+            'Y': _np.array([[0.0, -1j], [1j, 0.0]]),
+            'Z': _np.array([[1.0, 0.0], [0.0, -1.0]]),
+        }
+        expectation = 0.0
+        for term, coefficient in terms_dict:
+            rho = self._rho
+            for local_op in term:
+                rho = self._apply_to_rows(paulis[local_op[1]], [self._map[ids[local_op[0]]]], rho)
+            expectation += coefficient * _np.real(_np.trace(rho))
+        return expectation
+
+    def get_probability(self, bit_string, ids):
+        """
+        Return the probability of the outcome `bit_string` when measuring the qubits given by the list of ids.
+
+        Args:
+            bit_string (list[bool|int]): Measurement outcome.
+            ids (list[int]): List of qubit ids determining the ordering.
+
+        Returns:
+            Probability of measuring the provided bit string.
+        """
+        self._check_ids(ids, 'get_probability')
+        mask, val = self._mask_and_value(ids, bit_string)
+        probabilities = self._diagonal()
+        return _np.sum(probabilities[(_np.arange(len(probabilities)) & mask) == val])
+
+    def get_probabilities(self, ids):
+        """
+        Return the probabilities of all the outcomes when measuring the qubits given by the list of ids.
+
+        Args:
+            ids (list[int]): List of qubit ids determining the ordering.
+
+        Returns:
+            Numpy array whose k-th entry is the probability of measuring bit j of k for the qubit ids[j].
+        """
+        self._check_ids(ids, 'get_probabilities')
+        indices = _np.arange(len(self._rho))
+        outcomes = _np.zeros(len(self._rho), dtype=_np.int64)
+        for i, qubit_id in enumerate(ids):
+            outcomes |= ((indices >> self._map[qubit_id]) & 1) << i
+        return _np.bincount(outcomes, weights=self._diagonal(), minlength=1 << len(ids))
+
+    def get_reduced_density_matrix(self, ids):
+        """
+        Return the density matrix of the qubits in ids, tracing out all the other qubits.
+
+        Args:
+            ids (list[int]): List of qubit ids determining the ordering.
+
+        Returns:
+            2^k x 2^k numpy array where bit j of the row/column index corresponds to ids[j].
+        """
+        self._check_ids(ids, 'get_reduced_density_matrix')
+        num_qubits = self._num_qubits
+        kept = [num_qubits - 1 - self._map[qubit_id] for qubit_id in reversed(ids)]
+        if len(set(kept)) != len(kept):
+            raise ValueError("get_reduced_density_matrix(): Duplicate qubit id.")
+        traced = [axis for axis in range(num_qubits) if axis not in kept]
+        tensor = self._rho.reshape([2] * (2 * num_qubits))
+        tensor = tensor.transpose(kept + traced + [num_qubits + axis for axis in kept + traced])
+        dim_kept = 1 << len(kept)
+        dim_traced = 1 << len(traced)
+        return _np.einsum('atbt->ab', tensor.reshape(dim_kept, dim_traced, dim_kept, dim_traced))
+
+    def get_purity(self):
+        """Return Tr(rho^2)."""
+        return _np.sum(_np.abs(self._rho) ** 2)
+
+    def collapse_wavefunction(self, ids, values):
+        """
+        Collapse a quantum register onto a classical basis state.
+
+        Args:
+            ids (list[int]): Qubit IDs to collapse.
+            values (list[bool]): Measurement outcome for each of the qubit IDs in `ids`.
+
+        Raises:
+            RuntimeError: If probability of outcome is ~0 or unknown qubits are provided.
+        """
+        if len(ids) != len(values):
+            raise ValueError('The number of ids and values do not match!')
+        if not all(qubit_id in self._map for qubit_id in ids):
+            raise RuntimeError(
+                "collapse_wavefunction(): Unknown qubit id(s) provided. Try calling eng.flush() before "
+                "invoking this function."
+            )
+        mask, val = self._mask_and_value(ids, values)
+        probabilities = self._diagonal()
+        nrm = _np.sum(probabilities[(_np.arange(len(probabilities)) & mask) == val])
+        if nrm < 1.0e-12:
+            raise RuntimeError("collapse_wavefunction(): Invalid collapse! Probability is ~0.")
+        self._project(mask, val, 1.0 / nrm)
+
+    def cheat(self):
+        """
+        Return the qubit index to bit location map and a copy of the density matrix.
+
+        Returns:
+            A tuple where the first entry is a dictionary mapping qubit indices to bit-locations and the second entry is
+            the corresponding 2^n x 2^n density matrix.
+        """
+        return (dict(self._map), _np.copy(self._rho))
+
+    def run(self):
+        """
+        Provide a dummy implementation for running a quantum circuit.
+
+        Only defined to provide the same interface as the C++ simulator.
+        """
+
+    def select_backend(self, backend_type):
+        """
+        Provide a dummy implementation for selecting a C++ simulator backend.
+
+        Only defined to provide the same interface as the C++ simulator.
+        """
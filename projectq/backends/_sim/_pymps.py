@@ -0,0 +1,274 @@
+# -*- coding: utf-8 -*-
+#   Copyright 2021 <Huawei Technologies Co., Ltd>
+#
+#   Licensed under the Apache License, Version 2.0 (the "License");
+#   you may not use this file except in compliance with the License.
+#   You may obtain a copy of the License at
+#
+#       http://www.apache.org/licenses/LICENSE-2.0
+#
+#   Unless required by applicable law or agreed to in writing, software
+#   distributed under the License is distributed on an "AS IS" BASIS,
+#   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+#   See the License for the specific language governing permissions and
+#   limitations under the License.
+
+"""
+A (slow) Python matrix product state simulator.
+
+Please compile the c++ simulator for large-scale simulations.
+"""
+
+import random
+
+import numpy as _np
+
+_ZERO_SINGULAR_VALUE = 1.0e-14
+_PAULI = {
+    'X': _np.array([[0, 1], [1, 0]], dtype=complex),
+    'Y': _np.array([[0, -1j], [1j, 0]], dtype=complex),
+    'Z': _np.array([[1, 0], [0, -1]], dtype=complex),
+}
+_SWAP = _np.array([[1, 0, 0, 0], [0, 0, 1, 0], [0, 1, 0, 0], [0, 0, 0, 1]], dtype=complex)
+
+
+def _rank(singular_values):
+    rank = 1
+    while rank < len(singular_values) and singular_values[rank] > _ZERO_SINGULAR_VALUE * singular_values[0]:
+        rank += 1
+    return rank
+
+
+class MPSSimulator:
+    """
+    Python implementation of a matrix product state simulator.
+
+    Used as a backup if the c++ simulator is not available. The site tensors have shape (D_left, 2, D_right) and the
+    state is kept in mixed canonical form around an orthogonality center (see the c++ implementation).
+    """
+
+    def __init__(self, rnd_seed, max_bond_dimension=0, truncation_threshold=0.0):
+        """
+        Initialize the simulator.
+
+        Args:
+            rnd_seed (int): Seed to initialize the random number generator.
+            max_bond_dimension (int): Maximal bond dimension (0 for no limit).
+            truncation_threshold (float): Maximal weight discarded by each SVD.
+        """
+        random.seed(rnd_seed)
+        self._sites = []
+        self._qubit_at = []
+        self._map = {}
+        self._center = 0
+        self._max_bond_dimension = max_bond_dimension
+        self._truncation_threshold = truncation_threshold
+        self._truncation_error = 0.0
+        print("(Note: This is the (slow) Python MPS simulator.)")
+
+    def _position(self, qubit_id, function_name):
+        if qubit_id not in self._map:
+            raise RuntimeError(
+                "{}(): Unknown qubit id. Please make sure you have called eng.flush().".format(function_name)
+            )
+        return self._map[qubit_id]
+
+    def allocate_qubit(self, qubit_id):
+        """Allocate a qubit in the |0> state at the end of the chain."""
+        if qubit_id in self._map:
+            raise RuntimeError("AllocateQubit: ID already exists. Qubit IDs should be unique.")
+        self._sites.append(_np.array([1, 0], dtype=complex).reshape(1, 2, 1))
+        self._map[qubit_id] = len(self._qubit_at)
+        self._qubit_at.append(qubit_id)
+
+    def deallocate_qubit(self, qubit_id):
+        """Deallocate a qubit (which must be in a computational basis state)."""
+        pos = self._position(qubit_id, "deallocate_qubit")
+        self._move_center(pos)
+        site = self._sites[pos]
+        total = _np.vdot(site, site).real
+        prob_one = _np.vdot(site[:, 1, :], site[:, 1, :]).real / total
+        if 1e-12 < prob_one < 1 - 1e-12:
+            raise RuntimeError(
+                "Error: Qubit has not been measured / uncomputed! There is most likely a bug in your code."
+            )
+        value = int(prob_one > 0.5)
+        projected = site[:, value, :] / _np.linalg.norm(site[:, value, :])
+        if pos + 1 < len(self._sites):
+            self._sites[pos + 1] = _np.tensordot(projected, self._sites[pos + 1], axes=(1, 0))
+            self._center = pos
+        elif pos > 0:
+            self._sites[pos - 1] = _np.tensordot(self._sites[pos - 1], projected, axes=(2, 0))
+            self._center = pos - 1
+        else:
+            self._center = 0
+        del self._sites[pos]
+        del self._qubit_at[pos]
+        del self._map[qubit_id]
+        for new_pos in range(pos, len(self._qubit_at)):
+            self._map[self._qubit_at[new_pos]] = new_pos
+
+    def measure_qubits(self, ids):
+        """Measure the qubits and return the outcomes."""
+        result = []
+        for qubit_id in ids:
+            pos = self._position(qubit_id, "measure_qubits")
+            self._move_center(pos)
+            site = self._sites[pos]
+            total = _np.vdot(site, site).real
+            prob_one = _np.vdot(site[:, 1, :], site[:, 1, :]).real
+            outcome = random.random() * total < prob_one
+            site[:, 1 - int(outcome), :] = 0
+            site /= _np.sqrt(prob_one if outcome else total - prob_one)
+            result.append(outcome)
+        return result
+
+    def _move_center(self, pos):
+        while self._center < pos:
+            site = self._sites[self._center]
+            left, _, right = site.shape
+            u_mat, svals, vh_mat = _np.linalg.svd(site.reshape(left * 2, right), full_matrices=False)
+            rank = _rank(svals)
+            self._sites[self._center] = u_mat[:, :rank].reshape(left, 2, rank)
+            remainder = svals[:rank, None] * vh_mat[:rank, :]
+            self._sites[self._center + 1] = _np.tensordot(remainder, self._sites[self._center + 1], axes=(1, 0))
+            self._center += 1
+        while self._center > pos:
+            site = self._sites[self._center]
+            left, _, right = site.shape
+            u_mat, svals, vh_mat = _np.linalg.svd(site.reshape(left, 2 * right), full_matrices=False)
+            rank = _rank(svals)
+            self._sites[self._center] = vh_mat[:rank, :].reshape(rank, 2, right)
+            remainder = u_mat[:, :rank] * svals[:rank]
+            self._sites[self._center - 1] = _np.tensordot(self._sites[self._center - 1], remainder, axes=(2, 0))
+            self._center -= 1
+
+    def _apply_two_sites(self, pos, matrix):
+        """Apply a 4x4 matrix to positions pos and pos + 1 (bit 0 of the matrix indices is position pos)."""
+        self._move_center(pos)
+        site_a, site_b = self._sites[pos], self._sites[pos + 1]
+        left, right = site_a.shape[0], site_b.shape[2]
+        theta = _np.tensordot(site_a, site_b, axes=(2, 0))  # (l, s1, s2, r)
+        gate = matrix.reshape(2, 2, 2, 2)  # (t2, t1, s2, s1)
+        theta = _np.einsum('abcd,ldcr->lbar', gate, theta)
+        u_mat, svals, vh_mat = _np.linalg.svd(theta.reshape(left * 2, 2 * right), full_matrices=False)
+        total = _np.sum(svals ** 2)
+        chi = len(svals)
+        discarded = 0.0
+        while chi > 1:
+            weight = svals[chi - 1] ** 2
+            if (
+                (self._max_bond_dimension > 0 and chi > self._max_bond_dimension)
+                or svals[chi - 1] <= _ZERO_SINGULAR_VALUE * svals[0]
+                or discarded + weight <= self._truncation_threshold * total
+            ):
+                discarded += weight
+                chi -= 1
+            else:
+                break
+        if total > 0:
+            self._truncation_error += discarded / total
+        norm = _np.sqrt(total - discarded)
+        self._sites[pos] = u_mat[:, :chi].reshape(left, 2, chi)
+        self._sites[pos + 1] = (svals[:chi, None] / norm * vh_mat[:chi, :]).reshape(chi, 2, right)
+        self._center = pos + 1
+
+    def _swap_sites(self, pos):
+        self._apply_two_sites(pos, _SWAP)
+        self._qubit_at[pos], self._qubit_at[pos + 1] = self._qubit_at[pos + 1], self._qubit_at[pos]
+        self._map[self._qubit_at[pos]] = pos
+        self._map[self._qubit_at[pos + 1]] = pos + 1
+
+    def apply_controlled_gate(self, matrix, ids, ctrlids):
+        """Apply a gate acting on at most two qubits (including the control qubits)."""
+        num_qubits = len(ids) + len(ctrlids)
+        if num_qubits == 0 or num_qubits > 2:
+            raise ValueError(
+                "MPSSimulator: only gates acting on one or two qubits (including the control qubits) are supported."
+            )
+        matrix = _np.asarray(matrix, dtype=complex).reshape(2 ** len(ids), 2 ** len(ids))
+        # The control qubits are the most significant bits of the full matrix
+        full = _np.eye(2 ** num_qubits, dtype=complex)
+        full[-len(matrix) :, -len(matrix) :] = matrix  # noqa: E203
+        qubits = list(ids) + list(ctrlids)
+
+        if num_qubits == 1:
+            site = self._sites[self._position(qubits[0], "apply_controlled_gate")]
+            self._sites[self._map[qubits[0]]] = _np.einsum('ts,lsr->ltr', full, site)
+            return
+
+        pos0 = self._position(qubits[0], "apply_controlled_gate")
+        pos1 = self._position(qubits[1], "apply_controlled_gate")
+        low, high = min(pos0, pos1), max(pos0, pos1)
+        for pos in range(high - 1, low, -1):
+            self._swap_sites(pos)
+        if pos0 > pos1:
+            perm = [0, 2, 1, 3]
+            full = full[perm][:, perm]
+        self._apply_two_sites(low, full)
+        for pos in range(low + 1, high):
+            self._swap_sites(pos)
+
+    def _expectation(self, operators):
+        """Return <psi| (x)_p op_p |psi> for a dictionary position -> 2x2 operator."""
+        if not self._sites:
+            return 1.0
+        first = min([self._center] + list(operators))
+        last = max([self._center] + list(operators))
+        dim = self._sites[first].shape[0]
+        env = _np.eye(dim, dtype=complex)
+        for pos in range(first, last + 1):
+            site = self._sites[pos]
+            op_site = _np.einsum('ts,lsr->ltr', operators.get(pos, _np.eye(2)), site)
+            env = _np.einsum('ab,atr,bts->rs', env, site.conj(), op_site)
+        return _np.trace(env)
+
+    def get_expectation_value(self, terms_dict, ids):
+        """Return the expectation value of a sum of Pauli strings."""
+        positions = [self._position(qubit_id, "get_expectation_value") for qubit_id in ids]
+        expectation = 0.0
+        for term, coefficient in terms_dict:
+            operators = {positions[index]: _PAULI[pauli] for index, pauli in term}
+            expectation += coefficient * self._expectation(operators).real
+        return expectation
+
+    def get_probability(self, bit_string, ids):
+        """Return the probability of measuring bit_string."""
+        if len(bit_string) != len(ids):
+            raise ValueError("get_probability(): ids and bit_string size mismatch")
+        operators = {}
+        for bit, qubit_id in zip(bit_string, ids):
+            projector = _np.zeros((2, 2), dtype=complex)
+            projector[int(bit), int(bit)] = 1
+            operators[self._position(qubit_id, "get_probability")] = projector
+        return self._expectation(operators).real
+
+    def get_amplitude(self, bit_string, ids):
+        """Return the amplitude of a basis state (ids must contain all the qubits)."""
+        if len(bit_string) != len(ids) or sorted(ids) != sorted(self._map):
+            raise RuntimeError(
+                "get_amplitude(): The second argument must be a list of all the qubits (and match the bit string)."
+            )
+        bits = [0] * len(self._sites)
+        for bit, qubit_id in zip(bit_string, ids):
+            bits[self._map[qubit_id]] = int(bit)
+        vec = _np.ones(1, dtype=complex)
+        for pos, site in enumerate(self._sites):
+            vec = vec @ site[:, bits[pos], :]
+        return complex(vec[0])
+
+    def get_bond_dimensions(self):
+        """Return the bond dimensions between neighbouring positions."""
+        return [site.shape[2] for site in self._sites[:-1]]
+
+    def get_truncation_error(self):
+        """Return the total weight discarded by the truncations."""
+        return self._truncation_error
+
+    def cheat(self):
+        """Return the qubit mapping and the dense state vector (bit p of the index is the qubit at position p)."""
+        psi = _np.ones((1, 1), dtype=complex)
+        for site in self._sites:
+            # psi[x, l] -> psi[s, x, r] -> flattened index x + s * 2^p
+            psi = _np.einsum('xl,lsr->sxr', psi, site).reshape(-1, site.shape[2])
+        return dict(self._map), psi.reshape(-1)
@@ -51,19 +51,29 @@ class Simulator:
         self._state = _np.ones(1, dtype=_np.complex128)
         self._map = {}
         self._num_qubits = 0
+        self._channels = []
+        self._qubit_noise = {}
         print("(Note: This is the (slow) Python simulator.)")
 
-    def cheat(self):
+    def cheat(self, writeable=False, copy=True):
         """
         Return the qubit index to bit location map and the corresponding state vector.
 
         This function can be used to measure expectation values more efficiently (emulation).
 
+        Args:
+            writeable (bool): If True, the returned state vector is a view which may be modified in place.
+            copy (bool): If False, the returned (read-only) state vector is a view of the internal state.
+
         Returns:
             A tuple where the first entry is a dictionary mapping qubit indices to bit-locations and the second entry is
-            the corresponding state vector
+            the corresponding state vector (copy of the internal state, or a view if writeable or not copy)
         """
-        return (self._map, self._state)
+        if not writeable and copy:
+            return (self._map, self._state.copy())
+        state = self._state.view()
+        state.flags.writeable = writeable
+        return (self._map, state)
 
     def measure_qubits(self, ids):
         """
@@ -173,6 +183,7 @@ class Simulator:
         self._map = newmap
         self._state = newstate
         self._num_qubits -= 1
+        self._qubit_noise.pop(qubit_id, None)
 
     def _get_control_mask(self, ctrlids):
         """
@@ -290,6 +301,30 @@ class Simulator:
                 probability += state.real ** 2 + state.imag ** 2
         return probability
 
+    def get_probabilities(self, ids):
+        """
+        Return the probabilities of all the outcomes when measuring the qubits given by the list of ids.
+
+        Args:
+            ids (list[int]): List of qubit ids determining the ordering.
+
+        Returns:
+            Numpy array whose k-th entry is the probability of measuring bit j of k for the qubit ids[j].
+
+        Raises:
+            RuntimeError if an unknown qubit id was provided.
+        """
+        for qubit_id in ids:
+            if qubit_id not in self._map:
+                raise RuntimeError(
+                    "get_probabilities(): Unknown qubit id. Please make sure you have called eng.flush()."
+                )
+        indices = _np.arange(len(self._state))
+        outcomes = _np.zeros(len(self._state), dtype=_np.int64)
+        for i, qubit_id in enumerate(ids):
+            outcomes |= ((indices >> self._map[qubit_id]) & 1) << i
+        return _np.bincount(outcomes, weights=_np.abs(self._state) ** 2, minlength=1 << len(ids))
+
     def get_amplitude(self, bit_string, ids):
         """
         Return the probability amplitude of the supplied `bit_string`.
@@ -373,6 +408,13 @@ class Simulator:
             ids (list): A list containing the qubit IDs to which to apply the gate.
             ctrlids (list): A list of control qubit IDs (i.e., the gate is only applied where these qubits are 1).
         """
+        self._apply_noiseless_gate(matrix, ids, ctrlids)
+        for qubit_id in list(ids) + list(ctrlids):
+            for handle in self._qubit_noise.get(qubit_id, []):
+                self.apply_channel(handle, [qubit_id])
+
+    def _apply_noiseless_gate(self, matrix, ids, ctrlids):
+        """Apply a gate without the noise channels of its qubits (see apply_controlled_gate())."""
         matrix = _np.array(_np.split(_np.array(matrix), len(matrix) ** 0.5))
         mask = self._get_control_mask(ctrlids)
         if len(matrix) == 2:
@@ -382,6 +424,73 @@ class Simulator:
             pos = [self._map[qubit_id] for qubit_id in ids]
             self._multi_qubit_gate(matrix, pos, mask)
 
+    def add_channel(self, kraus_operators):
+        """
+        Register a noise channel.
+
+        Args:
+            kraus_operators (list[list[complex]]): Kraus operators (flattened 2^k x 2^k matrices).
+
+        Returns:
+            Handle of the channel (for apply_channel() and set_qubit_noise()).
+        """
+        dim = int(round(len(kraus_operators[0]) ** 0.5))
+        self._channels.append([_np.array(op, dtype=_np.complex128).reshape(dim, dim) for op in kraus_operators])
+        return len(self._channels) - 1
+
+    def apply_channel(self, handle, ids):
+        """
+        Apply a registered channel to the qubits in ids by sampling one of its Kraus operators.
+
+        Args:
+            handle (int): Handle returned by add_channel().
+            ids (list[int]): Qubit IDs the channel acts on.
+        """
+        operators = self._channels[handle]
+        if len(operators[0]) != 1 << len(ids):
+            raise ValueError("apply_channel(): Channel size does not match the number of qubits.")
+        if not all(qubit_id in self._map for qubit_id in ids):
+            raise RuntimeError("apply_channel(): Unknown qubit id. Please make sure you have called eng.flush().")
+        positions = [self._map[qubit_id] for qubit_id in ids]
+        states = [self._apply_matrix(op, positions) for op in operators]
+        probabilities = [_np.vdot(state, state).real for state in states]
+        random_outcome = random.random()
+        # Operators with probability 0 are never picked, even if the probabilities add up to slightly less than 1
+        picked = len(states) - 1
+        total = 0.0
+        for k, probability in enumerate(probabilities):
+            if probability <= 0:
+                continue
+            picked = k
+            total += probability
+            if random_outcome < total:
+                break
+        if not probabilities[picked] > 0:
+            raise RuntimeError("apply_channel(): All the Kraus operators have probability 0.")
+        self._state = states[picked] / _np.sqrt(probabilities[picked])
+
+    def set_qubit_noise(self, qubit_id, handles):
+        """
+        Set the (single-qubit) channels applied after every gate acting on a qubit.
+
+        Args:
+            qubit_id (int): ID of the qubit.
+            handles (list[int]): Handles returned by add_channel().
+        """
+        if handles:
+            self._qubit_noise[qubit_id] = list(handles)
+        else:
+            self._qubit_noise.pop(qubit_id, None)
+
+    def _apply_matrix(self, matrix, positions):
+        """Return the state obtained by applying the 2^k x 2^k matrix to the qubits at the given positions."""
+        num_qubits = self._num_qubits
+        k = len(positions)
+        tensor = self._state.reshape([2] * num_qubits)
+        axes = [num_qubits - 1 - pos for pos in reversed(positions)]
+        tensor = _np.tensordot(matrix.reshape([2] * (2 * k)), tensor, axes=(list(range(k, 2 * k)), axes))
+        return _np.moveaxis(tensor, list(range(k)), axes).reshape(self._state.shape)
+
     def _single_qubit_gate(self, matrix, pos, mask):
         """
         Apply the single qubit gate matrix m to the qubit at position `pos` using `mask` to identify control qubits.
@@ -529,4 +638,4 @@ class Simulator:
             ctrlids = []
         for local_op in term:
             qb_id = ids[local_op[0]]
-            self.apply_controlled_gate(gates[ord(local_op[1]) - ord('X')], [qb_id], ctrlids)
+            self._apply_noiseless_gate(gates[ord(local_op[1]) - ord('X')], [qb_id], ctrlids)
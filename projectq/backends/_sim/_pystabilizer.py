@@ -0,0 +1,232 @@
+# -*- coding: utf-8 -*-
+#   Copyright 2021 <Huawei Technologies Co., Ltd>
+#
+#   Licensed under the Apache License, Version 2.0 (the "License");
+#   you may not use this file except in compliance with the License.
+#   You may obtain a copy of the License at
+#
+#       http://www.apache.org/licenses/LICENSE-2.0
+#
+#   Unless required by applicable law or agreed to in writing, software
+#   distributed under the License is distributed on an "AS IS" BASIS,
+#   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+#   See the License for the specific language governing permissions and
+#   limitations under the License.
+
+"""
+A (slow) Python stabilizer simulator.
+
+Please compile the c++ simulator for large-scale simulations.
+"""
+
+import random
+
+
+def _popcount(value):
+    return bin(value).count('1')
+
+
+class StabilizerSimulator:  # pylint: disable=too-many-public-methods
+    """
+    Python implementation of the CHP stabilizer tableau simulator.
+
+    Used as a backup if the c++ simulator is not available. Each row of the tableau is stored as two Python integers (x
+    and z bits, bit p corresponds to the qubit at position p) and a sign bit. Rows 0..n-1 are the destabilizers, rows
+    n..2n-1 the stabilizers.
+    """
+
+    def __init__(self, rnd_seed, *args, **kwargs):  # pylint: disable=unused-argument
+        """
+        Initialize the simulator.
+
+        Args:
+            rnd_seed (int): Seed to initialize the random number generator.
+            args: Dummy argument to allow an interface identical to the c++ simulator.
+            kwargs: Same as args.
+        """
+        random.seed(rnd_seed)
+        self._destabilizers = []
+        self._stabilizers = []
+        self._map = {}
+        self._free_positions = []
+        print("(Note: This is the (slow) Python stabilizer simulator.)")
+
+    def _position(self, qubit_id, function_name):
+        if qubit_id not in self._map:
+            raise RuntimeError(
+                "{}(): Unknown qubit id. Please make sure you have called eng.flush().".format(function_name)
+            )
+        return self._map[qubit_id]
+
+    @staticmethod
+    def _rowsum(row_h, row_i):
+        """Return the Pauli product row_h * row_i (rows are [x, z, r] lists)."""
+        x1, z1, r1 = row_i
+        x2, z2, r2 = row_h
+        plus = (x1 & z1 & z2 & ~x2) | (x1 & ~z1 & x2 & z2) | (~x1 & z1 & x2 & ~z2)
+        minus = (x1 & z1 & x2 & ~z2) | (x1 & ~z1 & ~x2 & z2) | (~x1 & z1 & x2 & z2)
+        total = 2 * (r1 + r2) + _popcount(plus) - _popcount(minus)
+        return [x1 ^ x2, z1 ^ z2, int(total % 4 == 2)]
+
+    def _rows(self):
+        return self._destabilizers + self._stabilizers
+
+    def allocate_qubit(self, qubit_id):
+        """Allocate a qubit in the |0> state."""
+        if qubit_id in self._map:
+            raise RuntimeError("AllocateQubit: ID already exists. Qubit IDs should be unique.")
+        if self._free_positions:
+            self._map[qubit_id] = self._free_positions.pop()
+            return
+        pos = len(self._stabilizers)
+        self._destabilizers.append([1 << pos, 0, 0])
+        self._stabilizers.append([0, 1 << pos, 0])
+        self._map[qubit_id] = pos
+
+    def deallocate_qubit(self, qubit_id):
+        """Deallocate a qubit (which must be in a computational basis state)."""
+        pos = self._position(qubit_id, "deallocate_qubit")
+        if any(row[0] >> pos & 1 for row in self._stabilizers):
+            raise RuntimeError(
+                "Error: Qubit has not been measured / uncomputed! There is most likely a bug in your code."
+            )
+        if self._measure(pos)[0]:
+            self.pauli_x(qubit_id)
+        del self._map[qubit_id]
+        self._free_positions.append(pos)
+        if not self._map:
+            self._destabilizers = []
+            self._stabilizers = []
+            self._free_positions = []
+
+    def _measure(self, pos, forced=None):
+        """Measure the qubit at position pos, returning the outcome and whether it was random."""
+        for p, stabilizer in enumerate(self._stabilizers):  # pylint: disable=invalid-name
+            if stabilizer[0] >> pos & 1:
+                for rows in (self._destabilizers, self._stabilizers):
+                    for i, row in enumerate(rows):
+                        if row is not stabilizer and row[0] >> pos & 1:
+                            rows[i] = self._rowsum(row, stabilizer)
+                outcome = random.random() < 0.5 if forced is None else bool(forced)
+                self._destabilizers[p] = list(stabilizer)
+                self._stabilizers[p] = [0, 1 << pos, int(outcome)]
+                return outcome, True
+
+        scratch = [0, 0, 0]
+        for destabilizer, stabilizer in zip(self._destabilizers, self._stabilizers):
+            if destabilizer[0] >> pos & 1:
+                scratch = self._rowsum(scratch, stabilizer)
+        return bool(scratch[2]), False
+
+    def measure_qubits(self, ids):
+        """Measure the qubits and return the outcomes."""
+        return [self._measure(self._position(qubit_id, "measure_qubits"))[0] for qubit_id in ids]
+
+    def _for_each_row(self, qubit_id, function_name, func):
+        pos = self._position(qubit_id, function_name)
+        for row in self._rows():
+            x_bit, z_bit, sign = func(row[0] >> pos & 1, row[1] >> pos & 1, row[2])
+            row[0] = (row[0] & ~(1 << pos)) | (x_bit << pos)
+            row[1] = (row[1] & ~(1 << pos)) | (z_bit << pos)
+            row[2] = sign
+
+    def hadamard(self, qubit_id):
+        """Apply a Hadamard gate."""
+        self._for_each_row(qubit_id, "hadamard", lambda x, z, r: (z, x, r ^ (x & z)))
+
+    def phase(self, qubit_id):
+        """Apply an S gate."""
+        self._for_each_row(qubit_id, "phase", lambda x, z, r: (x, z ^ x, r ^ (x & z)))
+
+    def phase_dagger(self, qubit_id):
+        """Apply an S^dagger gate."""
+        self._for_each_row(qubit_id, "phase_dagger", lambda x, z, r: (x, z ^ x, r ^ (x & (1 - z))))
+
+    def pauli_x(self, qubit_id):
+        """Apply an X gate."""
+        self._for_each_row(qubit_id, "pauli_x", lambda x, z, r: (x, z, r ^ z))
+
+    def pauli_y(self, qubit_id):
+        """Apply a Y gate."""
+        self._for_each_row(qubit_id, "pauli_y", lambda x, z, r: (x, z, r ^ x ^ z))
+
+    def pauli_z(self, qubit_id):
+        """Apply a Z gate."""
+        self._for_each_row(qubit_id, "pauli_z", lambda x, z, r: (x, z, r ^ x))
+
+    def cnot(self, control, target):
+        """Apply a CNOT gate."""
+        pos_a = self._position(control, "cnot")
+        pos_b = self._position(target, "cnot")
+        for row in self._rows():
+            x_a, z_a = row[0] >> pos_a & 1, row[1] >> pos_a & 1
+            x_b, z_b = row[0] >> pos_b & 1, row[1] >> pos_b & 1
+            row[2] ^= x_a & z_b & (x_b ^ z_a ^ 1)
+            row[0] ^= x_a << pos_b
+            row[1] ^= z_b << pos_a
+
+    def cz(self, qubit_id1, qubit_id2):  # pylint: disable=invalid-name
+        """Apply a CZ gate."""
+        self.hadamard(qubit_id2)
+        self.cnot(qubit_id1, qubit_id2)
+        self.hadamard(qubit_id2)
+
+    def swap(self, qubit_id1, qubit_id2):
+        """Swap two qubits (by relabelling their positions)."""
+        pos_a = self._position(qubit_id1, "swap")
+        pos_b = self._position(qubit_id2, "swap")
+        self._map[qubit_id1], self._map[qubit_id2] = pos_b, pos_a
+
+    def get_expectation_value(self, terms_dict, ids):
+        """Return the expectation value of a sum of Pauli strings."""
+        positions = [self._position(qubit_id, "get_expectation_value") for qubit_id in ids]
+        expectation = 0.0
+        for term, coefficient in terms_dict:
+            x_bits, z_bits = 0, 0
+            for index, pauli in term:
+                if pauli in 'XY':
+                    x_bits ^= 1 << positions[index]
+                if pauli in 'ZY':
+                    z_bits ^= 1 << positions[index]
+
+            def anticommutes(row, x_bits=x_bits, z_bits=z_bits):
+                return _popcount((row[0] & z_bits) ^ (row[1] & x_bits)) % 2 == 1
+
+            if any(anticommutes(row) for row in self._stabilizers):
+                continue
+            scratch = [0, 0, 0]
+            for destabilizer, stabilizer in zip(self._destabilizers, self._stabilizers):
+                if anticommutes(destabilizer):
+                    scratch = self._rowsum(scratch, stabilizer)
+            expectation += -coefficient if scratch[2] else coefficient
+        return expectation
+
+    def get_probability(self, bit_string, ids):
+        """Return the probability of measuring bit_string."""
+        if len(bit_string) != len(ids):
+            raise ValueError("get_probability(): ids and bit_string size mismatch")
+        positions = [self._position(qubit_id, "get_probability") for qubit_id in ids]
+        destabilizers = [list(row) for row in self._destabilizers]
+        stabilizers = [list(row) for row in self._stabilizers]
+        probability = 1.0
+        for pos, bit in zip(positions, bit_string):
+            outcome, is_random = self._measure(pos, bit)
+            if is_random:
+                probability /= 2
+            elif outcome != bool(bit):
+                probability = 0.0
+                break
+        self._destabilizers = destabilizers
+        self._stabilizers = stabilizers
+        return probability
+
+    def cheat(self):
+        """Return the qubit mapping and the stabilizer generators as strings (e.g. '+XZI')."""
+        num_positions = len(self._stabilizers)
+        stabilizers = []
+        for x_bits, z_bits, sign in self._stabilizers:
+            pauli = '-' if sign else '+'
+            for pos in range(num_positions):
+                pauli += 'IZXY'[(x_bits >> pos & 1) * 2 + (z_bits >> pos & 1)]
+            stabilizers.append(pauli)
+        return dict(self._map), stabilizers
@@ -24,15 +24,22 @@ implementation is used as an alternative.
 # pylint: disable=no-name-in-module
 
 import math
+import os
 import random
+import sys
+import warnings
+
+import numpy as np
 
 from projectq.cengines import BasicEngine
 from projectq.meta import LogicalQubitIDTag, get_control_count, has_negative_control
 from projectq.ops import (
     Allocate,
     BasicMathGate,
+    ControlledGate,
     Deallocate,
     FlushGate,
+    MatrixGate,
     Measure,
     TimeEvolution,
 )
@@ -40,14 +47,99 @@ from projectq.types import WeakQubitRef
 
 FALLBACK_TO_PYSIM = False
 try:
+    from ._cppsim import DistributedSimulator as DistributedSimulatorBackend
+    from ._cppsim import OutOfCoreSimulator as OutOfCoreSimulatorBackend
     from ._cppsim import SimBackend  # pylint: disable=unused-import
     from ._cppsim import Simulator as SimulatorBackend
 except ImportError:  # pragma: no cover
     from ._pysim import Simulator as SimulatorBackend
 
+    DistributedSimulatorBackend = None
+    OutOfCoreSimulatorBackend = None
     SimBackend = None
     FALLBACK_TO_PYSIM = True
 
+# Started by the distributed C++ simulator with the transport endpoint and the rank of the process as last arguments
+_DISTRIBUTED_WORKER_CODE = (
+    'import os, sys; sys.path[:0] = sys.argv[1].split(os.pathsep); '
+    'from projectq.backends._sim._cppsim import DistributedSimulator; '
+    'DistributedSimulator.serve(sys.argv[2], int(sys.argv[3]))'
+)
+
+
+# Opcodes of the packed command buffers (see include/command_buffer.hpp)
+_OP_GATE = 0
+_OP_ALLOCATE = 1
+_OP_DEALLOCATE = 2
+_OP_RUN = 3
+_OP_REGISTERED_GATE = 4
+
+# Maximal number of gate matrices registered with the C++ simulator (the other ones are sent with each gate)
+_MAX_REGISTERED_MATRICES = 1024
+
+# Maximal number of gate instances whose matrix handle is remembered (these gates are kept alive by the simulator)
+_MAX_CACHED_GATES = 4096
+
+
+class _CommandBuffer:
+    """
+    Packed buffer of simulator commands, submitted to the C++ simulator in a single call.
+
+    The commands are stored as a flat list of integers (opcodes, qubit ids and offsets of the gate matrices), the
+    matrices of the gates being concatenated into a single array of complex numbers.
+    """
+
+    def __init__(self):
+        """Initialize an empty buffer."""
+        self._words = []
+        self._matrices = []
+        self._matrix_size = 0
+
+    def __len__(self):
+        """Return the number of words in the buffer."""
+        return len(self._words)
+
+    def allocate(self, qubit_id):
+        """Add the allocation of a qubit."""
+        self._words += (_OP_ALLOCATE, qubit_id)
+
+    def deallocate(self, qubit_id):
+        """Add the deallocation of a qubit."""
+        self._words += (_OP_DEALLOCATE, qubit_id)
+
+    def gate(self, matrix, ids, ctrlids):
+        """Add a gate, given by its (2^len(ids) x 2^len(ids)) matrix, controlled on the ctrlids qubits."""
+        entries = np.asarray(matrix, dtype=complex).ravel()
+        self._words += (_OP_GATE, len(ids), len(ctrlids), self._matrix_size)
+        self._words += ids
+        self._words += ctrlids
+        self._matrices.append(entries)
+        self._matrix_size += len(entries)
+
+    def registered_gate(self, handle, ids, ctrlids):
+        """Add a gate whose matrix was registered with the simulator, controlled on the ctrlids qubits."""
+        self._words += (_OP_REGISTERED_GATE, len(ids), len(ctrlids), handle)
+        self._words += ids
+        self._words += ctrlids
+
+    def run(self):
+        """Add the application of the pending (fused) gates."""
+        self._words.append(_OP_RUN)
+
+    def submit(self, simulator):
+        """Apply the buffered commands to a C++ simulator and empty the buffer."""
+        if not self._words:
+            return
+        words = np.array(self._words, dtype=np.int64)
+        if self._matrices:
+            matrices = np.concatenate(self._matrices)
+        else:
+            matrices = np.zeros(0, dtype=complex)
+        self._words = []
+        self._matrices = []
+        self._matrix_size = 0
+        simulator.apply_commands(words, matrices)
+
 
 class Simulator(BasicEngine):
     """
@@ -61,14 +153,37 @@ class Simulator(BasicEngine):
         export OMP_PROC_BIND=spread # bind threads to processors by spreading
     """
 
-    def __init__(self, gate_fusion=False, rnd_seed=None):
+    def __init__(  # pylint: disable=too-many-arguments
+        self,
+        gate_fusion=False,
+        rnd_seed=None,
+        storage_dir=None,
+        local_qubits=28,
+        num_processes=1,
+        transport='shm',
+        noise_model=None,
+    ):
         """
         Construct the C++/Python-simulator object and initialize it with a random seed.
 
         Args:
-            gate_fusion (bool): If True, gates are cached and only executed once a certain gate-size has been reached
-                (only has an effect for the c++ simulator).
+            gate_fusion (bool|str|dict): If True, gates are cached and only executed once a certain gate-size has
+                been reached (only has an effect for the c++ simulator). If 'lookahead' or a dictionary with the keys
+                'window' (number of buffered gates, 64 by default) and/or 'max_qubits' (size of the fused gates, at
+                most 5 which is the default), the gates are buffered and reordered (as far as they commute) into as
+                few fused gates as possible (in-memory c++ simulator only: a ValueError is raised in out-of-core and
+                distributed modes and a warning is emitted with the Python simulator).
             rnd_seed (int): Random seed (uses random.randint(0, 4294967295) by default).
+            storage_dir (str): If not None, the state vector is stored in chunk files inside this (existing) directory
+                instead of main memory (out-of-core mode, only available with the c++ simulator).
+            local_qubits (int): Number of qubits per chunk in out-of-core mode. About 6 chunks of 2^local_qubits
+                amplitudes are kept in memory at any time.
+            num_processes (int): If larger than 1, the state vector is partitioned across this many processes (must
+                be a power of 2, only available with the c++ simulator on POSIX systems).
+            transport (str): Communication between the processes in distributed mode: 'shm' (POSIX shared memory) or
+                'tcp' (localhost sockets).
+            noise_model (NoiseModel): Noise channels applied after the gates (see projectq.backends.NoiseModel). Each
+                run of a circuit then samples one quantum trajectory; use run_trajectories() to collect statistics.
 
         Example of gate_fusion: Instead of applying a Hadamard gate to 5 qubits, the simulator calculates the
         kronecker product of the 1-qubit gate matrices and then applies one 5-qubit gate. This increases operational
@@ -82,12 +197,83 @@ class Simulator(BasicEngine):
 
             If you need to run large simulations, check out the tutorial in the docs which gives futher hints on how
             to build the C++ extension.
+
+        Note:
+            In out-of-core mode, math gates and time evolution gates are not supported (they get decomposed by the
+            compiler if possible) and neither are apply_qubit_operator(), set_wavefunction() and cheat().
+
+        Note:
+            The same restrictions apply in distributed mode. The worker processes are started when the simulator is
+            created and each of them uses the multi-threaded kernels according to OMP_NUM_THREADS, so the total number
+            of threads should not exceed the number of cores.
+
+        Note:
+            Noise models are only supported by the in-memory simulator. Noise is only applied after gates given by a
+            matrix: math and time evolution gates, apply_qubit_operator() and get_expectation_value() are noiseless.
         """
         if rnd_seed is None:
             rnd_seed = random.randint(0, 4294967295)
         super().__init__()
-        self._simulator = SimulatorBackend(rnd_seed)
-        self._gate_fusion = gate_fusion
+        self._out_of_core = storage_dir is not None
+        self._distributed = num_processes > 1
+        if self._out_of_core and self._distributed:
+            raise ValueError('Out-of-core and distributed modes cannot be combined!')
+        if self._distributed:
+            if DistributedSimulatorBackend is None:
+                raise RuntimeError('Distributed simulation requires the C++ simulator!')
+            worker_command = [sys.executable, '-c', _DISTRIBUTED_WORKER_CODE, os.pathsep.join(sys.path)]
+            self._simulator = DistributedSimulatorBackend(rnd_seed, num_processes, transport, worker_command)
+        elif self._out_of_core:
+            if OutOfCoreSimulatorBackend is None:
+                raise RuntimeError('Out-of-core simulation requires the C++ simulator!')
+            self._simulator = OutOfCoreSimulatorBackend(rnd_seed, str(storage_dir), local_qubits)
+        else:
+            self._simulator = SimulatorBackend(rnd_seed)
+        # Planner configurations enable gate fusion even if they are empty (e.g. gate_fusion={})
+        if isinstance(gate_fusion, (str, dict)):
+            self._configure_fusion_planner(gate_fusion)
+            self._gate_fusion = True
+        else:
+            self._gate_fusion = bool(gate_fusion)
+
+        self._matrix_handles = {}
+        self._gate_handles = {}
+        self._matrix_handles_owner = None
+
+        self._noise_model = noise_model
+        self._channel_handles = {}
+        if noise_model is not None:
+            if self._out_of_core or self._distributed:
+                raise ValueError('Noise models are not supported in out-of-core and distributed modes!')
+            for _, channel in noise_model.gate_noise + noise_model.qubit_noise:
+                if id(channel) not in self._channel_handles:
+                    self._channel_handles[id(channel)] = self._simulator.add_channel(
+                        [[item for row in op.tolist() for item in row] for op in channel.kraus_operators]
+                    )
+
+    def _configure_fusion_planner(self, gate_fusion):
+        """
+        Enable the lookahead gate fusion of the C++ simulator.
+
+        Args:
+            gate_fusion (str|dict): Either 'lookahead' or a dictionary of options ('window' and 'max_qubits').
+        """
+        options = {'window': 64, 'max_qubits': 5}
+        if isinstance(gate_fusion, dict):
+            unknown = set(gate_fusion) - set(options)
+            if unknown:
+                raise ValueError('Unknown gate fusion option(s): {}'.format(', '.join(sorted(unknown))))
+            options.update(gate_fusion)
+        elif gate_fusion != 'lookahead':
+            raise ValueError("gate_fusion must be a boolean, 'lookahead' or a dictionary of options!")
+        if options['window'] < 1 or not 1 <= options['max_qubits'] <= 5:
+            raise ValueError('The fusion window must be positive and the fused gates must act on 1 to 5 qubits!')
+        if self._out_of_core or self._distributed:
+            raise ValueError('Lookahead gate fusion is not supported in out-of-core and distributed modes!')
+        if hasattr(self._simulator, 'set_fusion_planner'):
+            self._simulator.set_fusion_planner(options['window'], options['max_qubits'])
+        else:
+            warnings.warn('Lookahead gate fusion requires the C++ simulator: the gate fusion options are ignored')
 
     def is_available(self, cmd):
         """
@@ -105,14 +291,12 @@ class Simulator(BasicEngine):
         if has_negative_control(cmd):
             return False
 
-        if (
-            cmd.gate == Measure
-            or cmd.gate == Allocate
-            or cmd.gate == Deallocate
-            or isinstance(cmd.gate, (BasicMathGate, TimeEvolution))
-        ):
+        if cmd.gate == Measure or cmd.gate == Allocate or cmd.gate == Deallocate:
             return True
 
+        if isinstance(cmd.gate, (BasicMathGate, TimeEvolution)):
+            return not (self._out_of_core or self._distributed)
+
         if cmd.gate.is_parametric():
             return False
 
@@ -228,6 +412,36 @@ class Simulator(BasicEngine):
         bit_string = [bool(int(b)) for b in bit_string]
         return self._simulator.get_probability(bit_string, [qb.id for qb in qureg])
 
+    def get_probabilities(self, qureg):
+        """
+        Return the probabilities of all the outcomes when measuring the quantum register `qureg`.
+
+        Args:
+            qureg (Qureg|list[Qubit]): Quantum register.
+
+        Returns:
+            Numpy array of length 2**len(qureg) whose k-th entry is the probability of measuring bit j of k for the
+            qubit qureg[j].
+
+        Note:
+            Make sure all previous commands (especially allocations) have passed through the compilation chain (call
+            main_engine.flush() to make sure).
+
+        Note:
+            If there is a mapper present in the compiler, this function automatically converts from logical qubits to
+            mapped qubits for the qureg argument.
+        """
+        qureg = self._convert_logical_to_mapped_qureg(qureg)
+        ids = [qb.id for qb in qureg]
+        if hasattr(self._simulator, 'get_probabilities'):
+            return self._simulator.get_probabilities(ids)
+        return np.array(
+            [
+                self._simulator.get_probability([bool((k >> j) & 1) for j in range(len(ids))], ids)
+                for k in range(1 << len(ids))
+            ]
+        )
+
     def get_amplitude(self, bit_string, qureg):
         """
         Return the probability amplitude of the supplied `bit_string`.
@@ -262,8 +476,8 @@ class Simulator(BasicEngine):
         the wavefunction).
 
         Args:
-            wavefunction (list[complex]): Array of complex amplitudes
-                describing the wavefunction (must be normalized).
+            wavefunction (list[complex]|numpy.ndarray): Array of complex
+                amplitudes describing the wavefunction (must be normalized).
             qureg (Qureg|list[Qubit]): Quantum register determining the
                 ordering. Must contain all allocated qubits.
 
@@ -272,6 +486,12 @@ class Simulator(BasicEngine):
             passed through the compilation chain (call main_engine.flush() to
             make sure).
 
+        Note:
+            With the C++ simulator, C-contiguous complex128 numpy arrays are
+            copied directly into the state vector (other inputs are converted
+            first). To avoid any copy, write the amplitudes into the view
+            returned by cheat(writeable=True) and pass that view.
+
         Note:
             If there is a mapper present in the compiler, this function
             automatically converts from logical qubits to mapped qubits for
@@ -305,28 +525,217 @@ class Simulator(BasicEngine):
         qureg = self._convert_logical_to_mapped_qureg(qureg)
         return self._simulator.collapse_wavefunction([qb.id for qb in qureg], [bool(int(v)) for v in values])
 
-    def cheat(self):
+    def cheat(self, writeable=False, copy=True):
         """
         Access the ordering of the qubits and the state vector directly.
 
         This is a cheat function which enables, e.g., more efficient
         evaluation of expectation values and debugging.
 
+        Args:
+            writeable (bool): If True, the returned state vector is a view
+                which may be modified in place (implies copy=False).
+            copy (bool): If False, the returned (read-only) state vector is a
+                view sharing its memory with the simulator instead of a copy.
+
         Returns:
             A tuple where the first entry is a dictionary mapping qubit
             indices to bit-locations and the second entry is the corresponding
-            state vector.
+            state vector (numpy array).
 
         Note:
             Make sure all previous commands have passed through the
             compilation chain (call main_engine.flush() to make sure).
 
+        Note:
+            A view (writeable=True or copy=False) avoids copying large state
+            vectors, but it is only valid until the next command is sent to
+            the simulator, which may reallocate the state vector: reading or
+            writing it afterwards is undefined behavior.
+
+        Note:
+            After writing amplitudes through a writeable view, pass the view
+            to set_wavefunction() before sending any other command, so that
+            the simulator discards what it knows about the previous state.
+
         Note:
             If there is a mapper present in the compiler, this function
             DOES NOT automatically convert from logical qubits to mapped
             qubits.
         """
-        return self._simulator.cheat()
+        return self._simulator.cheat(writeable, copy)
+
+    def get_io_stats(self):
+        """
+        Return the I/O statistics of the out-of-core mode.
+
+        Returns:
+            A dictionary with the number of bytes read from and written to the chunk files (in total and per gate),
+            the number of gates, the number of sweeps over the chunk files and the number of swaps between global and
+            local qubits since the last call to reset_io_stats().
+
+        Raises:
+            RuntimeError: If the simulator is not in out-of-core mode.
+        """
+        if not self._out_of_core:
+            raise RuntimeError('I/O statistics are only available in out-of-core mode!')
+        return self._simulator.get_io_stats()
+
+    def reset_io_stats(self):
+        """
+        Reset the I/O statistics of the out-of-core mode.
+
+        Raises:
+            RuntimeError: If the simulator is not in out-of-core mode.
+        """
+        if not self._out_of_core:
+            raise RuntimeError('I/O statistics are only available in out-of-core mode!')
+        self._simulator.reset_io_stats()
+
+    def get_fusion_cache_stats(self):
+        """
+        Return the statistics of the cache of fused gate matrices.
+
+        When gate fusion is enabled, the C++ simulator caches the matrices obtained by fusing sequences of gates, so
+        that circuits which repeatedly apply the same gates on the same qubits (e.g. in variational algorithms) do not
+        need to fuse them again. Gates whose matrices differ in any way (e.g. rotations by different angles) do not
+        share cache entries.
+
+        Returns:
+            A dictionary with the number of cache hits and misses since the last call to reset_fusion_cache_stats(),
+            as well as the current number of entries ('size') and the maximal number of entries ('capacity').
+
+        Raises:
+            RuntimeError: If the simulator is not the in-memory C++ simulator.
+        """
+        if not hasattr(self._simulator, 'get_fusion_cache_stats'):
+            raise RuntimeError('The fusion cache is only available with the in-memory C++ simulator!')
+        return self._simulator.get_fusion_cache_stats()
+
+    def reset_fusion_cache_stats(self):
+        """
+        Reset the hit and miss counters of the cache of fused gate matrices.
+
+        Raises:
+            RuntimeError: If the simulator is not the in-memory C++ simulator.
+        """
+        if not hasattr(self._simulator, 'reset_fusion_cache_stats'):
+            raise RuntimeError('The fusion cache is only available with the in-memory C++ simulator!')
+        self._simulator.reset_fusion_cache_stats()
+
+    def set_fusion_cache_size(self, size):
+        """
+        Set the maximal number of fused gate matrices kept in the cache (the least recently used ones are evicted).
+
+        Args:
+            size (int): Capacity of the cache (0 disables the cache).
+
+        Raises:
+            RuntimeError: If the simulator is not the in-memory C++ simulator.
+        """
+        if not hasattr(self._simulator, 'set_fusion_cache_size'):
+            raise RuntimeError('The fusion cache is only available with the in-memory C++ simulator!')
+        self._simulator.set_fusion_cache_size(size)
+
+    def get_scratch_memory_stats(self):
+        """
+        Return the statistics of the temporary state vectors of the simulator.
+
+        Operations which cannot be performed in place (e.g. growing the state vector, expectation values or time
+        evolutions) use temporary state vectors, which are kept by each C++ simulator for the next operations instead
+        of being freed.
+
+        Returns:
+            A dictionary with the number and total size of the retained vectors ('buffers' and 'bytes'), their limits
+            ('max_buffers' and 'max_bytes', which is infinite if there is no limit) and the number of temporary vectors
+            which were newly allocated or reused ('allocations' and 'reuses').
+
+        Raises:
+            RuntimeError: If the simulator is not the in-memory C++ simulator.
+        """
+        if not hasattr(self._simulator, 'get_scratch_stats'):
+            raise RuntimeError('Scratch memory statistics are only available with the in-memory C++ simulator!')
+        return self._simulator.get_scratch_stats()
+
+    def set_scratch_memory_limits(self, max_buffers, max_bytes=None):
+        """
+        Limit the memory retained between operations for temporary state vectors (the largest vectors are kept).
+
+        Args:
+            max_buffers (int): Maximal number of retained vectors (2 by default, 0 frees them after each operation).
+            max_bytes (int): Maximal size of the retained vectors in bytes (None: no limit).
+
+        Raises:
+            RuntimeError: If the simulator is not the in-memory C++ simulator.
+        """
+        if not hasattr(self._simulator, 'set_scratch_limits'):
+            raise RuntimeError('Scratch memory limits are only available with the in-memory C++ simulator!')
+        self._simulator.set_scratch_limits(max_buffers, max_bytes)
+
+    def trim_scratch_memory(self, max_bytes=0):
+        """
+        Free the temporary state vectors retained by the simulator (e.g. after a memory-intensive part of a circuit).
+
+        Args:
+            max_bytes (int): Size of the retained vectors to keep at most, in bytes.
+
+        Raises:
+            RuntimeError: If the simulator is not the in-memory C++ simulator.
+        """
+        if not hasattr(self._simulator, 'trim_scratch'):
+            raise RuntimeError('Scratch memory is only available with the in-memory C++ simulator!')
+        self._simulator.trim_scratch(max_bytes)
+
+    def enable_stats(self, enable=True):
+        """
+        Enable (or disable) the performance counters of the simulator.
+
+        The counters are disabled by default, in which case they cost (almost) nothing.
+
+        Args:
+            enable (bool): Whether to record the performance counters.
+
+        Raises:
+            RuntimeError: If the simulator is not the in-memory C++ simulator.
+        """
+        if not hasattr(self._simulator, 'enable_stats'):
+            raise RuntimeError('Performance counters are only available with the in-memory C++ simulator!')
+        self._simulator.enable_stats(enable)
+
+    def get_stats(self):
+        """
+        Return the performance counters recorded since the last call to reset_stats().
+
+        Returns:
+            A dictionary with the following entries (all times are wall times in seconds):
+
+            - 'enabled': whether the counters are being recorded,
+            - 'kernel_calls' and 'kernel_time': number of kernel calls and time spent in the kernels, indexed by
+              (number of target qubits, number of control qubits),
+            - 'fused_gates_per_flush': histogram of the number of gates applied by each kernel call,
+            - 'bytes_moved' and 'flops': estimates of the memory traffic and floating point operations of the kernels,
+            - 'fusion_time', 'measurement_time' and 'emulate_math_time': time spent fusing gates, measuring qubits
+              and emulating math functions.
+
+        Raises:
+            RuntimeError: If the simulator is not the in-memory C++ simulator.
+        """
+        if not hasattr(self._simulator, 'get_stats'):
+            raise RuntimeError('Performance counters are only available with the in-memory C++ simulator!')
+        self._simulator.run()
+        return self._simulator.get_stats()
+
+    def reset_stats(self):
+        """
+        Reset the performance counters (without enabling or disabling them).
+
+        Raises:
+            RuntimeError: If the simulator is not the in-memory C++ simulator.
+        """
+        if not hasattr(self._simulator, 'reset_stats'):
+            raise RuntimeError('Performance counters are only available with the in-memory C++ simulator!')
+        self._simulator.run()
+        self._simulator.reset_stats()
 
     def select_backend(self, backend_type):
         """
@@ -346,6 +755,57 @@ class Simulator(BasicEngine):
         """
         self._simulator.select_backend(backend_type)
 
+    def set_auto_backend_thresholds(self, threaded_min_qubits, qubits_per_thread):
+        """
+        Set the problem sizes at which the Auto backend switches to the multi-threaded kernels and adds threads.
+
+        With the Auto backend, the single-threaded kernels are used below threaded_min_qubits qubits (where starting
+        threads costs more than it gains); above, each thread handles at least 2^qubits_per_thread amplitudes. The
+        thresholds are shared by all the simulators of the process; their defaults can also be set with the
+        SIM_THREADED_MIN_QUBITS and SIM_QUBITS_PER_THREAD environment variables.
+
+        Args:
+            threaded_min_qubits (int): Number of qubits from which the multi-threaded kernels are used.
+            qubits_per_thread (int): Log2 of the minimal number of amplitudes per thread.
+
+        Raises:
+            RuntimeError: If the simulator is not the in-memory C++ simulator.
+        """
+        if not hasattr(self._simulator, 'set_auto_backend_thresholds'):
+            raise RuntimeError('The automatic backend selection is only available with the in-memory C++ simulator!')
+        self._simulator.set_auto_backend_thresholds(threaded_min_qubits, qubits_per_thread)
+
+    def get_auto_backend_thresholds(self):
+        """
+        Return the thresholds of the Auto backend (see set_auto_backend_thresholds()).
+
+        Returns:
+            A tuple (threaded_min_qubits, qubits_per_thread).
+
+        Raises:
+            RuntimeError: If the simulator is not the in-memory C++ simulator.
+        """
+        if not hasattr(self._simulator, 'get_auto_backend_thresholds'):
+            raise RuntimeError('The automatic backend selection is only available with the in-memory C++ simulator!')
+        return tuple(self._simulator.get_auto_backend_thresholds())
+
+    def calibrate_auto_backend(self):
+        """
+        Measure the thresholds of the Auto backend on the current machine and use them from now on.
+
+        The single-threaded and multi-threaded kernels are timed on growing state vectors (up to 20 qubits, which
+        takes well under a second) to find where the latter become faster.
+
+        Returns:
+            The new thresholds, as a tuple (threaded_min_qubits, qubits_per_thread).
+
+        Raises:
+            RuntimeError: If the simulator is not the in-memory C++ simulator.
+        """
+        if not hasattr(self._simulator, 'calibrate_auto_backend'):
+            raise RuntimeError('The automatic backend selection is only available with the in-memory C++ simulator!')
+        return tuple(self._simulator.calibrate_auto_backend())
+
     def _handle(self, cmd):  # pylint: disable=too-many-branches,too-many-locals,too-many-statements
         """
         Handle all commands.
@@ -380,6 +840,10 @@ class Simulator(BasicEngine):
         elif cmd.gate == Allocate:
             qubit_id = cmd.qubits[0][0].id
             self._simulator.allocate_qubit(qubit_id)
+            if self._noise_model is not None:
+                channels = self._noise_model.get_qubit_channels(qubit_id)
+                if channels:
+                    self._simulator.set_qubit_noise(qubit_id, [self._channel_handles[id(c)] for c in channels])
         elif cmd.gate == Deallocate:
             qubit_id = cmd.qubits[0][0].id
             self._simulator.deallocate_qubit(qubit_id)
@@ -427,28 +891,120 @@ class Simulator(BasicEngine):
             qubitids = [qb.id for qb in cmd.qubits[0]]
             ctrlids = [qb.id for qb in cmd.control_qubits]
             self._simulator.emulate_time_evolution(op, time, qubitids, ctrlids)
-        elif len(cmd.gate.matrix) <= 2 ** 5:
-            matrix = cmd.gate.matrix
+        else:
             ids = [qb.id for qureg in cmd.qubits for qb in qureg]
-            if not 2 ** len(ids) == len(cmd.gate.matrix):
-                raise Exception(
-                    "Simulator: Error applying {} gate: "
-                    "{}-qubit gate applied to {} qubits.".format(
-                        str(cmd.gate), int(math.log(len(cmd.gate.matrix), 2)), len(ids)
+            handle = self._get_gate_handle(cmd.gate, len(ids))
+            if handle is None:
+                matrix = cmd.gate.matrix
+                if len(matrix) > 2 ** 5:
+                    raise Exception(
+                        "This simulator only supports controlled k-qubit"
+                        " gates with k < 6!\nPlease add an auto-replacer"
+                        " engine to your list of compiler engines."
+                    )
+                if not 2 ** len(ids) == len(matrix):
+                    raise Exception(
+                        "Simulator: Error applying {} gate: "
+                        "{}-qubit gate applied to {} qubits.".format(
+                            str(cmd.gate), int(math.log(len(matrix), 2)), len(ids)
+                        )
                     )
+                handle = self._get_matrix_handle(cmd.gate, matrix)
+            if handle is not None:
+                self._simulator.apply_registered_gate(handle, ids, [qb.id for qb in cmd.control_qubits])
+            else:
+                self._simulator.apply_controlled_gate(
+                    [item for sublist in matrix.tolist() for item in sublist],
+                    ids,
+                    [qb.id for qb in cmd.control_qubits],
                 )
-            self._simulator.apply_controlled_gate(
-                [item for sublist in matrix.tolist() for item in sublist], ids, [qb.id for qb in cmd.control_qubits]
-            )
+            if self._noise_model is not None:
+                self._apply_gate_noise(cmd.gate, ids, [qb.id for qb in cmd.control_qubits])
 
             if not self._gate_fusion:
                 self._simulator.run()
-        else:
-            raise Exception(
-                "This simulator only supports controlled k-qubit"
-                " gates with k < 6!\nPlease add an auto-replacer"
-                " engine to your list of compiler engines."
-            )
+
+    def _get_gate_handle(self, gate, num_qubits):
+        """
+        Return the handle of the matrix of a gate instance seen before (see _get_matrix_handle()), if any.
+
+        This avoids computing the matrix of gates applied over and over again (e.g. H).
+
+        Args:
+            gate (BasicGate): Gate of the command.
+            num_qubits (int): Number of target qubits of the command.
+
+        Returns:
+            The handle of the matrix, or None if it is unknown or the matrix does not act on num_qubits qubits.
+        """
+        if self._matrix_handles_owner is not self._simulator:
+            return None
+        cached = self._gate_handles.get(id(gate))
+        if cached is not None and cached[0] is gate and cached[2] == 2 ** num_qubits:
+            return cached[1]
+        return None
+
+    def _get_matrix_handle(self, gate, matrix):
+        """
+        Return the handle of a gate matrix registered with the C++ simulator, registering it if needed.
+
+        The handle is remembered for the gate instance (see _get_gate_handle()), which keeps the gate alive as long as
+        the simulator (for at most _MAX_CACHED_GATES gates). Once the registry is full, the matrices of other gate
+        instances are not looked up anymore.
+
+        Args:
+            gate (BasicGate): Gate of the command.
+            matrix (numpy.matrix): Matrix of the gate.
+
+        Returns:
+            The handle of the matrix, or None if the simulator does not support registered matrices or too many
+            matrices were registered already (e.g. rotations with many different angles).
+        """
+        if not hasattr(self._simulator, 'register_matrix'):
+            return None
+        if self._matrix_handles_owner is not self._simulator:
+            self._matrix_handles = {}
+            self._gate_handles = {}
+            self._matrix_handles_owner = self._simulator
+        if len(self._matrix_handles) >= _MAX_REGISTERED_MATRICES:
+            return None
+        entries = np.asarray(matrix, dtype=complex).ravel()
+        key = entries.tobytes()
+        handle = self._matrix_handles.get(key)
+        if handle is None:
+            handle = self._simulator.register_matrix(entries)
+            self._matrix_handles[key] = handle
+        # The matrix of a MatrixGate may be changed in place. The gate is kept alive, so that its id is not reused.
+        if not isinstance(gate, MatrixGate) and len(self._gate_handles) < _MAX_CACHED_GATES:
+            self._gate_handles[id(gate)] = (gate, handle, len(matrix))
+        return handle
+
+    def _apply_gate_noise(self, gate, ids, ctrlids):
+        """
+        Apply the channels of the noise model associated with a gate.
+
+        Args:
+            gate (BasicGate): Gate which was just applied.
+            ids (list[int]): IDs of the target qubits of the gate.
+            ctrlids (list[int]): IDs of the control qubits of the gate.
+        """
+        channels = [(channel, ids) for channel in self._noise_model.get_gate_channels(gate)]
+        if ctrlids:
+            controlled_gate = ControlledGate(gate, len(ctrlids))
+            channels += [(channel, ctrlids + ids) for channel in self._noise_model.get_gate_channels(controlled_gate)]
+        for channel, qubit_ids in channels:
+            handle = self._channel_handles[id(channel)]
+            if channel.num_qubits == 1:
+                for qubit_id in qubit_ids:
+                    self._simulator.apply_channel(handle, [qubit_id])
+            elif channel.num_qubits == len(qubit_ids):
+                self._simulator.apply_channel(handle, qubit_ids)
+            else:
+                raise ValueError(
+                    "Simulator: {}-qubit noise channel cannot be applied after the {}-qubit gate {}.".format(
+                        channel.num_qubits, len(qubit_ids), str(gate)
+                    )
+                )
 
     def receive(self, command_list):
         """
@@ -460,10 +1016,85 @@ class Simulator(BasicEngine):
         Args:
             command_list (list<Command>): List of commands to execute on the simulator.
         """
+        if hasattr(self._simulator, 'apply_commands') and self._noise_model is None:
+            self._receive_buffered(command_list)
+            return
+        for cmd in command_list:
+            if not cmd.gate == FlushGate():
+                self._handle(cmd)
+            else:
+                self._simulator.run()  # flush gate --> run all saved gates
+            if not self.is_last_engine:
+                self.send([cmd])
+
+    def _receive_buffered(self, command_list):
+        """
+        Handle a list of commands, packing the allocations, deallocations and gates into a command buffer.
+
+        The buffer is submitted to the C++ simulator in a single call (which releases the GIL) before any other
+        command, e.g. a measurement, is handled, and at the end of the list. The buffered commands are sent to the next
+        engine once they have been submitted, so that the commands are forwarded in order and only once they have been
+        applied.
+
+        Args:
+            command_list (list<Command>): List of commands to execute on the simulator.
+        """
+        buffer = _CommandBuffer()
+        buffered = []
+
+        def submit():
+            buffer.submit(self._simulator)
+            if not self.is_last_engine and buffered:
+                self.send(list(buffered))
+            buffered.clear()
+
         for cmd in command_list:
+            if self._buffer_command(buffer, cmd):
+                buffered.append(cmd)
+                continue
+            submit()
             if not cmd.gate == FlushGate():
                 self._handle(cmd)
             else:
                 self._simulator.run()  # flush gate --> run all saved gates
             if not self.is_last_engine:
                 self.send([cmd])
+        submit()
+
+    def _buffer_command(self, buffer, cmd):
+        """
+        Add a command to a command buffer, if it is an allocation, a deallocation or a gate given by its matrix.
+
+        Args:
+            buffer (_CommandBuffer): Buffer to add the command to.
+            cmd (Command): Command to add.
+
+        Returns:
+            True if the command was added to the buffer, False if it has to be handled by _handle().
+        """
+        if cmd.gate == Allocate:
+            buffer.allocate(cmd.qubits[0][0].id)
+            return True
+        if cmd.gate == Deallocate:
+            buffer.deallocate(cmd.qubits[0][0].id)
+            return True
+        if cmd.gate == Measure or isinstance(cmd.gate, (BasicMathGate, TimeEvolution, FlushGate)):
+            return False
+        ids = [qb.id for qureg in cmd.qubits for qb in qureg]
+        ctrlids = [qb.id for qb in cmd.control_qubits]
+        handle = self._get_gate_handle(cmd.gate, len(ids))
+        if handle is None:
+            try:
+                matrix = cmd.gate.matrix
+            except AttributeError:
+                return False
+            if len(matrix) > 2 ** 5 or 2 ** len(ids) != len(matrix):
+                return False  # _handle() raises the appropriate error
+            handle = self._get_matrix_handle(cmd.gate, matrix)
+        if handle is not None:
+            buffer.registered_gate(handle, ids, ctrlids)
+        else:
+            buffer.gate(matrix, ids, ctrlids)
+        if not self._gate_fusion:
+            buffer.run()
+        return True
@@ -45,6 +45,8 @@ from projectq.ops import (
     BasicGate,
     BasicMathGate,
     Command,
+    Deallocate,
+    FlushGate,
     H,
     MatrixGate,
     Measure,
@@ -53,6 +55,8 @@ from projectq.ops import (
     Ry,
     Rz,
     S,
+    Swap,
+    T,
     TimeEvolution,
     Toffoli,
     X,
@@ -228,6 +232,22 @@ def test_simulator_cheat(sim):
     assert len(sim.cheat()[1]) == 2
     assert 1.0 == pytest.approx(abs(sim.cheat()[1][0]))
 
+    # the state vector is a copy of the simulator's state, unless a view is requested
+    state = sim.cheat()[1]
+    assert isinstance(state, numpy.ndarray)
+    X | qubit
+    eng.flush()
+    assert 1.0 == pytest.approx(abs(state[0]))
+    view = sim.cheat(copy=False)[1]
+    assert isinstance(view, numpy.ndarray)
+    assert not view.flags.writeable
+    with pytest.raises(ValueError):
+        view[0] = 0.5
+    assert 1.0 == pytest.approx(abs(view[1]))
+    sim.cheat(writeable=True)[1][1] *= -1
+    assert -1.0 == pytest.approx(view[1].real)
+    assert -1.0 == pytest.approx(sim.cheat()[1][1].real)
+
     qubit[0].__del__()
     # should be empty:
     assert len(sim.cheat()[0]) == 0
@@ -390,6 +410,28 @@ def test_simulator_probability(sim, mapper):
     All(Measure) | qubits
 
 
+def test_simulator_probabilities(sim, mapper):
+    engine_list = [LocalOptimizer()]
+    if mapper is not None:
+        engine_list.append(mapper)
+    eng = MainEngine(sim, engine_list=engine_list)
+    qubits = eng.allocate_qureg(4)
+    Ry(2 * math.acos(math.sqrt(0.3))) | qubits[0]
+    Ry(2 * math.acos(math.sqrt(0.4))) | qubits[2]
+    X | qubits[3]
+    eng.flush()
+    probabilities = eng.backend.get_probabilities([qubits[2], qubits[0]])
+    assert isinstance(probabilities, numpy.ndarray)
+    assert probabilities == pytest.approx([0.12, 0.18, 0.28, 0.42])
+    assert eng.backend.get_probabilities([qubits[3], qubits[1]]) == pytest.approx([0.0, 1.0, 0.0, 0.0])
+    assert eng.backend.get_probabilities([]) == pytest.approx([1.0])
+    extra_qubit = eng.allocate_qubit()
+    with pytest.raises(RuntimeError):
+        eng.backend.get_probabilities(extra_qubit)
+    del extra_qubit
+    All(Measure) | qubits
+
+
 def test_simulator_amplitude(sim, mapper):
     engine_list = [LocalOptimizer()]
     if mapper is not None:
@@ -619,6 +661,41 @@ def test_simulator_set_wavefunction_always_complex(sim):
     assert eng.backend.get_amplitude('1', qubit) == pytest.approx(1j)
 
 
+def test_simulator_set_wavefunction_numpy(sim):
+    eng = MainEngine(sim, engine_list=[])
+    qubits = eng.allocate_qureg(2)
+    eng.flush()
+    wf = numpy.array([0.0, 0.0, math.sqrt(0.2), math.sqrt(0.8)], dtype=numpy.complex128)
+    eng.backend.set_wavefunction(wf, qubits)
+    assert pytest.approx(eng.backend.get_probability('01', qubits)) == 0.2
+    assert pytest.approx(eng.backend.get_probability('11', qubits)) == 0.8
+
+    # Preparing the state in place through the writeable view
+    mapping, view = eng.backend.cheat(writeable=True)
+    view[:] = 0
+    view[0] = 1.0
+    eng.backend.set_wavefunction(view, sorted(qubits, key=lambda q: mapping[q.id]))
+    assert pytest.approx(eng.backend.get_probability('00', qubits)) == 1.0
+    All(Measure) | qubits
+
+
+def test_simulator_set_wavefunction_in_place_pending_gates(sim):
+    eng = MainEngine(sim, engine_list=[])
+    qubits = eng.allocate_qureg(2)
+    All(H) | qubits
+    eng.flush()
+    mapping, view = eng.backend.cheat(writeable=True)
+
+    # Not flushed: the gate may still be pending in the simulator when the amplitudes are written
+    X | qubits[0]
+    view[:] = 0
+    view[1 << mapping[qubits[0].id]] = 1.0
+    eng.backend.set_wavefunction(view, sorted(qubits, key=lambda q: mapping[q.id]))
+    eng.flush()
+    assert pytest.approx(eng.backend.get_probability('10', qubits)) == 1.0
+    All(Measure) | qubits
+
+
 def test_simulator_collapse_wavefunction(sim, mapper):
     engine_list = [LocalOptimizer()]
     if mapper is not None:
@@ -804,3 +881,676 @@ def test_simulator_constant_math_emulation():
         ref = result[0]
         for res in result[1:]:
             assert ref == res
+
+
+def test_simulator_out_of_core(tmp_path):
+    if len(get_available_simulators()) == 1:
+        pytest.skip("No C++ simulator")
+        return
+
+    def run_circuit(sim):
+        eng = MainEngine(sim, [])
+        qureg = eng.allocate_qureg(8)
+        All(H) | qureg
+        for i in range(7):
+            CNOT | (qureg[i], qureg[7 - i])
+            Rx(0.3 * i) | qureg[i]
+            Ry(0.1 + i) | qureg[7 - i]
+        with Control(eng, qureg[6:]):
+            Rz(0.7) | qureg[0]
+        eng.flush()
+        probabilities = [eng.backend.get_probability('1', [qb]) for qb in qureg]
+        expectation = eng.backend.get_expectation_value(QubitOperator('X0 Y5 Z7') + 0.3 * QubitOperator('Z6'), qureg)
+        amplitude = eng.backend.get_amplitude('01100101', qureg)
+        eng.backend.collapse_wavefunction(qureg[6:], [1, 0])
+        collapsed = [eng.backend.get_probability('1', [qb]) for qb in qureg[:6]]
+        All(Measure) | qureg
+        return probabilities, expectation, amplitude, collapsed
+
+    ooc_sim = Simulator(rnd_seed=1, storage_dir=tmp_path, local_qubits=5)
+    ref = run_circuit(Simulator(rnd_seed=1))
+    res = run_circuit(ooc_sim)
+    assert numpy.allclose(res[0], ref[0])
+    assert res[1] == pytest.approx(ref[1])
+    assert res[2] == pytest.approx(ref[2])
+    assert numpy.allclose(res[3], ref[3])
+
+    stats = ooc_sim.get_io_stats()
+    assert stats['bytes_read'] > 0 and stats['bytes_written'] > 0
+    assert stats['bytes_read_per_gate'] > 0
+    ooc_sim.reset_io_stats()
+    assert ooc_sim.get_io_stats()['bytes_read'] == 0
+
+    assert not ooc_sim.is_available(
+        Command(None, TimeEvolution(1.0, QubitOperator('X0')), qubits=([WeakQubitRef(engine=None, idx=0)],))
+    )
+    with pytest.raises(RuntimeError):
+        Simulator().get_io_stats()
+    with pytest.raises(RuntimeError):
+        Simulator().reset_io_stats()
+
+
+def test_simulator_fusion_cache():
+    from projectq.backends._sim._pysim import Simulator as PySim
+
+    pysim = Simulator()
+    pysim._simulator = PySim(1)
+    with pytest.raises(RuntimeError):
+        pysim.get_fusion_cache_stats()
+    with pytest.raises(RuntimeError):
+        pysim.reset_fusion_cache_stats()
+    with pytest.raises(RuntimeError):
+        pysim.set_fusion_cache_size(4)
+
+    if len(get_available_simulators()) == 1:
+        pytest.skip("No C++ simulator")
+        return
+
+    def run_layers(sim, angles):
+        eng = MainEngine(sim, [])
+        qureg = eng.allocate_qureg(6)
+        for angle in angles:
+            for i in range(5):
+                Rx(angle) | qureg[i]
+                CNOT | (qureg[i], qureg[i + 1])
+            Ry(angle) | qureg[5]
+            eng.flush()
+        wavefunction = numpy.array(eng.backend.cheat()[1])
+        All(Measure) | qureg
+        return wavefunction
+
+    sim = Simulator(gate_fusion=True)
+    uncached = Simulator(gate_fusion=True)
+    uncached.set_fusion_cache_size(0)
+    angles = [0.1, 0.2] * 5
+    assert numpy.allclose(run_layers(sim, angles), run_layers(uncached, angles))
+
+    stats = sim.get_fusion_cache_stats()
+    assert stats['hits'] > 0 and stats['misses'] > 0
+    assert 0 < stats['size'] <= stats['capacity']
+    assert uncached.get_fusion_cache_stats()['hits'] == 0
+
+    # Different angles never hit
+    sim.reset_fusion_cache_stats()
+    assert sim.get_fusion_cache_stats()['hits'] == 0
+    run_layers(sim, [0.3, 0.4])
+    assert sim.get_fusion_cache_stats()['hits'] == 0
+
+
+def test_simulator_scratch_memory():
+    from projectq.backends._sim._pysim import Simulator as PySim
+
+    pysim = Simulator()
+    pysim._simulator = PySim(1)
+    with pytest.raises(RuntimeError):
+        pysim.get_scratch_memory_stats()
+    with pytest.raises(RuntimeError):
+        pysim.set_scratch_memory_limits(2)
+    with pytest.raises(RuntimeError):
+        pysim.trim_scratch_memory()
+
+    if len(get_available_simulators()) == 1:
+        pytest.skip("No C++ simulator")
+        return
+
+    def run_circuit(sim):
+        eng = MainEngine(sim, [])
+        qureg = eng.allocate_qureg(8)
+        All(H) | qureg
+        for i in range(7):
+            CNOT | (qureg[i], qureg[i + 1])
+        TimeEvolution(0.5, QubitOperator('X0 Z1') + 0.3 * QubitOperator('Y2')) | qureg
+        eng.flush()
+        expectation = eng.backend.get_expectation_value(QubitOperator('Z0 X3'), qureg)
+        wavefunction = numpy.array(eng.backend.cheat()[1])
+        All(Measure) | qureg
+        return expectation, wavefunction
+
+    sim = Simulator()
+    unbuffered = Simulator()
+    unbuffered.set_scratch_memory_limits(0)
+    expectation, wavefunction = run_circuit(sim)
+    unbuffered_expectation, unbuffered_wavefunction = run_circuit(unbuffered)
+    assert expectation == pytest.approx(unbuffered_expectation)
+    assert numpy.allclose(wavefunction, unbuffered_wavefunction)
+
+    stats = sim.get_scratch_memory_stats()
+    assert 0 < stats['buffers'] <= stats['max_buffers'] == 2
+    assert stats['bytes'] >= 16 * 2**8 and stats['max_bytes'] == float('inf')
+    assert stats['reuses'] > 0
+    assert unbuffered.get_scratch_memory_stats()['buffers'] == 0
+
+    sim.set_scratch_memory_limits(3, 16 * 2**8)
+    assert sim.get_scratch_memory_stats()['bytes'] <= 16 * 2**8
+    sim.trim_scratch_memory()
+    assert sim.get_scratch_memory_stats()['buffers'] == 0
+
+
+def test_simulator_lookahead_fusion_options():
+    for gate_fusion in ('greedy', {'windows': 8}, {'window': 0}, {'max_qubits': 6}):
+        with pytest.raises(ValueError):
+            Simulator(gate_fusion=gate_fusion)
+
+    # Any planner configuration enables gate fusion, even an empty one
+    for gate_fusion in ('lookahead', {}, {'window': 8}, True, 1):
+        assert Simulator(gate_fusion=gate_fusion)._gate_fusion
+    for gate_fusion in (False, None, 0):
+        assert not Simulator(gate_fusion=gate_fusion)._gate_fusion
+
+
+def test_simulator_lookahead_fusion_unsupported():
+    from projectq.backends._sim._pysim import Simulator as PySim
+
+    sim = Simulator()
+    sim._simulator = PySim(1)
+    with pytest.warns(UserWarning):
+        sim._configure_fusion_planner('lookahead')
+
+    # The out-of-core and distributed simulators do not reorder gates
+    sim._out_of_core = True
+    with pytest.raises(ValueError):
+        sim._configure_fusion_planner({'window': 8})
+
+
+@pytest.mark.parametrize("gate_fusion", ['lookahead', {}, {'window': 8, 'max_qubits': 3}, {'window': 1}])
+def test_simulator_lookahead_fusion(gate_fusion):
+    if len(get_available_simulators()) == 1:
+        pytest.skip("No C++ simulator")
+        return
+
+    def run_circuit(sim):
+        eng = MainEngine(sim, [])
+        qureg = eng.allocate_qureg(7)
+        rng = random.Random(3)
+        for _ in range(60):
+            qubits = [qureg[i] for i in rng.sample(range(7), 3)]
+            kind = rng.randrange(7)
+            if kind < 4:
+                [H, T, Rx(0.3), Rz(1.2)][kind] | qubits[0]
+            elif kind == 4:
+                CNOT | (qubits[0], qubits[1])
+            elif kind == 5:
+                with Control(eng, qubits[:2]):
+                    Rz(0.7) | qubits[2]
+            else:
+                Swap | (qubits[0], qubits[1])
+        eng.flush()
+        probabilities = eng.backend.get_probabilities(qureg)
+        wavefunction = numpy.array(eng.backend.cheat()[1])
+        All(Measure) | qureg
+        return probabilities, wavefunction
+
+    ref = run_circuit(Simulator(gate_fusion=False))
+    res = run_circuit(Simulator(gate_fusion=gate_fusion))
+    assert numpy.allclose(res[0], ref[0])
+    assert numpy.allclose(res[1], ref[1])
+
+
+def test_simulator_stats():
+    from projectq.backends._sim._pysim import Simulator as PySim
+    from projectq.libs.math import AddConstant
+
+    pysim = Simulator()
+    pysim._simulator = PySim(1)
+    with pytest.raises(RuntimeError):
+        pysim.enable_stats()
+    with pytest.raises(RuntimeError):
+        pysim.get_stats()
+    with pytest.raises(RuntimeError):
+        pysim.reset_stats()
+
+    if len(get_available_simulators()) == 1:
+        pytest.skip("No C++ simulator")
+        return
+
+    sim = Simulator(gate_fusion=False)
+    eng = MainEngine(sim, [])
+    qureg = eng.allocate_qureg(4)
+    H | qureg[0]
+    eng.flush()
+    stats = sim.get_stats()
+    assert not stats['enabled']
+    assert stats['kernel_calls'] == {} and stats['flops'] == 0
+
+    sim.enable_stats()
+    H | qureg[1]
+    CNOT | (qureg[0], qureg[2])
+    with Control(eng, qureg[:2]):
+        Rx(0.3) | qureg[3]
+    AddConstant(3) | qureg
+    Measure | qureg[3]
+    eng.flush()
+    stats = sim.get_stats()
+    assert stats['enabled']
+    assert stats['kernel_calls'] == {(1, 0): 1, (1, 1): 1, (1, 2): 1}
+    assert set(stats['kernel_time']) == set(stats['kernel_calls'])
+    assert stats['fused_gates_per_flush'] == {1: 3}
+    # 16 + 8 + 4 amplitudes, each read and written once and updated with 2 complex multiply-adds
+    assert stats['bytes_moved'] == 2 * 16 * (16 + 8 + 4)
+    assert stats['flops'] == 8 * 2 * (16 + 8 + 4)
+    assert stats['measurement_time'] > 0 and stats['emulate_math_time'] > 0
+
+    sim.reset_stats()
+    stats = sim.get_stats()
+    assert stats['enabled'] and stats['kernel_calls'] == {} and stats['measurement_time'] == 0
+    sim.enable_stats(False)
+    All(X) | qureg
+    eng.flush()
+    assert sim.get_stats()['kernel_calls'] == {}
+    All(Measure) | qureg
+
+
+def test_simulator_auto_backend_thresholds():
+    from projectq.backends._sim._pysim import Simulator as PySim
+
+    pysim = Simulator()
+    pysim._simulator = PySim(1)
+    with pytest.raises(RuntimeError):
+        pysim.set_auto_backend_thresholds(10, 8)
+    with pytest.raises(RuntimeError):
+        pysim.get_auto_backend_thresholds()
+    with pytest.raises(RuntimeError):
+        pysim.calibrate_auto_backend()
+
+    if len(get_available_simulators()) == 1:
+        pytest.skip("No C++ simulator")
+        return
+
+    sim = Simulator()
+    thresholds = sim.get_auto_backend_thresholds()
+    try:
+        # Crosses the switch point to the multi-threaded kernels (and back) while the state is being built
+        sim.set_auto_backend_thresholds(3, 2)
+        assert sim.get_auto_backend_thresholds() == (3, 2)
+        eng = MainEngine(sim, [])
+        qureg = eng.allocate_qureg(2)
+        All(H) | qureg
+        qureg += eng.allocate_qureg(4)
+        All(H) | qureg[2:]
+        eng.flush()
+        _, wavefunction = sim.cheat()
+        assert numpy.allclose(wavefunction, 1 / 8.0)
+        All(Measure) | qureg[2:]
+        for qubit in qureg[2:]:
+            qubit.__del__()
+        eng.flush()
+        _, wavefunction = sim.cheat()
+        assert len(wavefunction) == 4
+        assert numpy.allclose(wavefunction, 0.5)
+        All(Measure) | qureg[:2]
+
+        threaded_min_qubits, qubits_per_thread = sim.calibrate_auto_backend()
+        assert sim.get_auto_backend_thresholds() == (threaded_min_qubits, qubits_per_thread)
+        assert qubits_per_thread < threaded_min_qubits
+    finally:
+        sim.set_auto_backend_thresholds(*thresholds)
+
+
+def test_simulator_lazy_allocation():
+    if len(get_available_simulators()) == 1:
+        pytest.skip("No C++ simulator")
+        return
+
+    sim = Simulator()
+    eng = MainEngine(sim, [])
+    qureg = eng.allocate_qureg(4)
+    X | qureg[2]
+    with Control(eng, qureg[3]):
+        X | qureg[0]  # qureg[3] was never acted upon: the gate does nothing
+    eng.flush()
+    assert sim.get_probability('1', [qureg[2]]) == pytest.approx(1.0)
+    assert sim.get_probability('0', [qureg[3]]) == pytest.approx(1.0)
+    # Deallocating untouched qubits does not require a measurement
+    qureg[3].__del__()
+    eng.flush()
+    mapping, wavefunction = sim.cheat()
+    assert sorted(mapping.values()) == [0, 1, 2]
+    assert len(wavefunction) == 8
+    assert abs(wavefunction[1 << mapping[qureg[2].id]]) == pytest.approx(1.0)
+    All(Measure) | qureg[:3]
+
+    cppsim = Simulator()._simulator
+    cppsim.allocate_qureg([0, 1, 2])
+    with pytest.raises(RuntimeError):
+        cppsim.allocate_qureg([3, 3])
+    cppsim.allocate_qureg([3])
+    assert cppsim.is_classical(3)
+    _, wavefunction = cppsim.cheat()
+    assert len(wavefunction) == 16
+
+    # Only the qubits acted upon take memory (the whole register would need 2^40 amplitudes)
+    cppsim = Simulator()._simulator
+    cppsim.allocate_qureg(list(range(40)))
+    cppsim.apply_controlled_gate(H.matrix.tolist(), [0], [])
+    cppsim.apply_controlled_gate(X.matrix.tolist(), [1], [0])
+    cppsim.run()
+    assert cppsim.get_probability([1, 1], [0, 1]) == pytest.approx(0.5)
+    assert cppsim.get_scratch_stats()['bytes'] <= 16 * 2**2
+
+    # A gate between qubits far apart only stores these two qubits
+    cppsim = Simulator()._simulator
+    cppsim.allocate_qureg(list(range(24)))
+    for qubit_id in range(24):
+        cppsim.apply_controlled_gate(H.matrix.tolist(), [qubit_id], [])
+    cppsim.apply_controlled_gate(X.matrix.tolist(), [23], [0])
+    cppsim.run()
+    assert cppsim.num_stored_qubits() == 2
+    assert cppsim.get_probabilities([0, 23, 12]) == pytest.approx([0.125] * 8)
+    assert cppsim.num_stored_qubits() == 2
+
+
+def test_simulator_product_state():
+    from projectq.backends._sim._pysim import Simulator as PySim
+
+    def run_circuit(sim):
+        eng = MainEngine(sim, [])
+        qureg = eng.allocate_qureg(4)
+        Ry(0.3) | qureg[0]
+        H | qureg[1]
+        S | qureg[1]
+        X | qureg[2]
+        with Control(eng, qureg[2]):
+            Rx(0.5) | qureg[3]  # the control is in |1>
+        eng.flush()
+        results = [
+            eng.backend.get_probability('10', qureg[:2]),
+            eng.backend.get_expectation_value(QubitOperator('Z0 Y1') + 0.5 * QubitOperator('X3 Z2'), qureg),
+        ]
+        CNOT | (qureg[0], qureg[1])
+        eng.flush()
+        results.append(eng.backend.get_expectation_value(QubitOperator('Z0 Z1'), qureg))
+        Measure | qureg[2]
+        results.append(int(qureg[2]))
+        eng.flush()
+        results.append(eng.backend.cheat()[1])
+        All(Measure) | qureg
+        return results
+
+    pysim = Simulator(rnd_seed=1)
+    pysim._simulator = PySim(1)
+    ref = run_circuit(pysim)
+
+    if len(get_available_simulators()) == 1:
+        pytest.skip("No C++ simulator")
+        return
+
+    res = run_circuit(Simulator(rnd_seed=1))
+    for value, expected in zip(res[:4], ref[:4]):
+        assert value == pytest.approx(expected)
+    assert numpy.allclose(res[4], ref[4])
+
+
+def test_simulator_classical_tracking():
+    from projectq.backends._sim._pysim import Simulator as PySim
+
+    def run_circuit(sim):
+        eng = MainEngine(sim, [])
+        qureg = eng.allocate_qureg(4)
+        All(H) | qureg
+        CNOT | (qureg[0], qureg[1])
+        CNOT | (qureg[2], qureg[3])
+        Measure | qureg[0]
+        results = [int(qureg[0])]
+        with Control(eng, qureg[0]):
+            Ry(0.4) | qureg[2]
+        X | qureg[0]
+        with Control(eng, qureg[0]):
+            Rx(0.7) | qureg[3]
+        Swap | (qureg[0], qureg[1])
+        eng.flush()
+        eng.backend.collapse_wavefunction([qureg[2]], [1])
+        with Control(eng, qureg[2]):
+            Rz(0.3) | qureg[3]
+        eng.flush()
+        results.append(eng.backend.get_probability('1', [qureg[1]]))
+        results.append(eng.backend.cheat()[1])
+        Measure | qureg[1]
+        results.append(int(qureg[1]))
+        Deallocate | qureg[1]
+        eng.flush()
+        results.append(eng.backend.cheat()[1])
+        All(Measure) | [qureg[0], qureg[2], qureg[3]]
+        return results
+
+    pysim = Simulator(rnd_seed=1)
+    pysim._simulator = PySim(1)
+    ref = run_circuit(pysim)
+    assert ref[1] == pytest.approx(1 - ref[0])
+    assert ref[3] == 1 - ref[0]
+
+    if len(get_available_simulators()) == 1:
+        pytest.skip("No C++ simulator")
+        return
+
+    res = run_circuit(Simulator(rnd_seed=1))
+    assert res[0] == ref[0]
+    assert res[1] == pytest.approx(ref[1])
+    assert numpy.allclose(res[2], ref[2])
+    assert res[3] == ref[3]
+    assert numpy.allclose(res[4], ref[4])
+
+
+def test_simulator_command_buffer():
+    from projectq.backends._sim._pysim import Simulator as PySim
+
+    class BufferedPySim(PySim):
+        """Python simulator decoding the packed command buffers (see include/command_buffer.hpp)."""
+
+        def __init__(self, rnd_seed):
+            super().__init__(rnd_seed)
+            self.num_submissions = 0
+
+        def apply_commands(self, words, matrices):
+            assert words.dtype == numpy.int64 and matrices.dtype == complex
+            self.num_submissions += 1
+            words = words.tolist()
+            pos = 0
+            while pos < len(words):
+                opcode = words[pos]
+                if opcode == 0:
+                    num_ids, num_ctrls, offset = words[pos + 1 : pos + 4]
+                    ids = words[pos + 4 : pos + 4 + num_ids]
+                    ctrls = words[pos + 4 + num_ids : pos + 4 + num_ids + num_ctrls]
+                    self.apply_controlled_gate(matrices[offset : offset + 4 ** num_ids].tolist(), ids, ctrls)
+                    pos += 4 + num_ids + num_ctrls
+                elif opcode == 1:
+                    self.allocate_qubit(words[pos + 1])
+                    pos += 2
+                elif opcode == 2:
+                    self.deallocate_qubit(words[pos + 1])
+                    pos += 2
+                else:
+                    assert opcode == 3
+                    self.run()
+                    pos += 1
+
+    def run_circuit(sim):
+        eng = MainEngine(sim, [])
+        qureg = eng.allocate_qureg(4)
+        All(H) | qureg
+        CNOT | (qureg[0], qureg[3])
+        with Control(eng, qureg[1:3]):
+            Rx(0.4) | qureg[0]
+        MatrixGate([[0, 1, 0, 0], [1, 0, 0, 0], [0, 0, 0, 1j], [0, 0, 1j, 0]]) | (qureg[1], qureg[3])
+        Measure | qureg[2]
+        Ry(0.2) | qureg[1]
+        eng.flush()
+        _, wavefunction = eng.backend.cheat()
+        All(Measure) | qureg
+        return wavefunction
+
+    ref = run_circuit(Simulator(rnd_seed=3))
+    sim = Simulator(rnd_seed=3)
+    sim._simulator = BufferedPySim(3)
+    assert numpy.allclose(run_circuit(sim), ref)
+    assert sim._simulator.num_submissions > 0
+
+    class NextEngine(DummyEngine):
+        """Engine checking that the commands are forwarded once the simulator has applied them."""
+
+        def receive(self, command_list):
+            for cmd in command_list:
+                if cmd.gate == Allocate:
+                    assert cmd.qubits[0][0].id in sim._simulator._map
+                self.received_commands.append(cmd)
+
+    sim = Simulator(rnd_seed=3)
+    sim._simulator = BufferedPySim(3)
+    eng = MainEngine(NextEngine(), [sim])
+    qureg = eng.allocate_qureg(2)
+    H | qureg[0]
+    CNOT | (qureg[0], qureg[1])
+    Measure | qureg[1]
+    eng.flush()
+    gates = [cmd.gate for cmd in eng.backend.received_commands]
+    assert gates == [Allocate, Allocate, H, X, Measure, FlushGate()]
+
+    if len(get_available_simulators()) == 1:
+        pytest.skip("No C++ simulator")
+        return
+
+    for gate_fusion in (False, True):
+        assert numpy.allclose(run_circuit(Simulator(rnd_seed=3, gate_fusion=gate_fusion)), ref)
+
+    cppsim = Simulator()._simulator
+    cppsim.allocate_qubit(0)
+    with pytest.raises(ValueError):
+        cppsim.apply_commands(numpy.array([0, 1, 0], dtype=numpy.int64), numpy.zeros(4, dtype=complex))
+    with pytest.raises(ValueError):
+        cppsim.apply_commands(numpy.array([0, 1, 0, 2, 0], dtype=numpy.int64), numpy.zeros(4, dtype=complex))
+    with pytest.raises(ValueError):
+        cppsim.apply_commands(numpy.array([7], dtype=numpy.int64), numpy.zeros(0, dtype=complex))
+
+
+def test_simulator_matrix_registry(monkeypatch):
+    import projectq.backends._sim._simulator as _sim
+    from projectq.backends._sim._pysim import Simulator as PySim
+
+    class RegistryPySim(PySim):
+        """Python simulator with a (non-interning) matrix registry."""
+
+        def __init__(self, rnd_seed):
+            super().__init__(rnd_seed)
+            self.matrices = []
+
+        def register_matrix(self, matrix):
+            self.matrices.append(matrix.tolist())
+            return len(self.matrices) - 1
+
+        def apply_registered_gate(self, handle, ids, ctrlids):
+            self.apply_controlled_gate(self.matrices[handle], ids, ctrlids)
+
+    def run_circuit(sim):
+        eng = MainEngine(sim, [])
+        qureg = eng.allocate_qureg(3)
+        for _ in range(3):
+            All(H) | qureg
+            CNOT | (qureg[0], qureg[2])
+            T | qureg[1]
+            Rx(0.1) | qureg[2]
+        eng.flush()
+        _, wavefunction = eng.backend.cheat()
+        All(Measure) | qureg
+        return wavefunction
+
+    ref = run_circuit(Simulator(rnd_seed=1))
+    sim = Simulator(rnd_seed=1)
+    sim._simulator = RegistryPySim(1)
+    assert numpy.allclose(run_circuit(sim), ref)
+    assert len(sim._simulator.matrices) == 4
+
+    # Once the registry is full, the other matrices are sent with each gate
+    monkeypatch.setattr(_sim, '_MAX_REGISTERED_MATRICES', 2)
+    sim = Simulator(rnd_seed=1)
+    sim._simulator = RegistryPySim(1)
+    assert numpy.allclose(run_circuit(sim), ref)
+    assert len(sim._simulator.matrices) == 2
+    monkeypatch.undo()
+
+    # The matrix of a gate instance is only computed the first time it is applied
+    class CountingGate(BasicGate):
+        def __init__(self):
+            super().__init__()
+            self.num_matrix_calls = 0
+
+        @property
+        def matrix(self):
+            self.num_matrix_calls += 1
+            return H.matrix
+
+    gate = CountingGate()
+    sim = Simulator(rnd_seed=1)
+    sim._simulator = RegistryPySim(1)
+    eng = MainEngine(sim, [])
+    qubit = eng.allocate_qubit()
+    for _ in range(3):
+        gate | qubit
+    eng.flush()
+    assert gate.num_matrix_calls == 1
+    cmd = Command(eng, gate, ([qubit[0]],))
+    assert sim._buffer_command(_sim._CommandBuffer(), cmd)
+    assert gate.num_matrix_calls == 1
+    Measure | qubit
+
+    if len(get_available_simulators()) == 1:
+        pytest.skip("No C++ simulator")
+        return
+
+    assert numpy.allclose(run_circuit(Simulator(rnd_seed=1)), ref)
+
+    cppsim = Simulator()._simulator
+    handles = {
+        name: cppsim.register_matrix(numpy.asarray(gate.matrix, dtype=complex).ravel())
+        for name, gate in (('H', H), ('X', X), ('T', T), ('CNOT', CNOT), ('Rx', Rx(0.2)))
+    }
+    assert cppsim.register_matrix(numpy.asarray(X.matrix, dtype=complex).ravel()) == handles['X']
+    assert cppsim.num_registered_matrices() == 5
+    for handle in handles.values():
+        assert cppsim.get_matrix_classification(handle) == {'identity': False}
+    identity = cppsim.register_matrix(numpy.eye(4, dtype=complex).ravel())
+    assert cppsim.get_matrix_classification(identity) == {'identity': True}
+
+    cppsim.allocate_qubit(0)
+    with pytest.raises(ValueError):
+        cppsim.apply_registered_gate(handles['CNOT'], [0], [])
+    with pytest.raises(ValueError):
+        cppsim.register_matrix(numpy.zeros(8, dtype=complex))
+    cppsim.clear_matrix_registry()
+    with pytest.raises(ValueError):
+        cppsim.apply_registered_gate(handles['X'], [0], [])
+
+
+@pytest.mark.parametrize("transport", ['shm', 'tcp'])
+def test_simulator_distributed(transport):
+    if len(get_available_simulators()) == 1:
+        pytest.skip("No C++ simulator")
+        return
+
+    def run_circuit(sim):
+        eng = MainEngine(sim, [])
+        qureg = eng.allocate_qureg(8)
+        All(H) | qureg
+        for i in range(7):
+            CNOT | (qureg[i], qureg[7 - i])
+            Rx(0.3 * i) | qureg[i]
+            Rz(0.1 + i) | qureg[7 - i]
+        with Control(eng, qureg[6:]):
+            Ry(0.7) | qureg[0]
+        eng.flush()
+        probabilities = [eng.backend.get_probability('1', [qb]) for qb in qureg]
+        expectation = eng.backend.get_expectation_value(QubitOperator('X0 Y5 Z7') + 0.3 * QubitOperator('X6'), qureg)
+        amplitude = eng.backend.get_amplitude('01100101', qureg)
+        eng.backend.collapse_wavefunction(qureg[6:], [1, 0])
+        collapsed = [eng.backend.get_probability('1', [qb]) for qb in qureg[:6]]
+        All(Measure) | qureg
+        return probabilities, expectation, amplitude, collapsed
+
+    ref = run_circuit(Simulator(rnd_seed=1))
+    res = run_circuit(Simulator(rnd_seed=1, num_processes=4, transport=transport))
+    assert numpy.allclose(res[0], ref[0])
+    assert res[1] == pytest.approx(ref[1])
+    assert res[2] == pytest.approx(ref[2])
+    assert numpy.allclose(res[3], ref[3])
+
+    with pytest.raises(ValueError):
+        Simulator(num_processes=2, storage_dir='.')
@@ -0,0 +1,248 @@
+# -*- coding: utf-8 -*-
+#   Copyright 2021 <Huawei Technologies Co., Ltd>
+#
+#   Licensed under the Apache License, Version 2.0 (the "License");
+#   you may not use this file except in compliance with the License.
+#   You may obtain a copy of the License at
+#
+#       http://www.apache.org/licenses/LICENSE-2.0
+#
+#   Unless required by applicable law or agreed to in writing, software
+#   distributed under the License is distributed on an "AS IS" BASIS,
+#   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+#   See the License for the specific language governing permissions and
+#   limitations under the License.
+
+"""
+Contains a compiler engine which simulates Clifford circuits using the stabilizer formalism.
+
+The C++ implementation stores the CHP tableau as bit-packed rows and can simulate thousands of qubits. If it is not
+available, a (slow) Python implementation is used instead.
+"""
+
+# pylint: disable=no-name-in-module
+
+import random
+
+from projectq.cengines import BasicEngine
+from projectq.meta import LogicalQubitIDTag, get_control_count, has_negative_control
+from projectq.ops import (
+    Allocate,
+    Deallocate,
+    FlushGate,
+    H,
+    Measure,
+    S,
+    Sdag,
+    Swap,
+    X,
+    Y,
+    Z,
+)
+from projectq.types import WeakQubitRef
+
+try:
+    from ._cppsim import StabilizerSimulator as StabilizerSimulatorBackend
+except ImportError:  # pragma: no cover
+    from ._pystabilizer import StabilizerSimulator as StabilizerSimulatorBackend
+
+
+class StabilizerSimulator(BasicEngine):
+    """
+    Compiler engine simulating Clifford circuits.
+
+    The state of n qubits is described by n stabilizer generators (and n destabilizers), which requires O(n^2) bits of
+    memory. Gates take O(n) time and measurements O(n^2), so that circuits on hundreds or thousands of qubits can be
+    simulated. Only the gates H, S, S^dagger, X, Y, Z, CNOT, CZ and Swap are supported, which is enough for
+    error-correction circuits and randomized benchmarking.
+    """
+
+    def __init__(self, rnd_seed=None):
+        """
+        Construct the stabilizer simulator and initialize it with a random seed.
+
+        Args:
+            rnd_seed (int): Random seed (uses random.randint(0, 4294967295) by default).
+        """
+        if rnd_seed is None:
+            rnd_seed = random.randint(0, 4294967295)
+        super().__init__()
+        self._simulator = StabilizerSimulatorBackend(rnd_seed)
+
+    def is_available(self, cmd):
+        """
+        Test whether a Command is supported by a compiler engine.
+
+        Specialized implementation of is_available: The stabilizer simulator can deal with the Clifford gates H, S,
+        S^dagger, X, Y, Z and Swap, with X and Z also accepting one control qubit (CNOT and CZ).
+
+        Args:
+            cmd (Command): Command for which to check availability
+
+        Returns:
+            True if it can be simulated and False otherwise.
+        """
+        if has_negative_control(cmd):
+            return False
+
+        num_controls = get_control_count(cmd)
+        if cmd.gate in (Measure, Allocate, Deallocate, H, S, Sdag, Y, Swap):
+            return num_controls == 0
+        if cmd.gate in (X, Z):
+            return num_controls <= 1
+        return False
+
+    def _convert_logical_to_mapped_qureg(self, qureg):
+        """
+        Convert a qureg from logical to mapped qubits if there is a mapper.
+
+        Args:
+            qureg (list[Qubit],Qureg): Logical quantum bits
+        """
+        mapper = self.main_engine.mapper
+        if mapper is not None:
+            mapped_qureg = []
+            for qubit in qureg:
+                if qubit.id not in mapper.current_mapping:
+                    raise RuntimeError("Unknown qubit id. Please make sure you have called eng.flush().")
+                new_qubit = WeakQubitRef(qubit.engine, mapper.current_mapping[qubit.id])
+                mapped_qureg.append(new_qubit)
+            return mapped_qureg
+        return qureg
+
+    def get_expectation_value(self, qubit_operator, qureg):
+        """
+        Return the expectation value of a qubit operator.
+
+        The expectation value of each Pauli string is either 0 or +/-1 for a stabilizer state.
+
+        Args:
+            qubit_operator (projectq.ops.QubitOperator): Operator to measure.
+            qureg (list[Qubit],Qureg): Quantum bits to measure.
+
+        Returns:
+            Expectation value
+
+        Note:
+            If there is a mapper present in the compiler, this function automatically converts from logical qubits to
+            mapped qubits for the qureg argument.
+
+        Raises:
+            Exception: If `qubit_operator` acts on more qubits than present in the `qureg` argument.
+        """
+        qureg = self._convert_logical_to_mapped_qureg(qureg)
+        num_qubits = len(qureg)
+        for term, _ in qubit_operator.terms.items():
+            if not term == () and term[-1][0] >= num_qubits:
+                raise Exception("qubit_operator acts on more qubits than contained in the qureg.")
+        operator = [(list(term), coeff) for (term, coeff) in qubit_operator.terms.items()]
+        return self._simulator.get_expectation_value(operator, [qb.id for qb in qureg])
+
+    def get_probability(self, bit_string, qureg):
+        """
+        Return the probability of the outcome `bit_string` when measuring the quantum register `qureg`.
+
+        Args:
+            bit_string (list[bool|int]|string[0|1]): Measurement outcome.
+            qureg (Qureg|list[Qubit]): Quantum register.
+
+        Returns:
+            Probability of measuring the provided bit string (either 0 or a power of 1/2).
+
+        Note:
+            If there is a mapper present in the compiler, this function automatically converts from logical qubits to
+            mapped qubits for the qureg argument.
+        """
+        qureg = self._convert_logical_to_mapped_qureg(qureg)
+        bit_string = [bool(int(b)) for b in bit_string]
+        return self._simulator.get_probability(bit_string, [qb.id for qb in qureg])
+
+    def cheat(self):
+        """
+        Access the ordering of the qubits and the stabilizer generators.
+
+        Returns:
+            A tuple where the first entry is a dictionary mapping qubit indices to bit-locations and the second entry is
+            the list of stabilizer generators as strings such as '+XZI' or '-YYI' (the character following the sign
+            at index p corresponds to the qubit at location p).
+
+        Note:
+            If there is a mapper present in the compiler, this function DOES NOT automatically convert from logical
+            qubits to mapped qubits.
+        """
+        return self._simulator.cheat()
+
+    def _handle(self, cmd):  # pylint: disable=too-many-branches
+        """
+        Handle all commands.
+
+        Args:
+            cmd (Command): Command to handle.
+
+        Raises:
+            Exception: If a non-Clifford gate needs to be processed (which should never happen due to is_available).
+        """
+        ids = [qb.id for qr in cmd.qubits for qb in qr]
+        ctrlids = [qb.id for qb in cmd.control_qubits]
+        if cmd.gate == Measure:
+            if ctrlids:
+                raise ValueError('Cannot have control qubits with a measurement gate!')
+            out = self._simulator.measure_qubits(ids)
+            i = 0
+            for qureg in cmd.qubits:
+                for qb in qureg:
+                    # Check if a mapper assigned a different logical id
+                    for tag in cmd.tags:
+                        if isinstance(tag, LogicalQubitIDTag):
+                            qb = WeakQubitRef(qb.engine, tag.logical_qubit_id)
+                    self.main_engine.set_measurement_result(qb, out[i])
+                    i += 1
+        elif cmd.gate == Allocate:
+            self._simulator.allocate_qubit(ids[0])
+        elif cmd.gate == Deallocate:
+            self._simulator.deallocate_qubit(ids[0])
+        elif cmd.gate == X and len(ctrlids) == 1:
+            self._simulator.cnot(ctrlids[0], ids[0])
+        elif cmd.gate == Z and len(ctrlids) == 1:
+            self._simulator.cz(ctrlids[0], ids[0])
+        elif ctrlids:
+            raise Exception(
+                "StabilizerSimulator: Cannot apply {} with {} control qubits.".format(str(cmd.gate), len(ctrlids))
+            )
+        elif cmd.gate == Swap:
+            self._simulator.swap(ids[0], ids[1])
+        else:
+            single_qubit_gates = (
+                (H, self._simulator.hadamard),
+                (S, self._simulator.phase),
+                (Sdag, self._simulator.phase_dagger),
+                (X, self._simulator.pauli_x),
+                (Y, self._simulator.pauli_y),
+                (Z, self._simulator.pauli_z),
+            )
+            for gate, apply in single_qubit_gates:
+                if cmd.gate == gate:
+                    for qubit_id in ids:
+                        apply(qubit_id)
+                    break
+            else:
+                raise Exception(
+                    "StabilizerSimulator only supports Clifford gates (H, S, S^dagger, Pauli, CNOT, CZ, Swap)!\n"
+                    "Please add an auto-replacer engine to your list of compiler engines."
+                )
+
+    def receive(self, command_list):
+        """
+        Receive a list of commands.
+
+        Receive a list of commands from the previous engine and handle them (simulate them classically) prior to
+        sending them on to the next engine.
+
+        Args:
+            command_list (list<Command>): List of commands to execute on the simulator.
+        """
+        for cmd in command_list:
+            if not cmd.gate == FlushGate():
+                self._handle(cmd)
+            if not self.is_last_engine:
+                self.send([cmd])
@@ -0,0 +1,235 @@
+# -*- coding: utf-8 -*-
+#   Copyright 2021 <Huawei Technologies Co., Ltd>
+#
+#   Licensed under the Apache License, Version 2.0 (the "License");
+#   you may not use this file except in compliance with the License.
+#   You may obtain a copy of the License at
+#
+#       http://www.apache.org/licenses/LICENSE-2.0
+#
+#   Unless required by applicable law or agreed to in writing, software
+#   distributed under the License is distributed on an "AS IS" BASIS,
+#   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+#   See the License for the specific language governing permissions and
+#   limitations under the License.
+"""
+Tests for projectq.backends._sim._stabilizer_simulator.py, using both the Python and the C++ implementations.
+"""
+
+import random
+
+import pytest
+
+from projectq import MainEngine
+from projectq.backends import Simulator, StabilizerSimulator
+from projectq.cengines import BasicMapperEngine, DummyEngine
+from projectq.meta import Control
+from projectq.ops import (
+    CNOT,
+    CZ,
+    All,
+    H,
+    Measure,
+    QubitOperator,
+    Rx,
+    S,
+    Sdag,
+    Swap,
+    T,
+    Toffoli,
+    X,
+    Y,
+    Z,
+)
+
+
+def get_available_simulators():
+    result = ["py_simulator"]
+    try:
+        from projectq.backends._sim._cppsim import (  # noqa: F401
+            StabilizerSimulator as CppStabilizerSim,
+        )
+
+        result.append("cpp_simulator")
+    except ImportError:
+        # The C++ simulator was either not installed or is misconfigured. Skip.
+        pass
+    return result
+
+
+@pytest.fixture(params=get_available_simulators())
+def sim(request):
+    if request.param == "py_simulator":
+        from projectq.backends._sim._pystabilizer import (
+            StabilizerSimulator as PyStabilizerSim,
+        )
+
+        sim = StabilizerSimulator()
+        sim._simulator = PyStabilizerSim(1)
+        return sim
+    else:
+        from projectq.backends._sim._cppsim import (
+            StabilizerSimulator as CppStabilizerSim,
+        )
+
+        sim = StabilizerSimulator()
+        sim._simulator = CppStabilizerSim(1)
+        return sim
+
+
+@pytest.fixture(params=["mapper", "no_mapper"])
+def mapper(request):
+    """
+    Adds a mapper which changes qubit ids by adding 1
+    """
+    if request.param == "mapper":
+
+        class TrivialMapper(BasicMapperEngine):
+            def __init__(self):
+                super().__init__()
+                self.current_mapping = {}
+
+            def receive(self, command_list):
+                for cmd in command_list:
+                    for qureg in cmd.all_qubits:
+                        for qubit in qureg:
+                            if qubit.id == -1:
+                                continue
+                            elif qubit.id not in self.current_mapping:
+                                previous_map = self.current_mapping
+                                previous_map[qubit.id] = qubit.id + 1
+                                self.current_mapping = previous_map
+                    self._send_cmd_with_mapped_ids(cmd)
+
+        return TrivialMapper()
+    if request.param == "no_mapper":
+        return None
+
+
+def test_stabilizer_simulator_is_available(sim):
+    backend = DummyEngine(save_commands=True)
+    eng = MainEngine(backend, [])
+    qureg = eng.allocate_qureg(3)
+    for gate in (H, S, Sdag, X, Y, Z, Measure):
+        gate | qureg[0]
+    CNOT | (qureg[0], qureg[1])
+    CZ | (qureg[0], qureg[1])
+    Swap | (qureg[0], qureg[1])
+    T | qureg[0]
+    Rx(0.3) | qureg[0]
+    Toffoli | (qureg[0], qureg[1], qureg[2])
+    with Control(eng, qureg[0]):
+        H | qureg[1]
+        Swap | (qureg[1], qureg[2])
+    eng.flush()
+    cmds = backend.received_commands[3:-1]
+    assert [sim.is_available(cmd) for cmd in cmds] == [True] * 10 + [False] * 5
+
+
+@pytest.mark.parametrize("seed", range(10))
+def test_stabilizer_simulator_random_clifford(sim, mapper, seed):
+    """Compare random Clifford circuits with the state vector simulator."""
+    engine_list = [] if mapper is None else [mapper]
+    eng = MainEngine(sim, engine_list=engine_list)
+    ref_eng = MainEngine(Simulator(), engine_list=[])
+    num_qubits = 4
+    qureg = eng.allocate_qureg(num_qubits)
+    ref_qureg = ref_eng.allocate_qureg(num_qubits)
+
+    rng = random.Random(seed)
+    for _ in range(30):
+        gate = rng.choice([H, S, Sdag, X, Y, Z, CNOT, CZ, Swap])
+        qubits = rng.sample(range(num_qubits), 2 if gate in (CNOT, CZ, Swap) else 1)
+        for qubits_of in (qureg, ref_qureg):
+            gate | tuple(qubits_of[i] for i in qubits)
+    eng.flush()
+    ref_eng.flush()
+
+    for k in range(2 ** num_qubits):
+        bits = [(k >> i) & 1 for i in range(num_qubits)]
+        assert eng.backend.get_probability(bits, qureg) == pytest.approx(
+            ref_eng.backend.get_probability(bits, ref_qureg)
+        )
+    for _ in range(10):
+        term = tuple((i, rng.choice('XYZ')) for i in range(num_qubits) if rng.random() < 0.7)
+        op = QubitOperator(term, 0.5) + QubitOperator('', -0.25)
+        assert eng.backend.get_expectation_value(op, qureg) == pytest.approx(
+            ref_eng.backend.get_expectation_value(op, ref_qureg)
+        )
+
+    All(Measure) | qureg
+    eng.flush()
+    assert ref_eng.backend.get_probability([int(qb) for qb in qureg], ref_qureg) > 1e-6
+    All(Measure) | ref_qureg
+
+
+def test_stabilizer_simulator_ghz(sim):
+    eng = MainEngine(sim, engine_list=[])
+    num_qubits = 150
+    qureg = eng.allocate_qureg(num_qubits)
+    H | qureg[0]
+    for i in range(1, num_qubits):
+        CNOT | (qureg[i - 1], qureg[i])
+    eng.flush()
+
+    assert eng.backend.get_probability('0' * num_qubits, qureg) == pytest.approx(0.5)
+    assert eng.backend.get_probability('0' * (num_qubits - 1) + '1', qureg) == pytest.approx(0.0)
+    assert eng.backend.get_expectation_value(QubitOperator(tuple((i, 'X') for i in range(num_qubits))), qureg) == 1
+    assert eng.backend.get_expectation_value(QubitOperator('Z0'), qureg) == 0
+    assert eng.backend.get_expectation_value(QubitOperator('Z3 Z100'), qureg) == 1
+
+    All(Measure) | qureg
+    eng.flush()
+    assert len({int(qb) for qb in qureg}) == 1
+
+
+def test_stabilizer_simulator_deallocate(sim):
+    eng = MainEngine(sim, engine_list=[])
+    qubit = eng.allocate_qubit()
+    qureg = eng.allocate_qureg(2)
+    X | qubit
+    H | qureg[0]
+    CNOT | (qureg[0], qureg[1])
+    eng.flush()
+    # Deallocating a qubit in a basis state resets it and its location is reused
+    qubit_id = qubit[0].id
+    del qubit
+    eng.flush()
+    mapping, stabilizers = eng.backend.cheat()
+    assert qubit_id not in mapping
+    new_qubit = eng.allocate_qubit()
+    eng.flush()
+    mapping, stabilizers = eng.backend.cheat()
+    assert len(stabilizers) == 3
+    assert eng.backend.get_probability('0', new_qubit) == 1
+
+    with pytest.raises(RuntimeError):
+        eng.backend._simulator.deallocate_qubit(qureg[0].id)
+    All(Measure) | qureg + new_qubit
+
+
+def test_stabilizer_simulator_cheat(sim):
+    eng = MainEngine(sim, engine_list=[])
+    qureg = eng.allocate_qureg(2)
+    X | qureg[0]
+    H | qureg[1]
+    eng.flush()
+    mapping, stabilizers = eng.backend.cheat()
+    assert sorted(mapping) == [qb.id for qb in qureg]
+    by_location = sorted(stabilizers, key=lambda s: s.find('Z') if 'Z' in s else s.find('X'))
+    pos0, pos1 = mapping[qureg[0].id], mapping[qureg[1].id]
+    assert by_location[pos0][1 + pos0] == 'Z' and by_location[pos0][0] == '-'
+    assert by_location[pos1][1 + pos1] == 'X' and by_location[pos1][0] == '+'
+    All(Measure) | qureg
+
+
+def test_stabilizer_simulator_errors(sim):
+    eng = MainEngine(sim, engine_list=[])
+    qureg = eng.allocate_qureg(2)
+    eng.flush()
+    with pytest.raises(Exception):
+        T | qureg[0]
+        eng.flush()
+    with pytest.raises(Exception):
+        eng.backend.get_expectation_value(QubitOperator('Z3'), qureg)
+    All(Measure) | qureg
@@ -0,0 +1,342 @@
+# -*- coding: utf-8 -*-
+#   Copyright 2021 <Huawei Technologies Co., Ltd>
+#
+#   Licensed under the Apache License, Version 2.0 (the "License");
+#   you may not use this file except in compliance with the License.
+#   You may obtain a copy of the License at
+#
+#       http://www.apache.org/licenses/LICENSE-2.0
+#
+#   Unless required by applicable law or agreed to in writing, software
+#   distributed under the License is distributed on an "AS IS" BASIS,
+#   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+#   See the License for the specific language governing permissions and
+#   limitations under the License.
+
+"""
+End-to-end benchmarks of the simulator: standard circuits run through a MainEngine with the default compiler engines.
+
+Every circuit is run for every simulator backend (see SimBackend, Auto included) with and without gate fusion, each
+run in a fresh process so that the peak resident set size (RSS) only accounts for that run. The circuits are seeded,
+so that runs are comparable across builds and machines. The results are written as JSON, e.g.::
+
+    python circuit_benchmark.py --qubits 18 --output results.json
+    python circuit_benchmark.py --circuits qft grover --backends VectorThreaded --repeat 5
+
+If the C++ simulator is not available, the Python simulator is benchmarked instead (backend 'python').
+"""
+
+import argparse
+import datetime
+import json
+import math
+import multiprocessing
+import os
+import platform
+import random
+import resource
+import sys
+import time
+from queue import Empty
+
+BACKENDS = ['Auto', 'ScalarSerial', 'ScalarThreaded', 'VectorSerial', 'VectorThreaded', 'OffloadNVIDIA']
+
+# Modulus and base of the modular exponentiation of the 'shor' circuit (the rest of the qubits hold the exponent)
+SHOR_N = 33
+SHOR_A = 5
+
+
+def _make_simulator(backend, gate_fusion):
+    """Return a simulator counting the gates it receives, using the given SimBackend (by name)."""
+    from projectq.backends import Simulator  # pylint: disable=import-outside-toplevel
+    from projectq.backends._sim._simulator import SimBackend  # pylint: disable=import-outside-toplevel
+    from projectq.ops import (  # pylint: disable=import-outside-toplevel
+        Allocate,
+        Deallocate,
+        FlushGate,
+        Measure,
+    )
+
+    class CountingSimulator(Simulator):
+        """Simulator counting the gates it applies."""
+
+        def __init__(self):
+            super().__init__(gate_fusion=gate_fusion, rnd_seed=1)
+            self.gate_count = 0
+
+        def receive(self, command_list):
+            # Counted here since the C++ simulator applies most of the commands in bulk, without calling _handle()
+            self.gate_count += sum(
+                1 for cmd in command_list if cmd.gate not in (Allocate, Deallocate, Measure, FlushGate())
+            )
+            super().receive(command_list)
+
+    sim = CountingSimulator()
+    if backend != 'python':
+        sim.select_backend(getattr(SimBackend, backend))
+    return sim
+
+
+def _qft(eng, num_qubits, rng):
+    """Quantum Fourier transform of a random basis state."""
+    from projectq.ops import QFT, All, Measure, X  # pylint: disable=import-outside-toplevel
+
+    qureg = eng.allocate_qureg(num_qubits)
+    for qubit in qureg:
+        if rng.random() < 0.5:
+            X | qubit
+    QFT | qureg
+    All(Measure) | qureg
+
+
+def _random_circuit(eng, num_qubits, rng, depth=20):
+    """Layers of random single-qubit rotations followed by CNOTs on random pairs of qubits."""
+    from projectq.ops import CNOT, All, Measure, Rx, Ry, Rz  # pylint: disable=import-outside-toplevel
+
+    qureg = eng.allocate_qureg(num_qubits)
+    for _ in range(depth):
+        for qubit in qureg:
+            rng.choice([Rx, Ry, Rz])(rng.uniform(0, 2 * math.pi)) | qubit
+        order = list(range(num_qubits))
+        rng.shuffle(order)
+        for i in range(0, num_qubits - 1, 2):
+            CNOT | (qureg[order[i]], qureg[order[i + 1]])
+    All(Measure) | qureg
+
+
+def _grover(eng, num_qubits, rng):
+    """Grover search for a random bit string on num_qubits - 1 qubits (plus the oracle qubit)."""
+    from projectq.meta import Compute, Control, Uncompute  # pylint: disable=import-outside-toplevel
+    from projectq.ops import All, H, Measure, X, Z  # pylint: disable=import-outside-toplevel
+
+    num_bits = num_qubits - 1
+    solution = [rng.randint(0, 1) for _ in range(num_bits)]
+    qureg = eng.allocate_qureg(num_bits)
+    oracle_out = eng.allocate_qubit()
+    All(H) | qureg
+    X | oracle_out
+    H | oracle_out
+    for _ in range(int(math.pi / 4 * math.sqrt(2**num_bits))):
+        with Compute(eng):
+            for qubit, bit in zip(qureg, solution):
+                if not bit:
+                    X | qubit
+        with Control(eng, qureg):
+            X | oracle_out
+        Uncompute(eng)
+
+        with Compute(eng):
+            All(H) | qureg
+            All(X) | qureg
+        with Control(eng, qureg[:-1]):
+            Z | qureg[-1]
+        Uncompute(eng)
+    All(Measure) | qureg
+    Measure | oracle_out
+
+
+def _shor(eng, num_qubits, rng):  # pylint: disable=unused-argument
+    """Order finding of SHOR_A modulo SHOR_N: controlled modular multiplications (libs.math) and an inverse QFT."""
+    from projectq.libs.math import MultiplyByConstantModN  # pylint: disable=import-outside-toplevel
+    from projectq.meta import Control, Dagger  # pylint: disable=import-outside-toplevel
+    from projectq.ops import QFT, All, H, Measure, X  # pylint: disable=import-outside-toplevel
+
+    num_work = SHOR_N.bit_length()
+    exponent = eng.allocate_qureg(num_qubits - num_work)
+    work = eng.allocate_qureg(num_work)
+    X | work[0]
+    All(H) | exponent
+    for i, qubit in enumerate(exponent):
+        with Control(eng, qubit):
+            MultiplyByConstantModN(pow(SHOR_A, 2**i, SHOR_N), SHOR_N) | work
+    with Dagger(eng):
+        QFT | exponent
+    All(Measure) | exponent
+    All(Measure) | work
+
+
+def _qaoa(eng, num_qubits, rng, layers=2):
+    """QAOA for MaxCut on a ring, followed by the evaluation of the cost function."""
+    from projectq.ops import CNOT, All, H, Measure, QubitOperator, Rx, Rz  # pylint: disable=import-outside-toplevel
+
+    qureg = eng.allocate_qureg(num_qubits)
+    All(H) | qureg
+    for _ in range(layers):
+        gamma, beta = rng.uniform(0, math.pi), rng.uniform(0, math.pi)
+        for i in range(num_qubits):
+            j = (i + 1) % num_qubits
+            CNOT | (qureg[i], qureg[j])
+            Rz(2 * gamma) | qureg[j]
+            CNOT | (qureg[i], qureg[j])
+        for qubit in qureg:
+            Rx(2 * beta) | qubit
+    eng.flush()
+    cost = QubitOperator()
+    for i in range(num_qubits):
+        cost += QubitOperator('Z{} Z{}'.format(i, (i + 1) % num_qubits), 0.5)
+    eng.backend.get_expectation_value(cost, qureg)
+    All(Measure) | qureg
+
+
+def _vqe(eng, num_qubits, rng, iterations=10):
+    """Expectation values of a Heisenberg chain for a hardware-efficient ansatz with changing parameters."""
+    from projectq.ops import CNOT, All, Measure, QubitOperator, Ry  # pylint: disable=import-outside-toplevel
+
+    hamiltonian = QubitOperator()
+    for i in range(num_qubits - 1):
+        for pauli in 'XYZ':
+            hamiltonian += QubitOperator('{0}{1} {0}{2}'.format(pauli, i, i + 1))
+    for _ in range(iterations):
+        qureg = eng.allocate_qureg(num_qubits)
+        for _ in range(2):
+            for qubit in qureg:
+                Ry(rng.uniform(0, 2 * math.pi)) | qubit
+            for i in range(num_qubits - 1):
+                CNOT | (qureg[i], qureg[i + 1])
+        eng.flush()
+        eng.backend.get_expectation_value(hamiltonian, qureg)
+        All(Measure) | qureg
+        eng.flush()
+        del qureg
+
+
+CIRCUITS = {
+    'qft': _qft,
+    'random': _random_circuit,
+    'grover': _grover,
+    'shor': _shor,
+    'qaoa': _qaoa,
+    'vqe': _vqe,
+}
+
+
+def _peak_rss_mb():
+    """Peak resident set size of the current process in MiB."""
+    peak = resource.getrusage(resource.RUSAGE_SELF).ru_maxrss
+    # kilobytes on Linux, bytes on macOS
+    return peak / (2**20 if sys.platform == 'darwin' else 2**10)
+
+
+def _run_case(circuit, backend, gate_fusion, num_qubits, repeat, queue):
+    """Run one benchmark case (in a child process) and put its results into the queue."""
+    from projectq import MainEngine  # pylint: disable=import-outside-toplevel
+
+    # Keep the JSON output clean (e.g. from the note printed by the Python simulator)
+    sys.stdout = sys.stderr
+
+    result = {
+        'circuit': circuit,
+        'backend': backend,
+        'gate_fusion': gate_fusion,
+        'qubits': num_qubits,
+    }
+    try:
+        times = []
+        for _ in range(repeat):
+            sim = _make_simulator(backend, gate_fusion)
+            eng = MainEngine(sim)
+            start = time.perf_counter()
+            CIRCUITS[circuit](eng, num_qubits, random.Random(42))
+            eng.flush(deallocate_qubits=True)
+            times.append(time.perf_counter() - start)
+        result.update(
+            {
+                'gates': sim.gate_count,
+                'wall_time': min(times),
+                'wall_time_mean': sum(times) / len(times),
+                'gates_per_second': sim.gate_count / min(times),
+                'peak_rss_mb': _peak_rss_mb(),
+            }
+        )
+    except Exception as err:  # pylint: disable=broad-except
+        result['error'] = '{}: {}'.format(type(err).__name__, err)
+    queue.put(result)
+
+
+def _wait_for_result(process, queue, case, timeout):
+    """Result of a benchmark case, or an error if its process crashed or did not finish within timeout seconds."""
+    deadline = time.monotonic() + timeout if timeout else None
+    while True:
+        try:
+            result = queue.get(timeout=1.0)
+            break
+        except Empty:
+            if not process.is_alive():
+                try:  # the result may have been sent just before the process exited
+                    result = queue.get(timeout=1.0)
+                    break
+                except Empty:
+                    process.join()
+                    return dict(case, error='process exited with code {}'.format(process.exitcode))
+            if deadline is not None and time.monotonic() > deadline:
+                process.terminate()
+                process.join()
+                return dict(case, error='timed out after {} s'.format(timeout))
+    process.join()
+    if process.exitcode != 0 and 'error' not in result:
+        result['error'] = 'process exited with code {}'.format(process.exitcode)
+    return result
+
+
+def main(argv=None):
+    """Run the benchmarks and write the results as JSON."""
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--qubits', type=int, default=16, help='number of qubits of every circuit (default: 16)')
+    parser.add_argument('--circuits', nargs='+', choices=list(CIRCUITS), default=list(CIRCUITS))
+    parser.add_argument('--backends', nargs='+', help='SimBackend names (default: all the available ones)')
+    parser.add_argument('--repeat', type=int, default=3, help='runs per case, the fastest is reported (default: 3)')
+    parser.add_argument(
+        '--timeout', type=float, default=3600, help='time limit per case in seconds, 0 for none (default: 3600)'
+    )
+    parser.add_argument('--output', help='output file (default: stdout)')
+    args = parser.parse_args(argv)
+
+    from projectq.backends._sim._simulator import (  # pylint: disable=import-outside-toplevel
+        FALLBACK_TO_PYSIM,
+    )
+
+    backends = args.backends or (['python'] if FALLBACK_TO_PYSIM else BACKENDS)
+    if args.qubits <= SHOR_N.bit_length() and 'shor' in args.circuits:
+        parser.error('the shor circuit needs more than {} qubits'.format(SHOR_N.bit_length()))
+
+    context = multiprocessing.get_context('spawn')
+    results = []
+    for circuit in args.circuits:
+        for backend in backends:
+            for gate_fusion in (False, True):
+                queue = context.Queue()
+                process = context.Process(
+                    target=_run_case, args=(circuit, backend, gate_fusion, args.qubits, args.repeat, queue)
+                )
+                process.start()
+                case = {'circuit': circuit, 'backend': backend, 'gate_fusion': gate_fusion, 'qubits': args.qubits}
+                result = _wait_for_result(process, queue, case, args.timeout)
+                results.append(result)
+                print(
+                    '{circuit:>8} {backend:>15} fusion={gate_fusion!s:5} {status}'.format(
+                        status=result.get('error') or '{:.3f} s'.format(result['wall_time']), **result
+                    ),
+                    file=sys.stderr,
+                )
+
+    report = {
+        'metadata': {
+            'date': datetime.datetime.now().isoformat(),
+            'platform': platform.platform(),
+            'processor': platform.processor(),
+            'cpu_count': os.cpu_count(),
+            'omp_num_threads': os.environ.get('OMP_NUM_THREADS'),
+            'python': platform.python_version(),
+        },
+        'results': results,
+    }
+    if args.output:
+        with open(args.output, 'w') as output:
+            json.dump(report, output, indent=2)
+    else:
+        json.dump(report, sys.stdout, indent=2)
+        print()
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,114 @@
+//   Copyright 2021 <Huawei Technologies Co., Ltd>
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+// Cost of fusion::Fusion::perform_fusion() as a function of the number of fused qubits and of the number of items,
+// and per-gate cost of the decision whether to extend the fused gates (as made by the simulators for every gate).
+//
+// Usage: fusion_benchmark [repetitions]
+
+#include "fusion.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+namespace
+{
+    using fusion::Fusion;
+
+    // Keeps the compiler from optimizing the fusion away
+    volatile double sink = 0.;
+
+    // Random circuit alternating single- and two-qubit gates on (at most) num_qubits qubits
+    Fusion make_fusion(unsigned num_qubits, unsigned num_items, std::mt19937& rng)
+    {
+        std::normal_distribution<double> normal;
+        std::uniform_int_distribution<unsigned> qubit(0, num_qubits - 1);
+        Fusion result;
+        for (auto item = 0U; item < num_items; ++item) {
+            Fusion::IndexVector ids{qubit(rng)};
+            if (item % 2 == 1) {
+                auto other = qubit(rng);
+                while (other == ids[0]) {
+                    other = qubit(rng);
+                }
+                ids.push_back(other);
+            }
+            Fusion::Matrix matrix(1UL << (2 * ids.size()));
+            for (auto& entry: matrix) {
+                entry = {normal(rng), normal(rng)};
+            }
+            result.insert(matrix, ids);
+        }
+        return result;
+    }
+
+    // Insert num_gates single-qubit gates acting on 3 qubits (so that the fused gates never get flushed), checking the
+    // size of the resulting fused gate beforehand either on a copy (as the simulators used to) or with
+    // num_qubits_after(). Returns the time in microseconds.
+    double time_insertions(unsigned num_gates, bool copy)
+    {
+        const Fusion::Matrix matrix{1., 1., 1., -1.};
+        Fusion fused;
+        const auto start = std::chrono::steady_clock::now();
+        for (auto gate = 0U; gate < num_gates; ++gate) {
+            const Fusion::IndexVector ids{gate % 3};
+            if (copy) {
+                auto fused_copy = fused;
+                fused_copy.insert(matrix, ids);
+                sink = fused_copy.num_qubits();
+            }
+            else {
+                sink = fused.num_qubits_after(ids, {});
+            }
+            fused.insert(matrix, ids);
+        }
+        const auto stop = std::chrono::steady_clock::now();
+        return std::chrono::duration<double, std::micro>(stop - start).count();
+    }
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+    const auto repetitions = argc > 1 ? std::atoi(argv[1]) : 100;
+    std::mt19937 rng(42);
+
+    std::printf("%10s %10s %15s %15s\n", "qubits", "items", "time [us]", "per item [us]");
+    for (auto num_qubits = 2U; num_qubits <= 5U; ++num_qubits) {
+        for (auto num_items = 1U; num_items <= 64U; num_items *= 2) {
+            auto fused = make_fusion(num_qubits, num_items, rng);
+
+            const auto start = std::chrono::steady_clock::now();
+            for (auto rep = 0; rep < repetitions; ++rep) {
+                Fusion::Matrix matrix;
+                Fusion::IndexVector ids;
+                Fusion::IndexVector ctrls;
+                fused.perform_fusion(matrix, ids, ctrls);
+                sink = matrix[0].real();
+            }
+            const auto stop = std::chrono::steady_clock::now();
+
+            const auto time = std::chrono::duration<double, std::micro>(stop - start).count() / repetitions;
+            std::printf("%10u %10u %15.2f %15.3f\n", fused.num_qubits(), num_items, time, time / num_items);
+        }
+    }
+
+    std::printf("\n%10s %20s %20s\n", "gates", "copy [us/gate]", "query [us/gate]");
+    for (auto num_gates = 16U; num_gates <= 4096U; num_gates *= 4) {
+        std::printf("%10u %20.3f %20.3f\n", num_gates, time_insertions(num_gates, true) / num_gates,
+                    time_insertions(num_gates, false) / num_gates);
+    }
+    return 0;
+}
@@ -0,0 +1,175 @@
+//   Copyright 2021 <Huawei Technologies Co., Ltd>
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+// Throughput of the kernels of one backend module (built once per backend as kernel_benchmark_<backend>, see
+// CMakeLists.txt) for all the kernel sizes, several state sizes, target qubit positions and numbers of control qubits.
+// The kernels are called directly, i.e. without Python nor the simulator in the loop.
+//
+// The results are written to stdout as JSON. The bandwidth is estimated the same way as by the simulator statistics:
+// every amplitude with all the control qubits set is read and written once.
+//
+// Usage: kernel_benchmark_<backend> [min_qubits [max_qubits [step [min_time]]]]
+//
+// The defaults (10, 26, 2 and 0.05 seconds per measurement) use at most 1 GiB; a 30-qubit state takes 16 GiB.
+
+#include "types.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#if defined(ENABLE_MULTITHREADING) && defined(USE_THREAD_POOL)
+#    include "thread_pool.hpp"
+#elif defined(ENABLE_MULTITHREADING) && defined(_OPENMP)
+#    include <omp.h>
+#endif
+
+#ifndef BENCHMARK_BACKEND
+#    define BENCHMARK_BACKEND "unknown"
+#endif
+
+using types::M;
+using types::UINT;
+using types::V;
+
+// Defined in src/kernels.cpp
+extern "C" void kernel(V& psi, M const& m, UINT ctrlmask, fusion::Fusion::IndexVector const& ids, unsigned nids);
+
+namespace
+{
+    constexpr auto max_kernel = 5U;
+    constexpr auto max_controls = 2U;
+
+    // Qubit positions of the targets and of the controls
+    struct Layout
+    {
+        fusion::Fusion::IndexVector ids;
+        UINT ctrlmask;
+    };
+
+    // low: targets 0, 1, ... and controls right above them
+    // high: targets n-1, n-2, ... and controls right below them
+    // mixed: targets 0, n-1, 1, n-2, ... and controls in the middle
+    Layout make_layout(std::string const& pattern, unsigned num_qubits, unsigned nids, unsigned nctrls)
+    {
+        Layout layout{{}, 0};
+        for (auto i = 0U; i < nids; ++i) {
+            if (pattern == "low") {
+                layout.ids.push_back(i);
+            }
+            else if (pattern == "high") {
+                layout.ids.push_back(num_qubits - 1 - i);
+            }
+            else {
+                layout.ids.push_back(i % 2 == 0 ? i / 2 : num_qubits - 1 - i / 2);
+            }
+        }
+        for (auto c = 0U; c < nctrls; ++c) {
+            unsigned ctrl = 0;
+            if (pattern == "low") {
+                ctrl = nids + c;
+            }
+            else if (pattern == "high") {
+                ctrl = num_qubits - 1 - nids - c;
+            }
+            else {
+                ctrl = num_qubits / 2 + c;
+            }
+            layout.ctrlmask |= UINT(1) << ctrl;
+        }
+        layout.ids.resize(max_kernel);  // padded as done by the simulator
+        return layout;
+    }
+
+    // Tensor product of nids Hadamard gates (a dense unitary, so that the state stays normalized)
+    M make_matrix(unsigned nids)
+    {
+        const auto dim = std::size_t(1) << nids;
+        const auto norm = 1. / std::sqrt(static_cast<double>(dim));
+        M matrix(dim * dim);
+        for (std::size_t i = 0; i < dim; ++i) {
+            for (std::size_t j = 0; j < dim; ++j) {
+                matrix[i * dim + j] = (__builtin_popcountll(i & j) % 2 == 0) ? norm : -norm;
+            }
+        }
+        return matrix;
+    }
+
+    int num_threads()
+    {
+#if defined(ENABLE_MULTITHREADING) && defined(USE_THREAD_POOL)
+        return static_cast<int>(parallel::ThreadPool::instance().max_threads());
+#elif defined(ENABLE_MULTITHREADING) && defined(_OPENMP)
+        return omp_get_max_threads();
+#else
+        return 1;
+#endif
+    }
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+    const auto min_qubits = argc > 1 ? static_cast<unsigned>(std::atoi(argv[1])) : 10U;
+    const auto max_qubits = argc > 2 ? static_cast<unsigned>(std::atoi(argv[2])) : 26U;
+    const auto step = argc > 3 ? std::max(1U, static_cast<unsigned>(std::atoi(argv[3]))) : 2U;
+    const auto min_time = argc > 4 ? std::atof(argv[4]) : 0.05;
+
+    if (min_qubits < max_kernel + max_controls + 1 || max_qubits < min_qubits) {
+        std::fprintf(stderr, "Invalid range of qubits (at least %u qubits are required)\n",
+                     max_kernel + max_controls + 1);
+        return 1;
+    }
+
+    std::printf("{\n  \"backend\": \"%s\",\n  \"threads\": %d,\n  \"results\": [", BENCHMARK_BACKEND, num_threads());
+    const char* separator = "\n";
+    for (auto num_qubits = min_qubits; num_qubits <= max_qubits; num_qubits += step) {
+        const auto size = std::size_t(1) << num_qubits;
+        V psi(size, 1. / std::sqrt(static_cast<double>(size)));
+
+        for (auto nids = 1U; nids <= max_kernel; ++nids) {
+            const auto matrix = make_matrix(nids);
+            for (std::string const pattern: {"low", "high", "mixed"}) {
+                for (auto nctrls = 0U; nctrls <= max_controls; ++nctrls) {
+                    const auto layout = make_layout(pattern, num_qubits, nids, nctrls);
+
+                    kernel(psi, matrix, layout.ctrlmask, layout.ids, nids);  // warm-up
+
+                    auto calls = 0UL;
+                    auto elapsed = 0.;
+                    const auto start = std::chrono::steady_clock::now();
+                    while (elapsed < min_time) {
+                        kernel(psi, matrix, layout.ctrlmask, layout.ids, nids);
+                        ++calls;
+                        elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                    }
+
+                    const auto time = elapsed / static_cast<double>(calls);
+                    const auto bytes = 2. * sizeof(types::complex_type) * static_cast<double>(size >> nctrls);
+                    std::printf("%s    {\"kernel\": %u, \"qubits\": %u, \"targets\": \"%s\", \"controls\": %u, "
+                                "\"calls\": %lu, \"ns_per_amplitude\": %.4f, \"gb_per_s\": %.3f}",
+                                separator, nids, num_qubits, pattern.c_str(), nctrls, calls,
+                                time * 1.e9 / static_cast<double>(size), bytes / time * 1.e-9);
+                    separator = ",\n";
+                    std::fflush(stdout);
+                }
+            }
+        }
+    }
+    std::printf("\n  ]\n}\n");
+    return 0;
+}
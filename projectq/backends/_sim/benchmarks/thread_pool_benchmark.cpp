@@ -0,0 +1,116 @@
+//   Copyright 2021 <Huawei Technologies Co., Ltd>
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+// Latency of a parallel loop over a state vector with the persistent thread pool (see include/thread_pool.hpp)
+// compared to an OpenMP parallel for (the default build) and to a serial loop. Each loop scales all the amplitudes,
+// which is about the cheapest thing a kernel does: for small states, the time is dominated by starting and joining
+// the threads.
+//
+// The results are written to stdout as JSON.
+//
+// Usage: thread_pool_benchmark [max_qubits [min_time]]
+//
+// The defaults (24 qubits, i.e. 256 MiB, and 0.05 seconds per measurement) cover both the latency-bound and the
+// bandwidth-bound regimes.
+
+#include "thread_pool.hpp"
+#include "types.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+#ifdef _OPENMP
+#    include <omp.h>
+#endif  // _OPENMP
+
+namespace
+{
+    // Average wall time of loop() in seconds
+    template <class F>
+    double time_loop(F&& loop, double min_time)
+    {
+        loop();  // warm-up
+        auto calls = 0UL;
+        auto elapsed = 0.;
+        const auto start = std::chrono::steady_clock::now();
+        while (elapsed < min_time) {
+            loop();
+            ++calls;
+            elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        }
+        return elapsed / static_cast<double>(calls);
+    }
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+    const auto max_qubits = argc > 1 ? static_cast<unsigned>(std::atoi(argv[1])) : 24U;
+    const auto min_time = argc > 2 ? std::atof(argv[2]) : 0.05;
+
+    auto& pool = parallel::ThreadPool::instance();
+#ifdef _OPENMP
+    const auto openmp_threads = omp_get_max_threads();
+#else
+    const auto openmp_threads = 0;
+#endif  // _OPENMP
+
+    std::printf("{\n  \"pool_threads\": %u,\n  \"openmp_threads\": %d,\n  \"results\": [", pool.max_threads(),
+                openmp_threads);
+    const char* separator = "\n";
+    for (auto num_qubits = 0U; num_qubits <= max_qubits; num_qubits += 2) {
+        const auto size = std::size_t(1) << num_qubits;
+        types::StateVector psi(size, 1.);
+        const auto factor = types::complex_type(0., 1.);  // keeps the amplitudes bounded
+        auto* data = psi.data();
+
+        const auto serial = time_loop(
+            [&] {
+                for (std::size_t i = 0; i < size; ++i) {
+                    data[i] *= factor;
+                }
+            },
+            min_time);
+
+        const auto thread_pool = time_loop(
+            [&] {
+                pool.run(size, [&](std::size_t begin, std::size_t end) {
+                    for (auto i = begin; i < end; ++i) {
+                        data[i] *= factor;
+                    }
+                });
+            },
+            min_time);
+
+        std::printf("%s    {\"qubits\": %u, \"serial_ns\": %.1f, \"thread_pool_ns\": %.1f", separator, num_qubits,
+                    serial * 1.e9, thread_pool * 1.e9);
+#ifdef _OPENMP
+        const auto openmp = time_loop(
+            [&] {
+#    pragma omp parallel for schedule(static)
+                for (std::size_t i = 0; i < size; ++i) {
+                    data[i] *= factor;
+                }
+            },
+            min_time);
+        std::printf(", \"openmp_ns\": %.1f, \"speedup_vs_openmp\": %.2f", openmp * 1.e9, openmp / thread_pool);
+#endif  // _OPENMP
+        std::printf("}");
+        separator = ",\n";
+        std::fflush(stdout);
+    }
+    std::printf("\n  ]\n}\n");
+    return 0;
+}
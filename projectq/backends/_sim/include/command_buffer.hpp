@@ -0,0 +1,132 @@
+//   Copyright 2021 <Huawei Technologies Co., Ltd>
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#ifndef COMMAND_BUFFER_HPP
+#define COMMAND_BUFFER_HPP
+
+#include "types.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+// Packed command buffers, used to submit many commands to a simulator in a single call (e.g. from Python, see
+// Simulator.receive() in _simulator.py).
+//
+// A buffer is a sequence of 64-bit integer words, the matrices of the gates being stored in a separate array of
+// complex numbers. Each command starts with its opcode:
+//
+//   gate:            [gate, #ids, #ctrls, offset, ids..., ctrls...]
+//   allocate:        [allocate, id]
+//   deallocate:      [deallocate, id]
+//   run:             [run]
+//   registered_gate: [registered_gate, #ids, #ctrls, handle, ids..., ctrls...]
+//
+// where the matrix of a gate (2^#ids x 2^#ids, row-major) starts at matrices[offset], run applies the pending (fused)
+// gates and handle is the handle of a matrix registered with the simulator (see matrix_registry.hpp).
+namespace commands
+{
+    enum Opcode : std::int64_t
+    {
+        gate = 0,
+        allocate = 1,
+        deallocate = 2,
+        run = 3,
+        registered_gate = 4,
+    };
+
+    // Apply the commands of a buffer to a simulator, in order. The buffer is validated while it is processed: the
+    // commands preceding a malformed one are applied.
+    template <class Sim>
+    void apply(Sim& sim, std::int64_t const* words, std::size_t num_words, types::complex_type const* matrices,
+               std::size_t num_matrix_entries)
+    {
+        constexpr std::int64_t max_ids = 5;
+
+        std::size_t pos = 0;
+        auto next = [&]() {
+            if (pos >= num_words) {
+                throw std::invalid_argument("apply_commands(): truncated command buffer");
+            }
+            return words[pos++];
+        };
+        auto next_id = [&]() {
+            const auto id = next();
+            if (id < 0 || id > static_cast<std::int64_t>(std::numeric_limits<unsigned>::max())) {
+                throw std::invalid_argument("apply_commands(): invalid qubit id");
+            }
+            return static_cast<unsigned>(id);
+        };
+
+        std::vector<unsigned> ids;
+        std::vector<unsigned> ctrls;
+        auto read_ids = [&](std::int64_t num_ids, std::int64_t num_ctrls) {
+            ids.clear();
+            for (std::int64_t i = 0; i < num_ids; ++i) {
+                ids.push_back(next_id());
+            }
+            ctrls.clear();
+            for (std::int64_t i = 0; i < num_ctrls; ++i) {
+                ctrls.push_back(next_id());
+            }
+        };
+        types::M matrix;
+        while (pos < num_words) {
+            switch (next()) {
+                case gate: {
+                    const auto num_ids = next();
+                    const auto num_ctrls = next();
+                    const auto offset = next();
+                    if (num_ids < 1 || num_ids > max_ids || num_ctrls < 0 || offset < 0) {
+                        throw std::invalid_argument("apply_commands(): invalid gate");
+                    }
+                    const auto size = std::size_t(1) << (2 * num_ids);
+                    if (static_cast<std::size_t>(offset) + size > num_matrix_entries) {
+                        throw std::invalid_argument("apply_commands(): gate matrix out of bounds");
+                    }
+                    read_ids(num_ids, num_ctrls);
+                    matrix.assign(matrices + offset, matrices + offset + size);
+                    sim.apply_controlled_gate(matrix, ids, ctrls);
+                    break;
+                }
+                case registered_gate: {
+                    const auto num_ids = next();
+                    const auto num_ctrls = next();
+                    const auto handle = next();
+                    if (num_ids < 1 || num_ids > max_ids || num_ctrls < 0 || handle < 0) {
+                        throw std::invalid_argument("apply_commands(): invalid gate");
+                    }
+                    read_ids(num_ids, num_ctrls);
+                    sim.apply_registered_gate(static_cast<std::size_t>(handle), ids, ctrls);
+                    break;
+                }
+                case allocate:
+                    sim.allocate_qubit(next_id());
+                    break;
+                case deallocate:
+                    sim.deallocate_qubit(next_id());
+                    break;
+                case run:
+                    sim.run();
+                    break;
+                default:
+                    throw std::invalid_argument("apply_commands(): unknown opcode");
+            }
+        }
+    }
+}  // namespace commands
+
+#endif /* COMMAND_BUFFER_HPP */
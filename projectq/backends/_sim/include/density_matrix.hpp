@@ -0,0 +1,143 @@
+//   Copyright 2021 <Huawei Technologies Co., Ltd>
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#ifndef DENSITY_MATRIX_HPP
+#define DENSITY_MATRIX_HPP
+
+#include "fusion.hpp"
+#include "simbackends.hpp"
+#include "simulator.hpp"
+#include "types.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <random>
+#include <tuple>
+#include <vector>
+
+// Simulator of mixed states.
+//
+// The density matrix rho of n qubits is stored as a vector of 2n "qubits": the qubit mapped to position p owns bit 2p
+// (row index) and bit 2p + 1 (column index) of the vector index. A gate U is applied as U (x) conj(U), i.e. by calling
+// the regular backend kernel twice: once with U on the row bits and once with conj(U) on the column bits. Allocating a
+// qubit therefore only appends zeros at the end of the vector, while deallocating a qubit traces it out.
+class DensityMatrixSimulator
+{
+    static constexpr auto default_tol_ = 1.e-12;
+    static constexpr auto max_qubit_num_ = 5U;
+
+public:
+    using calc_type = types::calc_type;
+    using complex_type = types::complex_type;
+    using StateVector = types::StateVector;
+    using Map = Simulator::Map;
+    using RndEngine = Simulator::RndEngine;
+    using TermsDict = Simulator::TermsDict;
+    using Matrix = std::vector<complex_type>;
+
+    using backend_kernel_t = Simulator::backend_kernel_t;
+
+    explicit DensityMatrixSimulator(unsigned seed = 1);
+
+    void allocate_qubit(unsigned id);
+
+    // Trace out the qubit (no need for it to be in a classical state)
+    void deallocate_qubit(unsigned id);
+
+    std::vector<bool> measure_qubits(std::vector<unsigned> const& ids);
+
+    template <class M>
+    void apply_controlled_gate(M const& m, const std::vector<unsigned>& ids, const std::vector<unsigned>& ctrl)
+    {
+        const auto num_qubits = fused_gates_.num_qubits_after(ids, ctrl);
+
+        if (num_qubits >= fusion_qubits_min_ && num_qubits <= fusion_qubits_max_) {
+            fused_gates_.insert(m, ids, ctrl);
+            run();
+        }
+        else if (num_qubits > fusion_qubits_max_ || (num_qubits - ids.size()) > fused_gates_.num_qubits()) {
+            run();
+            fused_gates_.insert(m, ids, ctrl);
+        }
+        else {
+            fused_gates_.insert(m, ids, ctrl);
+        }
+    }
+
+    calc_type get_expectation_value(TermsDict const& td, std::vector<unsigned> const& ids);
+
+    calc_type get_probability(std::vector<bool> const& bit_string, std::vector<unsigned> const& ids);
+
+    std::vector<calc_type> get_probabilities(std::vector<unsigned> const& ids);
+
+    void collapse_wavefunction(std::vector<unsigned> const& ids, std::vector<bool> const& values);
+
+    // Reduced density matrix of the qubits in ids (all other qubits are traced out), as a row-major 2^k x 2^k matrix
+    // where bit j of the row/column index corresponds to ids[j].
+    Matrix get_reduced_density_matrix(std::vector<unsigned> const& ids);
+
+    // Tr(rho^2)
+    calc_type get_purity();
+
+    // Full density matrix in the usual ordering (bit p of the row/column index is the qubit at position p)
+    std::tuple<Map, Matrix> cheat();
+
+    void select_backend(backends::SimBackend backend);
+
+    void run();
+
+private:
+    // Spread the bits of x to the given positions (bit j of x goes to bit positions[j])
+    static std::size_t deposit(std::size_t x, std::vector<unsigned> const& positions)
+    {
+        std::size_t result = 0;
+        for (std::size_t j = 0; j < positions.size(); ++j) {
+            result |= ((x >> j) & 1UL) << positions[j];
+        }
+        return result;
+    }
+
+    // Bit positions of the row bits of all the qubits, ordered by qubit position
+    [[nodiscard]] std::vector<unsigned> row_positions() const
+    {
+        std::vector<unsigned> positions(N_);
+        for (unsigned p = 0; p < N_; ++p) {
+            positions[p] = 2 * p;
+        }
+        return positions;
+    }
+
+    // Probability of the outcomes x (over all qubits) with (x & mask) == value
+    calc_type norm_of(std::size_t mask, std::size_t value);
+
+    // Keep only the entries whose row and column agree with (x & mask) == value and scale them
+    void project(std::size_t mask, std::size_t value, calc_type scale);
+
+    bool check_ids(std::vector<unsigned> const& ids)
+    {
+        return std::all_of(begin(ids), end(ids), [map = map_](const auto& id) { return map.count(id) != 0UL; });
+    }
+
+    unsigned N_;  // #qubits
+    StateVector vec_;
+    Map map_;
+    fusion::Fusion fused_gates_;
+    unsigned fusion_qubits_min_, fusion_qubits_max_;
+    RndEngine rnd_eng_;
+    std::function<double()> rng_;
+    backends::SimBackend backend_type_;
+    backend_kernel_t* backend_kernel_;
+};
+
+#endif /* DENSITY_MATRIX_HPP */
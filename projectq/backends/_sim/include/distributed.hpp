@@ -0,0 +1,240 @@
+//   Copyright 2021 <Huawei Technologies Co., Ltd>
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#ifndef DISTRIBUTED_HPP
+#define DISTRIBUTED_HPP
+
+#include "fusion.hpp"
+#include "simbackends.hpp"
+#include "simulator.hpp"
+#include "transport.hpp"
+#include "types.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Simulator which partitions the state vector across several processes.
+//
+// The 2^n amplitudes are split into 2^g partitions of 2^l amplitudes (n = l + g, 2^g <= number of processes). Qubits
+// mapped to one of the l lowest bit positions are "local" while the other ones are "global": the global bits of an
+// index are the rank of the process holding the amplitude. Gates acting only on local qubits are applied by every
+// process to its own partition using the regular backend kernels. Diagonal gates on global qubits do not require any
+// communication; any other gate on a global qubit first swaps it with a local qubit, which exchanges half of the
+// partition between pairs of processes.
+//
+// The process creating the simulator is rank 0. It spawns the other processes by running the given worker command
+// followed by the transport endpoint and the rank of the process; the worker command is expected to end up calling
+// serve() on a simulator constructed from these two arguments. All processes then execute the same sequence of
+// commands broadcast by rank 0, communicating through a pluggable transport (see transport.hpp). Workers are
+// separate programs rather than forked copies of rank 0 since OpenMP runtimes do not generally survive a fork().
+class DistributedSimulator
+{
+    static constexpr auto default_tol_ = 1.e-12;
+    static constexpr auto max_qubit_num_ = 5U;
+    static constexpr std::size_t block_size_ = 1UL << 16U;  // amplitudes per message during exchanges
+
+public:
+    using calc_type = types::calc_type;
+    using complex_type = types::complex_type;
+    using StateVector = types::StateVector;
+    using Map = Simulator::Map;
+    using RndEngine = Simulator::RndEngine;
+    using TermsDict = Simulator::TermsDict;
+
+    using backend_kernel_t = Simulator::backend_kernel_t;
+
+    // Rank 0
+    DistributedSimulator(unsigned seed, unsigned num_processes, std::string const& transport,
+                         std::vector<std::string> const& worker_command);
+
+    // Other ranks
+    DistributedSimulator(std::string const& endpoint, unsigned rank);
+
+    ~DistributedSimulator();
+
+    // Command loop of the other ranks (returns when rank 0 destroys the simulator)
+    void serve();
+
+    DistributedSimulator(const DistributedSimulator&) = delete;
+    DistributedSimulator& operator=(const DistributedSimulator&) = delete;
+    DistributedSimulator(DistributedSimulator&&) = delete;
+    DistributedSimulator& operator=(DistributedSimulator&&) = delete;
+
+    void allocate_qubit(unsigned id);
+
+    void deallocate_qubit(unsigned id);
+
+    std::vector<bool> measure_qubits(std::vector<unsigned> const& ids);
+
+    template <class M>
+    void apply_controlled_gate(M const& m, const std::vector<unsigned>& ids, const std::vector<unsigned>& ctrl)
+    {
+        const auto num_qubits = fused_gates_.num_qubits_after(ids, ctrl);
+
+        if (num_qubits >= fusion_qubits_min_ && num_qubits <= fusion_qubits_max_) {
+            fused_gates_.insert(m, ids, ctrl);
+            run();
+        }
+        else if (num_qubits > fusion_qubits_max_ || (num_qubits - ids.size()) > fused_gates_.num_qubits()) {
+            run();
+            fused_gates_.insert(m, ids, ctrl);
+        }
+        else {
+            fused_gates_.insert(m, ids, ctrl);
+        }
+    }
+
+    calc_type get_expectation_value(TermsDict const& td, std::vector<unsigned> const& ids);
+
+    calc_type get_probability(std::vector<bool> const& bit_string, std::vector<unsigned> const& ids);
+
+    complex_type get_amplitude(std::vector<bool> const& bit_string, std::vector<unsigned> const& ids);
+
+    void collapse_wavefunction(std::vector<unsigned> const& ids, std::vector<bool> const& values);
+
+    void select_backend(backends::SimBackend backend);
+
+    void run();
+
+    [[nodiscard]] unsigned num_processes() const
+    {
+        return transport_->size();
+    }
+
+private:
+    // Commands broadcast by rank 0 and executed by all the processes
+    enum class Op : std::uint64_t
+    {
+        Shutdown,
+        SelectBackend,   // ints: backend
+        AllocateLocal,   // new local qubit at the highest local bit position
+        AllocateGlobal,  // new global qubit (doubles the number of active processes)
+        CheckClassical,  // ints: pos -> rank 0 receives whether a 0 and/or a 1 was found
+        RemoveLocal,     // ints: pos, value
+        MergeGlobal,     // turn the highest global qubit into the highest local one
+        Swap,            // ints: global bit, local pos
+        Gate,            // ints: nids, ids..., ctrlmask, gctrlmask; data: matrix (row major)
+        DiagonalGate,    // ints: nids, positions..., ctrlmask, gctrlmask; data: diagonal
+        Norms,           // -> rank 0 receives the norm of each partition
+        Pick,            // ints: rank; data: P, rnd -> rank 0 receives the picked local index
+        NormOf,          // ints: mask, value -> rank 0 receives the total probability
+        Project,         // ints: mask, value; data: scale
+        Expectation,     // ints: #terms, (xmask, zmask)...; data: factors -> rank 0 receives the expectation value
+        Amplitude,       // ints: rank, local index -> rank 0 receives the amplitude
+    };
+
+    struct Command
+    {
+        Op op;
+        std::vector<std::uint64_t> ints;
+        std::vector<complex_type> data;
+    };
+
+    // Values returned to rank 0 by the collective commands
+    struct Result
+    {
+        std::vector<calc_type> values;
+        std::vector<std::uint64_t> ints;
+        complex_type amplitude;
+    };
+
+    [[nodiscard]] unsigned num_active() const
+    {
+        return 1U << G_;
+    }
+    [[nodiscard]] bool is_active() const
+    {
+        return rank_ < num_active();
+    }
+
+    // Rank 0: send the command to all the other processes and execute it locally
+    Result submit(Command const& cmd);
+    void send_command(unsigned dest, Command const& cmd);
+    Command recv_command();
+
+    // Executed by all the processes
+    Result execute(Command const& cmd);
+
+    // Concatenation of the values of all the active processes (only returned to rank 0)
+    std::vector<calc_type> gather(std::vector<calc_type> const& local);
+
+    // Load all the available CPU kernels when the process starts (every rank, the spawned workers included), so that
+    // select_backend() only switches between loaded kernels while the commands are being executed
+    void load_kernels();
+
+    // Kill and collect the worker processes after a failed initialization
+    void kill_workers();
+
+    // Map a backend (Auto included) to one of the loaded kernels; called by rank 0 before spawning the workers and
+    // before sending SelectBackend, so that an unavailable backend is reported without involving the workers
+    backends::SimBackend resolve_backend(backends::SimBackend backend) const;
+
+    // Exchange the amplitudes with bit local_pos set (lower partition) or cleared (upper partition) with the ones of
+    // the partner process, one block at a time.
+    void exchange_half(unsigned partner, unsigned local_pos, bool upper);
+
+    // Partial sum of <psi|P|psi> over this partition for a Pauli string P
+    complex_type pauli_term(std::size_t xmask, std::size_t zmask);
+
+    void swap_qubits(unsigned global_pos, unsigned local_pos);
+
+    void split_mask(std::size_t mask, std::size_t& local, std::size_t& global) const;
+
+    calc_type norm_of(std::size_t mask, std::size_t value);
+
+    void project(std::size_t mask, std::size_t value, calc_type scale);
+
+    std::size_t get_control_mask(std::vector<unsigned> const& ctrls)
+    {
+        std::size_t ctrlmask = 0;
+        for (auto c: ctrls) {
+            ctrlmask |= (1UL << map_[c]);
+        }
+        return ctrlmask;
+    }
+
+    bool check_ids(std::vector<unsigned> const& ids)
+    {
+        return std::all_of(begin(ids), end(ids), [map = map_](const auto& id) { return map.count(id) != 0UL; });
+    }
+
+    std::unique_ptr<distributed::Transport> transport_;
+    std::vector<int> pids_;
+    unsigned rank_;
+    unsigned max_global_;  // log2(#processes)
+
+    // State replicated in all the processes
+    unsigned L_;  // #local qubits
+    unsigned G_;  // #global qubits
+    StateVector vec_;
+    StateVector buffer_;
+    std::map<backends::SimBackend, backend_kernel_t*> kernels_;
+    backend_kernel_t* backend_kernel_;
+
+    // Only used by rank 0
+    Map map_;
+    fusion::Fusion fused_gates_;
+    unsigned fusion_qubits_min_, fusion_qubits_max_;
+    RndEngine rnd_eng_;
+    std::function<double()> rng_;
+};
+
+#endif /* DISTRIBUTED_HPP */
@@ -15,6 +15,7 @@
 #ifndef FOR_EACH_HPP
 #define FOR_EACH_HPP
 
+#include <cstddef>
 #include <type_traits>
 
 #if defined(__SYCL_COMPILER_VERSION)
@@ -22,13 +23,19 @@
 #    include <sycl/execution>
 #    define PARALLEL_STL_LOOP 1  // NOLINT
 #    define OPENMP_LOOP       0  // NOLINT
+#    define THREAD_POOL_LOOP  0  // NOLINT
 #else
-#    if defined(HIQ_WITH_CUDA) || (defined(ENABLE_MULTITHREADING) && defined(USE_PARALLEL_STL))
+#    if defined(ENABLE_MULTITHREADING) && defined(USE_THREAD_POOL) && !defined(HIQ_WITH_CUDA)
+#        define THREAD_POOL_LOOP 1  // NOLINT
+#    else
+#        define THREAD_POOL_LOOP 0  // NOLINT
+#    endif
+#    if !THREAD_POOL_LOOP && (defined(HIQ_WITH_CUDA) || (defined(ENABLE_MULTITHREADING) && defined(USE_PARALLEL_STL)))
 #        define PARALLEL_STL_LOOP 1  // NOLINT
 #    else
 #        define PARALLEL_STL_LOOP 0  // NOLINT
 #    endif
-#    if defined(ENABLE_MULTITHREADING) && defined(USE_OPENMP)
+#    if !THREAD_POOL_LOOP && defined(ENABLE_MULTITHREADING) && defined(USE_OPENMP)
 #        define OPENMP_LOOP 1  // NOLINT
 #    else
 #        define OPENMP_LOOP 0  // NOLINT
@@ -38,6 +45,9 @@
 #    if PARALLEL_STL_LOOP
 #        include <execution>
 #    endif  // PARALLEL_STL_LOOP
+#    if THREAD_POOL_LOOP
+#        include "thread_pool.hpp"
+#    endif  // THREAD_POOL_LOOP
 
 #endif  // __SYCL_COMPILER_VERSION
 
@@ -46,7 +56,16 @@ namespace parallel
     template <typename kernel_counter_t, typename unary_func_t>
     void for_each(const kernel_counter_t& counter, unary_func_t&& unary_func)
     {
-#if PARALLEL_STL_LOOP
+#if THREAD_POOL_LOOP
+        const auto first = *std::begin(counter);
+        const auto size = static_cast<std::size_t>(std::end(counter) - std::begin(counter));
+        ThreadPool::instance().run(size, [first, &unary_func](std::size_t begin, std::size_t end) {
+            using value_t = std::remove_cv_t<decltype(first)>;
+            for (auto i = begin; i < end; ++i) {
+                unary_func(static_cast<value_t>(first + i));
+            }
+        });
+#elif PARALLEL_STL_LOOP
         std::for_each(std::execution::par_unseq, std::begin(counter), std::end(counter),
                       std::forward<unary_func_t>(unary_func));
 #elif OPENMP_LOOP
@@ -62,5 +81,6 @@ namespace parallel
 
 #undef PARALLEL_STL_LOOP
 #undef OPENMP_LOOP
+#undef THREAD_POOL_LOOP
 
 #endif
@@ -19,8 +19,13 @@
 
 #include <algorithm>
 #include <complex>
+#include <cstdint>
+#include <cstring>
 #include <iostream>
+#include <list>
 #include <set>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 namespace fusion
@@ -40,10 +45,18 @@ namespace fusion
         {
             return mat_;
         }
+        Matrix const& get_matrix() const
+        {
+            return mat_;
+        }
         IndexVector& get_indices()
         {
             return idx_;
         }
+        IndexVector const& get_indices() const
+        {
+            return idx_;
+        }
 
     private:
         Matrix mat_;
@@ -60,7 +73,7 @@ namespace fusion
         using Matrix = std::vector<Complex, aligned_allocator<Complex, alignment>>;
         using ItemVector = std::vector<Item>;
 
-        unsigned num_qubits()
+        unsigned num_qubits() const
         {
             return set_.size();
         }
@@ -77,12 +90,41 @@ namespace fusion
             }
 
             handle_controls(matrix, index_list, ctrl_list);
-            Item item(matrix, index_list);
-            items_.push_back(item);
+            items_.emplace_back(std::move(matrix), std::move(index_list));
+        }
+
+        // Number of qubits the fused gate would act on after inserting a gate acting on index_list with the controls
+        // ctrl_list (cheaper than calling insert() on a copy, which copies all the items)
+        [[nodiscard]] unsigned num_qubits_after(IndexVector const& index_list, IndexVector const& ctrl_list) const
+        {
+            IndexVector added;
+            auto add = [this, &added](Index idx) {
+                if (set_.count(idx) == 0U && std::find(added.begin(), added.end(), idx) == added.end()) {
+                    added.push_back(idx);
+                }
+            };
+            for (auto idx: index_list) {
+                add(idx);
+            }
+            // New controls become target qubits unless the fused gate is empty (see handle_controls())
+            for (auto ctrl: ctrl_list) {
+                if (ctrl_set_.count(ctrl) == 0U && !items_.empty()) {
+                    add(ctrl);
+                }
+            }
+            // Global controls missing from the new gate become target qubits as well
+            for (auto ctrl: ctrl_set_) {
+                if (std::find(ctrl_list.begin(), ctrl_list.end(), ctrl) == ctrl_list.end()) {
+                    add(ctrl);
+                }
+            }
+            return static_cast<unsigned>(set_.size() + added.size());
         }
 
+        // Compute the product of all the items (the last item inserted being the leftmost factor) as a single
+        // matrix acting on the qubits of index_list (sorted in increasing order).
         // NOLINTNEXTLINE
-        void perform_fusion(Matrix& fused_matrix, IndexVector& index_list, IndexVector& ctrl_list)
+        void perform_fusion(Matrix& fused_matrix, IndexVector& index_list, IndexVector& ctrl_list) const
         {
             for (const auto& idx: set_) {
                 index_list.push_back(idx);
@@ -93,54 +135,154 @@ namespace fusion
             fused_matrix = Matrix(dim * dim);
             auto& M = fused_matrix;
 
-            for (std::size_t i = 0; i < dim; ++i) {
-                M[i * dim + i] = 1.;
+            if (items_.empty()) {
+                for (std::size_t i = 0; i < dim; ++i) {
+                    M[i * dim + i] = 1.;
+                }
             }
+            else {
+                // The first item is simply embedded into the (otherwise zero) fused matrix
+                auto tables = embedding(items_.front(), index_list);
+                auto const& mat = items_.front().get_matrix();
+                const auto dim2 = tables.first.size();
+                for (auto base = std::size_t(0); base < dim; base = next_base(base, tables.second)) {
+                    for (std::size_t i = 0; i < dim2; ++i) {
+                        for (std::size_t j = 0; j < dim2; ++j) {
+                            M[(base + tables.first[i]) * dim + base + tables.first[j]] = mat[i * dim2 + j];
+                        }
+                    }
+                }
 
-            for (auto& item: items_) {
-                auto dim2 = static_cast<std::size_t>(sqrt(item.get_matrix().size()));
-                auto const& idx = item.get_indices();
-                IndexVector idx2mat(idx.size());
-                for (std::size_t i = 0; i < idx.size(); ++i) {
-                    idx2mat[i] = static_cast<unsigned>(
-                        std::equal_range(index_list.begin(), index_list.end(), idx[i]).first - index_list.begin());
+                Matrix buffer;
+                for (auto it = items_.begin() + 1; it != items_.end(); ++it) {
+                    multiply_item(M, dim, *it, index_list, buffer);
                 }
+            }
 
-                for (std::size_t k = 0; k < dim; ++k) {  // loop over big matrix columns
-                    // check if column index satisfies control-mask
-                    // if not: leave it unchanged
-                    std::vector<Complex> oldcol(1UL << N);
-                    for (std::size_t i = 0; i < (1UL << N); ++i) {
-                        oldcol[i] = M[i * dim + k];
+            ctrl_list.reserve(ctrl_set_.size());
+            for (const auto& ctrl: ctrl_set_) {
+                ctrl_list.push_back(ctrl);
+            }
+        }
+
+        // Hash of the item matrices (bitwise), of their indices and of the global controls; two Fusion objects with
+        // the same items and controls have the same fused matrix.
+        [[nodiscard]] std::size_t hash() const
+        {
+            std::uint64_t h = items_.size();
+            auto combine = [&h](std::uint64_t value) {
+                h ^= value + 0x9e3779b97f4a7c15ULL + (h << 6U) + (h >> 2U);  // NOLINT
+            };
+            for (auto const& item: items_) {
+                for (auto const& entry: item.get_matrix()) {
+                    std::uint64_t bits[2];
+                    std::memcpy(bits, &entry, sizeof(bits));
+                    combine(bits[0]);
+                    combine(bits[1]);
+                }
+                for (auto idx: item.get_indices()) {
+                    combine(idx);
+                }
+                combine(~std::uint64_t(0));  // item separator
+            }
+            for (auto ctrl: ctrl_set_) {
+                combine(ctrl);
+            }
+            return static_cast<std::size_t>(h);
+        }
+
+        bool operator==(Fusion const& other) const
+        {
+            if (items_.size() != other.items_.size() || ctrl_set_ != other.ctrl_set_) {
+                return false;
+            }
+            for (std::size_t i = 0; i < items_.size(); ++i) {
+                auto const& mat = items_[i].get_matrix();
+                auto const& other_mat = other.items_[i].get_matrix();
+                if (items_[i].get_indices() != other.items_[i].get_indices() || mat.size() != other_mat.size()
+                    || std::memcmp(mat.data(), other_mat.data(), mat.size() * sizeof(Complex)) != 0) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+    private:
+        // Number of columns of the fused matrix processed at once by multiply_item()
+        static constexpr std::size_t block_size = 64;
+
+        // Return the offsets of the 2^k basis states of an item within the fused index space (i.e. the bits of the
+        // local index scattered to the positions of the item qubits in index_list) and the mask of these positions.
+        static std::pair<std::vector<std::size_t>, std::size_t> embedding(Item const& item,
+                                                                          IndexVector const& index_list)
+        {
+            auto const& idx = item.get_indices();
+            std::vector<std::size_t> offsets(1UL << idx.size(), 0);
+            std::size_t mask = 0;
+            for (std::size_t l = 0; l < idx.size(); ++l) {
+                const auto pos = std::lower_bound(index_list.begin(), index_list.end(), idx[l]) - index_list.begin();
+                mask |= 1UL << pos;
+                for (std::size_t j = 0; j < offsets.size(); ++j) {
+                    if ((j >> l) & 1UL) {
+                        offsets[j] |= 1UL << pos;
                     }
+                }
+            }
+            return {offsets, mask};
+        }
 
-                    for (std::size_t i = 0; i < (1UL << N); ++i) {
-                        std::size_t local_i = 0;
-                        for (std::size_t l = 0; l < idx.size(); ++l) {
-                            local_i |= ((i >> idx2mat[l]) & 1UL) << l;
-                        }
+        // Next index larger than base with all the bits of mask equal to zero
+        static std::size_t next_base(std::size_t base, std::size_t mask)
+        {
+            return ((base | mask) + 1) & ~mask;
+        }
 
-                        Complex res = 0.;
-                        for (std::size_t j = 0; j < (1UL << idx.size()); ++j) {
-                            std::size_t locidx = i;
-                            for (std::size_t l = 0; l < idx.size(); ++l) {
-                                if (((j >> l) & 1UL) != ((i >> idx2mat[l]) & 1UL)) {
-                                    locidx ^= (1UL << idx2mat[l]);
-                                }
+        // M <- (item (x) identity) * M
+        //
+        // For every assignment of the qubits which are not part of the item, the 2^k rows of M selected by the
+        // embedding tables form a 2^k x dim matrix which gets multiplied by the 2^k x 2^k item matrix. The columns are
+        // processed in blocks of block_size so that the rows being accumulated stay in the L1 cache; zero matrix
+        // entries (abundant in the matrices of controlled gates) are skipped.
+        static void multiply_item(Matrix& M, std::size_t dim, Item const& item, IndexVector const& index_list,
+                                  Matrix& buffer)
+        {
+            auto tables = embedding(item, index_list);
+            auto const& offsets = tables.first;
+            auto const& mat = item.get_matrix();
+            const auto dim2 = offsets.size();
+            const auto width = std::min(dim, block_size);
+            buffer.resize(dim2 * width);
+
+            // std::complex multiplications do not vectorize without -ffast-math (NaN/Inf handling), hence the
+            // explicit real and imaginary parts below
+            auto* out = reinterpret_cast<double*>(buffer.data());
+            for (auto base = std::size_t(0); base < dim; base = next_base(base, tables.second)) {
+                for (std::size_t col = 0; col < dim; col += width) {
+                    std::fill(buffer.begin(), buffer.end(), Complex(0.));
+                    for (std::size_t i = 0; i < dim2; ++i) {
+                        auto* out_row = out + 2 * i * width;
+                        for (std::size_t j = 0; j < dim2; ++j) {
+                            const auto m_ij = mat[i * dim2 + j];
+                            if (m_ij == Complex(0.)) {
+                                continue;
+                            }
+                            const auto re = m_ij.real();
+                            const auto im = m_ij.imag();
+                            const auto* in_row = reinterpret_cast<const double*>(&M[(base + offsets[j]) * dim + col]);
+                            for (std::size_t k = 0; k < 2 * width; k += 2) {
+                                out_row[k] += re * in_row[k] - im * in_row[k + 1];
+                                out_row[k + 1] += re * in_row[k + 1] + im * in_row[k];
                             }
-                            res += oldcol[locidx] * item.get_matrix()[local_i * dim2 + j];
                         }
-                        M[i * dim + k] = res;
+                    }
+                    for (std::size_t i = 0; i < dim2; ++i) {
+                        std::copy(buffer.begin() + i * width, buffer.begin() + (i + 1) * width,
+                                  M.begin() + (base + offsets[i]) * dim + col);
                     }
                 }
             }
-            ctrl_list.reserve(ctrl_set_.size());
-            for (const auto& ctrl: ctrl_set_) {
-                ctrl_list.push_back(ctrl);
-            }
         }
 
-    private:
         static void add_controls(Matrix& matrix, IndexVector& indexList, IndexVector const& new_ctrls)
         {
             indexList.reserve(indexList.size() + new_ctrls.size());
@@ -203,6 +345,117 @@ namespace fusion
         IndexSet ctrl_set_;
     };
 
+    // Bounded cache of fused matrices (the least recently used entry is evicted first).
+    //
+    // Variational algorithms and Trotterized time evolutions send the same gate sequences on the same qubits over and
+    // over again. The cache is keyed by Fusion::hash() and hits are confirmed by comparing the items bitwise, so that
+    // gates with slightly different parameters simply miss.
+    class FusionCache
+    {
+    public:
+        using Matrix = Fusion::Matrix;
+        using IndexVector = Fusion::IndexVector;
+
+        struct Entry
+        {
+            Fusion key;
+            std::size_t hash;
+            Matrix matrix;
+            IndexVector ids;
+            IndexVector ctrls;
+        };
+
+        static constexpr std::size_t default_capacity = 64;
+
+        explicit FusionCache(std::size_t capacity = default_capacity) : capacity_(capacity), hits_(0), misses_(0)
+        {}
+
+        // Return the fused matrix of the gates (performing the fusion on a miss). The reference stays valid until
+        // the next call to a non-const member function.
+        Entry const& fuse(Fusion const& fused)
+        {
+            const auto h = fused.hash();
+            auto it = index_.find(h);
+            if (it != index_.end()) {
+                if (it->second->key == fused) {
+                    ++hits_;
+                    entries_.splice(entries_.begin(), entries_, it->second);
+                    return *it->second;
+                }
+                // Hash collision: replace the old entry
+                entries_.erase(it->second);
+                index_.erase(it);
+            }
+
+            ++misses_;
+            Entry entry{fused, h, {}, {}, {}};
+            fused.perform_fusion(entry.matrix, entry.ids, entry.ctrls);
+            if (capacity_ == 0) {
+                // Not cached (and not indexed): the entry is only kept until the next call
+                uncached_ = std::move(entry);
+                return uncached_;
+            }
+            if (entries_.size() >= capacity_) {
+                index_.erase(entries_.back().hash);
+                entries_.pop_back();
+            }
+            entries_.push_front(std::move(entry));
+            index_[h] = entries_.begin();
+            return entries_.front();
+        }
+
+        [[nodiscard]] std::size_t capacity() const
+        {
+            return capacity_;
+        }
+
+        void set_capacity(std::size_t capacity)
+        {
+            capacity_ = capacity;
+            while (entries_.size() > capacity_) {
+                index_.erase(entries_.back().hash);
+                entries_.pop_back();
+            }
+        }
+
+        [[nodiscard]] std::size_t size() const
+        {
+            return index_.size();
+        }
+
+        [[nodiscard]] std::size_t hits() const
+        {
+            return hits_;
+        }
+
+        [[nodiscard]] std::size_t misses() const
+        {
+            return misses_;
+        }
+
+        void reset_stats()
+        {
+            hits_ = 0;
+            misses_ = 0;
+        }
+
+        void clear()
+        {
+            entries_.clear();
+            index_.clear();
+        }
+
+    private:
+        using List = std::list<Entry>;  // most recently used first
+
+        std::size_t capacity_;
+        std::size_t hits_;
+        std::size_t misses_;
+        List entries_;
+        std::unordered_map<std::size_t, List::iterator> index_;
+        Entry uncached_{};  // result of the last fusion with capacity 0
+    };
+
 }  // namespace fusion
 
 #endif
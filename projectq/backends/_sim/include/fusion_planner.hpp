@@ -0,0 +1,182 @@
+//   Copyright 2021 <Huawei Technologies Co., Ltd>
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#ifndef FUSION_PLANNER_HPP_
+#define FUSION_PLANNER_HPP_
+
+#include "fusion.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <vector>
+
+namespace fusion
+{
+    // Lookahead gate fusion.
+    //
+    // The greedy fusion of the simulator flushes the fused gates as soon as the next gate does not fit, even if that
+    // gate could be moved past the fused gates or fused with gates further ahead. The planner instead buffers a window
+    // of gates and partitions it into clusters acting on at most max_qubits qubits (each cluster being applied in a
+    // single sweep over the state vector). Every gate joins the cluster that grows the least among the ones it can be
+    // moved back to, i.e. without crossing a gate it does not commute with.
+    //
+    // Two gates commute if they act "diagonally" on all the qubits they share: a gate acts diagonally on its control
+    // qubits and on the target qubits whose value it never changes (e.g. all the qubits of a diagonal gate).
+    class Planner
+    {
+    public:
+        using Index = Fusion::Index;
+        using IndexVector = Fusion::IndexVector;
+        using Matrix = Fusion::Matrix;
+
+        struct Gate
+        {
+            Matrix matrix;
+            IndexVector ids;
+            IndexVector ctrls;
+            IndexVector qubits;           // ids and ctrls (sorted)
+            IndexVector diagonal_qubits;  // qubits the gate acts diagonally on (sorted)
+        };
+
+        Planner() : window_(0), max_qubits_(0)
+        {}
+
+        // window = 0 disables the planner
+        void configure(unsigned window, unsigned max_qubits)
+        {
+            window_ = window;
+            max_qubits_ = max_qubits;
+        }
+
+        [[nodiscard]] bool enabled() const
+        {
+            return window_ > 0;
+        }
+
+        [[nodiscard]] bool empty() const
+        {
+            return gates_.empty();
+        }
+
+        [[nodiscard]] bool full() const
+        {
+            return gates_.size() >= window_;
+        }
+
+        // Drop the buffered gates
+        void clear()
+        {
+            gates_.clear();
+        }
+
+        template <class M>
+        void push(M const& m, IndexVector const& ids, IndexVector const& ctrls)
+        {
+            Gate gate{Matrix(m.begin(), m.end()), ids, ctrls, {}, {}};
+            gate.qubits = ids;
+            gate.qubits.insert(gate.qubits.end(), ctrls.begin(), ctrls.end());
+            std::sort(gate.qubits.begin(), gate.qubits.end());
+
+            gate.diagonal_qubits = ctrls;
+            const std::size_t dim = 1UL << ids.size();
+            for (std::size_t l = 0; l < ids.size(); ++l) {
+                bool diagonal = true;
+                for (std::size_t i = 0; i < dim && diagonal; ++i) {
+                    for (std::size_t j = 0; j < dim; ++j) {
+                        if ((((i ^ j) >> l) & 1UL) && gate.matrix[i * dim + j] != Fusion::Complex(0.)) {
+                            diagonal = false;
+                            break;
+                        }
+                    }
+                }
+                if (diagonal) {
+                    gate.diagonal_qubits.push_back(ids[l]);
+                }
+            }
+            std::sort(gate.diagonal_qubits.begin(), gate.diagonal_qubits.end());
+            gates_.push_back(std::move(gate));
+        }
+
+        static bool commute(Gate const& a, Gate const& b)
+        {
+            IndexVector shared;
+            std::set_intersection(a.qubits.begin(), a.qubits.end(), b.qubits.begin(), b.qubits.end(),
+                                  std::back_inserter(shared));
+            return std::all_of(shared.begin(), shared.end(), [&a, &b](Index q) {
+                return std::binary_search(a.diagonal_qubits.begin(), a.diagonal_qubits.end(), q)
+                       && std::binary_search(b.diagonal_qubits.begin(), b.diagonal_qubits.end(), q);
+            });
+        }
+
+        // Partition the buffered gates into clusters (in the order in which they need to be applied) and clear the
+        // buffer
+        std::vector<Fusion> plan()
+        {
+            struct Cluster
+            {
+                IndexVector qubits;  // sorted
+                std::vector<std::size_t> gates;
+            };
+            std::vector<Cluster> clusters;
+
+            for (std::size_t g = 0; g < gates_.size(); ++g) {
+                auto const& gate = gates_[g];
+                auto best = clusters.size();
+                auto best_size = std::size_t(max_qubits_) + 1;
+                for (auto c = clusters.size(); c-- > 0;) {
+                    IndexVector merged;
+                    std::set_union(clusters[c].qubits.begin(), clusters[c].qubits.end(), gate.qubits.begin(),
+                                   gate.qubits.end(), std::back_inserter(merged));
+                    const auto growth = merged.size() - clusters[c].qubits.size();
+                    if (merged.size() <= max_qubits_ && (best == clusters.size() || growth < best_size)) {
+                        best = c;
+                        best_size = growth;
+                    }
+                    const auto blocked = std::any_of(clusters[c].gates.begin(), clusters[c].gates.end(),
+                                                     [&](std::size_t other) { return !commute(gate, gates_[other]); });
+                    if (blocked) {
+                        break;
+                    }
+                }
+                if (best == clusters.size()) {
+                    clusters.push_back({gate.qubits, {g}});
+                }
+                else {
+                    IndexVector merged;
+                    std::set_union(clusters[best].qubits.begin(), clusters[best].qubits.end(), gate.qubits.begin(),
+                                   gate.qubits.end(), std::back_inserter(merged));
+                    clusters[best].qubits = std::move(merged);
+                    clusters[best].gates.push_back(g);
+                }
+            }
+
+            std::vector<Fusion> result(clusters.size());
+            for (std::size_t c = 0; c < clusters.size(); ++c) {
+                for (auto g: clusters[c].gates) {
+                    result[c].insert(std::move(gates_[g].matrix), gates_[g].ids, gates_[g].ctrls);
+                }
+            }
+            gates_.clear();
+            return result;
+        }
+
+    private:
+        unsigned window_;
+        unsigned max_qubits_;
+        std::vector<Gate> gates_;
+    };
+
+}  // namespace fusion
+
+#endif
@@ -0,0 +1,130 @@
+//   Copyright 2021 <Huawei Technologies Co., Ltd>
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#ifndef MATRIX_REGISTRY_HPP
+#define MATRIX_REGISTRY_HPP
+
+#include "fusion.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Registry of interned gate matrices.
+//
+// Circuits apply the same few matrices (H, T, CNOT, ...) over and over again: registering a matrix once and referring
+// to it by its handle avoids converting it again for every gate. Matrices are interned bitwise, i.e. registering the
+// same matrix twice returns the same handle.
+//
+// Identity matrices are detected once, when they are registered, and skipped by the simulator.
+namespace matrices
+{
+    using Matrix = fusion::Fusion::Matrix;
+
+    struct Entry
+    {
+        Matrix matrix;  // row-major, aligned as the kernels expect it
+        unsigned num_qubits;
+        bool identity;
+    };
+
+    class Registry
+    {
+    public:
+        using Handle = std::size_t;
+
+        static constexpr unsigned max_qubits = 5;
+
+        // Register a (2^k x 2^k, row-major) matrix with 1 <= k <= 5 and return its handle
+        Handle add(Matrix matrix)
+        {
+            auto num_qubits = 0U;
+            while ((std::size_t(1) << (2 * num_qubits)) < matrix.size()) {
+                ++num_qubits;
+            }
+            if (num_qubits < 1 || num_qubits > max_qubits || (std::size_t(1) << (2 * num_qubits)) != matrix.size()) {
+                throw std::invalid_argument("register_matrix(): the matrix must be 2^k x 2^k with 1 <= k <= 5.");
+            }
+
+            const auto h = hash(matrix);
+            const auto range = index_.equal_range(h);
+            for (auto it = range.first; it != range.second; ++it) {
+                auto const& other = entries_[it->second].matrix;
+                if (std::memcmp(other.data(), matrix.data(), matrix.size() * sizeof(matrix[0])) == 0) {
+                    return it->second;
+                }
+            }
+
+            const auto handle = entries_.size();
+            entries_.push_back(make_entry(std::move(matrix), num_qubits));
+            index_.emplace(h, handle);
+            return handle;
+        }
+
+        [[nodiscard]] Entry const& get(Handle handle) const
+        {
+            if (handle >= entries_.size()) {
+                throw std::invalid_argument("Unknown matrix handle.");
+            }
+            return entries_[handle];
+        }
+
+        [[nodiscard]] std::size_t size() const
+        {
+            return entries_.size();
+        }
+
+        // Invalidates all the handles
+        void clear()
+        {
+            entries_.clear();
+            index_.clear();
+        }
+
+    private:
+        static std::size_t hash(Matrix const& matrix)
+        {
+            std::uint64_t h = matrix.size();
+            for (auto const& entry: matrix) {
+                std::uint64_t bits[2];
+                std::memcpy(bits, &entry, sizeof(bits));
+                h ^= bits[0] + 0x9e3779b97f4a7c15ULL + (h << 6U) + (h >> 2U);  // NOLINT
+                h ^= bits[1] + 0x9e3779b97f4a7c15ULL + (h << 6U) + (h >> 2U);  // NOLINT
+            }
+            return static_cast<std::size_t>(h);
+        }
+
+        static Entry make_entry(Matrix matrix, unsigned num_qubits)
+        {
+            const auto dim = std::size_t(1) << num_qubits;
+            Entry entry{std::move(matrix), num_qubits, true};
+            auto const& m = entry.matrix;
+            for (std::size_t i = 0; i < dim && entry.identity; ++i) {
+                for (std::size_t j = 0; j < dim && entry.identity; ++j) {
+                    entry.identity = m[i * dim + j] == fusion::Fusion::Complex(i == j ? 1. : 0.);
+                }
+            }
+            return entry;
+        }
+
+        std::vector<Entry> entries_;
+        std::unordered_multimap<std::size_t, Handle> index_;
+    };
+}  // namespace matrices
+
+#endif /* MATRIX_REGISTRY_HPP */
@@ -0,0 +1,142 @@
+//   Copyright 2021 <Huawei Technologies Co., Ltd>
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#ifndef MPS_HPP
+#define MPS_HPP
+
+#include "types.hpp"
+
+#include <array>
+#include <cstddef>
+#include <map>
+#include <random>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace mps
+{
+    using calc_type = types::calc_type;
+    using complex_type = types::complex_type;
+    using Matrix = std::vector<complex_type>;  // row-major
+
+    // Thin singular value decomposition m = U diag(s) Vh of a row-major rows x cols matrix (U is rows x k, Vh is k x
+    // cols with k = min(rows, cols) and s sorted in decreasing order). Uses LAPACK (zgesvd) if HAVE_LAPACK is defined
+    // and a one-sided Jacobi algorithm otherwise.
+    std::tuple<Matrix, std::vector<calc_type>, Matrix> svd(Matrix m, std::size_t rows, std::size_t cols);
+}  // namespace mps
+
+// Simulator of (low-entanglement) states written as matrix product states.
+//
+// The qubit at position p is represented by a tensor A_p[l, s, r] of shape D_{p-1} x 2 x D_p and the state is kept in
+// mixed canonical form around an orthogonality center, so that measurements and two-qubit gates only need to touch a
+// couple of tensors. Two-qubit gates are applied to neighbouring tensors followed by an SVD whose spectrum is truncated
+// to the maximal bond dimension and/or to the given discarded weight. Gates on non-adjacent qubits are applied by
+// swapping one of the qubits next to the other one first (and back afterwards).
+class MPSSimulator
+{
+    static constexpr auto default_tol_ = 1.e-12;
+
+public:
+    using calc_type = types::calc_type;
+    using complex_type = types::complex_type;
+    using Matrix = mps::Matrix;
+    using Map = std::map<unsigned, unsigned>;
+    using RndEngine = std::mt19937;
+    using Term = std::vector<std::pair<unsigned, char>>;
+    using TermsDict = std::vector<std::pair<Term, calc_type>>;
+
+    // max_bond_dimension = 0 means no limit; truncation_threshold is the maximal weight (sum of the squared singular
+    // values, relative to the norm) discarded by each SVD
+    explicit MPSSimulator(unsigned seed = 1, unsigned max_bond_dimension = 0, calc_type truncation_threshold = 0.);
+
+    void allocate_qubit(unsigned id);
+
+    // The qubit must be in a computational basis state
+    void deallocate_qubit(unsigned id);
+
+    std::vector<bool> measure_qubits(std::vector<unsigned> const& ids);
+
+    // Gates acting on at most two qubits (including the control qubits); bit j of the matrix indices corresponds to
+    // ids[j]
+    void apply_controlled_gate(Matrix const& m, std::vector<unsigned> const& ids, std::vector<unsigned> const& ctrl);
+
+    calc_type get_expectation_value(TermsDict const& td, std::vector<unsigned> const& ids);
+
+    calc_type get_probability(std::vector<bool> const& bit_string, std::vector<unsigned> const& ids);
+
+    // ids must contain all the qubits
+    complex_type get_amplitude(std::vector<bool> const& bit_string, std::vector<unsigned> const& ids);
+
+    // Bond dimensions between neighbouring positions
+    std::vector<unsigned> get_bond_dimensions() const;
+
+    // Total weight discarded by the truncations so far
+    calc_type get_truncation_error() const
+    {
+        return truncation_error_;
+    }
+
+    // Dense state vector (bit p of the index is the qubit at position p): only for small numbers of qubits!
+    std::tuple<Map, Matrix> cheat() const;
+
+private:
+    struct Site
+    {
+        std::size_t left, right;
+        Matrix data;  // data[(l * 2 + s) * right + r]
+
+        complex_type& operator()(std::size_t l, std::size_t s, std::size_t r)
+        {
+            return data[(l * 2 + s) * right + r];
+        }
+        complex_type const& operator()(std::size_t l, std::size_t s, std::size_t r) const
+        {
+            return data[(l * 2 + s) * right + r];
+        }
+    };
+
+    // 2x2 operator acting on the physical index of a site (row-major)
+    using SiteOperator = std::array<complex_type, 4>;
+
+    unsigned position(unsigned id, char const* function_name) const;
+
+    // Move the orthogonality center to position pos
+    void move_center(std::size_t pos);
+
+    void apply_single_site(std::size_t pos, Matrix const& m);
+
+    // Apply a 4x4 gate to positions pos and pos + 1 (bit 0 of the matrix indices is the qubit at position pos)
+    void apply_two_sites(std::size_t pos, Matrix const& m);
+
+    // Swap the qubits at positions pos and pos + 1
+    void swap_sites(std::size_t pos);
+
+    // E'[r, r'] = sum conj(A[l, t, r]) op[t, s] E[l, l'] A[l', s, r'] for the environment E of the left bond
+    static Matrix transfer(Matrix const& env, Site const& site, SiteOperator const& op);
+
+    // <psi| (x)_p op_p |psi> with op_p the identity for the positions missing from ops
+    complex_type expectation(std::map<unsigned, SiteOperator> const& ops) const;
+
+    std::vector<Site> sites_;
+    std::vector<unsigned> qubit_at_;  // position -> qubit id
+    Map map_;                         // qubit id -> position
+    std::size_t center_;
+    unsigned max_bond_dimension_;
+    calc_type truncation_threshold_;
+    calc_type truncation_error_;
+    RndEngine rnd_eng_;
+};
+
+#endif /* MPS_HPP */
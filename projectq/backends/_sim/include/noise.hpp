@@ -0,0 +1,177 @@
+//   Copyright 2021 <Huawei Technologies Co., Ltd>
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#ifndef NOISE_HPP
+#define NOISE_HPP
+
+#include "types.hpp"
+
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace noise
+{
+    // Quantum channel given by its Kraus operators (row-major 2^k x 2^k matrices, bit j of the index is qubit j).
+    //
+    // Channels whose operators are all proportional to unitaries (e.g. depolarizing noise) are detected when the
+    // channel is created: the probability of each operator then does not depend on the state and the operator can be
+    // sampled without looking at the state vector.
+    class KrausChannel
+    {
+        static constexpr auto tol_ = 1.e-10;
+
+    public:
+        using calc_type = types::calc_type;
+        using complex_type = types::complex_type;
+        using Matrix = types::M;
+
+        explicit KrausChannel(std::vector<Matrix> operators) : operators_(std::move(operators)), num_qubits_(0)
+        {
+            if (operators_.empty()) {
+                throw std::invalid_argument("KrausChannel: at least one Kraus operator is required!");
+            }
+            dim_ = static_cast<std::size_t>(std::lround(std::sqrt(operators_[0].size())));
+            while ((1UL << num_qubits_) < dim_) {
+                ++num_qubits_;
+            }
+            if ((1UL << num_qubits_) != dim_) {
+                throw std::invalid_argument("KrausChannel: Kraus operators must be 2^k x 2^k matrices!");
+            }
+            for (auto const& op: operators_) {
+                if (op.size() != dim_ * dim_) {
+                    throw std::invalid_argument("KrausChannel: all Kraus operators must have the same size!");
+                }
+            }
+
+            // K^dagger K for all the operators, checking whether each one is proportional to the identity
+            is_unitary_mixture_ = true;
+            for (auto const& op: operators_) {
+                const auto kk = adjoint_times_self(op);
+                const auto p = std::real(kk[0]);
+                bool proportional = true;
+                for (std::size_t i = 0; i < dim_ && proportional; ++i) {
+                    for (std::size_t j = 0; j < dim_ && proportional; ++j) {
+                        const auto expected = i == j ? complex_type(p) : complex_type(0.);
+                        proportional = std::abs(kk[i * dim_ + j] - expected) < tol_;
+                    }
+                }
+                is_unitary_mixture_ = is_unitary_mixture_ && proportional;
+                probabilities_.push_back(p);
+
+                Matrix unitary(op);
+                if (p > tol_) {
+                    for (auto& v: unitary) {
+                        v /= std::sqrt(p);
+                    }
+                }
+                is_identity_.push_back(proportional && p > tol_ && is_phase_times_identity(unitary));
+                unitaries_.push_back(std::move(unitary));
+            }
+        }
+
+        [[nodiscard]] unsigned num_qubits() const
+        {
+            return num_qubits_;
+        }
+
+        [[nodiscard]] std::vector<Matrix> const& operators() const
+        {
+            return operators_;
+        }
+
+        // True if every Kraus operator is sqrt(p_k) U_k with U_k unitary
+        [[nodiscard]] bool is_unitary_mixture() const
+        {
+            return is_unitary_mixture_;
+        }
+
+        // p_k and U_k of a unitary mixture (U_k is K_k / sqrt(K_k^dagger K_k [0, 0]) otherwise)
+        [[nodiscard]] std::vector<calc_type> const& probabilities() const
+        {
+            return probabilities_;
+        }
+        [[nodiscard]] Matrix const& unitary(std::size_t k) const
+        {
+            return unitaries_[k];
+        }
+
+        // U_k is the identity up to a global phase (nothing needs to be applied)
+        [[nodiscard]] bool is_identity(std::size_t k) const
+        {
+            return is_identity_[k];
+        }
+
+        // Probability of each Kraus operator for a reduced density matrix rho of the channel qubits: Tr(K rho K^dagger)
+        [[nodiscard]] std::vector<calc_type> probabilities(std::vector<complex_type> const& rho) const
+        {
+            std::vector<calc_type> result;
+            result.reserve(operators_.size());
+            for (auto const& op: operators_) {
+                calc_type p = 0.;
+                for (std::size_t r = 0; r < dim_; ++r) {
+                    for (std::size_t a = 0; a < dim_; ++a) {
+                        complex_type row = 0.;
+                        for (std::size_t b = 0; b < dim_; ++b) {
+                            row += rho[a * dim_ + b] * std::conj(op[r * dim_ + b]);
+                        }
+                        p += std::real(op[r * dim_ + a] * row);
+                    }
+                }
+                result.push_back(p);
+            }
+            return result;
+        }
+
+    private:
+        [[nodiscard]] std::vector<complex_type> adjoint_times_self(Matrix const& op) const
+        {
+            std::vector<complex_type> result(dim_ * dim_, 0.);
+            for (std::size_t i = 0; i < dim_; ++i) {
+                for (std::size_t j = 0; j < dim_; ++j) {
+                    for (std::size_t r = 0; r < dim_; ++r) {
+                        result[i * dim_ + j] += std::conj(op[r * dim_ + i]) * op[r * dim_ + j];
+                    }
+                }
+            }
+            return result;
+        }
+
+        [[nodiscard]] bool is_phase_times_identity(Matrix const& m) const
+        {
+            for (std::size_t i = 0; i < dim_; ++i) {
+                for (std::size_t j = 0; j < dim_; ++j) {
+                    const auto expected = i == j ? m[0] : complex_type(0.);
+                    if (std::abs(m[i * dim_ + j] - expected) > tol_) {
+                        return false;
+                    }
+                }
+            }
+            return true;
+        }
+
+        std::vector<Matrix> operators_;
+        std::vector<Matrix> unitaries_;
+        std::vector<calc_type> probabilities_;
+        std::vector<bool> is_identity_;
+        bool is_unitary_mixture_;
+        unsigned num_qubits_;
+        std::size_t dim_;
+    };
+}  // namespace noise
+
+#endif /* NOISE_HPP */
@@ -0,0 +1,205 @@
+//   Copyright 2021 <Huawei Technologies Co., Ltd>
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#ifndef OUT_OF_CORE_HPP
+#define OUT_OF_CORE_HPP
+
+#include "fusion.hpp"
+#include "simbackends.hpp"
+#include "simulator.hpp"
+#include "types.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+// Simulator which keeps the state vector in a set of chunk files instead of main memory.
+//
+// The 2^n amplitudes are split into 2^g chunks of 2^l amplitudes (n = l + g). Qubits mapped to one of the l lowest
+// bit positions are "local" (they index amplitudes within a chunk) while the others are "global" (they index the
+// chunk files). Gates only ever act on local qubits: they are buffered and applied to each chunk in turn during a
+// single sweep over all the files, using the regular backend kernels. A gate acting on a global qubit first swaps
+// it with a local one, which requires loading pairs of chunks. Reading the next chunk and writing back the previous
+// one overlap with the computation on the current chunk.
+class OutOfCoreSimulator
+{
+    static constexpr auto default_tol_ = 1.e-12;
+    static constexpr auto max_qubit_num_ = 5U;
+    static constexpr auto max_pending_ = 64U;
+    static constexpr auto num_slots_ = 3U;
+    static constexpr auto max_group_size_ = 2U;
+
+public:
+    using calc_type = types::calc_type;
+    using complex_type = types::complex_type;
+    using StateVector = types::StateVector;
+    using Map = Simulator::Map;
+    using RndEngine = Simulator::RndEngine;
+    using TermsDict = Simulator::TermsDict;
+    using IOStats = std::map<std::string, double>;
+
+    using backend_kernel_t = Simulator::backend_kernel_t;
+
+    OutOfCoreSimulator(unsigned seed, std::string directory, unsigned local_qubits);
+    ~OutOfCoreSimulator();
+
+    OutOfCoreSimulator(const OutOfCoreSimulator&) = delete;
+    OutOfCoreSimulator& operator=(const OutOfCoreSimulator&) = delete;
+    OutOfCoreSimulator(OutOfCoreSimulator&&) = delete;
+    OutOfCoreSimulator& operator=(OutOfCoreSimulator&&) = delete;
+
+    void allocate_qubit(unsigned id);
+
+    void deallocate_qubit(unsigned id);
+
+    std::vector<bool> measure_qubits(std::vector<unsigned> const& ids);
+
+    template <class M>
+    void apply_controlled_gate(M const& m, const std::vector<unsigned>& ids, const std::vector<unsigned>& ctrl)
+    {
+        ++num_gates_;
+        const auto num_qubits = fused_gates_.num_qubits_after(ids, ctrl);
+
+        if (num_qubits >= fusion_qubits_min_ && num_qubits <= fusion_qubits_max_) {
+            fused_gates_.insert(m, ids, ctrl);
+            run();
+        }
+        else if (num_qubits > fusion_qubits_max_ || (num_qubits - ids.size()) > fused_gates_.num_qubits()) {
+            run();
+            fused_gates_.insert(m, ids, ctrl);
+        }
+        else {
+            fused_gates_.insert(m, ids, ctrl);
+        }
+    }
+
+    calc_type get_expectation_value(TermsDict const& td, std::vector<unsigned> const& ids);
+
+    calc_type get_probability(std::vector<bool> const& bit_string, std::vector<unsigned> const& ids);
+
+    complex_type get_amplitude(std::vector<bool> const& bit_string, std::vector<unsigned> const& ids);
+
+    void collapse_wavefunction(std::vector<unsigned> const& ids, std::vector<bool> const& values);
+
+    void select_backend(backends::SimBackend backend);
+
+    void run();
+
+    // Number of bytes read from/written to the chunk files (in total and per gate) since the last reset.
+    IOStats get_io_stats() const;
+
+    void reset_io_stats();
+
+private:
+    // Operation waiting to be applied to every chunk during the next sweep.
+    struct PendingOp
+    {
+        bool is_gate;
+        types::M matrix;
+        fusion::Fusion::IndexVector ids;  // local bit positions, padded to max_qubit_num_
+        unsigned nids;
+        std::size_t mask;   // local control mask (gates) or projection mask
+        std::size_t value;  // projection value
+        std::size_t gmask;  // only apply to chunks c with (c & gmask) == gval
+        std::size_t gval;
+        calc_type scale;
+    };
+
+    using Group = std::vector<std::size_t>;
+    using GroupBuffers = std::array<StateVector, max_group_size_>;
+    using ChunkVisitor = std::function<bool(std::size_t, StateVector&)>;
+    using PairVisitor = std::function<bool(std::size_t, StateVector&, std::size_t, StateVector&)>;
+    using GroupVisitor = std::function<bool(Group const&, GroupBuffers&)>;
+
+    [[nodiscard]] unsigned local_bits() const
+    {
+        return std::min(N_, L_);
+    }
+    [[nodiscard]] std::size_t chunk_size() const
+    {
+        return 1UL << local_bits();
+    }
+    [[nodiscard]] std::size_t num_chunks() const
+    {
+        return 1UL << (N_ - local_bits());
+    }
+
+    std::string chunk_path(std::size_t chunk) const;
+    void read_chunk(std::size_t chunk, StateVector& buffer, bool is_zero);
+    void write_chunk(std::size_t chunk, StateVector const& buffer);
+
+    void apply_pending(std::size_t chunk, StateVector& buffer);
+    void pipeline(std::vector<Group> const& groups, GroupVisitor const& visit);
+
+    // Apply all pending operations and call visit on each non-zero chunk c with (c & gmask) == gval. The chunk is
+    // written back if it was modified.
+    void sweep(ChunkVisitor const& visit, std::size_t gmask = 0, std::size_t gval = 0);
+
+    // Load all pairs of chunks (c, c ^ partner) with at least one non-zero chunk and call visit on them.
+    void sweep_pairs(std::size_t partner, PairVisitor const& visit);
+
+    void flush_pending();
+
+    void swap_qubits(unsigned global_pos, unsigned local_pos);
+
+    void split_mask(std::size_t mask, std::size_t& local, std::size_t& global) const;
+
+    // Total probability of the amplitudes with (i & mask) == value.
+    calc_type norm_of(std::size_t mask, std::size_t value);
+
+    // Set all amplitudes with (i & mask) != value to zero and scale the other ones.
+    void project(std::size_t mask, std::size_t value, calc_type scale);
+
+    std::size_t get_control_mask(std::vector<unsigned> const& ctrls)
+    {
+        std::size_t ctrlmask = 0;
+        for (auto c: ctrls) {
+            ctrlmask |= (1UL << map_[c]);
+        }
+        return ctrlmask;
+    }
+
+    bool check_ids(std::vector<unsigned> const& ids)
+    {
+        return std::all_of(begin(ids), end(ids), [map = map_](const auto& id) { return map.count(id) != 0UL; });
+    }
+
+    unsigned N_;  // #qubits
+    unsigned L_;  // maximum #local qubits
+    Map map_;
+    std::vector<bool> zero_;  // chunks known to contain only zeros (and possibly no file)
+    std::vector<PendingOp> pending_;
+    std::array<GroupBuffers, num_slots_> buffers_;
+    std::string directory_;
+    std::string tag_;
+    fusion::Fusion fused_gates_;
+    unsigned fusion_qubits_min_, fusion_qubits_max_;
+    RndEngine rnd_eng_;
+    std::function<double()> rng_;
+    backends::SimBackend backend_type_;
+    backend_kernel_t* backend_kernel_;
+
+    std::atomic<std::uint64_t> bytes_read_;
+    std::atomic<std::uint64_t> bytes_written_;
+    std::uint64_t num_gates_;
+    std::uint64_t num_sweeps_;
+    std::uint64_t num_swaps_;
+};
+
+#endif /* OUT_OF_CORE_HPP */
@@ -0,0 +1,107 @@
+/*
+ *   Copyright 2021 <Huawei Technologies Co., Ltd>
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * C API of the standalone simulator library (libprojectq_sim), i.e. of the C++ state vector simulator without Python.
+ *
+ * The kernels are loaded at runtime from the libprojectq_sim_kernels_<backend> libraries (see simbackends_dl.cpp);
+ * the backend is selected as for the Python extension (SIM_BACKEND environment variable or pqsim_select_backend()).
+ *
+ * All the functions returning an int return PQSIM_OK on success and PQSIM_ERROR on failure, in which case
+ * pqsim_last_error() describes the error (until the next error in the same thread). A simulator must not be used by
+ * several threads at the same time.
+ */
+
+#ifndef PROJECTQ_SIM_H_
+#define PROJECTQ_SIM_H_
+
+#include <stddef.h>
+
+#if defined(_WIN32) && defined(PROJECTQ_SIM_BUILD_SHARED)
+#    define PQSIM_API __declspec(dllexport)
+#elif defined(_WIN32) && defined(PROJECTQ_SIM_SHARED)
+#    define PQSIM_API __declspec(dllimport)
+#elif defined(PROJECTQ_SIM_BUILD_SHARED)
+#    define PQSIM_API __attribute__((visibility("default")))
+#else
+#    define PQSIM_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PQSIM_OK 0
+#define PQSIM_ERROR (-1)
+
+/* Values of backends::SimBackend */
+#define PQSIM_BACKEND_AUTO 0
+#define PQSIM_BACKEND_SCALAR_SERIAL 1
+#define PQSIM_BACKEND_SCALAR_THREADED 2
+#define PQSIM_BACKEND_VECTOR_SERIAL 3
+#define PQSIM_BACKEND_VECTOR_THREADED 4
+
+typedef struct pqsim_simulator pqsim_simulator;
+
+/* Term of a Pauli operator: coefficient * P_0(qubits[0]) P_1(qubits[1]) ..., paulis being a string of 'X', 'Y' and
+ * 'Z' of the same length as qubits */
+typedef struct pqsim_pauli_term
+{
+    double coefficient;
+    const char* paulis;
+    const unsigned* qubits;
+    size_t num_qubits;
+} pqsim_pauli_term;
+
+/* Description of the last error of the calling thread */
+PQSIM_API const char* pqsim_last_error(void);
+
+/* Create a simulator (NULL on failure) */
+PQSIM_API pqsim_simulator* pqsim_create(unsigned seed);
+PQSIM_API void pqsim_destroy(pqsim_simulator* sim);
+
+PQSIM_API int pqsim_select_backend(pqsim_simulator* sim, int backend);
+
+PQSIM_API int pqsim_allocate_qubit(pqsim_simulator* sim, unsigned id);
+/* Allocate num_ids qubits at once. Allocated qubits only take memory once a gate acts on them. */
+PQSIM_API int pqsim_allocate_qureg(pqsim_simulator* sim, const unsigned* ids, size_t num_ids);
+/* The qubit must be in a classical state (e.g. measured) */
+PQSIM_API int pqsim_deallocate_qubit(pqsim_simulator* sim, unsigned id);
+
+/* Apply a (2^num_ids x 2^num_ids) matrix, given row by row as interleaved real and imaginary parts, controlled on the
+ * ctrls qubits. Gates are fused and only applied when needed (see pqsim_run()). */
+PQSIM_API int pqsim_apply_gate(pqsim_simulator* sim, const double* matrix, const unsigned* ids, size_t num_ids,
+                               const unsigned* ctrls, size_t num_ctrls);
+
+/* Apply all the pending gates */
+PQSIM_API int pqsim_run(pqsim_simulator* sim);
+
+/* Measure the given qubits, storing the outcomes (0 or 1) in results */
+PQSIM_API int pqsim_measure(pqsim_simulator* sim, const unsigned* ids, size_t num_ids, int* results);
+
+/* Probability of measuring the bit string (one 0/1 value per qubit) */
+PQSIM_API int pqsim_get_probability(pqsim_simulator* sim, const int* bits, const unsigned* ids, size_t num_ids,
+                                    double* probability);
+
+/* Expectation value of a (hermitian) sum of Pauli terms */
+PQSIM_API int pqsim_get_expectation_value(pqsim_simulator* sim, const pqsim_pauli_term* terms, size_t num_terms,
+                                          double* value);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PROJECTQ_SIM_H_ */
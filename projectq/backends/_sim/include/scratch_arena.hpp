@@ -0,0 +1,162 @@
+//   Copyright 2021 <Huawei Technologies Co., Ltd>
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#ifndef SCRATCH_ARENA_HPP
+#define SCRATCH_ARENA_HPP
+
+#include "types.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <utility>
+#include <vector>
+
+// Scratch state vectors of a simulator.
+//
+// The operations which cannot work in place (growing or shrinking the state vector, emulate_math(), expectation
+// values, time evolutions, ...) acquire their temporary vectors from the arena and release them when they are done, so
+// that the next operations reuse the allocations. Each simulator owns its arena: simulators running in different
+// threads do not share any memory.
+//
+// Between two operations, the arena retains at most max_buffers buffers and max_bytes bytes (the largest buffers
+// which fit are kept). By default, it retains two buffers and has no byte limit, i.e. as much memory as the two static
+// buffers it replaces: at most two vectors of the size of the largest temporary used so far. Set max_bytes (or trim the
+// arena) to release them when the state vector shrinks.
+namespace memory
+{
+    class ScratchArena
+    {
+    public:
+        using StateVector = types::StateVector;
+
+        static constexpr std::size_t default_max_buffers = 2;
+        static constexpr std::size_t unlimited = std::numeric_limits<std::size_t>::max();
+
+        // Buffer of size amplitudes (its content is unspecified)
+        StateVector acquire(std::size_t size)
+        {
+            auto best = buffers_.end();  // smallest retained buffer which is large enough
+            for (auto it = buffers_.begin(); it != buffers_.end(); ++it) {
+                if (it->capacity() >= size && (best == buffers_.end() || it->capacity() < best->capacity())) {
+                    best = it;
+                }
+            }
+
+            StateVector buffer;
+            if (best != buffers_.end()) {
+                retained_bytes_ -= bytes(*best);
+                buffer = std::move(*best);
+                buffers_.erase(best);
+                ++reuses_;
+            }
+            else {
+                buffer.reserve(size);
+                ++allocations_;
+            }
+            buffer.resize(size);
+            return buffer;
+        }
+
+        // Give a buffer back to the arena, which keeps it if the limits allow it
+        void release(StateVector&& buffer)
+        {
+            if (buffer.capacity() == 0) {
+                return;
+            }
+            retained_bytes_ += bytes(buffer);
+            buffers_.push_back(std::move(buffer));
+            shrink_to(max_buffers_, max_bytes_);
+        }
+
+        // Free the retained buffers until at most max_bytes bytes are retained
+        void trim(std::size_t max_bytes = 0)
+        {
+            shrink_to(max_buffers_, max_bytes);
+        }
+
+        void set_limits(std::size_t max_buffers, std::size_t max_bytes)
+        {
+            max_buffers_ = max_buffers;
+            max_bytes_ = max_bytes;
+            shrink_to(max_buffers_, max_bytes_);
+        }
+
+        [[nodiscard]] std::size_t max_buffers() const
+        {
+            return max_buffers_;
+        }
+
+        [[nodiscard]] std::size_t max_bytes() const
+        {
+            return max_bytes_;
+        }
+
+        // Number of retained buffers and their size in bytes
+        [[nodiscard]] std::size_t num_buffers() const
+        {
+            return buffers_.size();
+        }
+
+        [[nodiscard]] std::size_t retained_bytes() const
+        {
+            return retained_bytes_;
+        }
+
+        // Number of buffers acquired by allocating memory and by reusing a retained buffer
+        [[nodiscard]] std::size_t allocations() const
+        {
+            return allocations_;
+        }
+
+        [[nodiscard]] std::size_t reuses() const
+        {
+            return reuses_;
+        }
+
+    private:
+        static std::size_t bytes(StateVector const& buffer)
+        {
+            return buffer.capacity() * sizeof(types::complex_type);
+        }
+
+        // Keep the largest buffers which fit into the limits
+        void shrink_to(std::size_t max_buffers, std::size_t max_bytes)
+        {
+            if (buffers_.size() <= max_buffers && retained_bytes_ <= max_bytes) {
+                return;
+            }
+            std::sort(buffers_.begin(), buffers_.end(),
+                      [](StateVector const& a, StateVector const& b) { return a.capacity() > b.capacity(); });
+            std::vector<StateVector> kept;
+            retained_bytes_ = 0;
+            for (auto& buffer: buffers_) {
+                if (kept.size() < max_buffers && bytes(buffer) <= max_bytes - retained_bytes_) {
+                    retained_bytes_ += bytes(buffer);
+                    kept.push_back(std::move(buffer));
+                }
+            }
+            buffers_ = std::move(kept);
+        }
+
+        std::vector<StateVector> buffers_;
+        std::size_t retained_bytes_ = 0;
+        std::size_t max_buffers_ = default_max_buffers;
+        std::size_t max_bytes_ = unlimited;
+        std::size_t allocations_ = 0;
+        std::size_t reuses_ = 0;
+    };
+}  // namespace memory
+
+#endif /* SCRATCH_ARENA_HPP */
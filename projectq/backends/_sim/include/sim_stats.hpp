@@ -0,0 +1,181 @@
+//   Copyright 2021 <Huawei Technologies Co., Ltd>
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#ifndef SIM_STATS_HPP
+#define SIM_STATS_HPP
+
+#include "types.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <utility>
+
+namespace stats
+{
+    using Clock = std::chrono::steady_clock;
+
+    // Time spent outside of the kernels
+    enum class Phase
+    {
+        fusion,
+        measurement,
+        emulate_math
+    };
+
+    // Performance counters of a simulator.
+    //
+    // All the counters are disabled by default, in which case recording anything costs a single branch (in particular
+    // no clock is read).
+    class SimulatorStats
+    {
+    public:
+        using KernelKey = std::pair<unsigned, unsigned>;  // (#target qubits, #control qubits)
+
+        [[nodiscard]] bool enabled() const
+        {
+            return enabled_;
+        }
+
+        void enable(bool enabled)
+        {
+            enabled_ = enabled;
+        }
+
+        // Reset all the counters (leaves the enabled/disabled state unchanged)
+        void reset()
+        {
+            kernel_calls_.clear();
+            kernel_time_.clear();
+            fused_gates_per_flush_.clear();
+            bytes_moved_ = 0.;
+            flops_ = 0.;
+            fusion_time_ = 0.;
+            measurement_time_ = 0.;
+            emulate_math_time_ = 0.;
+        }
+
+        // Record a kernel applying a (2^nqubits x 2^nqubits) matrix with nctrls control qubits onto a state vector of
+        // num_qubits qubits. Each of the 2^(num_qubits - nctrls) amplitudes with all controls set is read and written
+        // once, and costs 2^nqubits complex multiply-adds (8 FLOPs each).
+        void record_kernel(unsigned nqubits, unsigned nctrls, unsigned num_qubits, double seconds)
+        {
+            const KernelKey key{nqubits, nctrls};
+            ++kernel_calls_[key];
+            kernel_time_[key] += seconds;
+            const auto amplitudes = static_cast<double>(1ULL << (num_qubits - nctrls));
+            bytes_moved_ += 2. * sizeof(types::complex_type) * amplitudes;
+            flops_ += 8. * static_cast<double>(1ULL << nqubits) * amplitudes;
+        }
+
+        void record_flush(std::size_t fused_gates)
+        {
+            ++fused_gates_per_flush_[fused_gates];
+        }
+
+        double& time(Phase phase)
+        {
+            switch (phase) {
+                case Phase::fusion:
+                    return fusion_time_;
+                case Phase::measurement:
+                    return measurement_time_;
+                default:
+                    return emulate_math_time_;
+            }
+        }
+
+        [[nodiscard]] std::map<KernelKey, std::uint64_t> const& kernel_calls() const
+        {
+            return kernel_calls_;
+        }
+
+        // Wall time (in seconds) spent in the kernels
+        [[nodiscard]] std::map<KernelKey, double> const& kernel_time() const
+        {
+            return kernel_time_;
+        }
+
+        // Histogram of the number of gates fused into each kernel call
+        [[nodiscard]] std::map<std::size_t, std::uint64_t> const& fused_gates_per_flush() const
+        {
+            return fused_gates_per_flush_;
+        }
+
+        [[nodiscard]] double bytes_moved() const
+        {
+            return bytes_moved_;
+        }
+
+        [[nodiscard]] double flops() const
+        {
+            return flops_;
+        }
+
+        [[nodiscard]] double fusion_time() const
+        {
+            return fusion_time_;
+        }
+
+        [[nodiscard]] double measurement_time() const
+        {
+            return measurement_time_;
+        }
+
+        [[nodiscard]] double emulate_math_time() const
+        {
+            return emulate_math_time_;
+        }
+
+    private:
+        bool enabled_ = false;
+        std::map<KernelKey, std::uint64_t> kernel_calls_;
+        std::map<KernelKey, double> kernel_time_;
+        std::map<std::size_t, std::uint64_t> fused_gates_per_flush_;
+        double bytes_moved_ = 0.;
+        double flops_ = 0.;
+        double fusion_time_ = 0.;
+        double measurement_time_ = 0.;
+        double emulate_math_time_ = 0.;
+    };
+
+    // Adds the wall time of its scope to one of the phases of a SimulatorStats (if enabled at construction)
+    class ScopedTimer
+    {
+    public:
+        ScopedTimer(SimulatorStats& stats, Phase phase) : target_(stats.enabled() ? &stats.time(phase) : nullptr)
+        {
+            if (target_ != nullptr) {
+                start_ = Clock::now();
+            }
+        }
+
+        ScopedTimer(ScopedTimer const&) = delete;
+        ScopedTimer& operator=(ScopedTimer const&) = delete;
+
+        ~ScopedTimer()
+        {
+            if (target_ != nullptr) {
+                *target_ += std::chrono::duration<double>(Clock::now() - start_).count();
+            }
+        }
+
+    private:
+        double* target_;
+        Clock::time_point start_;
+    };
+}  // namespace stats
+
+#endif /* SIM_STATS_HPP */
@@ -15,9 +15,10 @@
 #ifndef SIMBACKENDS_HPP
 #define SIMBACKENDS_HPP
 
-#include <pybind11/pybind11.h>
+#include "types.hpp"
 
 #include <cstdlib>
+#include <string>
 
 namespace backends
 {
@@ -40,14 +41,58 @@ namespace backends
     // Automatically select the most suitable SIM backend for the current machine.
     SimBackend SimBackendGetAuto();
 
+    // Single-threaded counterpart of a multi-threaded CPU backend (SimBackend::Unknown if there is none).
+    SimBackend SimBackendSerial(SimBackend backend);
+
+    // Problem sizes at which SimBackend::Auto switches from the single-threaded to the multi-threaded kernels, and
+    // adds threads as the state vector grows.
+    struct AutoThresholds
+    {
+        unsigned threaded_min_qubits;  // multi-threaded kernels from this number of qubits on
+        unsigned qubits_per_thread;    // each thread handles (at least) 2^qubits_per_thread amplitudes
+    };
+
+    // Current thresholds of SimBackend::Auto (shared by all the simulators of the process). The defaults can be
+    // overridden with the SIM_THREADED_MIN_QUBITS and SIM_QUBITS_PER_THREAD environment variables.
+    AutoThresholds SimBackendGetThresholds();
+
+    void SimBackendSetThresholds(AutoThresholds thresholds);
+
+    // Measure where the multi-threaded kernels of SimBackendGetAuto() start to beat the single-threaded ones, then set
+    // (and return) the corresponding thresholds.
+    AutoThresholds SimBackendCalibrate();
+
     // Check whether the SIM backend is actually supported by the current version.
     bool SimBackendIsSupported(SimBackend backend);
 
     // Check whether the SIM backend is available to the current process.
     bool SimBackendIsAvailable(SimBackend backend);
 
-    // Acquire the Python module for the given backend
-    pybind11::module_ SimBackendAcquire(SimBackend backend);
+    // Name of the backend (e.g. "vector_threaded"), used to locate its kernels.
+    std::string SimBackendName(SimBackend backend);
+
+    // Signature of the kernel function of the backends (see src/kernels.cpp)
+    using KernelFunction = void(types::V&, types::M const&, types::UINT, fusion::Fusion::IndexVector const&,
+                                unsigned);
+
+    // Load the kernel function of the given backend. The kernels are loaded from the corresponding Python module for
+    // the Python extension (see simbackends_python.cpp), from the corresponding shared library for the standalone
+    // library (see simbackends_dl.cpp).
+    KernelFunction* SimBackendLoadKernel(SimBackend backend);
+
+    // Signature of the function setting the number of threads of the kernels (see src/kernels.cpp)
+    using ThreadsFunction = int(int);
+
+    // Load the function setting the number of threads of the kernels of the given backend (nullptr if there is none).
+    ThreadsFunction* SimBackendLoadThreads(SimBackend backend);
+
+    // Set the number of threads of the kernels through set_num_threads (a function loaded by SimBackendLoadThreads)
+    // and return its result. The call is skipped if the calling thread last set the same number with the same
+    // function, the setting being shared by all the simulators using the same kernels.
+    int SimBackendSetThreads(ThreadsFunction* set_num_threads, int num_threads);
+
+    // Address of a function exported by the kernels of the given backend (nullptr if there is no such function)
+    void* SimBackendLoadSymbol(SimBackend backend, char const* name);
 }  // namespace backends
 
 #endif /* SIMBACKENDS_HPP */
@@ -17,16 +17,26 @@
 #define SIMULATOR_HPP_
 
 #include "fusion.hpp"
+#include "fusion_planner.hpp"
+#include "matrix_registry.hpp"
+#include "noise.hpp"
+#include "scratch_arena.hpp"
+#include "sim_stats.hpp"
 #include "simbackends.hpp"
+#include "thread_pool.hpp"
 #include "types.hpp"
 
 #include <algorithm>
+#include <array>
 #include <cmath>
 #include <functional>
 #include <map>
+#include <mutex>
 #include <optional>
 #include <random>
+#include <string>
 #include <tuple>
+#include <utility>
 
 namespace details
 {
@@ -54,38 +64,54 @@ public:
     using Term = std::vector<std::pair<unsigned, char>>;
     using TermsDict = std::vector<std::pair<Term, types::calc_type>>;
     using ComplexTermsDict = std::vector<std::pair<Term, types::complex_type>>;
+    using Factor = std::array<complex_type, 2>;  // state of a qubit which is not entangled with the others
 
     using backend_kernel_t = decltype(details::kernel<types::V, types::M, types::UINT>);
 
     explicit Simulator(unsigned seed = 1);
 
+    // The qubit gets the next position but it is only stored in the state vector once a multi-qubit gate acts on it
+    // (see grow_vector()): until then, its state is kept as a separate factor (see factors_) and its position may
+    // change.
     void allocate_qubit(unsigned id)
     {
         if (map_.count(id) == 0U) {
             map_[id] = N_++;
-            StateVector newvec;  // avoid large memory allocations
-            if (tmpBuff1_.capacity() >= (1UL << N_)) {
-                std::swap(newvec, tmpBuff1_);
-            }
-            newvec.resize(1UL << N_);
-#pragma omp parallel for schedule(static)
-            for (std::size_t i = 0; i < newvec.size(); ++i) {
-                newvec[i] = (i < vec_.size()) ? vec_[i] : 0.;
-            }
-            std::swap(vec_, newvec);
-            // recycle large memory
-            std::swap(tmpBuff1_, newvec);
-            if (tmpBuff1_.capacity() < tmpBuff2_.capacity()) {
-                std::swap(tmpBuff1_, tmpBuff2_);
-            }
+            factors_[id] = {1., 0.};
         }
         else {
             throw(std::runtime_error("AllocateQubit: ID already exists. Qubit IDs should be unique."));
         }
     }
 
+    // Allocate several qubits at once (they only take memory once a gate acts on them, see allocate_qubit())
+    void allocate_qureg(std::vector<unsigned> const& ids)
+    {
+        for (std::size_t i = 0; i < ids.size(); ++i) {
+            if (map_.count(ids[i]) != 0U || std::find(ids.begin(), ids.begin() + i, ids[i]) != ids.begin() + i) {
+                throw(std::runtime_error("AllocateQubit: ID already exists. Qubit IDs should be unique."));
+            }
+        }
+        for (auto id: ids) {
+            map_[id] = N_++;
+            factors_[id] = {1., 0.};
+        }
+    }
+
+    // Number of qubits stored in vec_ (the others are not entangled with any qubit, see allocate_qubit())
+    [[nodiscard]] unsigned num_stored_qubits() const
+    {
+        return num_stored_;
+    }
+
     bool get_classical_value(unsigned id, calc_type tol = default_tol_)
     {
+        if (is_lazy(id)) {
+            return std::norm(factors_[id][0]) <= tol;
+        }
+        if (auto it = classical_.find(id); it != classical_.end()) {
+            return it->second;
+        }
         run();
         unsigned pos = map_[id];
         std::size_t delta = (1UL << pos);
@@ -106,52 +132,62 @@ public:
 
     bool is_classical(unsigned id, calc_type tol = default_tol_)
     {
+        if (is_lazy(id)) {
+            auto const& factor = factors_[id];
+            return (std::norm(factor[0]) > tol) != (std::norm(factor[1]) > tol);
+        }
+        if (classical_.count(id) != 0U) {
+            return true;
+        }
         run();
         unsigned pos = map_[id];
         std::size_t delta = (1UL << pos);
 
-        int16_t up = 0;
-        int16_t down = 0;
-#pragma omp parallel for schedule(static) reduction(| : up, down)
-        for (std::size_t i = 0; i < vec_.size(); i += 2UL * delta) {
+        // Number of blocks with non-zero amplitudes for |0> (up) and |1> (down)
+        const auto up = parallel::sum<std::size_t>(vec_.size() / (2UL * delta), [&](std::size_t k) {
+            const auto i = 2UL * delta * k;
             for (std::size_t j = 0; j < delta; ++j) {
-                up = up | (static_cast<int16_t>(std::norm(vec_[i + j]) > tol) & 1);              // NOLINT
-                down = down | (static_cast<int16_t>(std::norm(vec_[i + j + delta]) > tol) & 1);  // NOLINT
+                if (std::norm(vec_[i + j]) > tol) {
+                    return std::size_t(1);
+                }
             }
-        }
+            return std::size_t(0);
+        });
+        const auto down = parallel::sum<std::size_t>(vec_.size() / (2UL * delta), [&](std::size_t k) {
+            const auto i = 2UL * delta * k + delta;
+            for (std::size_t j = 0; j < delta; ++j) {
+                if (std::norm(vec_[i + j]) > tol) {
+                    return std::size_t(1);
+                }
+            }
+            return std::size_t(0);
+        });
 
-        return 1 == (up ^ down);  // NOLINT
+        return (up > 0) != (down > 0);
     }
 
     void collapse_vector(unsigned id, bool value = false, bool shrink = false)
     {
+        grow_vector({id});
         run();
         unsigned pos = map_[id];
         std::size_t delta = (1UL << pos);
 
         if (!shrink) {
-#pragma omp parallel for schedule(static)
-            for (std::size_t i = 0; i < vec_.size(); i += 2UL * delta) {
-                for (std::size_t j = 0; j < delta; ++j) {
-                    vec_[i + j + static_cast<std::size_t>(!value) * delta] = 0.;
-                }
-            }
+            parallel::for_range(vec_.size() / (2UL * delta), [&](std::size_t k) {
+                const auto i = 2UL * delta * k + static_cast<std::size_t>(!value) * delta;
+                std::fill_n(&vec_[i], delta, complex_type(0.));
+            });
+            classical_[id] = value;
         }
         else {
-            StateVector newvec;  // avoid costly memory reallocations
-            if (tmpBuff1_.capacity() >= (1UL << (N_ - 1UL))) {
-                std::swap(tmpBuff1_, newvec);
-            }
-            newvec.resize((1UL << (N_ - 1UL)));
+            auto newvec = scratch_.acquire(vec_.size() / 2UL);  // avoid costly memory reallocations
 #pragma omp parallel for schedule(static) if (0)
             for (std::size_t i = 0; i < vec_.size(); i += 2UL * delta) {
                 std::copy_n(&vec_[i + static_cast<std::size_t>(value) * delta], delta, &newvec[i / 2UL]);
             }
             std::swap(vec_, newvec);
-            std::swap(tmpBuff1_, newvec);
-            if (tmpBuff1_.capacity() < tmpBuff2_.capacity()) {
-                std::swap(tmpBuff1_, tmpBuff2_);
-            }
+            scratch_.release(std::move(newvec));
 
             for (auto& p: map_) {
                 if (p.second > pos) {
@@ -159,17 +195,40 @@ public:
                 }
             }
             map_.erase(id);
+            classical_.erase(id);
             N_--;
+            num_stored_--;
+            update_backend_kernel();
         }
     }
 
+    // The qubits which are not stored in vec_ are measured on their own factor and the result is known in advance for
+    // the stored qubits which are known to be classical
     void measure_qubits(std::vector<unsigned> const& ids, std::vector<bool>& res)  // NOLINT
     {
+        res = std::vector<bool>(ids.size());
+        std::vector<unsigned> stored;  // indices (in ids) of the qubits stored in vec_
+        for (unsigned i = 0; i < ids.size(); ++i) {
+            if (is_lazy(ids[i])) {
+                res[i] = measure_factor(factors_[ids[i]]);
+            }
+            else if (auto it = classical_.find(ids[i]); it != classical_.end()) {
+                res[i] = it->second;
+            }
+            else {
+                stored.push_back(i);
+            }
+        }
+        if (stored.empty()) {
+            return;
+        }
+
         run();
+        stats::ScopedTimer timer(stats_, stats::Phase::measurement);
 
-        std::vector<unsigned> positions(ids.size());
-        for (unsigned i = 0; i < ids.size(); ++i) {
-            positions[i] = map_[ids[i]];
+        std::vector<unsigned> positions(stored.size());
+        for (unsigned k = 0; k < stored.size(); ++k) {
+            positions[k] = map_[ids[stored[k]]];
         }
 
         calc_type P = 0.;
@@ -184,32 +243,26 @@ public:
         pick--;
         // determine result vector (boolean values for each qubit)
         // and create mask to detect bad entries (i.e., entries that don't agree with measurement)
-        res = std::vector<bool>(ids.size());
         std::size_t mask = 0;
         std::size_t val = 0;
-        for (unsigned i = 0; i < ids.size(); ++i) {
-            bool r = ((pick >> positions[i]) & 1) == 1;  // NOLINT
-            res[i] = r;
-            mask |= (1UL << positions[i]);
-            val |= (static_cast<std::size_t>(static_cast<unsigned int>(r) & 1U) << positions[i]);
+        for (unsigned k = 0; k < stored.size(); ++k) {
+            bool r = ((pick >> positions[k]) & 1) == 1;  // NOLINT
+            res[stored[k]] = r;
+            classical_[ids[stored[k]]] = r;
+            mask |= (1UL << positions[k]);
+            val |= (static_cast<std::size_t>(static_cast<unsigned int>(r) & 1U) << positions[k]);
         }
         // set bad entries to 0
-        calc_type N = 0.;
-#pragma omp parallel for reduction(+ : N) schedule(static)
-        for (std::size_t i = 0; i < vec_.size(); ++i) {
+        calc_type N = parallel::sum<calc_type>(vec_.size(), [&](std::size_t i) {
             if ((i & mask) != val) {
                 vec_[i] = 0.;
+                return calc_type(0.);
             }
-            else {
-                N += std::norm(vec_[i]);
-            }
-        }
+            return std::norm(vec_[i]);
+        });
         // re-normalize
         N = 1. / std::sqrt(N);
-#pragma omp parallel for schedule(static)
-        for (auto& i: vec_) {
-            i *= N;
-        }
+        parallel::for_range(vec_.size(), [&](std::size_t i) { vec_[i] *= N; });
     }
 
     std::vector<bool> measure_qubits_return(std::vector<unsigned> const& ids)
@@ -221,61 +274,233 @@ public:
 
     void deallocate_qubit(unsigned id)
     {
-        run();
         if (map_.count(id) != 1UL) {
             throw(std::runtime_error("DeallocateQubit: Qubit IDs is not known!"));
         }
-        if (!is_classical(id)) {
-            throw(std::runtime_error(
-                "Error: Qubit has not been measured / uncomputed! There is most likely a bug in your code."));
+        if (is_lazy(id)) {
+            // Not stored in vec_: only the positions of the qubits above it change
+            if (!is_classical(id)) {
+                throw(std::runtime_error(
+                    "Error: Qubit has not been measured / uncomputed! There is most likely a bug in your code."));
+            }
+            // The (global) phase of the qubit is kept by another factor or by the state vector
+            const auto phase = factors_[id][get_classical_value(id) ? 1 : 0];
+            factors_.erase(id);
+            if (phase != complex_type(1.)) {
+                if (!factors_.empty()) {
+                    auto& factor = factors_.begin()->second;
+                    factor = {factor[0] * phase, factor[1] * phase};
+                }
+                else {
+                    parallel::for_range(vec_.size(), [&](std::size_t i) { vec_[i] *= phase; });
+                }
+            }
+            const auto pos = map_[id];
+            for (auto& p: map_) {
+                if (p.second > pos) {
+                    p.second--;
+                }
+            }
+            map_.erase(id);
+            N_--;
+            qubit_noise_.erase(id);
+            return;
+        }
+        // A single pass over the state vector if the value of the qubit is known
+        bool value = false;
+        if (auto it = classical_.find(id); it != classical_.end()) {
+            value = it->second;
+        }
+        else {
+            run();
+            if (!is_classical(id)) {
+                throw(std::runtime_error(
+                    "Error: Qubit has not been measured / uncomputed! There is most likely a bug in your code."));
+            }
+            value = get_classical_value(id);
         }
-
-        bool value = get_classical_value(id);
         collapse_vector(id, value, true);
+        qubit_noise_.erase(id);
     }
 
+    // Apply a gate, followed by the noise channels of its qubits (see set_qubit_noise())
     template <class M>
     void apply_controlled_gate(M const& m, const std::vector<unsigned>& ids, const std::vector<unsigned>& ctrl)
     {
-        auto fused_gates = fused_gates_;
-        fused_gates.insert(m, ids, ctrl);
+        apply_noiseless_gate(m, ids, ctrl);
+        if (!qubit_noise_.empty()) {
+            apply_qubit_noise(ids);
+            apply_qubit_noise(ctrl);
+        }
+    }
 
-        if (fused_gates.num_qubits() >= fusion_qubits_min_ && fused_gates.num_qubits() <= fusion_qubits_max_) {
-            fused_gates_ = fused_gates;
-            run();
+    // Intern a gate matrix (see matrix_registry.hpp) and return its handle for apply_registered_gate()
+    std::size_t register_matrix(types::M matrix)
+    {
+        return matrix_registry_.add(std::move(matrix));
+    }
+
+    void apply_registered_gate(std::size_t handle, const std::vector<unsigned>& ids, const std::vector<unsigned>& ctrl)
+    {
+        auto const& entry = matrix_registry_.get(handle);
+        if (entry.num_qubits != ids.size()) {
+            throw std::invalid_argument("apply_registered_gate(): Matrix size does not match the number of qubits.");
         }
-        else if (fused_gates.num_qubits() > fusion_qubits_max_
-                 || (fused_gates.num_qubits() - ids.size()) > fused_gates_.num_qubits()) {
-            run();
-            fused_gates_.insert(m, ids, ctrl);
+        if (entry.identity && qubit_noise_.empty()) {
+            return;
+        }
+        apply_controlled_gate(entry.matrix, ids, ctrl);
+    }
+
+    // Classification of a registered matrix
+    [[nodiscard]] std::map<std::string, bool> get_matrix_classification(std::size_t handle) const
+    {
+        return {{"identity", matrix_registry_.get(handle).identity}};
+    }
+
+    // Number of registered matrices
+    [[nodiscard]] std::size_t num_registered_matrices() const
+    {
+        return matrix_registry_.size();
+    }
+
+    // Invalidate all the matrix handles
+    void clear_matrix_registry()
+    {
+        matrix_registry_.clear();
+    }
+
+    // Register a noise channel and return its handle (for apply_channel() and set_qubit_noise())
+    unsigned add_channel(noise::KrausChannel channel)
+    {
+        channels_.push_back(std::move(channel));
+        return static_cast<unsigned>(channels_.size() - 1);
+    }
+
+    // Apply one of the registered channels to the qubits in ids by sampling one of its Kraus operators (quantum
+    // trajectories). Mixtures of unitaries do not depend on the state and are simply fused with the other gates;
+    // otherwise, the probabilities of all the Kraus operators are obtained from a single pass over the state vector.
+    void apply_channel(unsigned handle, std::vector<unsigned> const& ids)
+    {
+        if (handle >= channels_.size()) {
+            throw(std::invalid_argument("apply_channel(): Unknown channel."));
+        }
+        auto const& channel = channels_[handle];
+        if (channel.num_qubits() != ids.size()) {
+            throw(std::invalid_argument("apply_channel(): Channel size does not match the number of qubits."));
+        }
+        if (!check_ids(ids)) {
+            throw(std::runtime_error(
+                "apply_channel(): Unknown qubit id. Please make sure you have called eng.flush()."));
+        }
+        grow_vector(ids);
+        for (auto id: ids) {
+            classical_.erase(id);
+        }
+
+        if (channel.is_unitary_mixture()) {
+            const auto k = sample(channel.probabilities());
+            if (!channel.is_identity(k)) {
+                insert_gate(channel.unitary(k), ids, {});
+            }
+            return;
+        }
+
+        run();
+        const auto probabilities = channel.probabilities(get_reduced_density_matrix(ids));
+        const auto k = sample(probabilities);
+        if (!(probabilities[k] > 0.)) {
+            throw(std::runtime_error("apply_channel(): All the Kraus operators have probability 0."));
+        }
+        auto m = channel.operators()[k];
+        const auto scale = 1. / std::sqrt(probabilities[k]);
+        for (auto& v: m) {
+            v *= scale;
+        }
+        insert_gate(m, ids, {});
+        run();
+    }
+
+    // Channels applied after every gate acting on the qubit (as target or control)
+    void set_qubit_noise(unsigned id, std::vector<unsigned> const& handles)
+    {
+        for (auto handle: handles) {
+            if (handle >= channels_.size() || channels_[handle].num_qubits() != 1) {
+                throw(std::invalid_argument("set_qubit_noise(): Unknown or multi-qubit channel."));
+            }
+        }
+        if (handles.empty()) {
+            qubit_noise_.erase(id);
         }
         else {
-            fused_gates_ = fused_gates;
+            qubit_noise_[id] = handles;
         }
     }
 
+    // Reduced density matrix of the qubits in ids (row-major, bit j of the row/column index is ids[j]), computed with
+    // per-thread accumulators in a single pass over the state vector.
+    std::vector<complex_type> get_reduced_density_matrix(std::vector<unsigned> const& ids)
+    {
+        grow_vector(ids);
+        run();
+        std::vector<std::size_t> positions;
+        std::size_t mask = 0;
+        for (auto id: ids) {
+            positions.push_back(map_[id]);
+            mask |= 1UL << map_[id];
+        }
+        const std::size_t dim = 1UL << ids.size();
+        std::vector<complex_type> rho(dim * dim, 0.);
+        std::mutex mutex;
+        parallel::for_chunks(vec_.size(), [&](std::size_t begin, std::size_t end) {
+            std::vector<complex_type> local(dim * dim, 0.);
+            std::vector<complex_type> amplitudes(dim);
+            for (std::size_t i = begin; i < end; ++i) {
+                if ((i & mask) != 0) {
+                    continue;
+                }
+                for (std::size_t a = 0; a < dim; ++a) {
+                    std::size_t offset = 0;
+                    for (std::size_t j = 0; j < positions.size(); ++j) {
+                        offset |= ((a >> j) & 1UL) << positions[j];
+                    }
+                    amplitudes[a] = vec_[i | offset];
+                }
+                for (std::size_t a = 0; a < dim; ++a) {
+                    for (std::size_t b = 0; b < dim; ++b) {
+                        local[a * dim + b] += amplitudes[a] * std::conj(amplitudes[b]);
+                    }
+                }
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            for (std::size_t k = 0; k < rho.size(); ++k) {
+                rho[k] += local[k];
+            }
+        });
+        return rho;
+    }
+
     template <class F, class QuReg>
     void emulate_math(F const& f, QuReg quregs, const std::vector<unsigned>& ctrl,  // NOLINT
                       bool /*parallelize*/ = false)
     {
+        for (auto const& qureg: quregs) {
+            grow_vector(qureg);
+        }
+        grow_vector(ctrl);
         run();
+        stats::ScopedTimer timer(stats_, stats::Phase::emulate_math);
         auto ctrlmask = get_control_mask(ctrl);
 
         for (unsigned i = 0; i < quregs.size(); ++i) {
             for (unsigned j = 0; j < quregs[i].size(); ++j) {
+                classical_.erase(quregs[i][j]);
                 quregs[i][j] = map_[quregs[i][j]];
             }
         }
 
-        StateVector newvec;  // avoid costly memory reallocations
-        if (tmpBuff1_.capacity() >= vec_.size()) {
-            std::swap(newvec, tmpBuff1_);
-        }
-        newvec.resize(vec_.size());
-#pragma omp parallel for schedule(static)
-        for (std::size_t i = 0; i < vec_.size(); i++) {
-            newvec[i] = 0;
-        }
+        auto newvec = scratch_.acquire(vec_.size());  // avoid costly memory reallocations
+        parallel::for_range(vec_.size(), [&](std::size_t i) { newvec[i] = 0; });
 
         //#pragma omp parallel reduction(+:newvec[:newvec.size()]) if(parallelize) // requires OpenMP 4.5
         {
@@ -307,7 +532,7 @@ public:
             }
         }
         std::swap(vec_, newvec);
-        std::swap(tmpBuff1_, newvec);
+        scratch_.release(std::move(newvec));
     }
 
     // faster version without calling python
@@ -350,98 +575,173 @@ public:
             quregs, ctrl, true);
     }
 
+    // The qubits which are not stored in vec_ contribute a product of single-qubit expectation values to each term
     calc_type get_expectation_value(TermsDict const& td, std::vector<unsigned> const& ids)
     {
-        run();
         calc_type expectation = 0.;
-
-        StateVector current_state;  // avoid costly memory reallocations
-        if (tmpBuff1_.capacity() >= vec_.size()) {
-            std::swap(tmpBuff1_, current_state);
+        TermsDict stored_terms;  // parts of the terms acting on the qubits stored in vec_
+        for (auto const& term: td) {
+            Term stored;
+            auto coefficient = term.second;
+            for (auto const& local_op: term.first) {
+                if (is_lazy(ids[local_op.first])) {
+                    coefficient *= factor_expectation_value(factors_[ids[local_op.first]], local_op.second);
+                }
+                else {
+                    stored.push_back(local_op);
+                }
+            }
+            if (stored.empty()) {
+                expectation += coefficient;
+            }
+            else {
+                stored_terms.emplace_back(std::move(stored), coefficient);
+            }
         }
-        current_state.resize(vec_.size());
-#pragma omp parallel for schedule(static)
-        for (std::size_t i = 0; i < vec_.size(); ++i) {
-            current_state[i] = vec_[i];
+        if (stored_terms.empty()) {
+            return expectation;
         }
 
-        for (auto const& term: td) {
+        run();
+
+        const auto classical = classical_;  // the terms are applied to (a copy of) the state and then undone
+        auto current_state = scratch_.acquire(vec_.size());  // avoid costly memory reallocations
+        parallel::for_range(vec_.size(), [&](std::size_t i) { current_state[i] = vec_[i]; });
+
+        for (auto const& term: stored_terms) {
             auto const& coefficient = term.second;
             apply_term(term.first, ids, {});
-            calc_type delta = 0.;
-#pragma omp parallel for reduction(+ : delta) schedule(static)
-            for (std::size_t i = 0; i < vec_.size(); ++i) {
+            const auto delta = parallel::sum<calc_type>(vec_.size(), [&](std::size_t i) {
                 auto const a1 = std::real(current_state[i]);
                 auto const b1 = -std::imag(current_state[i]);
                 auto const a2 = std::real(vec_[i]);
                 auto const b2 = std::imag(vec_[i]);
-                delta += a1 * a2 - b1 * b2;
                 // reset vec_
                 vec_[i] = current_state[i];
-            }
+                return a1 * a2 - b1 * b2;
+            });
             expectation += coefficient * delta;
         }
-        std::swap(current_state, tmpBuff1_);
+        scratch_.release(std::move(current_state));
+        classical_ = classical;
         return expectation;
     }
 
     void apply_qubit_operator(ComplexTermsDict const& td, std::vector<unsigned> const& ids)
     {
+        grow_vector(ids);
         run();
-        StateVector new_state;
-        StateVector current_state;  // avoid costly memory reallocations
-        if (tmpBuff1_.capacity() >= vec_.size()) {
-            std::swap(tmpBuff1_, new_state);
-        }
-        if (tmpBuff2_.capacity() >= vec_.size()) {
-            std::swap(tmpBuff2_, current_state);
-        }
-        new_state.resize(vec_.size());
-        current_state.resize(vec_.size());
-#pragma omp parallel for schedule(static)
-        for (std::size_t i = 0; i < vec_.size(); ++i) {
+        auto new_state = scratch_.acquire(vec_.size());  // avoid costly memory reallocations
+        auto current_state = scratch_.acquire(vec_.size());
+        parallel::for_range(vec_.size(), [&](std::size_t i) {
             new_state[i] = 0;
             current_state[i] = vec_[i];
-        }
+        });
         for (auto const& term: td) {
             auto const& coefficient = term.second;
             apply_term(term.first, ids, {});
-#pragma omp parallel for schedule(static)
-            for (std::size_t i = 0; i < vec_.size(); ++i) {
+            parallel::for_range(vec_.size(), [&](std::size_t i) {
                 new_state[i] += coefficient * vec_[i];
                 vec_[i] = current_state[i];
-            }
+            });
         }
         std::swap(vec_, new_state);
-        std::swap(tmpBuff1_, new_state);
-        std::swap(tmpBuff2_, current_state);
+        scratch_.release(std::move(new_state));
+        scratch_.release(std::move(current_state));
+        for (auto id: ids) {
+            classical_.erase(id);
+        }
     }
 
     calc_type get_probability(std::vector<bool> const& bit_string, std::vector<unsigned> const& ids)
     {
-        run();
         if (!check_ids(ids)) {
             throw(std::runtime_error(
                 "get_probability(): Unknown qubit id. Please make sure you have called eng.flush()."));
         }
+        // The qubits which are not stored in vec_ are independent of the others
+        calc_type probability = 1.;
         std::size_t mask = 0;
         std::size_t bit_str = 0;
         for (unsigned i = 0; i < ids.size(); ++i) {
+            if (is_lazy(ids[i])) {
+                probability *= std::norm(factors_[ids[i]][bit_string[i] ? 1 : 0]);
+                continue;
+            }
             mask |= 1UL << map_[ids[i]];
             bit_str |= (bit_string[i] ? 1UL : 0UL) << map_[ids[i]];
         }
-        calc_type probability = 0.;
-#pragma omp parallel for reduction(+ : probability) schedule(static)
-        for (std::size_t i = 0; i < vec_.size(); ++i) {
-            if ((i & mask) == bit_str) {
-                probability += std::norm(vec_[i]);
+        if (mask == 0) {
+            return probability;
+        }
+        run();
+        return probability * parallel::sum<calc_type>(vec_.size(), [&](std::size_t i) {
+                   return (i & mask) == bit_str ? std::norm(vec_[i]) : calc_type(0.);
+               });
+    }
+
+    // Marginal distribution of the qubits in ids: entry k is the probability of measuring bit j of k for qubit
+    // ids[j]. The outcomes of the qubits stored in vec_ are accumulated in a single pass over the state vector, with
+    // one histogram per thread; the qubits which are not stored in vec_ are independent of the others.
+    std::vector<calc_type> get_probabilities(std::vector<unsigned> const& ids)
+    {
+        if (!check_ids(ids)) {
+            throw(std::runtime_error(
+                "get_probabilities(): Unknown qubit id. Please make sure you have called eng.flush()."));
+        }
+        std::vector<std::size_t> stored;  // indices (in ids) of the qubits stored in vec_
+        std::vector<std::size_t> positions;
+        for (std::size_t j = 0; j < ids.size(); ++j) {
+            if (!is_lazy(ids[j])) {
+                stored.push_back(j);
+                positions.push_back(map_[ids[j]]);
             }
         }
-        return probability;
+
+        const std::size_t num_stored_outcomes = 1UL << stored.size();
+        std::vector<calc_type> stored_probabilities(num_stored_outcomes, 0.);
+        if (stored.empty()) {
+            stored_probabilities[0] = 1.;
+        }
+        else {
+            run();
+            std::mutex mutex;
+            parallel::for_chunks(vec_.size(), [&](std::size_t begin, std::size_t end) {
+                std::vector<calc_type> local(num_stored_outcomes, 0.);
+                for (std::size_t i = begin; i < end; ++i) {
+                    std::size_t outcome = 0;
+                    for (std::size_t k = 0; k < positions.size(); ++k) {
+                        outcome |= ((i >> positions[k]) & 1UL) << k;
+                    }
+                    local[outcome] += std::norm(vec_[i]);
+                }
+                std::lock_guard<std::mutex> lock(mutex);
+                for (std::size_t k = 0; k < num_stored_outcomes; ++k) {
+                    stored_probabilities[k] += local[k];
+                }
+            });
+        }
+
+        std::vector<calc_type> probabilities(1UL << ids.size());
+        for (std::size_t outcome = 0; outcome < probabilities.size(); ++outcome) {
+            std::size_t stored_outcome = 0;
+            for (std::size_t k = 0; k < stored.size(); ++k) {
+                stored_outcome |= ((outcome >> stored[k]) & 1UL) << k;
+            }
+            auto probability = stored_probabilities[stored_outcome];
+            for (std::size_t j = 0; j < ids.size(); ++j) {
+                if (is_lazy(ids[j])) {
+                    probability *= std::norm(factors_[ids[j]][(outcome >> j) & 1UL]);
+                }
+            }
+            probabilities[outcome] = probability;
+        }
+        return probabilities;
     }
 
     complex_type const& get_amplitude(std::vector<bool> const& bit_string, std::vector<unsigned> const& ids)
     {
+        grow_vector_to(N_);
         run();
         std::size_t chk = 0;
         std::size_t index = 0;
@@ -464,6 +764,8 @@ public:
     void emulate_time_evolution(TermsDict const& tdict, calc_type const& time, std::vector<unsigned> const& ids,
                                 std::vector<unsigned> const& ctrl)
     {
+        grow_vector(ids);
+        grow_vector(ctrl);
         run();
         complex_type I(0., 1.);
         calc_type tr = 0.;
@@ -480,49 +782,75 @@ public:
         }
         auto s = static_cast<unsigned>(std::abs(time) * op_nrm + 1.);
         complex_type correction = std::exp(-time * I * tr / static_cast<double>(s));
-        auto output_state = vec_;
+        // The temporary vectors are only allocated once (see scratch_arena.hpp)
+        auto output_state = scratch_.acquire(vec_.size());
+        auto current_state = scratch_.acquire(vec_.size());
+        auto update = scratch_.acquire(vec_.size());
+        parallel::for_range(vec_.size(), [&](std::size_t j) { output_state[j] = vec_[j]; });
         auto ctrlmask = get_control_mask(ctrl);
         for (unsigned i = 0; i < s; ++i) {
             calc_type nrm_change = 1.;
             for (unsigned k = 0; nrm_change > default_tol_; ++k) {
                 auto coeff = (-time * I) / double(s * (k + 1));
-                auto current_state = vec_;
-                auto update = StateVector(vec_.size(), 0.);
+                parallel::for_range(vec_.size(), [&](std::size_t j) {
+                    current_state[j] = vec_[j];
+                    update[j] = 0.;
+                });
                 for (auto const& tup: td) {
                     apply_term(tup.first, ids, {});
-#pragma omp parallel for schedule(static)
-                    for (std::size_t j = 0; j < vec_.size(); ++j) {
+                    parallel::for_range(vec_.size(), [&](std::size_t j) {
                         update[j] += vec_[j] * tup.second;
                         vec_[j] = current_state[j];
-                    }
+                    });
                 }
-                nrm_change = 0.;
-#pragma omp parallel for reduction(+ : nrm_change) schedule(static)
-                for (std::size_t j = 0; j < vec_.size(); ++j) {
+                nrm_change = parallel::sum<calc_type>(vec_.size(), [&](std::size_t j) {
                     update[j] *= coeff;
                     vec_[j] = update[j];
                     if ((j & ctrlmask) == ctrlmask) {
                         output_state[j] += update[j];
-                        nrm_change += std::norm(update[j]);
+                        return std::norm(update[j]);
                     }
-                }
+                    return calc_type(0.);
+                });
                 nrm_change = std::sqrt(nrm_change);
             }
-#pragma omp parallel for schedule(static)
-            for (std::size_t j = 0; j < vec_.size(); ++j) {
+            parallel::for_range(vec_.size(), [&](std::size_t j) {
                 if ((j & ctrlmask) == ctrlmask) {
                     output_state[j] *= correction;
                 }
                 vec_[j] = output_state[j];
-            }
+            });
+        }
+        scratch_.release(std::move(output_state));
+        scratch_.release(std::move(current_state));
+        scratch_.release(std::move(update));
+        for (auto id: ids) {
+            classical_.erase(id);
         }
     }
 
     void set_wavefunction(StateVector const& wavefunction, std::vector<unsigned> const& ordering)
     {
-        run();
+        set_wavefunction(wavefunction.data(), wavefunction.size(), ordering);
+    }
+
+    // Copy the amplitudes from an external buffer. No copy is made if the buffer is the state vector itself (e.g. a
+    // writeable view obtained through cheat()), in which case only the ordering changes and the gates which are still
+    // pending are discarded (they were sent before the amplitudes were written).
+    void set_wavefunction(complex_type const* wavefunction, std::size_t size, std::vector<unsigned> const& ordering)
+    {
+        const auto in_place = wavefunction == vec_.data();
+        if (in_place) {
+            if (size != vec_.size()) {
+                throw(std::runtime_error("set_wavefunction: size mismatch between wavefunction and state vector!"));
+            }
+        }
+        else {
+            grow_vector_to(N_);
+            run();
+        }
         // make sure there are 2^n amplitudes for n qubits
-        if (wavefunction.size() != (1UL << ordering.size())) {
+        if (size != (1UL << ordering.size())) {
             throw(std::runtime_error("set_wavefunction: size mismatch between wavefunction and ordering!"));
         }
         // check that all qubits have been allocated previously
@@ -536,14 +864,18 @@ public:
         for (unsigned i = 0; i < ordering.size(); ++i) {
             map_[ordering[i]] = i;
         }
-#pragma omp parallel for schedule(static)
-        for (std::size_t i = 0; i < wavefunction.size(); ++i) {
-            vec_[i] = wavefunction[i];
+        classical_.clear();
+        if (in_place) {
+            fused_gates_ = fusion::Fusion();
+            planner_.clear();
+            return;
         }
+        parallel::for_range(size, [&](std::size_t i) { vec_[i] = wavefunction[i]; });
     }
 
     void collapse_wavefunction(std::vector<unsigned> const& ids, std::vector<bool> const& values)
     {
+        grow_vector(ids);
         run();
         if (ids.size() != values.size()) {
             throw(std::length_error("collapse_wavefunction(): ids and values size mismatch"));
@@ -560,40 +892,392 @@ public:
             val |= ((values[i] ? 1UL : 0UL) << map_[ids[i]]);
         }
         // set bad entries to 0 and compute probability of outcome to renormalize
-        calc_type N = 0.;
-#pragma omp parallel for reduction(+ : N) schedule(static)
-        for (std::size_t i = 0; i < vec_.size(); ++i) {
-            if ((i & mask) == val) {
-                N += std::norm(vec_[i]);
-            }
-        }
+        calc_type N = parallel::sum<calc_type>(
+            vec_.size(), [&](std::size_t i) { return (i & mask) == val ? std::norm(vec_[i]) : calc_type(0.); });
         if (N < default_tol_) {
             throw(std::runtime_error("collapse_wavefunction(): Invalid collapse! Probability is ~0."));
         }
         // re-normalize (if possible)
         N = 1. / std::sqrt(N);
-#pragma omp parallel for schedule(static)
-        for (std::size_t i = 0; i < vec_.size(); ++i) {
+        parallel::for_range(vec_.size(), [&](std::size_t i) {
             if ((i & mask) != val) {
                 vec_[i] = 0.;
             }
             else {
                 vec_[i] *= N;
             }
+        });
+        for (unsigned i = 0; i < ids.size(); ++i) {
+            classical_[ids[i]] = values[i];
         }
     }
 
+    // With SimBackend::Auto, the single-threaded kernels are used for small problem sizes and the number of threads
+    // of the multi-threaded ones grows with the number of qubits (see backends::SimBackendGetThresholds())
     void select_backend(backends::SimBackend backend);
 
+    // Thresholds of SimBackend::Auto (shared by all the simulators of the process)
+    void set_auto_backend_thresholds(unsigned threaded_min_qubits, unsigned qubits_per_thread);
+
+    [[nodiscard]] std::pair<unsigned, unsigned> get_auto_backend_thresholds() const;
+
+    // Measure the thresholds of SimBackend::Auto on the current machine (see backends::SimBackendCalibrate())
+    std::pair<unsigned, unsigned> calibrate_auto_backend();
+
     void run();
 
+    // Hits/misses of the cache of fused matrices since the last reset, along with its size and capacity
+    std::map<std::string, double> get_fusion_cache_stats() const;
+
+    void reset_fusion_cache_stats()
+    {
+        fusion_cache_.reset_stats();
+    }
+
+    // Maximal number of fused matrices kept in the cache (0 disables the cache)
+    void set_fusion_cache_size(std::size_t size)
+    {
+        fusion_cache_.set_capacity(size);
+    }
+
+    // Number and size of the temporary state vectors retained between operations, as well as their limits and the
+    // number of allocations and reuses (see scratch_arena.hpp)
+    std::map<std::string, double> get_scratch_stats() const;
+
+    // Retain at most max_buffers temporary state vectors and max_bytes bytes between operations
+    void set_scratch_limits(std::size_t max_buffers, std::size_t max_bytes)
+    {
+        scratch_.set_limits(max_buffers, max_bytes);
+    }
+
+    // Free the retained temporary state vectors, keeping at most max_bytes bytes
+    void trim_scratch(std::size_t max_bytes = 0)
+    {
+        scratch_.trim(max_bytes);
+    }
+
+    // Enable or disable the performance counters (disabled by default)
+    void enable_stats(bool enable)
+    {
+        stats_.enable(enable);
+    }
+
+    [[nodiscard]] stats::SimulatorStats const& get_stats() const
+    {
+        return stats_;
+    }
+
+    void reset_stats()
+    {
+        stats_.reset();
+    }
+
+    // Buffer up to window gates and let the lookahead planner (see fusion_planner.hpp) fuse them into clusters of at
+    // most max_qubits qubits; window = 0 restores the greedy fusion
+    void set_fusion_planner(unsigned window, unsigned max_qubits);
+
+    // The state vector may be modified through the returned reference: the classical values are forgotten. The
+    // reference (and any pointer to its data) is only valid until the next operation.
     std::tuple<Map, StateVector&> cheat()
     {
+        grow_vector_to(N_);
         run();
+        classical_.clear();
         return make_tuple(map_, std::ref(vec_));
     }
 
+    // Read-only access to the state vector (with all the qubits stored), valid until the next operation
+    std::tuple<Map, StateVector const&> get_state()
+    {
+        grow_vector_to(N_);
+        run();
+        return make_tuple(map_, std::cref(vec_));
+    }
+
 private:
+    // Apply the fused gates
+    void run_fused();
+
+    // Whether a qubit is not stored in vec_ yet (its state being factors_[id])
+    bool is_lazy(unsigned id) const
+    {
+        auto it = map_.find(id);
+        return it != map_.end() && it->second >= num_stored_;
+    }
+
+    // Value of a qubit which is known to be in a basis state (from its factor or from classical_)
+    std::optional<bool> known_value(unsigned id) const
+    {
+        if (is_lazy(id)) {
+            auto const& factor = factors_.at(id);
+            if (factor[1] == complex_type(0.)) {
+                return false;
+            }
+            if (factor[0] == complex_type(0.)) {
+                return true;
+            }
+            return std::nullopt;
+        }
+        auto it = classical_.find(id);
+        if (it != classical_.end()) {
+            return it->second;
+        }
+        return std::nullopt;
+    }
+
+    // Apply a gate without any noise (also used for the operators of expectation values, qubit operators and time
+    // evolutions, which are exact)
+    template <class M>
+    void apply_noiseless_gate(M const& m, const std::vector<unsigned>& ids, const std::vector<unsigned>& ctrl)
+    {
+        // Controls known to be in |1> are dropped and the gate does nothing if one of them is known to be in |0>
+        auto const* controls = &ctrl;
+        std::vector<unsigned> remaining_ctrl;
+        if (std::any_of(ctrl.begin(), ctrl.end(), [this](unsigned c) { return known_value(c).has_value(); })) {
+            for (auto c: ctrl) {
+                if (auto value = known_value(c)) {
+                    if (!*value) {
+                        return;
+                    }
+                    continue;
+                }
+                remaining_ctrl.push_back(c);
+            }
+            controls = &remaining_ctrl;
+        }
+
+        // Single-qubit gates keep the qubit in a product state
+        if (controls->empty() && ids.size() == 1 && is_lazy(ids[0])) {
+            auto& factor = factors_[ids[0]];
+            factor = {m[0] * factor[0] + m[1] * factor[1], m[2] * factor[0] + m[3] * factor[1]};
+            return;
+        }
+
+        grow_vector(ids);
+        grow_vector(*controls);
+        update_classical_values(m, ids, *controls);
+        insert_gate(m, ids, *controls);
+    }
+
+    // Update the known values of the targets of a gate (ctrl: its controls with unknown values). The targets remain
+    // classical if the gate maps their basis state onto a single basis state (e.g. diagonal gates, X, CNOT or SWAP),
+    // which must be the same one if the gate is controlled.
+    template <class M>
+    void update_classical_values(M const& m, const std::vector<unsigned>& ids, const std::vector<unsigned>& ctrl)
+    {
+        if (classical_.empty()) {
+            return;
+        }
+        const auto dim = std::size_t(1) << ids.size();
+        std::size_t column = 0;  // basis state of the targets
+        std::size_t num_known = 0;
+        for (std::size_t j = 0; j < ids.size(); ++j) {
+            auto it = classical_.find(ids[j]);
+            if (it != classical_.end()) {
+                column |= static_cast<std::size_t>(it->second) << j;
+                ++num_known;
+            }
+        }
+        if (num_known == 0) {
+            return;
+        }
+
+        if (num_known == ids.size()) {
+            std::size_t row = 0;
+            auto num_nonzeros = 0U;
+            for (std::size_t i = 0; i < dim; ++i) {
+                if (m[i * dim + column] != complex_type(0.)) {
+                    row = i;
+                    ++num_nonzeros;
+                }
+            }
+            if (num_nonzeros == 1 && (ctrl.empty() || row == column)) {
+                for (std::size_t j = 0; j < ids.size(); ++j) {
+                    classical_[ids[j]] = ((row >> j) & 1U) != 0;
+                }
+                return;
+            }
+        }
+        else {
+            auto diagonal = true;
+            for (std::size_t i = 0; i < dim && diagonal; ++i) {
+                for (std::size_t j = 0; j < dim && diagonal; ++j) {
+                    diagonal = i == j || m[i * dim + j] == complex_type(0.);
+                }
+            }
+            if (diagonal) {
+                return;
+            }
+        }
+        for (auto id: ids) {
+            classical_.erase(id);
+        }
+    }
+
+    // Store the qubits at the first num_qubits positions in vec_, i.e. multiply the state vector by the tensor product
+    // of their factors. Only the memory of the stored qubits is allocated: qubits touched one after the other double
+    // the size of the vector each time, which costs as much as the last reallocation in total.
+    void grow_vector_to(unsigned num_qubits)
+    {
+        if (num_qubits <= num_stored_) {
+            return;
+        }
+
+        // coefficients[k]: amplitude of the new qubits being in the basis state k
+        std::vector<complex_type> coefficients(1UL << (num_qubits - num_stored_), 1.);
+        for (auto const& [id, pos]: map_) {
+            if (pos >= num_stored_ && pos < num_qubits) {
+                auto const& factor = factors_[id];
+                const auto bit = 1UL << (pos - num_stored_);
+                for (std::size_t k = 0; k < coefficients.size(); ++k) {
+                    coefficients[k] *= factor[(k & bit) != 0 ? 1 : 0];
+                }
+                if (auto value = known_value(id)) {
+                    classical_[id] = *value;
+                }
+                factors_.erase(id);
+            }
+        }
+
+        const auto size = 1UL << num_qubits;
+        const auto old_size = vec_.size();
+        if (vec_.capacity() >= size) {
+            vec_.resize(size);
+            parallel::for_range(size - old_size, [&](std::size_t j) {
+                const auto i = old_size + j;
+                vec_[i] = vec_[i & (old_size - 1)] * coefficients[i >> num_stored_];
+            });
+            if (coefficients[0] != complex_type(1.)) {
+                parallel::for_range(old_size, [&](std::size_t i) { vec_[i] *= coefficients[0]; });
+            }
+        }
+        else {
+            auto newvec = scratch_.acquire(size);  // avoid costly memory reallocations
+            parallel::for_range(size, [&](std::size_t i) {
+                newvec[i] = vec_[i & (old_size - 1)] * coefficients[i >> num_stored_];
+            });
+            std::swap(vec_, newvec);
+            scratch_.release(std::move(newvec));  // recycle large memory
+        }
+        num_stored_ = num_qubits;
+        update_backend_kernel();
+    }
+
+    // Store the given qubits in vec_. The qubits which are not stored yet take the next positions, which they swap with
+    // the (not stored) qubits there, so that only their own factors are multiplied into the state vector.
+    void grow_vector(std::vector<unsigned> const& ids)
+    {
+        auto num_qubits = num_stored_;
+        for (auto id: ids) {
+            auto it = map_.find(id);
+            if (it == map_.end() || it->second < num_qubits) {
+                continue;
+            }
+            if (it->second != num_qubits) {
+                for (auto& p: map_) {
+                    if (p.second == num_qubits) {
+                        p.second = it->second;
+                        break;
+                    }
+                }
+                it->second = num_qubits;
+            }
+            ++num_qubits;
+        }
+        grow_vector_to(num_qubits);
+    }
+
+    // Select the kernels (and number of threads) of SimBackend::Auto for the current number of qubits
+    void update_backend_kernel();
+
+    // Add a gate to the fused gates (flushing them first if needed), without applying any noise
+    template <class M>
+    void insert_gate(M const& m, const std::vector<unsigned>& ids, const std::vector<unsigned>& ctrl)
+    {
+        if (planner_.enabled()) {
+            planner_.push(m, ids, ctrl);
+            if (planner_.full()) {
+                run();
+            }
+            return;
+        }
+
+        const auto num_qubits = fused_gates_.num_qubits_after(ids, ctrl);
+
+        if (num_qubits >= fusion_qubits_min_ && num_qubits <= fusion_qubits_max_) {
+            fused_gates_.insert(m, ids, ctrl);
+            run();
+        }
+        else if (num_qubits > fusion_qubits_max_ || (num_qubits - ids.size()) > fused_gates_.num_qubits()) {
+            run();
+            fused_gates_.insert(m, ids, ctrl);
+        }
+        else {
+            fused_gates_.insert(m, ids, ctrl);
+        }
+    }
+
+    void apply_qubit_noise(std::vector<unsigned> const& ids)
+    {
+        for (auto id: ids) {
+            auto it = qubit_noise_.find(id);
+            if (it != qubit_noise_.end()) {
+                for (auto handle: it->second) {
+                    apply_channel(handle, {id});
+                }
+            }
+        }
+    }
+
+    // Index k picked at random with probability probabilities[k]. Indices with probability 0 are never picked, even
+    // if the probabilities add up to slightly less than 1 (the last index with a non-zero probability is picked then).
+    std::size_t sample(std::vector<calc_type> const& probabilities)
+    {
+        const auto rnd = rng_();
+        calc_type P = 0.;
+        auto last = probabilities.size() - 1;
+        for (std::size_t k = 0; k < probabilities.size(); ++k) {
+            if (probabilities[k] <= 0.) {
+                continue;
+            }
+            last = k;
+            P += probabilities[k];
+            if (rnd < P) {
+                return k;
+            }
+        }
+        return last;
+    }
+
+    // Measure a qubit which is not stored in vec_
+    bool measure_factor(Factor& factor)
+    {
+        const auto p0 = std::norm(factor[0]);
+        const auto p1 = std::norm(factor[1]);
+        bool result = false;
+        if (p0 == 0.) {
+            result = true;
+        }
+        else if (p1 != 0.) {
+            result = rng_() * (p0 + p1) >= p0;
+        }
+        factor = result ? Factor{0., factor[1] / std::sqrt(p1)} : Factor{factor[0] / std::sqrt(p0), 0.};
+        return result;
+    }
+
+    static calc_type factor_expectation_value(Factor const& factor, char pauli)
+    {
+        const auto overlap = std::conj(factor[0]) * factor[1];
+        switch (pauli) {
+            case 'X':
+                return 2. * overlap.real();
+            case 'Y':
+                return 2. * overlap.imag();
+            default:
+                return std::norm(factor[0]) - std::norm(factor[1]);
+        }
+    }
+
     void apply_term(Term const& term, std::vector<unsigned> const& ids, std::vector<unsigned> const& ctrl)
     {
         complex_type I(0., 1.);
@@ -603,7 +1287,7 @@ private:
         std::vector<types::M> gates = {X, Y, Z};
         for (auto const& local_op: term) {
             unsigned id = ids[local_op.first];
-            apply_controlled_gate(gates[local_op.second - 'X'], {id}, ctrl);
+            apply_noiseless_gate(gates[local_op.second - 'X'], {id}, ctrl);
         }
         run();
     }
@@ -621,18 +1305,34 @@ private:
         return std::all_of(begin(ids), end(ids), [map = map_](const auto& id) { return map.count(id) != 0UL; });
     }
 
-    unsigned N_;  // #qubits
+    unsigned N_;           // #qubits
+    unsigned num_stored_;  // #qubits stored in vec_, the ones at the positions num_stored_..N_-1 being in factors_
     StateVector vec_;
     Map map_;
+    std::map<unsigned, Factor> factors_;  // state of the qubits which are not stored in vec_ (by id)
+    std::map<unsigned, bool> classical_;  // values of the stored qubits known to be in a basis state (by id)
     fusion::Fusion fused_gates_;
+    fusion::FusionCache fusion_cache_;
+    fusion::Planner planner_;
+    matrices::Registry matrix_registry_;
+    stats::SimulatorStats stats_;
     unsigned fusion_qubits_min_, fusion_qubits_max_;
     RndEngine rnd_eng_;
     std::function<double()> rng_;
     backends::SimBackend backend_type_;
     backend_kernel_t* backend_kernel_;
-
-    // large array buffers to avoid costly reallocations
-    static StateVector tmpBuff1_, tmpBuff2_;  // NOLINT
+    backends::ThreadsFunction* backend_threads_;  // nullptr for single-threaded kernels
+    int num_threads_;                             // 0: as many as allowed
+    struct AutoKernels
+    {
+        backend_kernel_t* serial;
+        backend_kernel_t* threaded;
+        backends::ThreadsFunction* threads;
+    };
+    std::optional<AutoKernels> auto_kernels_;  // kernels to choose from with SimBackend::Auto
+    std::vector<noise::KrausChannel> channels_;
+    std::map<unsigned, std::vector<unsigned>> qubit_noise_;
+    memory::ScratchArena scratch_;  // large temporary vectors, to avoid costly reallocations
 };
 
 #endif
@@ -0,0 +1,140 @@
+//   Copyright 2021 <Huawei Technologies Co., Ltd>
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#ifndef STABILIZER_HPP
+#define STABILIZER_HPP
+
+#include "aligned_allocator.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <random>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+// Simulator of Clifford circuits using the CHP stabilizer tableau of Aaronson and Gottesman
+// (Phys. Rev. A 70, 052328 (2004)).
+//
+// The tableau holds n destabilizer rows, n stabilizer rows and one scratch row. Each row is a Pauli string stored as
+// two bit-packed arrays (x and z bits, one bit per qubit position) plus a sign bit, so that multiplying two rows
+// (rowsum) only involves bitwise operations on 64-bit words which the compiler vectorizes. Gates cost O(n) and
+// measurements O(n^2) (O(n^2 / 64) word operations).
+//
+// Deallocated qubits are reset to |0> and their position is reused by the next allocation, so the tableau never
+// shrinks.
+class StabilizerSimulator
+{
+public:
+    using word_t = std::uint64_t;
+    using Map = std::map<unsigned, unsigned>;
+    using RndEngine = std::mt19937;
+    using Term = std::vector<std::pair<unsigned, char>>;
+    using TermsDict = std::vector<std::pair<Term, double>>;
+
+    explicit StabilizerSimulator(unsigned seed = 1);
+
+    void allocate_qubit(unsigned id);
+
+    // The qubit must be in a computational basis state
+    void deallocate_qubit(unsigned id);
+
+    std::vector<bool> measure_qubits(std::vector<unsigned> const& ids);
+
+    void hadamard(unsigned id);
+    void phase(unsigned id);
+    void phase_dagger(unsigned id);
+    void pauli_x(unsigned id);
+    void pauli_y(unsigned id);
+    void pauli_z(unsigned id);
+    void cnot(unsigned control, unsigned target);
+    void cz(unsigned id1, unsigned id2);
+    void swap(unsigned id1, unsigned id2);
+
+    // Expectation value of a sum of Pauli strings (each string has expectation value 0 or +/-1)
+    double get_expectation_value(TermsDict const& td, std::vector<unsigned> const& ids);
+
+    // Probability of measuring bit_string (always 0 or a power of 1/2)
+    double get_probability(std::vector<bool> const& bit_string, std::vector<unsigned> const& ids);
+
+    // Stabilizer generators as strings such as "+XZI" (character p corresponds to the qubit at position p)
+    std::tuple<Map, std::vector<std::string>> cheat() const;
+
+private:
+    using Row = std::vector<word_t, aligned_allocator<word_t, 64>>;
+
+    static constexpr auto bits_per_word_ = 64U;
+
+    // Row indices in the tableau
+    [[nodiscard]] std::size_t destabilizer(std::size_t i) const
+    {
+        return i;
+    }
+    [[nodiscard]] std::size_t stabilizer(std::size_t i) const
+    {
+        return capacity_ + i;
+    }
+    [[nodiscard]] std::size_t scratch() const
+    {
+        return 2 * capacity_;
+    }
+
+    word_t* x(std::size_t row)
+    {
+        return x_.data() + row * words_;
+    }
+    word_t* z(std::size_t row)
+    {
+        return z_.data() + row * words_;
+    }
+    [[nodiscard]] bool x_bit(std::size_t row, unsigned pos) const
+    {
+        return ((x_[row * words_ + pos / bits_per_word_] >> (pos % bits_per_word_)) & 1U) != 0U;
+    }
+    [[nodiscard]] bool z_bit(std::size_t row, unsigned pos) const
+    {
+        return ((z_[row * words_ + pos / bits_per_word_] >> (pos % bits_per_word_)) & 1U) != 0U;
+    }
+
+    // Make room for at least num_qubits qubit positions
+    void reserve(std::size_t num_qubits);
+
+    // Row h <- row h * row i (Pauli product including the sign)
+    void rowsum(std::size_t h, std::size_t i);
+    void rowcopy(std::size_t h, std::size_t i);
+    void rowclear(std::size_t h);
+
+    // Apply f(x, z, r) to the bits of qubit position pos of all the (de)stabilizer rows
+    template <class F>
+    void for_each_row(unsigned pos, F&& f);
+
+    // Measure the qubit at position pos, returning the outcome and whether it was random. If forced is 0 or 1, a random
+    // outcome takes that value instead of being sampled.
+    std::pair<bool, bool> measure(unsigned pos, int forced = -1);
+
+    unsigned position(unsigned id, char const* function_name) const;
+
+    unsigned N_;  // #qubit positions (including the ones freed by deallocations)
+    std::size_t capacity_;
+    std::size_t words_;
+    Row x_, z_;
+    std::vector<std::uint8_t> r_;
+    Map map_;
+    std::vector<unsigned> free_positions_;
+    RndEngine rnd_eng_;
+};
+
+#endif /* STABILIZER_HPP */
@@ -0,0 +1,424 @@
+//   Copyright 2021 <Huawei Technologies Co., Ltd>
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(__linux__)
+#    include <pthread.h>
+#    include <sched.h>
+#elif defined(__unix__) || defined(__APPLE__)
+#    include <pthread.h>
+#endif  // __linux__
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#    include <intrin.h>
+#endif  // _MSC_VER
+
+#if defined(_OPENMP)
+#    include <omp.h>
+#endif  // _OPENMP
+
+// The parallel loops below use the pool in the same builds as parallel::for_each() (see for_each.hpp)
+#if defined(ENABLE_MULTITHREADING) && defined(USE_THREAD_POOL) && !defined(HIQ_WITH_CUDA)
+#    define PARALLEL_THREAD_POOL 1  // NOLINT
+#else
+#    define PARALLEL_THREAD_POOL 0  // NOLINT
+#endif
+
+namespace parallel
+{
+    // Persistent pool of worker threads running parallel loops.
+    //
+    // Contrary to an OpenMP parallel region, starting a loop does not create (or wake up from the OS) any thread as
+    // long as the workers are spinning, which they do for a short while after each loop (unless there are more threads
+    // than CPUs): gate-heavy circuits only pay a few hundred nanoseconds per loop instead of a full fork/join.
+    //
+    // The iteration space of a loop is split in one contiguous range per thread (the calling thread being one of
+    // them). Each thread processes its range chunk by chunk, then steals chunks from the ranges of the other threads,
+    // so that a slow (e.g. preempted) thread does not delay the whole loop.
+    //
+    // The pool has SIM_NUM_THREADS threads (including the calling one), or OMP_NUM_THREADS, or as many as CPUs.
+    // On Linux, the workers are pinned to distinct CPUs (unless SIM_PIN_THREADS=0). The threaded kernel modules of a
+    // process share a single pool (see share()), so that their workers never compete for the same CPUs.
+    //
+    // Loops started from within a loop, or while another thread is running a loop, run serially in the calling
+    // thread. The loop bodies must not throw.
+    class ThreadPool
+    {
+    public:
+        ThreadPool(ThreadPool const&) = delete;
+        ThreadPool& operator=(ThreadPool const&) = delete;
+
+        // Pool of the current module: the pool passed to share(), or a new one (never destroyed: the workers simply die
+        // with the process)
+        static ThreadPool& instance()
+        {
+            static auto* const pool = shared() != nullptr ? shared() : new ThreadPool(default_num_threads());  // NOLINT
+            return *pool;
+        }
+
+        // Use the pool of another module of the process as the pool of the current module, unless the latter already
+        // exists. Returns the pool of the current module. Must be called before any loop of the current module runs.
+        static ThreadPool& share(ThreadPool* pool)
+        {
+            shared() = pool;
+            return instance();
+        }
+
+        // Maximal number of threads (including the calling thread)
+        [[nodiscard]] unsigned max_threads() const
+        {
+            return static_cast<unsigned>(workers_.size()) + 1U;
+        }
+
+        // Number of threads used by the loops
+        [[nodiscard]] unsigned num_threads() const
+        {
+            return num_threads_.load(std::memory_order_relaxed);
+        }
+
+        // Limit the number of threads used by the loops (0: all of them)
+        void set_num_threads(unsigned num_threads)
+        {
+            num_threads_ = num_threads == 0 || num_threads > max_threads() ? max_threads() : num_threads;
+        }
+
+        // Call body(begin, end) on chunks of [0, size) in parallel; returns once all the chunks have been processed
+        template <class F>
+        void run(std::size_t size, F&& body)
+        {
+            if (size == 0) {
+                return;
+            }
+            const auto active = static_cast<unsigned>(std::min<std::size_t>(num_threads(), size));
+            if (active <= 1 || in_loop() || *forked_ || !busy_.try_lock()) {
+                body(std::size_t(0), size);
+                return;
+            }
+
+            job_ = [](void* context, std::size_t begin, std::size_t end) {
+                (*static_cast<std::remove_reference_t<F>*>(context))(begin, end);
+            };
+            // NOLINTNEXTLINE(cppcoreguidelines-pro-type-const-cast)
+            context_ = const_cast<void*>(static_cast<void const*>(&body));
+            chunk_ = std::max<std::size_t>(1, size / (chunks_per_thread * active));
+            for (auto i = 0U; i < active; ++i) {
+                ranges_[i].next.store(size * i / active, std::memory_order_relaxed);
+                ranges_[i].end = size * (i + 1) / active;
+            }
+            pending_.store(active - 1, std::memory_order_relaxed);
+
+            // Publish the loop (the ranges and job are released by the store)
+            const auto epoch = (state_.load(std::memory_order_relaxed) >> epoch_shift) + 1;
+            state_.store((epoch << epoch_shift) | active, std::memory_order_release);
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+            }
+            wakeup_.notify_all();
+
+            execute(0, active);
+            for (auto i = 0U; pending_.load(std::memory_order_acquire) != 0; ++i) {
+                if (i < spin_count_) {
+                    pause();
+                }
+                else {
+                    std::this_thread::yield();
+                }
+            }
+            busy_.unlock();
+        }
+
+    private:
+        static constexpr auto epoch_shift = 16U;
+        static constexpr std::size_t chunks_per_thread = 8;
+        static constexpr auto default_spin_count = 1U << 14U;
+
+        using Job = void (*)(void*, std::size_t, std::size_t);
+
+        struct alignas(64) Range
+        {
+            std::atomic<std::size_t> next{0};
+            std::size_t end{0};
+        };
+
+        explicit ThreadPool(unsigned num_threads)
+            : ranges_(std::make_unique<Range[]>(num_threads))  // NOLINT(cppcoreguidelines-avoid-c-arrays)
+            , forked_(&forked())
+            , num_threads_(num_threads)
+            , spin_count_(num_threads <= num_cpus() ? default_spin_count : 0U)
+        {
+#if defined(__unix__) || defined(__APPLE__)
+            pthread_atfork(nullptr, nullptr, [] { forked() = true; });
+#endif  // __unix__ || __APPLE__
+            const auto pin = env_value("SIM_PIN_THREADS", 1) != 0;
+            for (auto i = 1U; i < num_threads; ++i) {
+                workers_.emplace_back([this, i] { worker(i); });
+                if (pin) {
+                    pin_thread(workers_.back(), i);
+                }
+            }
+        }
+
+        static unsigned env_value(const char* name, unsigned default_value)
+        {
+            const char* cenv = std::getenv(name);  // NOLINT(concurrency-mt-unsafe)
+            if (cenv == nullptr) {
+                return default_value;
+            }
+            try {
+                return static_cast<unsigned>(std::stoul(cenv));
+            }
+            catch (std::exception const&) {
+                return default_value;
+            }
+        }
+
+        static unsigned default_num_threads()
+        {
+            return std::max(1U, env_value("SIM_NUM_THREADS", env_value("OMP_NUM_THREADS", num_cpus())));
+        }
+
+        // Number of CPUs the process may run on
+        static unsigned num_cpus()
+        {
+#if defined(__linux__)
+            cpu_set_t allowed;
+            CPU_ZERO(&allowed);
+            if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0) {
+                return std::max(1, CPU_COUNT(&allowed));
+            }
+#endif  // __linux__
+            return std::max(1U, std::thread::hardware_concurrency());
+        }
+
+        // Pin the index-th worker to the index-th CPU the process may run on
+        static void pin_thread([[maybe_unused]] std::thread& thread, [[maybe_unused]] unsigned index)
+        {
+#if defined(__linux__)
+            cpu_set_t allowed;
+            CPU_ZERO(&allowed);
+            if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0 || CPU_COUNT(&allowed) <= 1) {
+                return;
+            }
+            index %= static_cast<unsigned>(CPU_COUNT(&allowed));
+            for (auto cpu = 0U; cpu < CPU_SETSIZE; ++cpu) {
+                if (CPU_ISSET(cpu, &allowed) && index-- == 0) {
+                    cpu_set_t set;
+                    CPU_ZERO(&set);
+                    CPU_SET(cpu, &set);
+                    pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set);
+                    return;
+                }
+            }
+#endif  // __linux__
+        }
+
+        static void pause()
+        {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+            _mm_pause();
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+            __builtin_ia32_pause();
+#elif (defined(__GNUC__) || defined(__clang__)) && defined(__aarch64__)
+            asm volatile("yield");
+#endif  // _MSC_VER
+        }
+
+        // Whether the current thread is running a loop of a pool
+        static bool& in_loop()
+        {
+            static thread_local bool value = false;
+            return value;
+        }
+
+        // The workers do not survive a fork(): loops of a forked child are serial
+        static bool& forked()
+        {
+            static bool value = false;
+            return value;
+        }
+
+        // Pool passed to share()
+        static ThreadPool*& shared()
+        {
+            static ThreadPool* pool = nullptr;
+            return pool;
+        }
+
+        // Process the chunks of our range, then steal from the others
+        void execute(unsigned index, unsigned active)
+        {
+            in_loop() = true;
+            for (auto k = 0U; k < active; ++k) {
+                auto& range = ranges_[(index + k) % active];
+                for (;;) {
+                    const auto begin = range.next.fetch_add(chunk_, std::memory_order_relaxed);
+                    if (begin >= range.end) {
+                        break;
+                    }
+                    job_(context_, begin, std::min(begin + chunk_, range.end));
+                }
+            }
+            in_loop() = false;
+        }
+
+        [[noreturn]] void worker(unsigned index)
+        {
+            std::uint64_t epoch = 0;
+            for (;;) {
+                auto state = state_.load(std::memory_order_acquire);
+                for (auto i = 0U; i < spin_count_ && (state >> epoch_shift) == epoch; ++i) {
+                    pause();
+                    state = state_.load(std::memory_order_acquire);
+                }
+                if ((state >> epoch_shift) == epoch) {
+                    std::unique_lock<std::mutex> lock(mutex_);
+                    wakeup_.wait(lock, [&] {
+                        state = state_.load(std::memory_order_acquire);
+                        return (state >> epoch_shift) != epoch;
+                    });
+                }
+
+                // The loop (job and ranges) cannot change before all its threads are done, but we might have missed
+                // whole loops we were not part of
+                epoch = state >> epoch_shift;
+                const auto active = static_cast<unsigned>(state & ((1U << epoch_shift) - 1U));
+                if (index < active) {
+                    execute(index, active);
+                    pending_.fetch_sub(1, std::memory_order_acq_rel);
+                }
+            }
+        }
+
+        std::vector<std::thread> workers_;
+        std::unique_ptr<Range[]> ranges_;  // NOLINT(cppcoreguidelines-avoid-c-arrays)
+        bool const* forked_;               // forked() of the module which created the pool (set by its fork handler)
+        std::atomic<unsigned> num_threads_;
+        const unsigned spin_count_;  // no spinning if there are more threads than CPUs
+
+        // Current loop
+        Job job_ = nullptr;
+        void* context_ = nullptr;
+        std::size_t chunk_ = 1;
+        alignas(64) std::atomic<std::uint64_t> state_{0};  // (epoch << epoch_shift) | number of threads
+        alignas(64) std::atomic<unsigned> pending_{0};     // workers still running the loop
+
+        std::mutex busy_;  // held by the thread running a loop
+        std::mutex mutex_;
+        std::condition_variable wakeup_;
+    };
+
+#if PARALLEL_THREAD_POOL
+    // The loops below run serially in the calling thread over fewer iterations (amplitudes), as waking up the workers
+    // would cost more than the loop
+    constexpr std::size_t min_parallel_size = std::size_t(1) << 12U;
+#endif  // PARALLEL_THREAD_POOL
+
+    // Call f(i) for i in [0, size), in parallel
+    template <class F>
+    void for_range(std::size_t size, F&& f)
+    {
+#if PARALLEL_THREAD_POOL
+        auto body = [&f](std::size_t begin, std::size_t end) {
+            for (auto i = begin; i < end; ++i) {
+                f(i);
+            }
+        };
+        if (size < min_parallel_size) {
+            body(0, size);
+        }
+        else {
+            ThreadPool::instance().run(size, body);
+        }
+#else
+#    pragma omp parallel for schedule(static)
+        for (std::size_t i = 0; i < size; ++i) {
+            f(i);
+        }
+#endif  // PARALLEL_THREAD_POOL
+    }
+
+    // Call f(begin, end) on one contiguous chunk of [0, size) per thread, in parallel (e.g. to accumulate partial
+    // results per thread: their number does not grow with size)
+    template <class F>
+    void for_chunks(std::size_t size, F&& f)
+    {
+        auto chunk = [size, &f](std::size_t k, std::size_t num_chunks) {
+            if (size * k / num_chunks < size * (k + 1) / num_chunks) {
+                f(size * k / num_chunks, size * (k + 1) / num_chunks);
+            }
+        };
+#if PARALLEL_THREAD_POOL
+        const std::size_t num_chunks = size < min_parallel_size ? 1 : ThreadPool::instance().num_threads();
+        ThreadPool::instance().run(num_chunks, [&](std::size_t begin, std::size_t end) {
+            for (auto k = begin; k < end; ++k) {
+                chunk(k, num_chunks);
+            }
+        });
+#elif defined(_OPENMP)
+#    pragma omp parallel
+        chunk(static_cast<std::size_t>(omp_get_thread_num()), static_cast<std::size_t>(omp_get_num_threads()));
+#else
+        chunk(0, 1);
+#endif  // PARALLEL_THREAD_POOL
+    }
+
+    // Sum of f(i) for i in [0, size), computed in parallel
+    template <class T, class F>
+    T sum(std::size_t size, F&& f)
+    {
+        T result = T();
+#if PARALLEL_THREAD_POOL
+        std::mutex mutex;
+        auto body = [&](std::size_t begin, std::size_t end) {
+            T local = T();
+            for (auto i = begin; i < end; ++i) {
+                local += f(i);
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            result += local;
+        };
+        if (size < min_parallel_size) {
+            body(0, size);
+        }
+        else {
+            ThreadPool::instance().run(size, body);
+        }
+#else
+#    pragma omp parallel for reduction(+ : result) schedule(static)
+        for (std::size_t i = 0; i < size; ++i) {
+            result += f(i);
+        }
+#endif  // PARALLEL_THREAD_POOL
+        return result;
+    }
+}  // namespace parallel
+
+#endif /* THREAD_POOL_HPP */
@@ -0,0 +1,81 @@
+//   Copyright 2021 <Huawei Technologies Co., Ltd>
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#ifndef TRANSPORT_HPP
+#define TRANSPORT_HPP
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace distributed
+{
+    // Transports between the processes of a distributed simulator
+    enum class TransportType
+    {
+        SharedMemory,  // POSIX shared memory ring buffers
+        TCP,           // localhost TCP sockets
+    };
+
+    // Parse a transport name ("shm" or "tcp").
+    TransportType TransportTypeFromString(std::string const& name);
+
+    // Point-to-point communication between a fixed number of processes.
+    //
+    // Rank 0 creates the transport and hands its endpoint to the other processes, which join it with their own rank.
+    // All the processes then call connect() before doing any communication.
+    class Transport
+    {
+    public:
+        virtual ~Transport() = default;
+
+        // Description of the transport to be passed to join_transport()
+        [[nodiscard]] virtual std::string endpoint() const = 0;
+
+        // Record the process IDs of the other ranks (only known to rank 0) to detect processes that died.
+        virtual void set_pids(std::vector<int> pids) = 0;
+
+        // Wait for all the processes to join the transport and establish the connections between them.
+        virtual void connect() = 0;
+
+        [[nodiscard]] virtual unsigned rank() const = 0;
+        [[nodiscard]] virtual unsigned size() const = 0;
+
+        // Blocking send/receive of a message of exactly `bytes` bytes
+        virtual void send(unsigned dest, const void* data, std::size_t bytes) = 0;
+        virtual void recv(unsigned src, void* data, std::size_t bytes) = 0;
+
+        // Exchange messages of the same size with another process (the lower rank sends first to avoid deadlocks).
+        void sendrecv(unsigned partner, const void* send_data, void* recv_data, std::size_t bytes)
+        {
+            if (rank() < partner) {
+                send(partner, send_data, bytes);
+                recv(partner, recv_data, bytes);
+            }
+            else {
+                recv(partner, recv_data, bytes);
+                send(partner, send_data, bytes);
+            }
+        }
+    };
+
+    // Create a transport for `size` processes (rank 0).
+    std::unique_ptr<Transport> create_transport(TransportType type, unsigned size);
+
+    // Join the transport created by rank 0 (all the other ranks).
+    std::unique_ptr<Transport> join_transport(std::string const& endpoint, unsigned rank);
+}  // namespace distributed
+
+#endif /* TRANSPORT_HPP */
@@ -13,7 +13,14 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include "command_buffer.hpp"
+#include "density_matrix.hpp"
+#include "distributed.hpp"
+#include "mps.hpp"
+#include "noise.hpp"
+#include "out_of_core.hpp"
 #include "simulator.hpp"
+#include "stabilizer.hpp"
 #include "types.hpp"
 
 #include <pybind11/cast.h>
@@ -23,7 +30,13 @@
 #include <pybind11/pytypes.h>
 #include <pybind11/stl.h>
 
+#include <cmath>
 #include <complex>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <tuple>
 #include <vector>
 
 namespace py = pybind11;
@@ -41,6 +54,83 @@ void emulate_math_wrapper(Simulator& sim, py::function const& pyfunc, QR const&
     sim.emulate_math(f, qr, ctrls);
 }
 
+// Copy of the state vector, or a zero-copy view keeping the simulator alive if writeable or !copy. A view aliases the
+// storage of the state vector, which any subsequent operation may reallocate: it is only valid until the next
+// operation on the simulator.
+py::tuple cheat_wrapper(py::object const& self, bool writeable, bool copy)
+{
+    auto& sim = self.cast<Simulator&>();
+    if (writeable) {
+        auto result = sim.cheat();
+        auto& vec = std::get<1>(result);
+        py::array_t<types::complex_type> view({vec.size()}, {sizeof(types::complex_type)}, vec.data(), self);
+        return py::make_tuple(std::get<0>(result), view);
+    }
+    auto result = sim.get_state();
+    auto const& vec = std::get<1>(result);
+    if (copy) {
+        return py::make_tuple(std::get<0>(result), py::array_t<types::complex_type>(vec.size(), vec.data()));
+    }
+    py::array_t<types::complex_type> view({vec.size()}, {sizeof(types::complex_type)}, vec.data(), self);
+    view.attr("setflags")(py::arg("write") = false);
+    return py::make_tuple(std::get<0>(result), view);
+}
+
+using wavefunction_array_t = py::array_t<types::complex_type, py::array::c_style | py::array::forcecast>;
+
+// Copy the amplitudes straight from the numpy buffer, without the GIL
+void set_wavefunction_wrapper(Simulator& sim, wavefunction_array_t const& wavefunction,
+                              std::vector<unsigned> const& ordering)
+{
+    const auto* data = wavefunction.data();
+    const auto size = static_cast<std::size_t>(wavefunction.size());
+    py::gil_scoped_release release;
+    sim.set_wavefunction(data, size, ordering);
+}
+
+using commands_array_t = py::array_t<std::int64_t, py::array::c_style | py::array::forcecast>;
+
+// Apply a packed command buffer (see command_buffer.hpp) in a single call, without the GIL
+void apply_commands_wrapper(Simulator& sim, commands_array_t const& commands, wavefunction_array_t const& matrices)
+{
+    const auto* words = commands.data();
+    const auto num_words = static_cast<std::size_t>(commands.size());
+    const auto* entries = matrices.data();
+    const auto num_entries = static_cast<std::size_t>(matrices.size());
+    py::gil_scoped_release release;
+    commands::apply(sim, words, num_words, entries, num_entries);
+}
+
+// Move a buffer into a numpy array of the given shape (no copy)
+template <class T>
+py::array_t<T> to_numpy(std::vector<T>&& values, std::vector<py::ssize_t> const& shape)
+{
+    auto owned = std::make_unique<std::vector<T>>(std::move(values));
+    auto* data = owned->data();
+    py::capsule owner(owned.release(), [](void* ptr) { delete static_cast<std::vector<T>*>(ptr); });
+    return py::array_t<T>(shape, data, owner);
+}
+
+// Return the marginal distribution as a numpy array, computed without the GIL
+template <class Sim>
+py::array_t<types::calc_type> get_probabilities_wrapper(Sim& sim, std::vector<unsigned> const& ids)
+{
+    std::vector<types::calc_type> probabilities;
+    {
+        py::gil_scoped_release release;
+        probabilities = sim.get_probabilities(ids);
+    }
+    const auto size = static_cast<py::ssize_t>(probabilities.size());
+    return to_numpy(std::move(probabilities), {size});
+}
+
+// Return a (2^k x 2^k) density matrix as a numpy array
+py::array_t<types::complex_type> density_matrix_to_numpy(std::vector<types::complex_type>&& matrix)
+{
+    const auto dim = static_cast<py::ssize_t>(std::lround(std::sqrt(matrix.size())));
+    return to_numpy(std::move(matrix), {dim, dim});
+}
+
 // NOLINTNEXTLINE
 PYBIND11_MODULE(_cppsim, m)
 {
@@ -49,11 +139,19 @@ PYBIND11_MODULE(_cppsim, m)
     py::class_<Simulator>(m, "Simulator")
         .def(py::init<unsigned>())
         .def("allocate_qubit", &Simulator::allocate_qubit)
+        .def("allocate_qureg", &Simulator::allocate_qureg)
+        .def("num_stored_qubits", &Simulator::num_stored_qubits)
         .def("deallocate_qubit", &Simulator::deallocate_qubit)
         .def("get_classical_value", &Simulator::get_classical_value)
         .def("is_classical", &Simulator::is_classical)
         .def("measure_qubits", &Simulator::measure_qubits_return)
         .def("apply_controlled_gate", &Simulator::apply_controlled_gate<types::M>)
+        .def("apply_commands", &apply_commands_wrapper)
+        .def("register_matrix", &Simulator::register_matrix)
+        .def("apply_registered_gate", &Simulator::apply_registered_gate)
+        .def("get_matrix_classification", &Simulator::get_matrix_classification)
+        .def("num_registered_matrices", &Simulator::num_registered_matrices)
+        .def("clear_matrix_registry", &Simulator::clear_matrix_registry)
         .def("emulate_math", &emulate_math_wrapper<QuRegs>)
         .def("emulate_math_addConstant", &Simulator::emulate_math_addConstant<QuRegs>)
         .def("emulate_math_addConstantModN", &Simulator::emulate_math_addConstantModN<QuRegs>)
@@ -62,12 +160,148 @@ PYBIND11_MODULE(_cppsim, m)
         .def("apply_qubit_operator", &Simulator::apply_qubit_operator)
         .def("emulate_time_evolution", &Simulator::emulate_time_evolution)
         .def("get_probability", &Simulator::get_probability)
+        .def("get_probabilities", &get_probabilities_wrapper<Simulator>)
         .def("get_amplitude", &Simulator::get_amplitude)
-        .def("set_wavefunction", &Simulator::set_wavefunction)
+        .def("set_wavefunction", &set_wavefunction_wrapper)
         .def("collapse_wavefunction", &Simulator::collapse_wavefunction)
         .def("run", &Simulator::run)
-        .def("cheat", &Simulator::cheat)
-        .def("select_backend", &Simulator::select_backend);
+        .def("get_fusion_cache_stats", &Simulator::get_fusion_cache_stats)
+        .def("reset_fusion_cache_stats", &Simulator::reset_fusion_cache_stats)
+        .def("set_fusion_cache_size", &Simulator::set_fusion_cache_size)
+        .def("set_fusion_planner", &Simulator::set_fusion_planner)
+        .def("get_scratch_stats", &Simulator::get_scratch_stats)
+        .def("set_scratch_limits",
+             [](Simulator& sim, std::size_t max_buffers, std::optional<std::size_t> max_bytes) {
+                 sim.set_scratch_limits(max_buffers, max_bytes.value_or(memory::ScratchArena::unlimited));
+             },
+             py::arg("max_buffers"), py::arg("max_bytes") = py::none())
+        .def("trim_scratch", &Simulator::trim_scratch, py::arg("max_bytes") = 0)
+        .def("enable_stats", &Simulator::enable_stats)
+        .def("get_stats",
+             [](Simulator const& sim) {
+                 auto const& stats = sim.get_stats();
+                 py::dict result;
+                 result["enabled"] = stats.enabled();
+                 result["kernel_calls"] = stats.kernel_calls();
+                 result["kernel_time"] = stats.kernel_time();
+                 result["fused_gates_per_flush"] = stats.fused_gates_per_flush();
+                 result["bytes_moved"] = stats.bytes_moved();
+                 result["flops"] = stats.flops();
+                 result["fusion_time"] = stats.fusion_time();
+                 result["measurement_time"] = stats.measurement_time();
+                 result["emulate_math_time"] = stats.emulate_math_time();
+                 return result;
+             })
+        .def("reset_stats", &Simulator::reset_stats)
+        .def("cheat", &cheat_wrapper, py::arg("writeable") = false, py::arg("copy") = true)
+        .def("add_channel",
+             [](Simulator& sim, std::vector<types::M> const& kraus_operators) {
+                 return sim.add_channel(noise::KrausChannel(kraus_operators));
+             })
+        .def("apply_channel", &Simulator::apply_channel)
+        .def("set_qubit_noise", &Simulator::set_qubit_noise)
+        .def("get_reduced_density_matrix",
+             [](Simulator& sim, std::vector<unsigned> const& ids) {
+                 return density_matrix_to_numpy(sim.get_reduced_density_matrix(ids));
+             })
+        .def("select_backend", &Simulator::select_backend)
+        .def("set_auto_backend_thresholds", &Simulator::set_auto_backend_thresholds)
+        .def("get_auto_backend_thresholds", &Simulator::get_auto_backend_thresholds)
+        .def("calibrate_auto_backend", &Simulator::calibrate_auto_backend);
+
+    py::class_<OutOfCoreSimulator>(m, "OutOfCoreSimulator")
+        .def(py::init<unsigned, std::string, unsigned>())
+        .def("allocate_qubit", &OutOfCoreSimulator::allocate_qubit)
+        .def("deallocate_qubit", &OutOfCoreSimulator::deallocate_qubit)
+        .def("measure_qubits", &OutOfCoreSimulator::measure_qubits)
+        .def("apply_controlled_gate", &OutOfCoreSimulator::apply_controlled_gate<types::M>)
+        .def("get_expectation_value", &OutOfCoreSimulator::get_expectation_value)
+        .def("get_probability", &OutOfCoreSimulator::get_probability)
+        .def("get_amplitude", &OutOfCoreSimulator::get_amplitude)
+        .def("collapse_wavefunction", &OutOfCoreSimulator::collapse_wavefunction)
+        .def("run", &OutOfCoreSimulator::run)
+        .def("get_io_stats", &OutOfCoreSimulator::get_io_stats)
+        .def("reset_io_stats", &OutOfCoreSimulator::reset_io_stats)
+        .def("select_backend", &OutOfCoreSimulator::select_backend);
+
+    py::class_<DistributedSimulator>(m, "DistributedSimulator")
+        .def(py::init<unsigned, unsigned, std::string, std::vector<std::string>>())
+        .def_static("serve",
+                    [](std::string const& endpoint, unsigned rank) {
+                        DistributedSimulator worker(endpoint, rank);
+                        py::gil_scoped_release release;
+                        worker.serve();
+                    })
+        .def("allocate_qubit", &DistributedSimulator::allocate_qubit)
+        .def("deallocate_qubit", &DistributedSimulator::deallocate_qubit)
+        .def("measure_qubits", &DistributedSimulator::measure_qubits)
+        .def("apply_controlled_gate", &DistributedSimulator::apply_controlled_gate<types::M>)
+        .def("get_expectation_value", &DistributedSimulator::get_expectation_value)
+        .def("get_probability", &DistributedSimulator::get_probability)
+        .def("get_amplitude", &DistributedSimulator::get_amplitude)
+        .def("collapse_wavefunction", &DistributedSimulator::collapse_wavefunction)
+        .def("run", &DistributedSimulator::run)
+        .def("num_processes", &DistributedSimulator::num_processes)
+        .def("select_backend", &DistributedSimulator::select_backend);
+
+    py::class_<DensityMatrixSimulator>(m, "DensityMatrixSimulator")
+        .def(py::init<unsigned>())
+        .def("allocate_qubit", &DensityMatrixSimulator::allocate_qubit)
+        .def("deallocate_qubit", &DensityMatrixSimulator::deallocate_qubit)
+        .def("measure_qubits", &DensityMatrixSimulator::measure_qubits)
+        .def("apply_controlled_gate", &DensityMatrixSimulator::apply_controlled_gate<types::M>)
+        .def("get_expectation_value", &DensityMatrixSimulator::get_expectation_value)
+        .def("get_probability", &DensityMatrixSimulator::get_probability)
+        .def("get_probabilities", &get_probabilities_wrapper<DensityMatrixSimulator>)
+        .def("get_reduced_density_matrix",
+             [](DensityMatrixSimulator& sim, std::vector<unsigned> const& ids) {
+                 return density_matrix_to_numpy(sim.get_reduced_density_matrix(ids));
+             })
+        .def("get_purity", &DensityMatrixSimulator::get_purity)
+        .def("collapse_wavefunction", &DensityMatrixSimulator::collapse_wavefunction)
+        .def("run", &DensityMatrixSimulator::run)
+        .def("cheat",
+             [](DensityMatrixSimulator& sim) {
+                 auto result = sim.cheat();
+                 return py::make_tuple(std::get<0>(result), density_matrix_to_numpy(std::move(std::get<1>(result))));
+             })
+        .def("select_backend", &DensityMatrixSimulator::select_backend);
+
+    py::class_<StabilizerSimulator>(m, "StabilizerSimulator")
+        .def(py::init<unsigned>())
+        .def("allocate_qubit", &StabilizerSimulator::allocate_qubit)
+        .def("deallocate_qubit", &StabilizerSimulator::deallocate_qubit)
+        .def("measure_qubits", &StabilizerSimulator::measure_qubits)
+        .def("hadamard", &StabilizerSimulator::hadamard)
+        .def("phase", &StabilizerSimulator::phase)
+        .def("phase_dagger", &StabilizerSimulator::phase_dagger)
+        .def("pauli_x", &StabilizerSimulator::pauli_x)
+        .def("pauli_y", &StabilizerSimulator::pauli_y)
+        .def("pauli_z", &StabilizerSimulator::pauli_z)
+        .def("cnot", &StabilizerSimulator::cnot)
+        .def("cz", &StabilizerSimulator::cz)
+        .def("swap", &StabilizerSimulator::swap)
+        .def("get_expectation_value", &StabilizerSimulator::get_expectation_value)
+        .def("get_probability", &StabilizerSimulator::get_probability)
+        .def("cheat", &StabilizerSimulator::cheat);
+
+    py::class_<MPSSimulator>(m, "MPSSimulator")
+        .def(py::init<unsigned, unsigned, double>())
+        .def("allocate_qubit", &MPSSimulator::allocate_qubit)
+        .def("deallocate_qubit", &MPSSimulator::deallocate_qubit)
+        .def("measure_qubits", &MPSSimulator::measure_qubits)
+        .def("apply_controlled_gate", &MPSSimulator::apply_controlled_gate)
+        .def("get_expectation_value", &MPSSimulator::get_expectation_value)
+        .def("get_probability", &MPSSimulator::get_probability)
+        .def("get_amplitude", &MPSSimulator::get_amplitude)
+        .def("get_bond_dimensions", &MPSSimulator::get_bond_dimensions)
+        .def("get_truncation_error", &MPSSimulator::get_truncation_error)
+        .def("cheat", [](MPSSimulator const& sim) {
+            auto result = sim.cheat();
+            auto& psi = std::get<1>(result);
+            const auto size = static_cast<py::ssize_t>(psi.size());
+            return py::make_tuple(std::get<0>(result), to_numpy(std::move(psi), {size}));
+        });
 
     py::enum_<backends::SimBackend>(m, "SimBackend")
         .value("Unknown", backends::SimBackend::Unknown)
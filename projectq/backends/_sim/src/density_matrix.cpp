@@ -0,0 +1,380 @@
+//   Copyright 2021 <Huawei Technologies Co., Ltd>
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#include "density_matrix.hpp"
+
+#include "simbackends.hpp"
+
+#include <bitset>
+#include <climits>
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+
+namespace
+{
+    inline bool parity(std::size_t x)
+    {
+        return (std::bitset<sizeof(std::size_t) * CHAR_BIT>(x).count() & 1U) == 1U;
+    }
+}  // namespace
+
+DensityMatrixSimulator::DensityMatrixSimulator(unsigned seed)
+    : N_(0)
+    , vec_(1, 1.)  // all-zero initial state
+    , fusion_qubits_min_(4)
+    , fusion_qubits_max_(max_qubit_num_)
+    , rnd_eng_(seed)
+    , backend_type_(backends::SimBackend::Unknown)
+    , backend_kernel_(nullptr)
+{
+    std::uniform_real_distribution<double> dist(0., 1.);
+    rng_ = [this, dist]() mutable { return dist(rnd_eng_); };
+
+    select_backend(backends::SimBackendGetEnv());
+}
+
+void DensityMatrixSimulator::select_backend(backends::SimBackend backend)
+{
+    backend_kernel_ = backends::SimBackendLoadKernel(backend);
+    backend_type_ = backend;
+}
+
+// =============================================================================
+
+void DensityMatrixSimulator::allocate_qubit(unsigned id)
+{
+    if (map_.count(id) != 0U) {
+        throw(std::runtime_error("AllocateQubit: ID already exists. Qubit IDs should be unique."));
+    }
+    // rho (x) |0><0|: the new row and column bits are the two highest ones
+    vec_.resize(4 * vec_.size(), 0.);
+    map_[id] = N_++;
+}
+
+void DensityMatrixSimulator::deallocate_qubit(unsigned id)
+{
+    run();
+    if (map_.count(id) != 1UL) {
+        throw(std::runtime_error("DeallocateQubit: Qubit IDs is not known!"));
+    }
+
+    const auto pos = map_[id];
+    const auto low_mask = (1UL << (2 * pos)) - 1;
+    const auto diag = 3UL << (2 * pos);
+    StateVector newvec(vec_.size() / 4);
+#pragma omp parallel for schedule(static)
+    for (std::size_t j = 0; j < newvec.size(); ++j) {
+        const auto i = ((j & ~low_mask) << 2) | (j & low_mask);
+        newvec[j] = vec_[i] + vec_[i | diag];
+    }
+    std::swap(vec_, newvec);
+
+    for (auto& p: map_) {
+        if (p.second > pos) {
+            p.second--;
+        }
+    }
+    map_.erase(id);
+    N_--;
+}
+
+std::vector<bool> DensityMatrixSimulator::measure_qubits(std::vector<unsigned> const& ids)
+{
+    run();
+
+    const auto rows = row_positions();
+    const std::size_t num_states = 1UL << N_;
+    calc_type P = 0.;
+    calc_type rnd = rng_();
+
+    // pick a basis state at random with probability rho[x, x]
+    std::size_t pick = 0;
+    while (P < rnd && pick < num_states) {
+        const auto d = deposit(pick++, rows);
+        P += std::real(vec_[d | (d << 1U)]);
+    }
+    pick--;
+
+    std::vector<bool> res(ids.size());
+    std::size_t mask = 0;
+    std::size_t val = 0;
+    for (unsigned i = 0; i < ids.size(); ++i) {
+        const auto pos = map_[ids[i]];
+        res[i] = ((pick >> pos) & 1UL) == 1UL;
+        mask |= (1UL << pos);
+        val |= (static_cast<std::size_t>(res[i]) << pos);
+    }
+    project(mask, val, 1. / norm_of(mask, val));
+    return res;
+}
+
+DensityMatrixSimulator::calc_type DensityMatrixSimulator::get_expectation_value(TermsDict const& td,
+                                                                                std::vector<unsigned> const& ids)
+{
+    run();
+    if (!check_ids(ids)) {
+        throw(std::runtime_error(
+            "get_expectation_value(): Unknown qubit id. Please make sure you have called eng.flush()."));
+    }
+
+    // Tr(rho P) = sum_r rho[r, r ^ xmask] * i^#Y * (-1)^|r & zmask| for a Pauli string P
+    const auto rows = row_positions();
+    const std::size_t num_states = 1UL << N_;
+    calc_type expectation = 0.;
+    for (auto const& term: td) {
+        std::size_t xmask = 0;
+        std::size_t zmask = 0;
+        unsigned num_y = 0;
+        for (auto const& local_op: term.first) {
+            const auto bit = 1UL << map_[ids[local_op.first]];
+            if (local_op.second == 'X' || local_op.second == 'Y') {
+                xmask |= bit;
+            }
+            if (local_op.second == 'Y' || local_op.second == 'Z') {
+                zmask |= bit;
+            }
+            num_y += static_cast<unsigned>(local_op.second == 'Y');
+        }
+
+        calc_type sum_re = 0.;
+        calc_type sum_im = 0.;
+#pragma omp parallel for reduction(+ : sum_re, sum_im) schedule(static)
+        for (std::size_t r = 0; r < num_states; ++r) {
+            const auto value = vec_[deposit(r, rows) | (deposit(r ^ xmask, rows) << 1U)];
+            const auto sign = parity(r & zmask) ? -1. : 1.;
+            sum_re += sign * std::real(value);
+            sum_im += sign * std::imag(value);
+        }
+        complex_type sum(sum_re, sum_im);
+        for (unsigned k = 0; k < num_y % 4; ++k) {
+            sum *= complex_type(0., 1.);
+        }
+        expectation += std::real(sum) * term.second;
+    }
+    return expectation;
+}
+
+DensityMatrixSimulator::calc_type DensityMatrixSimulator::get_probability(std::vector<bool> const& bit_string,
+                                                                          std::vector<unsigned> const& ids)
+{
+    run();
+    if (!check_ids(ids)) {
+        throw(std::runtime_error("get_probability(): Unknown qubit id. Please make sure you have called eng.flush()."));
+    }
+    std::size_t mask = 0;
+    std::size_t bit_str = 0;
+    for (unsigned i = 0; i < ids.size(); ++i) {
+        mask |= 1UL << map_[ids[i]];
+        bit_str |= (bit_string[i] ? 1UL : 0UL) << map_[ids[i]];
+    }
+    return norm_of(mask, bit_str);
+}
+
+std::vector<DensityMatrixSimulator::calc_type> DensityMatrixSimulator::get_probabilities(
+    std::vector<unsigned> const& ids)
+{
+    run();
+    if (!check_ids(ids)) {
+        throw(std::runtime_error(
+            "get_probabilities(): Unknown qubit id. Please make sure you have called eng.flush()."));
+    }
+    std::vector<std::size_t> positions;
+    positions.reserve(ids.size());
+    for (auto id: ids) {
+        positions.push_back(map_[id]);
+    }
+    const auto rows = row_positions();
+    const std::size_t num_states = 1UL << N_;
+    const std::size_t num_outcomes = 1UL << ids.size();
+    std::vector<calc_type> probabilities(num_outcomes, 0.);
+#pragma omp parallel
+    {
+        std::vector<calc_type> local(num_outcomes, 0.);
+#pragma omp for schedule(static) nowait
+        for (std::size_t x = 0; x < num_states; ++x) {
+            std::size_t outcome = 0;
+            for (std::size_t j = 0; j < positions.size(); ++j) {
+                outcome |= ((x >> positions[j]) & 1UL) << j;
+            }
+            const auto d = deposit(x, rows);
+            local[outcome] += std::real(vec_[d | (d << 1U)]);
+        }
+#pragma omp critical
+        for (std::size_t k = 0; k < num_outcomes; ++k) {
+            probabilities[k] += local[k];
+        }
+    }
+    return probabilities;
+}
+
+void DensityMatrixSimulator::collapse_wavefunction(std::vector<unsigned> const& ids, std::vector<bool> const& values)
+{
+    run();
+    if (ids.size() != values.size()) {
+        throw(std::length_error("collapse_wavefunction(): ids and values size mismatch"));
+    }
+    if (!check_ids(ids)) {
+        throw(std::runtime_error("collapse_wavefunction(): Unknown qubit id(s) provided. Try calling eng.flush() "
+                                 "before invoking this function."));
+    }
+    std::size_t mask = 0;
+    std::size_t val = 0;
+    for (unsigned i = 0; i < ids.size(); ++i) {
+        mask |= (1UL << map_[ids[i]]);
+        val |= ((values[i] ? 1UL : 0UL) << map_[ids[i]]);
+    }
+    const auto N = norm_of(mask, val);
+    if (N < default_tol_) {
+        throw(std::runtime_error("collapse_wavefunction(): Invalid collapse! Probability is ~0."));
+    }
+    project(mask, val, 1. / N);
+}
+
+DensityMatrixSimulator::Matrix DensityMatrixSimulator::get_reduced_density_matrix(std::vector<unsigned> const& ids)
+{
+    run();
+    if (!check_ids(ids)) {
+        throw(std::runtime_error(
+            "get_reduced_density_matrix(): Unknown qubit id. Please make sure you have called eng.flush()."));
+    }
+
+    std::vector<unsigned> kept_rows;
+    std::vector<unsigned> kept_cols;
+    std::vector<bool> is_kept(N_, false);
+    for (auto id: ids) {
+        const auto pos = map_[id];
+        if (is_kept[pos]) {
+            throw(std::invalid_argument("get_reduced_density_matrix(): Duplicate qubit id."));
+        }
+        is_kept[pos] = true;
+        kept_rows.push_back(2 * pos);
+        kept_cols.push_back(2 * pos + 1);
+    }
+    std::vector<unsigned> traced_rows;
+    for (unsigned pos = 0; pos < N_; ++pos) {
+        if (!is_kept[pos]) {
+            traced_rows.push_back(2 * pos);
+        }
+    }
+
+    const std::size_t dim = 1UL << ids.size();
+    const std::size_t num_traced = 1UL << traced_rows.size();
+    Matrix result(dim * dim);
+#pragma omp parallel for schedule(static)
+    for (std::size_t k = 0; k < result.size(); ++k) {
+        const auto base = deposit(k / dim, kept_rows) | deposit(k % dim, kept_cols);
+        complex_type sum = 0.;
+        for (std::size_t t = 0; t < num_traced; ++t) {
+            const auto d = deposit(t, traced_rows);
+            sum += vec_[base | d | (d << 1U)];
+        }
+        result[k] = sum;
+    }
+    return result;
+}
+
+DensityMatrixSimulator::calc_type DensityMatrixSimulator::get_purity()
+{
+    run();
+    calc_type purity = 0.;
+#pragma omp parallel for reduction(+ : purity) schedule(static)
+    for (std::size_t i = 0; i < vec_.size(); ++i) {
+        purity += std::norm(vec_[i]);
+    }
+    return purity;
+}
+
+std::tuple<DensityMatrixSimulator::Map, DensityMatrixSimulator::Matrix> DensityMatrixSimulator::cheat()
+{
+    std::vector<unsigned> ids(N_);
+    for (auto const& p: map_) {
+        ids[p.second] = p.first;
+    }
+    return make_tuple(map_, get_reduced_density_matrix(ids));
+}
+
+void DensityMatrixSimulator::run()
+{
+    if (fused_gates_.size() < 1UL) {
+        return;
+    }
+
+    fusion::Fusion::Matrix m;
+    fusion::Fusion::IndexVector ids;
+    fusion::Fusion::IndexVector ctrls;
+
+    fused_gates_.perform_fusion(m, ids, ctrls);
+
+    if (ids.size() > max_qubit_num_) {
+        throw std::invalid_argument("Gates with more than 5 qubits are not supported!");
+    }
+
+    fusion::Fusion::IndexVector row_ids(max_qubit_num_, 0);
+    fusion::Fusion::IndexVector col_ids(max_qubit_num_, 0);
+    for (std::size_t i = 0; i < ids.size(); ++i) {
+        row_ids[i] = 2 * map_[ids[i]];
+        col_ids[i] = 2 * map_[ids[i]] + 1;
+    }
+    const unsigned nids = ids.size();
+
+    std::size_t row_ctrlmask = 0;
+    for (auto c: ctrls) {
+        row_ctrlmask |= (1UL << (2 * map_[c]));
+    }
+
+    // rho -> U rho U^dagger, i.e. U on the row index and conj(U) on the column index
+    backend_kernel_(vec_, m, row_ctrlmask, row_ids, nids);
+    for (auto& v: m) {
+        v = std::conj(v);
+    }
+    backend_kernel_(vec_, m, row_ctrlmask << 1U, col_ids, nids);
+
+    fused_gates_ = fusion::Fusion();
+}
+
+// =============================================================================
+
+DensityMatrixSimulator::calc_type DensityMatrixSimulator::norm_of(std::size_t mask, std::size_t value)
+{
+    const auto rows = row_positions();
+    const std::size_t num_states = 1UL << N_;
+    calc_type probability = 0.;
+#pragma omp parallel for reduction(+ : probability) schedule(static)
+    for (std::size_t x = 0; x < num_states; ++x) {
+        if ((x & mask) == value) {
+            const auto d = deposit(x, rows);
+            probability += std::real(vec_[d | (d << 1U)]);
+        }
+    }
+    return probability;
+}
+
+void DensityMatrixSimulator::project(std::size_t mask, std::size_t value, calc_type scale)
+{
+    const auto rows = row_positions();
+    const auto row_mask = deposit(mask, rows);
+    const auto row_value = deposit(value, rows);
+    const auto full_mask = row_mask | (row_mask << 1U);
+    const auto full_value = row_value | (row_value << 1U);
+#pragma omp parallel for schedule(static)
+    for (std::size_t i = 0; i < vec_.size(); ++i) {
+        if ((i & full_mask) != full_value) {
+            vec_[i] = 0.;
+        }
+        else {
+            vec_[i] *= scale;
+        }
+    }
+}
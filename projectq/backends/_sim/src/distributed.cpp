@@ -0,0 +1,859 @@
+//   Copyright 2021 <Huawei Technologies Co., Ltd>
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#include "distributed.hpp"
+
+#include "simbackends.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bitset>
+#include <climits>
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+
+#ifndef _WIN32
+#    include <spawn.h>
+#    include <sys/wait.h>
+#    include <unistd.h>
+
+#    include <csignal>
+#    ifdef __APPLE__
+#        include <crt_externs.h>
+#        define environ (*_NSGetEnviron())
+#    else
+extern char** environ;  // NOLINT(readability-redundant-declaration)
+#    endif  // __APPLE__
+#endif      // !_WIN32
+
+namespace
+{
+    inline bool parity(std::size_t x)
+    {
+        return (std::bitset<sizeof(std::size_t) * CHAR_BIT>(x).count() & 1U) == 1U;
+    }
+
+    // Index of the k-th amplitude with bit `pos` equal to `value`
+    inline std::size_t insert_bit(std::size_t k, unsigned pos, std::size_t value)
+    {
+        return ((k >> pos) << (pos + 1)) | (value << pos) | (k & ((1UL << pos) - 1));
+    }
+}  // namespace
+
+DistributedSimulator::DistributedSimulator(unsigned seed, unsigned num_processes, std::string const& transport,
+                                           std::vector<std::string> const& worker_command)
+    : rank_(0)
+    , max_global_(0)
+    , L_(0)
+    , G_(0)
+    , vec_(1, 1.)  // all-zero initial state
+    , backend_kernel_(nullptr)
+    , fusion_qubits_min_(4)
+    , fusion_qubits_max_(max_qubit_num_)
+    , rnd_eng_(seed)
+{
+#ifdef _WIN32
+    throw std::runtime_error("DistributedSimulator: not supported on this platform");
+#else
+    if (num_processes < 2 || (num_processes & (num_processes - 1)) != 0) {
+        throw std::invalid_argument("DistributedSimulator: the number of processes must be a power of 2 (>= 2)!");
+    }
+    if (worker_command.empty()) {
+        throw std::invalid_argument("DistributedSimulator: the worker command must not be empty!");
+    }
+    while ((1U << max_global_) < num_processes) {
+        ++max_global_;
+    }
+
+    std::uniform_real_distribution<double> dist(0., 1.);
+    rng_ = [this, dist]() mutable { return dist(rnd_eng_); };
+
+    load_kernels();
+    const auto backend = resolve_backend(backends::SimBackendGetEnv());
+
+    transport_ = distributed::create_transport(distributed::TransportTypeFromString(transport), num_processes);
+
+    pids_.push_back(getpid());
+    for (unsigned rank = 1; rank < num_processes; ++rank) {
+        std::vector<std::string> args(worker_command);
+        args.push_back(transport_->endpoint());
+        args.push_back(std::to_string(rank));
+        std::vector<char*> argv;
+        for (auto& arg: args) {
+            argv.push_back(&arg[0]);
+        }
+        argv.push_back(nullptr);
+
+        pid_t pid = 0;
+        if (posix_spawn(&pid, argv[0], nullptr, nullptr, argv.data(), environ) != 0) {
+            kill_workers();
+            throw std::runtime_error("DistributedSimulator: unable to start worker process " + args[0]);
+        }
+        pids_.push_back(pid);
+    }
+    transport_->set_pids(pids_);
+
+    try {
+        transport_->connect();
+    }
+    catch (std::exception&) {
+        kill_workers();
+        throw;
+    }
+    submit({Op::SelectBackend, {static_cast<std::uint64_t>(backend)}, {}});
+#endif  // _WIN32
+}
+
+DistributedSimulator::DistributedSimulator(std::string const& endpoint, unsigned rank)
+    : transport_(distributed::join_transport(endpoint, rank))
+    , rank_(rank)
+    , max_global_(0)
+    , L_(0)
+    , G_(0)
+    , backend_kernel_(nullptr)
+    , fusion_qubits_min_(4)
+    , fusion_qubits_max_(max_qubit_num_)
+{
+    load_kernels();
+    transport_->connect();
+}
+
+DistributedSimulator::~DistributedSimulator()
+{
+#ifndef _WIN32
+    if (rank_ != 0 || !transport_) {
+        return;
+    }
+    try {
+        const Command shutdown{Op::Shutdown, {}, {}};
+        for (unsigned rank = 1; rank < transport_->size(); ++rank) {
+            send_command(rank, shutdown);
+        }
+    }
+    catch (std::exception&) {  // NOLINT(bugprone-empty-catch)
+        // Workers that already died are collected below
+    }
+    for (std::size_t i = 1; i < pids_.size(); ++i) {
+        waitpid(pids_[i], nullptr, 0);
+    }
+#endif  // !_WIN32
+}
+
+void DistributedSimulator::serve()
+{
+    while (true) {
+        const auto cmd = recv_command();
+        if (cmd.op == Op::Shutdown) {
+            return;
+        }
+        execute(cmd);
+    }
+}
+
+void DistributedSimulator::load_kernels()
+{
+    for (auto backend: {backends::SimBackend::ScalarSerial, backends::SimBackend::ScalarThreaded,
+                        backends::SimBackend::VectorSerial, backends::SimBackend::VectorThreaded}) {
+        if (backends::SimBackendIsAvailable(backend)) {
+            kernels_[backend] = backends::SimBackendLoadKernel(backend);
+        }
+    }
+}
+
+void DistributedSimulator::kill_workers()
+{
+#ifndef _WIN32
+    for (std::size_t i = 1; i < pids_.size(); ++i) {
+        kill(pids_[i], SIGKILL);
+        waitpid(pids_[i], nullptr, 0);
+    }
+    pids_.clear();
+#endif  // !_WIN32
+}
+
+backends::SimBackend DistributedSimulator::resolve_backend(backends::SimBackend backend) const
+{
+    if (backend == backends::SimBackend::Auto) {
+        backend = backends::SimBackendIsAvailable(backends::SimBackend::VectorThreaded)
+                      ? backends::SimBackend::VectorThreaded
+                      : backends::SimBackend::ScalarThreaded;
+    }
+    if (kernels_.count(backend) == 0) {
+        throw std::invalid_argument("Only the CPU backends are available for distributed simulations");
+    }
+    return backend;
+}
+
+void DistributedSimulator::select_backend(backends::SimBackend backend)
+{
+    submit({Op::SelectBackend, {static_cast<std::uint64_t>(resolve_backend(backend))}, {}});
+}
+
+// =============================================================================
+
+void DistributedSimulator::allocate_qubit(unsigned id)
+{
+    if (map_.count(id) != 0U) {
+        throw(std::runtime_error("AllocateQubit: ID already exists. Qubit IDs should be unique."));
+    }
+
+    if (G_ < max_global_ && L_ >= max_qubit_num_) {
+        // New global qubit: the new partitions are all zeros, no communication required.
+        map_[id] = L_ + G_;
+        submit({Op::AllocateGlobal, {}, {}});
+    }
+    else {
+        // New local qubit at the highest local position: each partition doubles in size.
+        for (auto& p: map_) {
+            if (p.second >= L_) {
+                p.second++;
+            }
+        }
+        map_[id] = L_;
+        submit({Op::AllocateLocal, {}, {}});
+    }
+}
+
+void DistributedSimulator::deallocate_qubit(unsigned id)
+{
+    run();
+    if (map_.count(id) != 1UL) {
+        throw(std::runtime_error("DeallocateQubit: Qubit IDs is not known!"));
+    }
+
+    auto pos = map_[id];
+    const auto flags = submit({Op::CheckClassical, {pos}, {}}).values;
+    bool has_zero = false;
+    bool has_one = false;
+    for (std::size_t i = 0; i < flags.size(); i += 2) {
+        has_zero = has_zero || flags[i] > 0.;
+        has_one = has_one || flags[i + 1] > 0.;
+    }
+    if (has_zero == has_one) {
+        throw(std::runtime_error(
+            "Error: Qubit has not been measured / uncomputed! There is most likely a bug in your code."));
+    }
+
+    if (pos >= L_) {
+        swap_qubits(pos, L_ - 1);
+        pos = L_ - 1;
+    }
+    submit({Op::RemoveLocal, {pos, static_cast<std::uint64_t>(has_one)}, {}});
+    for (auto& p: map_) {
+        if (p.second > pos) {
+            p.second--;
+        }
+    }
+    map_.erase(id);
+
+    if (L_ < max_qubit_num_ && G_ > 0) {
+        // Keep enough local qubits for the largest gates
+        const auto top = L_ + G_ - 1;
+        for (auto& p: map_) {
+            if (p.second == top) {
+                p.second = L_;
+            }
+            else if (p.second >= L_) {
+                p.second++;
+            }
+        }
+        submit({Op::MergeGlobal, {}, {}});
+    }
+}
+
+std::vector<bool> DistributedSimulator::measure_qubits(std::vector<unsigned> const& ids)
+{
+    run();
+
+    std::vector<unsigned> positions(ids.size());
+    for (unsigned i = 0; i < ids.size(); ++i) {
+        positions[i] = map_[ids[i]];
+    }
+
+    const auto norms = submit({Op::Norms, {}, {}}).values;
+
+    calc_type P = 0.;
+    calc_type rnd = rng_();
+
+    // pick partition at random with probability |partition|^2, then the entry within it
+    std::size_t rank = 0;
+    for (std::size_t r = 0; r < norms.size(); ++r) {
+        if (norms[r] > 0.) {
+            rank = r;
+            if (P + norms[r] >= rnd) {
+                break;
+            }
+            P += norms[r];
+        }
+    }
+    if (P + norms[rank] < rnd) {
+        P -= norms[rank];
+    }
+
+    auto pick = submit({Op::Pick, {rank}, {complex_type(P, rnd)}}).ints[0];
+    pick |= rank << L_;
+
+    std::vector<bool> res(ids.size());
+    std::size_t mask = 0;
+    std::size_t val = 0;
+    for (unsigned i = 0; i < ids.size(); ++i) {
+        bool r = ((pick >> positions[i]) & 1) == 1;  // NOLINT
+        res[i] = r;
+        mask |= (1UL << positions[i]);
+        val |= (static_cast<std::size_t>(static_cast<unsigned int>(r) & 1U) << positions[i]);
+    }
+
+    project(mask, val, 1. / std::sqrt(norm_of(mask, val)));
+    return res;
+}
+
+DistributedSimulator::calc_type DistributedSimulator::get_expectation_value(TermsDict const& td,
+                                                                            std::vector<unsigned> const& ids)
+{
+    run();
+
+    const std::array<complex_type, 4> powers_of_i = {1., complex_type(0., 1.), -1., complex_type(0., -1.)};
+    Command cmd{Op::Expectation, {static_cast<std::uint64_t>(td.size())}, {}};
+    for (auto const& term: td) {
+        std::size_t xmask = 0;
+        std::size_t zmask = 0;
+        unsigned ny = 0;
+        for (auto const& local_op: term.first) {
+            const auto bit = 1UL << map_[ids[local_op.first]];
+            if (local_op.second == 'X' || local_op.second == 'Y') {
+                xmask |= bit;
+            }
+            if (local_op.second == 'Z' || local_op.second == 'Y') {
+                zmask |= bit;
+            }
+            ny += static_cast<unsigned>(local_op.second == 'Y');
+        }
+        cmd.ints.push_back(xmask);
+        cmd.ints.push_back(zmask);
+        cmd.data.push_back(term.second * powers_of_i[ny % 4]);
+    }
+
+    const auto partial = submit(cmd).values;
+    calc_type expectation = 0.;
+    for (auto value: partial) {
+        expectation += value;
+    }
+    return expectation;
+}
+
+DistributedSimulator::calc_type DistributedSimulator::get_probability(std::vector<bool> const& bit_string,
+                                                                      std::vector<unsigned> const& ids)
+{
+    run();
+    if (!check_ids(ids)) {
+        throw(std::runtime_error("get_probability(): Unknown qubit id. Please make sure you have called eng.flush()."));
+    }
+    std::size_t mask = 0;
+    std::size_t bit_str = 0;
+    for (unsigned i = 0; i < ids.size(); ++i) {
+        mask |= 1UL << map_[ids[i]];
+        bit_str |= (bit_string[i] ? 1UL : 0UL) << map_[ids[i]];
+    }
+    return norm_of(mask, bit_str);
+}
+
+DistributedSimulator::complex_type DistributedSimulator::get_amplitude(std::vector<bool> const& bit_string,
+                                                                       std::vector<unsigned> const& ids)
+{
+    run();
+    std::size_t chk = 0;
+    std::size_t index = 0;
+    for (unsigned i = 0; i < ids.size(); ++i) {
+        if (map_.count(ids[i]) == 0UL) {
+            break;
+        }
+        chk |= 1UL << map_[ids[i]];
+        index |= (bit_string[i] ? 1UL : 0UL) << map_[ids[i]];
+    }
+    if (chk + 1UL != (1UL << (L_ + G_))) {
+        throw(
+            std::runtime_error("The second argument to get_amplitude() must be a permutation of all allocated "
+                               "qubits. Please make sure you have called eng.flush()."));
+    }
+    return submit({Op::Amplitude, {index >> L_, index & ((1UL << L_) - 1)}, {}}).amplitude;
+}
+
+void DistributedSimulator::collapse_wavefunction(std::vector<unsigned> const& ids, std::vector<bool> const& values)
+{
+    run();
+    if (ids.size() != values.size()) {
+        throw(std::length_error("collapse_wavefunction(): ids and values size mismatch"));
+    }
+    if (!check_ids(ids)) {
+        throw(
+            std::runtime_error("collapse_wavefunction(): Unknown qubit id(s) provided. Try calling eng.flush() "
+                               "before invoking this function."));
+    }
+    std::size_t mask = 0;
+    std::size_t val = 0;
+    for (unsigned i = 0; i < ids.size(); ++i) {
+        mask |= (1UL << map_[ids[i]]);
+        val |= ((values[i] ? 1UL : 0UL) << map_[ids[i]]);
+    }
+    const auto N = norm_of(mask, val);
+    if (N < default_tol_) {
+        throw(std::runtime_error("collapse_wavefunction(): Invalid collapse! Probability is ~0."));
+    }
+    project(mask, val, 1. / std::sqrt(N));
+}
+
+void DistributedSimulator::run()
+{
+    if (fused_gates_.size() < 1UL) {
+        return;
+    }
+
+    fusion::Fusion::Matrix m;
+    fusion::Fusion::IndexVector ids;
+    fusion::Fusion::IndexVector ctrls;
+
+    fused_gates_.perform_fusion(m, ids, ctrls);
+    fused_gates_ = fusion::Fusion();
+
+    if (ids.size() > max_qubit_num_) {
+        throw std::invalid_argument("Gates with more than 5 qubits are not supported!");
+    }
+
+    const auto dim = 1UL << ids.size();
+    const bool has_global = std::any_of(begin(ids), end(ids), [this](unsigned id) { return map_[id] >= L_; });
+    bool is_diagonal = has_global;
+    for (std::size_t i = 0; is_diagonal && i < dim; ++i) {
+        for (std::size_t j = 0; is_diagonal && j < dim; ++j) {
+            is_diagonal = (i == j || m[i * dim + j] == complex_type(0.));
+        }
+    }
+
+    if (!is_diagonal) {
+        // Swap global target qubits with local ones that are not targeted by this gate
+        for (auto id: ids) {
+            if (map_[id] >= L_) {
+                auto victim = L_;
+                while (victim-- > 0) {
+                    if (std::none_of(begin(ids), end(ids), [&](unsigned other) { return map_[other] == victim; })) {
+                        break;
+                    }
+                }
+                swap_qubits(map_[id], victim);
+            }
+        }
+    }
+
+    Command cmd{is_diagonal ? Op::DiagonalGate : Op::Gate, {static_cast<std::uint64_t>(ids.size())}, {}};
+    for (auto id: ids) {
+        cmd.ints.push_back(map_[id]);
+    }
+    std::size_t ctrlmask = 0;
+    std::size_t gctrlmask = 0;
+    split_mask(get_control_mask(ctrls), ctrlmask, gctrlmask);
+    cmd.ints.push_back(ctrlmask);
+    cmd.ints.push_back(gctrlmask);
+    if (is_diagonal) {
+        for (std::size_t i = 0; i < dim; ++i) {
+            cmd.data.push_back(m[i * dim + i]);
+        }
+    }
+    else {
+        cmd.data.assign(begin(m), end(m));
+    }
+    submit(cmd);
+}
+
+// =============================================================================
+
+DistributedSimulator::Result DistributedSimulator::submit(Command const& cmd)
+{
+    for (unsigned rank = 1; rank < transport_->size(); ++rank) {
+        send_command(rank, cmd);
+    }
+    return execute(cmd);
+}
+
+void DistributedSimulator::send_command(unsigned dest, Command const& cmd)
+{
+    const std::array<std::uint64_t, 3> header = {static_cast<std::uint64_t>(cmd.op), cmd.ints.size(), cmd.data.size()};
+    transport_->send(dest, header.data(), sizeof(header));
+    if (!cmd.ints.empty()) {
+        transport_->send(dest, cmd.ints.data(), cmd.ints.size() * sizeof(std::uint64_t));
+    }
+    if (!cmd.data.empty()) {
+        transport_->send(dest, cmd.data.data(), cmd.data.size() * sizeof(complex_type));
+    }
+}
+
+DistributedSimulator::Command DistributedSimulator::recv_command()
+{
+    std::array<std::uint64_t, 3> header{};
+    transport_->recv(0, header.data(), sizeof(header));
+    Command cmd{static_cast<Op>(header[0]), std::vector<std::uint64_t>(header[1]),
+                std::vector<complex_type>(header[2])};
+    if (!cmd.ints.empty()) {
+        transport_->recv(0, cmd.ints.data(), cmd.ints.size() * sizeof(std::uint64_t));
+    }
+    if (!cmd.data.empty()) {
+        transport_->recv(0, cmd.data.data(), cmd.data.size() * sizeof(complex_type));
+    }
+    return cmd;
+}
+
+std::vector<DistributedSimulator::calc_type> DistributedSimulator::gather(std::vector<calc_type> const& local)
+{
+    const auto bytes = local.size() * sizeof(calc_type);
+    if (rank_ != 0) {
+        if (is_active()) {
+            transport_->send(0, local.data(), bytes);
+        }
+        return {};
+    }
+    std::vector<calc_type> all(local);
+    all.resize(local.size() * num_active());
+    for (unsigned rank = 1; rank < num_active(); ++rank) {
+        transport_->recv(rank, &all[rank * local.size()], bytes);
+    }
+    return all;
+}
+
+DistributedSimulator::Result DistributedSimulator::execute(Command const& cmd)
+{
+    Result result{{}, {}, 0.};
+    auto const& ints = cmd.ints;
+    const auto size = vec_.size();
+
+    switch (cmd.op) {
+        case Op::Shutdown:
+            break;
+
+        case Op::SelectBackend:
+            backend_kernel_ = kernels_.at(static_cast<backends::SimBackend>(ints[0]));
+            break;
+
+        case Op::AllocateLocal:
+            if (is_active()) {
+                vec_.resize(2 * size, 0.);
+            }
+            ++L_;
+            break;
+
+        case Op::AllocateGlobal:
+            ++G_;
+            if (is_active() && vec_.empty()) {
+                vec_.assign(1UL << L_, 0.);
+            }
+            break;
+
+        case Op::CheckClassical: {
+            const auto pos = static_cast<unsigned>(ints[0]);
+            bool has_zero = false;
+            bool has_one = false;
+            if (is_active()) {
+                if (pos >= L_) {
+                    const auto any = std::any_of(begin(vec_), end(vec_),
+                                                 [](complex_type const& a) { return std::norm(a) > default_tol_; });
+                    (((rank_ >> (pos - L_)) & 1U) == 1U ? has_one : has_zero) = any;
+                }
+                else {
+                    const auto bit = 1UL << pos;
+                    for (std::size_t i = 0; i < size; ++i) {
+                        if (std::norm(vec_[i]) > default_tol_) {
+                            has_one = has_one || ((i & bit) != 0);
+                            has_zero = has_zero || ((i & bit) == 0);
+                        }
+                    }
+                }
+            }
+            result.values = gather({static_cast<calc_type>(has_zero), static_cast<calc_type>(has_one)});
+        } break;
+
+        case Op::RemoveLocal: {
+            const auto pos = static_cast<unsigned>(ints[0]);
+            if (is_active()) {
+                const auto half = size / 2;
+                for (std::size_t i = 0; i < half; ++i) {
+                    vec_[i] = vec_[insert_bit(i, pos, ints[1])];
+                }
+                vec_.resize(half);
+            }
+            --L_;
+        } break;
+
+        case Op::MergeGlobal: {
+            const auto top = 1U << (G_ - 1);
+            if (is_active()) {
+                if ((rank_ & top) != 0) {
+                    transport_->send(rank_ ^ top, vec_.data(), size * sizeof(complex_type));
+                    StateVector().swap(vec_);
+                }
+                else {
+                    vec_.resize(2 * size);
+                    transport_->recv(rank_ | top, &vec_[size], size * sizeof(complex_type));
+                }
+            }
+            ++L_;
+            --G_;
+        } break;
+
+        case Op::Swap:
+            if (is_active()) {
+                const auto gbit = 1U << ints[0];
+                exchange_half(rank_ ^ gbit, static_cast<unsigned>(ints[1]), (rank_ & gbit) != 0);
+            }
+            break;
+
+        case Op::Gate:
+        case Op::DiagonalGate: {
+            const auto nids = static_cast<unsigned>(ints[0]);
+            const auto ctrlmask = ints[nids + 1];
+            const auto gctrlmask = ints[nids + 2];
+            if (!is_active() || (rank_ & gctrlmask) != gctrlmask) {
+                break;
+            }
+            if (cmd.op == Op::Gate) {
+                fusion::Fusion::IndexVector ids(begin(ints) + 1, begin(ints) + 1 + nids);
+                ids.resize(max_qubit_num_);  // Pad with zeros.
+                const types::M m(begin(cmd.data), end(cmd.data));
+                backend_kernel_(vec_, m, ctrlmask, ids, nids);
+                break;
+            }
+
+            // Diagonal gate: the global targets select a subset of the diagonal entries
+            std::size_t base = 0;
+            std::vector<std::pair<unsigned, unsigned>> local_targets;  // (position, bit of diagonal index)
+            for (unsigned j = 0; j < nids; ++j) {
+                const auto pos = static_cast<unsigned>(ints[j + 1]);
+                if (pos >= L_) {
+                    base |= static_cast<std::size_t>((rank_ >> (pos - L_)) & 1U) << j;
+                }
+                else {
+                    local_targets.emplace_back(pos, j);
+                }
+            }
+            auto const& diag = cmd.data;
+#pragma omp parallel for schedule(static)
+            for (std::size_t i = 0; i < size; ++i) {
+                if ((i & ctrlmask) == ctrlmask) {
+                    auto index = base;
+                    for (auto const& target: local_targets) {
+                        index |= ((i >> target.first) & 1UL) << target.second;
+                    }
+                    vec_[i] *= diag[index];
+                }
+            }
+        } break;
+
+        case Op::Norms: {
+            calc_type nrm = 0.;
+            if (is_active()) {
+#pragma omp parallel for reduction(+ : nrm) schedule(static)
+                for (std::size_t i = 0; i < size; ++i) {
+                    nrm += std::norm(vec_[i]);
+                }
+            }
+            result.values = gather({nrm});
+        } break;
+
+        case Op::Pick: {
+            const auto rank = static_cast<unsigned>(ints[0]);
+            std::uint64_t pick = 0;
+            if (rank_ == rank) {
+                auto P = std::real(cmd.data[0]);
+                const auto rnd = std::imag(cmd.data[0]);
+                while (P < rnd && pick < size) {
+                    P += std::norm(vec_[pick++]);
+                }
+                if (pick > 0) {
+                    pick--;
+                }
+                if (rank_ != 0) {
+                    transport_->send(0, &pick, sizeof(pick));
+                }
+            }
+            else if (rank_ == 0) {
+                transport_->recv(rank, &pick, sizeof(pick));
+            }
+            result.ints.push_back(pick);
+        } break;
+
+        case Op::NormOf: {
+            std::size_t lmask = 0;
+            std::size_t gmask = 0;
+            std::size_t lval = 0;
+            std::size_t gval = 0;
+            split_mask(ints[0], lmask, gmask);
+            split_mask(ints[1], lval, gval);
+            calc_type nrm = 0.;
+            if (is_active() && (rank_ & gmask) == gval) {
+#pragma omp parallel for reduction(+ : nrm) schedule(static)
+                for (std::size_t i = 0; i < size; ++i) {
+                    if ((i & lmask) == lval) {
+                        nrm += std::norm(vec_[i]);
+                    }
+                }
+            }
+            result.values = gather({nrm});
+        } break;
+
+        case Op::Project: {
+            std::size_t lmask = 0;
+            std::size_t gmask = 0;
+            std::size_t lval = 0;
+            std::size_t gval = 0;
+            split_mask(ints[0], lmask, gmask);
+            split_mask(ints[1], lval, gval);
+            const auto scale = std::real(cmd.data[0]);
+            if (!is_active()) {
+                break;
+            }
+            if ((rank_ & gmask) != gval) {
+                std::fill(begin(vec_), end(vec_), complex_type(0.));
+                break;
+            }
+#pragma omp parallel for schedule(static)
+            for (std::size_t i = 0; i < size; ++i) {
+                if ((i & lmask) != lval) {
+                    vec_[i] = 0.;
+                }
+                else {
+                    vec_[i] *= scale;
+                }
+            }
+        } break;
+
+        case Op::Expectation: {
+            calc_type expectation = 0.;
+            if (is_active()) {
+                for (std::size_t t = 0; t < ints[0]; ++t) {
+                    expectation += std::real(cmd.data[t] * pauli_term(ints[2 * t + 1], ints[2 * t + 2]));
+                }
+            }
+            result.values = gather({expectation});
+        } break;
+
+        case Op::Amplitude: {
+            const auto rank = static_cast<unsigned>(ints[0]);
+            if (rank_ == rank) {
+                result.amplitude = vec_[ints[1]];
+                if (rank_ != 0) {
+                    transport_->send(0, &result.amplitude, sizeof(complex_type));
+                }
+            }
+            else if (rank_ == 0) {
+                transport_->recv(rank, &result.amplitude, sizeof(complex_type));
+            }
+        } break;
+
+        default:
+            throw std::runtime_error("DistributedSimulator: unknown command");
+    }
+    return result;
+}
+
+void DistributedSimulator::exchange_half(unsigned partner, unsigned local_pos, bool upper)
+{
+    // The lower partition sends its amplitudes with the local bit set, the upper one those without it
+    const std::size_t value = upper ? 0UL : 1UL;
+    const auto half = vec_.size() / 2;
+    const auto block = std::min(block_size_, half);
+    buffer_.resize(2 * block);
+    for (std::size_t start = 0; start < half; start += block) {
+#pragma omp parallel for schedule(static)
+        for (std::size_t k = 0; k < block; ++k) {
+            buffer_[k] = vec_[insert_bit(start + k, local_pos, value)];
+        }
+        transport_->sendrecv(partner, &buffer_[0], &buffer_[block], block * sizeof(complex_type));
+#pragma omp parallel for schedule(static)
+        for (std::size_t k = 0; k < block; ++k) {
+            vec_[insert_bit(start + k, local_pos, value)] = buffer_[block + k];
+        }
+    }
+}
+
+DistributedSimulator::complex_type DistributedSimulator::pauli_term(std::size_t xmask, std::size_t zmask)
+{
+    // <psi|P|psi> = sum_i conj(psi[i ^ x]) * (-1)^|i & z| * psi[i] (up to the factor i^ny)
+    std::size_t xlocal = 0;
+    std::size_t xglobal = 0;
+    std::size_t zlocal = 0;
+    std::size_t zglobal = 0;
+    split_mask(xmask, xlocal, xglobal);
+    split_mask(zmask, zlocal, zglobal);
+
+    const auto size = vec_.size();
+    const auto block = std::min(block_size_, size);
+    calc_type re = 0.;
+    calc_type im = 0.;
+    if (xglobal != 0) {
+        buffer_.resize(block);
+    }
+    for (std::size_t start = 0; start < size; start += block) {
+        // Block of the partner partition containing the amplitudes i ^ xlocal for i in [start, start + block)
+        const auto partner_start = start ^ (xlocal & ~(block - 1));
+        const complex_type* partner = &vec_[partner_start];
+        if (xglobal != 0) {
+            transport_->sendrecv(rank_ ^ static_cast<unsigned>(xglobal), &vec_[partner_start], &buffer_[0],
+                                 block * sizeof(complex_type));
+            partner = &buffer_[0];
+        }
+        const auto xoffset = xlocal & (block - 1);
+#pragma omp parallel for reduction(+ : re, im) schedule(static)
+        for (std::size_t k = 0; k < block; ++k) {
+            auto a = std::conj(partner[k ^ xoffset]) * vec_[start + k];
+            if (parity((start + k) & zlocal)) {
+                a = -a;
+            }
+            re += std::real(a);
+            im += std::imag(a);
+        }
+    }
+    return (parity(rank_ & zglobal) ? -1. : 1.) * complex_type(re, im);
+}
+
+void DistributedSimulator::swap_qubits(unsigned global_pos, unsigned local_pos)
+{
+    submit({Op::Swap, {global_pos - L_, local_pos}, {}});
+
+    for (auto& p: map_) {
+        if (p.second == global_pos) {
+            p.second = local_pos;
+        }
+        else if (p.second == local_pos) {
+            p.second = global_pos;
+        }
+    }
+}
+
+void DistributedSimulator::split_mask(std::size_t mask, std::size_t& local, std::size_t& global) const
+{
+    local = mask & ((1UL << L_) - 1);
+    global = mask >> L_;
+}
+
+DistributedSimulator::calc_type DistributedSimulator::norm_of(std::size_t mask, std::size_t value)
+{
+    const auto partial = submit({Op::NormOf, {mask, value}, {}}).values;
+    calc_type N = 0.;
+    for (auto nrm: partial) {
+        N += nrm;
+    }
+    return N;
+}
+
+void DistributedSimulator::project(std::size_t mask, std::size_t value, calc_type scale)
+{
+    submit({Op::Project, {mask, value}, {scale}});
+}
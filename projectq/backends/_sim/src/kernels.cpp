@@ -23,11 +23,20 @@
 #include "kernel5.hpp"
 #include "types.hpp"
 
-#include <pybind11/pybind11.h>
+#ifndef KERNELS_STANDALONE
+#    include <pybind11/pybind11.h>
+#endif  // !KERNELS_STANDALONE
 
 #include <array>
 #include <functional>
 
+#if defined(ENABLE_MULTITHREADING) && defined(USE_THREAD_POOL)
+#    include "thread_pool.hpp"
+#elif defined(ENABLE_MULTITHREADING) && defined(USE_OPENMP) && defined(_OPENMP)
+#    include <omp.h>
+#    define KERNELS_OPENMP 1
+#endif
+
 template <class V, class M, typename UINT>
 using Kernel = std::function<void(V&, M const&, UINT, const unsigned*)>;
 
@@ -43,7 +52,17 @@ using types::M;
 using types::UINT;
 using types::V;
 
-extern "C" void kernel(V& psi, M const& m, UINT ctrlmask, fusion::Fusion::IndexVector const& ids, unsigned nids)
+// The standalone kernel libraries are loaded at runtime by the standalone simulator library (see simbackends_dl.cpp)
+#if defined(KERNELS_STANDALONE) && defined(_WIN32)
+#    define KERNEL_EXPORT __declspec(dllexport)
+#elif defined(KERNELS_STANDALONE)
+#    define KERNEL_EXPORT __attribute__((visibility("default")))
+#else
+#    define KERNEL_EXPORT
+#endif  // KERNELS_STANDALONE
+
+extern "C" KERNEL_EXPORT void kernel(V& psi, M const& m, UINT ctrlmask, fusion::Fusion::IndexVector const& ids,
+                                     unsigned nids)
 {
     debug::printf("kernel%d\n", static_cast<int>(nids));
 
@@ -51,9 +70,46 @@ extern "C" void kernel(V& psi, M const& m, UINT ctrlmask, fusion::Fusion::IndexV
     kernels<V, M, UINT>[nids - 1][ctrlmask == 0 ? 0 : 1](psi, m, ctrlmask, &ids[0]);
 }
 
+// Set the number of threads used by the kernels (as many as available if num_threads <= 0). Returns that maximal
+// number of threads, or 0 if it cannot be controlled (e.g. parallel STL).
+extern "C" KERNEL_EXPORT int set_num_threads(int num_threads)
+{
+#if defined(ENABLE_MULTITHREADING) && defined(USE_THREAD_POOL)
+    auto& pool = parallel::ThreadPool::instance();
+    pool.set_num_threads(num_threads > 0 ? static_cast<unsigned>(num_threads) : 0U);
+    return static_cast<int>(pool.max_threads());
+#elif defined(KERNELS_OPENMP)
+    static const int max_threads = omp_get_max_threads();
+    omp_set_num_threads(num_threads > 0 && num_threads < max_threads ? num_threads : max_threads);
+    return max_threads;
+#elif defined(ENABLE_MULTITHREADING)
+    static_cast<void>(num_threads);
+    return 0;
+#else
+    static_cast<void>(num_threads);
+    return 1;
+#endif  // KERNELS_OPENMP
+}
+
+#if defined(ENABLE_MULTITHREADING) && defined(USE_THREAD_POOL)
+// Make the kernels use the thread pool of another kernel module (if pool is not null and the kernels have not run yet).
+// Returns the thread pool used by the kernels.
+extern "C" KERNEL_EXPORT void* share_thread_pool(void* pool)
+{
+    return &parallel::ThreadPool::share(static_cast<parallel::ThreadPool*>(pool));
+}
+#endif  // ENABLE_MULTITHREADING && USE_THREAD_POOL
+
+// KERNELS_STANDALONE: linked directly into a C++ program (e.g. the kernel benchmarks) instead of a Python module
+#ifndef KERNELS_STANDALONE
 // NOLINTNEXTLINE
 PYBIND11_MODULE(MODULE_NAME, m)
 {
     m.doc() = "C++ simulator backend specialization for ProjectQ";
-    m.def("kernel", []() { return reinterpret_cast<void*>(&kernel); });  // NOLINT
+    m.def("kernel", []() { return reinterpret_cast<void*>(&kernel); });                    // NOLINT
+    m.def("set_num_threads", []() { return reinterpret_cast<void*>(&set_num_threads); });  // NOLINT
+#    if defined(ENABLE_MULTITHREADING) && defined(USE_THREAD_POOL)
+    m.def("share_thread_pool", []() { return reinterpret_cast<void*>(&share_thread_pool); });  // NOLINT
+#    endif  // ENABLE_MULTITHREADING && USE_THREAD_POOL
 }
+#endif  // !KERNELS_STANDALONE
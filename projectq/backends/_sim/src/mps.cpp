@@ -0,0 +1,732 @@
+//   Copyright 2021 <Huawei Technologies Co., Ltd>
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#include "mps.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+
+#ifdef HAVE_LAPACK
+extern "C" void zgesvd_(const char* jobu, const char* jobvt, const int* m, const int* n, std::complex<double>* a,
+                        const int* lda, double* s, std::complex<double>* u, const int* ldu, std::complex<double>* vt,
+                        const int* ldvt, std::complex<double>* work, const int* lwork, double* rwork, int* info);
+#endif  // HAVE_LAPACK
+
+namespace
+{
+    using mps::calc_type;
+    using mps::complex_type;
+    using mps::Matrix;
+
+    // Singular values below this fraction of the largest one are considered to be zero
+    constexpr auto zero_singular_value = 1.e-14;
+
+#ifndef HAVE_LAPACK
+    // One-sided (Hestenes) Jacobi SVD for rows >= cols: the columns of m are orthogonalized by plane rotations, which
+    // accumulate into V, so that m V = U diag(s).
+    std::tuple<Matrix, std::vector<calc_type>, Matrix> jacobi_svd(Matrix const& m, std::size_t rows, std::size_t cols)
+    {
+        constexpr auto eps = 1.e-15;
+        constexpr auto max_sweeps = 100;
+
+        // Column-major copies for cache-friendly column operations
+        std::vector<Matrix> a(cols, Matrix(rows));
+        std::vector<Matrix> v(cols, Matrix(cols, 0.));
+        for (std::size_t c = 0; c < cols; ++c) {
+            for (std::size_t r = 0; r < rows; ++r) {
+                a[c][r] = m[r * cols + c];
+            }
+            v[c][c] = 1.;
+        }
+
+        auto rotate = [](Matrix& x, Matrix& y, calc_type c, calc_type s, complex_type phase) {
+            for (std::size_t i = 0; i < x.size(); ++i) {
+                const auto xi = x[i];
+                const auto yi = y[i] * phase;
+                x[i] = c * xi - s * yi;
+                y[i] = s * xi + c * yi;
+            }
+        };
+
+        for (auto sweep = 0; sweep < max_sweeps; ++sweep) {
+            bool rotated = false;
+            for (std::size_t p = 0; p + 1 < cols; ++p) {
+                for (std::size_t q = p + 1; q < cols; ++q) {
+                    calc_type alpha = 0.;
+                    calc_type beta = 0.;
+                    complex_type gamma = 0.;
+                    for (std::size_t i = 0; i < rows; ++i) {
+                        alpha += std::norm(a[p][i]);
+                        beta += std::norm(a[q][i]);
+                        gamma += std::conj(a[p][i]) * a[q][i];
+                    }
+                    const auto abs_gamma = std::abs(gamma);
+                    if (abs_gamma <= eps * std::sqrt(alpha * beta) || abs_gamma == 0.) {
+                        continue;
+                    }
+                    rotated = true;
+
+                    // Remove the phase of gamma, then use a real rotation making columns p and q orthogonal
+                    const auto zeta = (beta - alpha) / (2. * abs_gamma);
+                    const auto t = (zeta >= 0. ? 1. : -1.) / (std::abs(zeta) + std::sqrt(1. + zeta * zeta));
+                    const auto c = 1. / std::sqrt(1. + t * t);
+                    const auto phase = std::conj(gamma) / abs_gamma;
+                    rotate(a[p], a[q], c, c * t, phase);
+                    rotate(v[p], v[q], c, c * t, phase);
+                }
+            }
+            if (!rotated) {
+                break;
+            }
+        }
+
+        std::vector<calc_type> norms(cols);
+        for (std::size_t c = 0; c < cols; ++c) {
+            norms[c] = std::sqrt(std::accumulate(begin(a[c]), end(a[c]), calc_type(0.),
+                                                 [](calc_type sum, complex_type x) { return sum + std::norm(x); }));
+        }
+        std::vector<std::size_t> order(cols);
+        std::iota(begin(order), end(order), 0);
+        std::sort(begin(order), end(order), [&norms](std::size_t i, std::size_t j) { return norms[i] > norms[j]; });
+
+        Matrix u(rows * cols, 0.);
+        std::vector<calc_type> s(cols);
+        Matrix vh(cols * cols);
+        for (std::size_t j = 0; j < cols; ++j) {
+            const auto c = order[j];
+            s[j] = norms[c];
+            if (s[j] > 0.) {
+                for (std::size_t r = 0; r < rows; ++r) {
+                    u[r * cols + j] = a[c][r] / s[j];
+                }
+            }
+            for (std::size_t k = 0; k < cols; ++k) {
+                vh[j * cols + k] = std::conj(v[c][k]);
+            }
+        }
+        return std::make_tuple(u, s, vh);
+    }
+#endif  // !HAVE_LAPACK
+
+    // Keep the first k columns of a row-major rows x cols matrix
+    Matrix first_columns(Matrix const& m, std::size_t rows, std::size_t cols, std::size_t k)
+    {
+        Matrix result(rows * k);
+        for (std::size_t r = 0; r < rows; ++r) {
+            std::copy_n(m.begin() + r * cols, k, result.begin() + r * k);
+        }
+        return result;
+    }
+
+    // Number of non-zero singular values
+    std::size_t rank(std::vector<calc_type> const& s)
+    {
+        std::size_t k = 1;
+        while (k < s.size() && s[k] > zero_singular_value * s[0]) {
+            ++k;
+        }
+        return k;
+    }
+}  // namespace
+
+std::tuple<Matrix, std::vector<calc_type>, Matrix> mps::svd(Matrix m, std::size_t rows, std::size_t cols)
+{
+    const auto k = std::min(rows, cols);
+#ifdef HAVE_LAPACK
+    // The row-major m is the column-major m^T = U' S V'^H, so that the buffers of V'^H and U' are respectively the
+    // row-major U and V^H of m.
+    const int m_lapack = static_cast<int>(cols);
+    const int n_lapack = static_cast<int>(rows);
+    const int ldvt = static_cast<int>(k);
+    Matrix u(rows * k);
+    Matrix vh(k * cols);
+    std::vector<calc_type> s(k);
+    std::vector<calc_type> rwork(5 * k);
+    int info = 0;
+    int lwork = -1;
+    complex_type work_size;
+    zgesvd_("S", "S", &m_lapack, &n_lapack, m.data(), &m_lapack, s.data(), vh.data(), &m_lapack, u.data(), &ldvt,
+            &work_size, &lwork, rwork.data(), &info);
+    lwork = static_cast<int>(std::real(work_size));
+    Matrix work(std::max(lwork, 1));
+    zgesvd_("S", "S", &m_lapack, &n_lapack, m.data(), &m_lapack, s.data(), vh.data(), &m_lapack, u.data(), &ldvt,
+            work.data(), &lwork, rwork.data(), &info);
+    if (info != 0) {
+        throw(std::runtime_error("svd(): zgesvd failed to converge (info = " + std::to_string(info) + ")"));
+    }
+    return std::make_tuple(u, s, vh);
+#else
+    if (rows >= cols) {
+        return jacobi_svd(m, rows, cols);
+    }
+    // m^H = U' S V'^H  =>  m = V' S U'^H
+    Matrix mh(cols * rows);
+    for (std::size_t r = 0; r < rows; ++r) {
+        for (std::size_t c = 0; c < cols; ++c) {
+            mh[c * rows + r] = std::conj(m[r * cols + c]);
+        }
+    }
+    auto [u_h, s, vh_h] = jacobi_svd(mh, cols, rows);
+    Matrix u(rows * k);
+    Matrix vh(k * cols);
+    for (std::size_t j = 0; j < k; ++j) {
+        for (std::size_t r = 0; r < rows; ++r) {
+            u[r * k + j] = std::conj(vh_h[j * rows + r]);
+        }
+        for (std::size_t c = 0; c < cols; ++c) {
+            vh[j * cols + c] = std::conj(u_h[c * k + j]);
+        }
+    }
+    return std::make_tuple(u, s, vh);
+#endif  // HAVE_LAPACK
+}
+
+// =============================================================================
+
+MPSSimulator::MPSSimulator(unsigned seed, unsigned max_bond_dimension, calc_type truncation_threshold)
+    : center_(0)
+    , max_bond_dimension_(max_bond_dimension)
+    , truncation_threshold_(truncation_threshold)
+    , truncation_error_(0.)
+    , rnd_eng_(seed)
+{}
+
+unsigned MPSSimulator::position(unsigned id, char const* function_name) const
+{
+    const auto it = map_.find(id);
+    if (it == map_.end()) {
+        throw(std::runtime_error(std::string(function_name)
+                                 + "(): Unknown qubit id. Please make sure you have called eng.flush()."));
+    }
+    return it->second;
+}
+
+// =============================================================================
+
+void MPSSimulator::allocate_qubit(unsigned id)
+{
+    if (map_.count(id) != 0U) {
+        throw(std::runtime_error("AllocateQubit: ID already exists. Qubit IDs should be unique."));
+    }
+    // |0> is both left- and right-canonical: the orthogonality center does not move
+    sites_.push_back(Site{1, 1, {1., 0.}});
+    map_[id] = static_cast<unsigned>(qubit_at_.size());
+    qubit_at_.push_back(id);
+}
+
+void MPSSimulator::deallocate_qubit(unsigned id)
+{
+    const auto pos = position(id, "deallocate_qubit");
+    move_center(pos);
+    auto const& site = sites_[pos];
+    calc_type p1 = 0.;
+    calc_type total = 0.;
+    for (std::size_t l = 0; l < site.left; ++l) {
+        for (std::size_t r = 0; r < site.right; ++r) {
+            p1 += std::norm(site(l, 1, r));
+            total += std::norm(site(l, 0, r)) + std::norm(site(l, 1, r));
+        }
+    }
+    p1 /= total;
+    if (p1 > default_tol_ && p1 < 1. - default_tol_) {
+        throw(std::runtime_error(
+            "Error: Qubit has not been measured / uncomputed! There is most likely a bug in your code."));
+    }
+
+    // Absorb the (normalized) projection of the site onto the classical value into a neighbour, which becomes the
+    // orthogonality center
+    const std::size_t value = p1 > 0.5 ? 1 : 0;
+    const auto scale = 1. / std::sqrt(value == 1 ? p1 * total : (1. - p1) * total);
+    if (pos + 1 < sites_.size()) {
+        auto const& next = sites_[pos + 1];
+        Site merged{site.left, next.right, Matrix(site.left * 2 * next.right, 0.)};
+        for (std::size_t l = 0; l < site.left; ++l) {
+            for (std::size_t m = 0; m < site.right; ++m) {
+                const auto b = site(l, value, m) * scale;
+                for (std::size_t s = 0; s < 2; ++s) {
+                    for (std::size_t r = 0; r < next.right; ++r) {
+                        merged(l, s, r) += b * next(m, s, r);
+                    }
+                }
+            }
+        }
+        sites_[pos + 1] = std::move(merged);
+        center_ = pos;
+    }
+    else if (pos > 0) {
+        auto const& prev = sites_[pos - 1];
+        Site merged{prev.left, site.right, Matrix(prev.left * 2 * site.right, 0.)};
+        for (std::size_t l = 0; l < prev.left; ++l) {
+            for (std::size_t s = 0; s < 2; ++s) {
+                for (std::size_t m = 0; m < prev.right; ++m) {
+                    const auto a = prev(l, s, m) * scale;
+                    for (std::size_t r = 0; r < site.right; ++r) {
+                        merged(l, s, r) += a * site(m, value, r);
+                    }
+                }
+            }
+        }
+        sites_[pos - 1] = std::move(merged);
+        center_ = pos - 1;
+    }
+    else {
+        center_ = 0;
+    }
+
+    sites_.erase(sites_.begin() + pos);
+    qubit_at_.erase(qubit_at_.begin() + pos);
+    map_.erase(id);
+    for (std::size_t p = pos; p < qubit_at_.size(); ++p) {
+        map_[qubit_at_[p]] = static_cast<unsigned>(p);
+    }
+}
+
+std::vector<bool> MPSSimulator::measure_qubits(std::vector<unsigned> const& ids)
+{
+    std::vector<bool> res;
+    res.reserve(ids.size());
+    for (auto const& id: ids) {
+        const auto pos = position(id, "measure_qubits");
+        move_center(pos);
+        auto& site = sites_[pos];
+        calc_type p1 = 0.;
+        calc_type total = 0.;
+        for (std::size_t l = 0; l < site.left; ++l) {
+            for (std::size_t r = 0; r < site.right; ++r) {
+                p1 += std::norm(site(l, 1, r));
+                total += std::norm(site(l, 0, r)) + std::norm(site(l, 1, r));
+            }
+        }
+        const bool outcome = std::uniform_real_distribution<calc_type>(0., total)(rnd_eng_) < p1;
+        const auto scale = 1. / std::sqrt(outcome ? p1 : total - p1);
+        for (std::size_t l = 0; l < site.left; ++l) {
+            for (std::size_t r = 0; r < site.right; ++r) {
+                site(l, outcome ? 0 : 1, r) = 0.;
+                site(l, outcome ? 1 : 0, r) *= scale;
+            }
+        }
+        res.push_back(outcome);
+    }
+    return res;
+}
+
+// =============================================================================
+
+void MPSSimulator::move_center(std::size_t pos)
+{
+    // Exact SVDs: only the zero singular values are dropped
+    while (center_ < pos) {
+        auto const& site = sites_[center_];
+        const auto rows = site.left * 2;
+        const auto cols = site.right;
+        auto [u, s, vh] = mps::svd(site.data, rows, cols);
+        const auto k = rank(s);
+
+        auto const& next = sites_[center_ + 1];
+        Site merged{k, next.right, Matrix(k * 2 * next.right, 0.)};
+        for (std::size_t j = 0; j < k; ++j) {
+            for (std::size_t m = 0; m < cols; ++m) {
+                const auto r_jm = s[j] * vh[j * cols + m];
+                for (std::size_t t = 0; t < 2 * next.right; ++t) {
+                    merged.data[j * 2 * next.right + t] += r_jm * next.data[m * 2 * next.right + t];
+                }
+            }
+        }
+        sites_[center_] = Site{site.left, k, first_columns(u, rows, std::min(rows, cols), k)};
+        sites_[center_ + 1] = std::move(merged);
+        ++center_;
+    }
+    while (center_ > pos) {
+        auto const& site = sites_[center_];
+        const auto rows = site.left;
+        const auto cols = 2 * site.right;
+        auto [u, s, vh] = mps::svd(site.data, rows, cols);
+        const auto k = rank(s);
+        const auto kfull = std::min(rows, cols);
+
+        auto const& prev = sites_[center_ - 1];
+        Site merged{prev.left, k, Matrix(prev.left * 2 * k, 0.)};
+        for (std::size_t t = 0; t < prev.left * 2; ++t) {
+            for (std::size_t m = 0; m < rows; ++m) {
+                const auto a = prev.data[t * rows + m];
+                for (std::size_t j = 0; j < k; ++j) {
+                    merged.data[t * k + j] += a * u[m * kfull + j] * s[j];
+                }
+            }
+        }
+        sites_[center_] = Site{k, site.right, Matrix(vh.begin(), vh.begin() + k * cols)};
+        sites_[center_ - 1] = std::move(merged);
+        --center_;
+    }
+}
+
+void MPSSimulator::apply_single_site(std::size_t pos, Matrix const& m)
+{
+    auto& site = sites_[pos];
+    for (std::size_t l = 0; l < site.left; ++l) {
+        for (std::size_t r = 0; r < site.right; ++r) {
+            const auto a0 = site(l, 0, r);
+            const auto a1 = site(l, 1, r);
+            site(l, 0, r) = m[0] * a0 + m[1] * a1;
+            site(l, 1, r) = m[2] * a0 + m[3] * a1;
+        }
+    }
+}
+
+void MPSSimulator::apply_two_sites(std::size_t pos, Matrix const& m)
+{
+    move_center(pos);
+    auto const& a = sites_[pos];
+    auto const& b = sites_[pos + 1];
+    const auto dl = a.left;
+    const auto dm = a.right;
+    const auto dr = b.right;
+
+    // theta[l, s1, s2, r] = sum_m A[l, s1, m] B[m, s2, r]
+    Matrix theta(dl * 4 * dr, 0.);
+    for (std::size_t l = 0; l < dl; ++l) {
+        for (std::size_t s1 = 0; s1 < 2; ++s1) {
+            for (std::size_t k = 0; k < dm; ++k) {
+                const auto a_val = a(l, s1, k);
+                if (a_val == 0.) {
+                    continue;
+                }
+                for (std::size_t t = 0; t < 2 * dr; ++t) {
+                    theta[(l * 2 + s1) * 2 * dr + t] += a_val * b.data[k * 2 * dr + t];
+                }
+            }
+        }
+    }
+
+    // Apply the gate (bit 0 of the matrix index is s1, bit 1 is s2)
+    Matrix gated(theta.size(), 0.);
+    for (std::size_t l = 0; l < dl; ++l) {
+        for (std::size_t out = 0; out < 4; ++out) {
+            for (std::size_t in = 0; in < 4; ++in) {
+                const auto g = m[out * 4 + in];
+                if (g == 0.) {
+                    continue;
+                }
+                const auto out_offset = ((l * 2 + (out & 1U)) * 2 + (out >> 1U)) * dr;
+                const auto in_offset = ((l * 2 + (in & 1U)) * 2 + (in >> 1U)) * dr;
+                for (std::size_t r = 0; r < dr; ++r) {
+                    gated[out_offset + r] += g * theta[in_offset + r];
+                }
+            }
+        }
+    }
+
+    // Split theta[(l, s1), (s2, r)] again, truncating the spectrum
+    const auto rows = dl * 2;
+    const auto cols = 2 * dr;
+    auto [u, s, vh] = mps::svd(std::move(gated), rows, cols);
+    const auto kfull = s.size();
+    const auto total = std::accumulate(begin(s), end(s), calc_type(0.), [](calc_type sum, calc_type x) {
+        return sum + x * x;
+    });
+    auto chi = kfull;
+    calc_type discarded = 0.;
+    while (chi > 1) {
+        const auto weight = s[chi - 1] * s[chi - 1];
+        if ((max_bond_dimension_ > 0 && chi > max_bond_dimension_) || s[chi - 1] <= zero_singular_value * s[0]
+            || discarded + weight <= truncation_threshold_ * total) {
+            discarded += weight;
+            --chi;
+        }
+        else {
+            break;
+        }
+    }
+    if (total > 0.) {
+        truncation_error_ += discarded / total;
+    }
+    const auto norm = std::sqrt(total - discarded);
+
+    Site new_b{chi, dr, Matrix(chi * cols)};
+    for (std::size_t j = 0; j < chi; ++j) {
+        for (std::size_t t = 0; t < cols; ++t) {
+            new_b.data[j * cols + t] = s[j] / norm * vh[j * cols + t];
+        }
+    }
+    sites_[pos] = Site{dl, chi, first_columns(u, rows, kfull, chi)};
+    sites_[pos + 1] = std::move(new_b);
+    center_ = pos + 1;
+}
+
+void MPSSimulator::swap_sites(std::size_t pos)
+{
+    static const Matrix swap_gate = {1., 0., 0., 0., 0., 0., 1., 0., 0., 1., 0., 0., 0., 0., 0., 1.};
+    apply_two_sites(pos, swap_gate);
+    std::swap(qubit_at_[pos], qubit_at_[pos + 1]);
+    map_[qubit_at_[pos]] = static_cast<unsigned>(pos);
+    map_[qubit_at_[pos + 1]] = static_cast<unsigned>(pos + 1);
+}
+
+void MPSSimulator::apply_controlled_gate(Matrix const& m, std::vector<unsigned> const& ids,
+                                         std::vector<unsigned> const& ctrl)
+{
+    const auto num_targets = ids.size();
+    const auto num_qubits = num_targets + ctrl.size();
+    if (num_qubits == 0 || num_qubits > 2) {
+        throw(std::invalid_argument(
+            "MPSSimulator: only gates acting on one or two qubits (including the control qubits) are supported."));
+    }
+    const std::size_t target_dim = 1UL << num_targets;
+    if (m.size() != target_dim * target_dim) {
+        throw(std::invalid_argument("apply_controlled_gate(): matrix size does not match the number of qubits."));
+    }
+
+    // Full matrix acting on ids + ctrl
+    const std::size_t dim = 1UL << num_qubits;
+    const std::size_t ctrl_mask = (dim - 1) ^ (target_dim - 1);
+    Matrix full(dim * dim, 0.);
+    for (std::size_t i = 0; i < dim; ++i) {
+        for (std::size_t j = 0; j < dim; ++j) {
+            if ((i & ctrl_mask) == ctrl_mask && (j & ctrl_mask) == ctrl_mask) {
+                full[i * dim + j] = m[(i & (target_dim - 1)) * target_dim + (j & (target_dim - 1))];
+            }
+            else if (i == j) {
+                full[i * dim + j] = 1.;
+            }
+        }
+    }
+
+    std::vector<unsigned> qubits(ids);
+    qubits.insert(qubits.end(), ctrl.begin(), ctrl.end());
+    if (num_qubits == 1) {
+        apply_single_site(position(qubits[0], "apply_controlled_gate"), full);
+        return;
+    }
+
+    const auto pos0 = position(qubits[0], "apply_controlled_gate");
+    const auto pos1 = position(qubits[1], "apply_controlled_gate");
+    if (pos0 == pos1) {
+        throw(std::invalid_argument("apply_controlled_gate(): duplicate qubit ids."));
+    }
+    const auto lo = std::min(pos0, pos1);
+    const auto hi = std::max(pos0, pos1);
+
+    // Bring the qubits next to each other, apply the gate and restore the ordering
+    for (auto p = hi - 1; p > lo; --p) {
+        swap_sites(p);
+    }
+    if (pos0 < pos1) {
+        apply_two_sites(lo, full);
+    }
+    else {
+        // Exchange the two bits of the matrix indices
+        static constexpr std::size_t perm[] = {0, 2, 1, 3};
+        Matrix permuted(16);
+        for (std::size_t i = 0; i < 4; ++i) {
+            for (std::size_t j = 0; j < 4; ++j) {
+                permuted[i * 4 + j] = full[perm[i] * 4 + perm[j]];
+            }
+        }
+        apply_two_sites(lo, permuted);
+    }
+    for (auto p = lo + 1; p < hi; ++p) {
+        swap_sites(p);
+    }
+}
+
+// =============================================================================
+
+MPSSimulator::Matrix MPSSimulator::transfer(Matrix const& env, Site const& site, SiteOperator const& op)
+{
+    const auto dl = site.left;
+    const auto dr = site.right;
+
+    // T[l, s, r'] = sum_l' E[l, l'] A[l', s, r']
+    Matrix tmp(dl * 2 * dr, 0.);
+    for (std::size_t l = 0; l < dl; ++l) {
+        for (std::size_t lp = 0; lp < dl; ++lp) {
+            const auto e = env[l * dl + lp];
+            if (e == 0.) {
+                continue;
+            }
+            for (std::size_t t = 0; t < 2 * dr; ++t) {
+                tmp[l * 2 * dr + t] += e * site.data[lp * 2 * dr + t];
+            }
+        }
+    }
+    // W[l, t, r'] = sum_s op[t, s] T[l, s, r']
+    Matrix w(tmp.size());
+    for (std::size_t l = 0; l < dl; ++l) {
+        for (std::size_t r = 0; r < dr; ++r) {
+            const auto t0 = tmp[(l * 2) * dr + r];
+            const auto t1 = tmp[(l * 2 + 1) * dr + r];
+            w[(l * 2) * dr + r] = op[0] * t0 + op[1] * t1;
+            w[(l * 2 + 1) * dr + r] = op[2] * t0 + op[3] * t1;
+        }
+    }
+    // E'[r, r'] = sum_{l, t} conj(A[l, t, r]) W[l, t, r']
+    Matrix result(dr * dr, 0.);
+    for (std::size_t lt = 0; lt < dl * 2; ++lt) {
+        for (std::size_t r = 0; r < dr; ++r) {
+            const auto a = std::conj(site.data[lt * dr + r]);
+            if (a == 0.) {
+                continue;
+            }
+            for (std::size_t rp = 0; rp < dr; ++rp) {
+                result[r * dr + rp] += a * w[lt * dr + rp];
+            }
+        }
+    }
+    return result;
+}
+
+MPSSimulator::complex_type MPSSimulator::expectation(std::map<unsigned, SiteOperator> const& ops) const
+{
+    if (sites_.empty()) {
+        return 1.;
+    }
+    static constexpr SiteOperator identity = {1., 0., 0., 1.};
+
+    // Sites left of the center are left-canonical and sites right of it right-canonical: they contract to identities
+    std::size_t first = center_;
+    std::size_t last = center_;
+    if (!ops.empty()) {
+        first = std::min<std::size_t>(first, ops.begin()->first);
+        last = std::max<std::size_t>(last, ops.rbegin()->first);
+    }
+    const auto dim = sites_[first].left;
+    Matrix env(dim * dim, 0.);
+    for (std::size_t l = 0; l < dim; ++l) {
+        env[l * dim + l] = 1.;
+    }
+    for (auto p = first; p <= last; ++p) {
+        const auto it = ops.find(static_cast<unsigned>(p));
+        env = transfer(env, sites_[p], it == ops.end() ? identity : it->second);
+    }
+    complex_type trace = 0.;
+    const auto dr = sites_[last].right;
+    for (std::size_t r = 0; r < dr; ++r) {
+        trace += env[r * dr + r];
+    }
+    return trace;
+}
+
+MPSSimulator::calc_type MPSSimulator::get_expectation_value(TermsDict const& td, std::vector<unsigned> const& ids)
+{
+    std::vector<unsigned> positions;
+    positions.reserve(ids.size());
+    for (auto const& id: ids) {
+        positions.push_back(position(id, "get_expectation_value"));
+    }
+
+    calc_type expectation_value = 0.;
+    for (auto const& [term, coefficient]: td) {
+        std::map<unsigned, SiteOperator> ops;
+        for (auto const& [index, pauli]: term) {
+            SiteOperator op;
+            switch (pauli) {
+                case 'X':
+                    op = {0., 1., 1., 0.};
+                    break;
+                case 'Y':
+                    op = {0., complex_type(0., -1.), complex_type(0., 1.), 0.};
+                    break;
+                case 'Z':
+                    op = {1., 0., 0., -1.};
+                    break;
+                default:
+                    throw(std::invalid_argument("get_expectation_value(): unknown Pauli operator."));
+            }
+            ops[positions.at(index)] = op;
+        }
+        expectation_value += coefficient * std::real(expectation(ops));
+    }
+    return expectation_value;
+}
+
+MPSSimulator::calc_type MPSSimulator::get_probability(std::vector<bool> const& bit_string,
+                                                      std::vector<unsigned> const& ids)
+{
+    if (bit_string.size() != ids.size()) {
+        throw(std::length_error("get_probability(): ids and bit_string size mismatch"));
+    }
+    std::map<unsigned, SiteOperator> ops;
+    for (std::size_t i = 0; i < ids.size(); ++i) {
+        ops[position(ids[i], "get_probability")] = bit_string[i] ? SiteOperator{0., 0., 0., 1.}
+                                                                 : SiteOperator{1., 0., 0., 0.};
+    }
+    return std::real(expectation(ops));
+}
+
+MPSSimulator::complex_type MPSSimulator::get_amplitude(std::vector<bool> const& bit_string,
+                                                       std::vector<unsigned> const& ids)
+{
+    if (bit_string.size() != ids.size() || ids.size() != sites_.size()) {
+        throw(std::runtime_error(
+            "get_amplitude(): The second argument must be a list of all the qubits (and match the bit string)."));
+    }
+    std::vector<std::size_t> bits(sites_.size(), 2);
+    for (std::size_t i = 0; i < ids.size(); ++i) {
+        bits[position(ids[i], "get_amplitude")] = bit_string[i] ? 1 : 0;
+    }
+    if (std::count(begin(bits), end(bits), 2) != 0) {
+        throw(std::runtime_error("get_amplitude(): duplicate qubit ids."));
+    }
+
+    Matrix v(1, 1.);
+    for (std::size_t p = 0; p < sites_.size(); ++p) {
+        auto const& site = sites_[p];
+        Matrix next(site.right, 0.);
+        for (std::size_t l = 0; l < site.left; ++l) {
+            for (std::size_t r = 0; r < site.right; ++r) {
+                next[r] += v[l] * site(l, bits[p], r);
+            }
+        }
+        std::swap(v, next);
+    }
+    return v[0];
+}
+
+std::vector<unsigned> MPSSimulator::get_bond_dimensions() const
+{
+    std::vector<unsigned> dims;
+    for (std::size_t p = 0; p + 1 < sites_.size(); ++p) {
+        dims.push_back(static_cast<unsigned>(sites_[p].right));
+    }
+    return dims;
+}
+
+std::tuple<MPSSimulator::Map, MPSSimulator::Matrix> MPSSimulator::cheat() const
+{
+    // psi[x, r] for the first p qubits
+    Matrix psi(1, 1.);
+    std::size_t num_states = 1;
+    for (auto const& site: sites_) {
+        Matrix next(2 * num_states * site.right, 0.);
+        for (std::size_t x = 0; x < num_states; ++x) {
+            for (std::size_t l = 0; l < site.left; ++l) {
+                const auto amplitude = psi[x * site.left + l];
+                if (amplitude == 0.) {
+                    continue;
+                }
+                for (std::size_t s = 0; s < 2; ++s) {
+                    for (std::size_t r = 0; r < site.right; ++r) {
+                        next[(x + s * num_states) * site.right + r] += amplitude * site(l, s, r);
+                    }
+                }
+            }
+        }
+        std::swap(psi, next);
+        num_states *= 2;
+    }
+    return std::make_tuple(map_, psi);
+}
@@ -0,0 +1,733 @@
+//   Copyright 2021 <Huawei Technologies Co., Ltd>
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#include "out_of_core.hpp"
+
+#include "simbackends.hpp"
+
+#include <algorithm>
+#include <bitset>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <future>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+namespace
+{
+    // Unique prefix for the chunk files of one simulator instance.
+    std::string make_tag()
+    {
+        std::random_device rd;
+        std::ostringstream ss;
+        ss << "projectq_" << std::hex << rd() << rd();
+        return ss.str();
+    }
+
+    inline bool parity(std::size_t x)
+    {
+        return (std::bitset<sizeof(std::size_t) * CHAR_BIT>(x).count() & 1U) == 1U;
+    }
+}  // namespace
+
+OutOfCoreSimulator::OutOfCoreSimulator(unsigned seed, std::string directory, unsigned local_qubits)
+    : N_(0)
+    , L_(local_qubits)
+    , zero_(1, false)
+    , directory_(std::move(directory))
+    , tag_(make_tag())
+    , fusion_qubits_min_(4)
+    , fusion_qubits_max_(max_qubit_num_)
+    , rnd_eng_(seed)
+    , backend_type_(backends::SimBackend::Unknown)
+    , backend_kernel_(nullptr)
+    , bytes_read_(0)
+    , bytes_written_(0)
+    , num_gates_(0)
+    , num_sweeps_(0)
+    , num_swaps_(0)
+{
+    if (L_ < max_qubit_num_) {
+        throw std::invalid_argument("OutOfCoreSimulator: the number of local qubits must be at least 5!");
+    }
+
+    std::uniform_real_distribution<double> dist(0., 1.);
+    rng_ = [this, dist]() mutable { return dist(rnd_eng_); };
+
+    select_backend(backends::SimBackendGetEnv());
+
+    StateVector init(1, 1.);  // all-zero initial state
+    write_chunk(0, init);
+    reset_io_stats();
+}
+
+OutOfCoreSimulator::~OutOfCoreSimulator()
+{
+    for (std::size_t chunk = 0; chunk < num_chunks(); ++chunk) {
+        std::remove(chunk_path(chunk).c_str());
+    }
+}
+
+void OutOfCoreSimulator::select_backend(backends::SimBackend backend)
+{
+    backend_kernel_ = backends::SimBackendLoadKernel(backend);
+    backend_type_ = backend;
+}
+
+// =============================================================================
+
+void OutOfCoreSimulator::allocate_qubit(unsigned id)
+{
+    if (map_.count(id) != 0U) {
+        throw(std::runtime_error("AllocateQubit: ID already exists. Qubit IDs should be unique."));
+    }
+
+    if (N_ < L_) {
+        // New local qubit: the (only) chunk doubles in size. Pending operations remain valid since they only act on
+        // the lower half which contains all the non-zero amplitudes.
+        auto& buffer = buffers_[0][0];
+        read_chunk(0, buffer, zero_[0]);
+        buffer.resize(2 * buffer.size(), 0.);
+        write_chunk(0, buffer);
+    }
+    else {
+        // New global qubit: the number of chunks doubles but the new ones are all zeros, no I/O required.
+        zero_.resize(2 * zero_.size(), true);
+    }
+    map_[id] = N_++;
+}
+
+void OutOfCoreSimulator::deallocate_qubit(unsigned id)
+{
+    run();
+    if (map_.count(id) != 1UL) {
+        throw(std::runtime_error("DeallocateQubit: Qubit IDs is not known!"));
+    }
+
+    auto pos = map_[id];
+    const auto bit = 1UL << pos;
+    bool has_zero = false;
+    bool has_one = false;
+    sweep([&](std::size_t chunk, StateVector& buffer) {
+        if (pos >= L_) {
+            const auto any = std::any_of(begin(buffer), end(buffer),
+                                         [](complex_type const& a) { return std::norm(a) > default_tol_; });
+            if (((chunk >> (pos - L_)) & 1UL) == 1UL) {
+                has_one = has_one || any;
+            }
+            else {
+                has_zero = has_zero || any;
+            }
+        }
+        else {
+            for (std::size_t i = 0; i < buffer.size(); ++i) {
+                if (std::norm(buffer[i]) > default_tol_) {
+                    has_one = has_one || ((i & bit) != 0);
+                    has_zero = has_zero || ((i & bit) == 0);
+                }
+            }
+        }
+        return false;
+    });
+
+    if (has_zero == has_one) {
+        throw(std::runtime_error(
+            "Error: Qubit has not been measured / uncomputed! There is most likely a bug in your code."));
+    }
+    const bool value = has_one;
+
+    if (pos < L_ && N_ > L_) {
+        // Turn the qubit into a global one so that whole chunks can be dropped
+        swap_qubits(N_ - 1, pos);
+        pos = N_ - 1;
+    }
+
+    if (pos >= L_) {
+        const auto gbit = pos - L_;
+        const auto old_chunks = num_chunks();
+        auto keep = [gbit, value](std::size_t chunk) {
+            return ((chunk >> gbit) & 1UL) == static_cast<unsigned>(value);
+        };
+
+        // Remove files first so that renaming never overwrites an existing file
+        for (std::size_t chunk = 0; chunk < old_chunks; ++chunk) {
+            if (!keep(chunk) || zero_[chunk]) {
+                std::remove(chunk_path(chunk).c_str());
+            }
+        }
+        std::vector<bool> zero;
+        zero.reserve(old_chunks / 2);
+        for (std::size_t chunk = 0; chunk < old_chunks; ++chunk) {
+            if (keep(chunk)) {
+                const auto new_chunk = zero.size();
+                if (!zero_[chunk] && new_chunk != chunk
+                    && std::rename(chunk_path(chunk).c_str(), chunk_path(new_chunk).c_str()) != 0) {
+                    throw(std::runtime_error("DeallocateQubit: unable to rename chunk file " + chunk_path(chunk)));
+                }
+                zero.push_back(zero_[chunk]);
+            }
+        }
+        zero_ = std::move(zero);
+    }
+    else {
+        // Only one chunk: remove the qubit in place
+        auto& buffer = buffers_[0][0];
+        read_chunk(0, buffer, zero_[0]);
+        const auto half = buffer.size() / 2;
+        for (std::size_t i = 0; i < half; ++i) {
+            buffer[i] = buffer[((i >> pos) << (pos + 1)) | (static_cast<std::size_t>(value) << pos) | (i & (bit - 1))];
+        }
+        buffer.resize(half);
+        write_chunk(0, buffer);
+    }
+
+    for (auto& p: map_) {
+        if (p.second > pos) {
+            p.second--;
+        }
+    }
+    map_.erase(id);
+    N_--;
+}
+
+std::vector<bool> OutOfCoreSimulator::measure_qubits(std::vector<unsigned> const& ids)
+{
+    run();
+
+    std::vector<unsigned> positions(ids.size());
+    for (unsigned i = 0; i < ids.size(); ++i) {
+        positions[i] = map_[ids[i]];
+    }
+
+    // Apply the pending operations and compute the norm of each chunk in a single pass
+    std::vector<calc_type> norms(num_chunks(), 0.);
+    sweep([&norms](std::size_t chunk, StateVector& buffer) {
+        calc_type nrm = 0.;
+#pragma omp parallel for reduction(+ : nrm) schedule(static)
+        for (std::size_t i = 0; i < buffer.size(); ++i) {
+            nrm += std::norm(buffer[i]);
+        }
+        norms[chunk] = nrm;
+        return false;
+    });
+
+    calc_type P = 0.;
+    calc_type rnd = rng_();
+
+    // pick chunk at random with probability |chunk|^2, then the entry within it
+    std::size_t chunk = 0;
+    for (std::size_t c = 0; c < norms.size(); ++c) {
+        if (norms[c] > 0.) {
+            chunk = c;
+            if (P + norms[c] >= rnd) {
+                break;
+            }
+            P += norms[c];
+        }
+    }
+    if (P + norms[chunk] < rnd) {
+        P -= norms[chunk];
+    }
+
+    auto& buffer = buffers_[0][0];
+    read_chunk(chunk, buffer, zero_[chunk]);
+    std::size_t pick = 0;
+    while (P < rnd && pick < buffer.size()) {
+        P += std::norm(buffer[pick++]);
+    }
+    if (pick > 0) {
+        pick--;
+    }
+    pick |= chunk << local_bits();
+
+    std::vector<bool> res(ids.size());
+    std::size_t mask = 0;
+    std::size_t val = 0;
+    for (unsigned i = 0; i < ids.size(); ++i) {
+        bool r = ((pick >> positions[i]) & 1) == 1;  // NOLINT
+        res[i] = r;
+        mask |= (1UL << positions[i]);
+        val |= (static_cast<std::size_t>(static_cast<unsigned int>(r) & 1U) << positions[i]);
+    }
+
+    project(mask, val, 1. / std::sqrt(norm_of(mask, val)));
+    return res;
+}
+
+OutOfCoreSimulator::calc_type OutOfCoreSimulator::get_expectation_value(TermsDict const& td,
+                                                                        std::vector<unsigned> const& ids)
+{
+    run();
+    flush_pending();
+
+    // <psi|P|psi> = sum_i conj(psi[i ^ x]) * i^ny * (-1)^|i & z| * psi[i] for a Pauli string P
+    struct PauliTerm
+    {
+        std::size_t xmask;  // local part of the bit flips
+        std::size_t zmask;
+        complex_type factor;
+    };
+    const std::array<complex_type, 4> powers_of_i = {1., complex_type(0., 1.), -1., complex_type(0., -1.)};
+
+    // Terms flipping the same global bits need the same pairs of chunks
+    std::map<std::size_t, std::vector<PauliTerm>> groups;
+    for (auto const& term: td) {
+        std::size_t xmask = 0;
+        std::size_t zmask = 0;
+        unsigned ny = 0;
+        for (auto const& local_op: term.first) {
+            const auto bit = 1UL << map_[ids[local_op.first]];
+            if (local_op.second == 'X' || local_op.second == 'Y') {
+                xmask |= bit;
+            }
+            if (local_op.second == 'Z' || local_op.second == 'Y') {
+                zmask |= bit;
+            }
+            ny += static_cast<unsigned>(local_op.second == 'Y');
+        }
+        std::size_t xlocal = 0;
+        std::size_t xglobal = 0;
+        split_mask(xmask, xlocal, xglobal);
+        groups[xglobal].push_back({xlocal, zmask, term.second * powers_of_i[ny % 4]});
+    }
+
+    calc_type expectation = 0.;
+    for (auto const& group: groups) {
+        auto const& terms = group.second;
+        std::vector<complex_type> sums(terms.size(), 0.);
+        auto accumulate = [&](std::size_t chunk, StateVector const& psi, StateVector const& partner) {
+            for (std::size_t t = 0; t < terms.size(); ++t) {
+                std::size_t zlocal = 0;
+                std::size_t zglobal = 0;
+                split_mask(terms[t].zmask, zlocal, zglobal);
+                const auto xlocal = terms[t].xmask;
+                calc_type re = 0.;
+                calc_type im = 0.;
+#pragma omp parallel for reduction(+ : re, im) schedule(static)
+                for (std::size_t i = 0; i < psi.size(); ++i) {
+                    auto a = std::conj(partner[i ^ xlocal]) * psi[i];
+                    if (parity(i & zlocal)) {
+                        a = -a;
+                    }
+                    re += std::real(a);
+                    im += std::imag(a);
+                }
+                sums[t] += (parity(chunk & zglobal) ? -1. : 1.) * terms[t].factor * complex_type(re, im);
+            }
+        };
+
+        if (group.first == 0) {
+            sweep([&](std::size_t chunk, StateVector& buffer) {
+                accumulate(chunk, buffer, buffer);
+                return false;
+            });
+        }
+        else {
+            sweep_pairs(group.first, [&](std::size_t c0, StateVector& b0, std::size_t c1, StateVector& b1) {
+                accumulate(c0, b0, b1);
+                accumulate(c1, b1, b0);
+                return false;
+            });
+        }
+        for (auto const& s: sums) {
+            expectation += std::real(s);
+        }
+    }
+    return expectation;
+}
+
+OutOfCoreSimulator::calc_type OutOfCoreSimulator::get_probability(std::vector<bool> const& bit_string,
+                                                                  std::vector<unsigned> const& ids)
+{
+    run();
+    if (!check_ids(ids)) {
+        throw(std::runtime_error("get_probability(): Unknown qubit id. Please make sure you have called eng.flush()."));
+    }
+    std::size_t mask = 0;
+    std::size_t bit_str = 0;
+    for (unsigned i = 0; i < ids.size(); ++i) {
+        mask |= 1UL << map_[ids[i]];
+        bit_str |= (bit_string[i] ? 1UL : 0UL) << map_[ids[i]];
+    }
+    return norm_of(mask, bit_str);
+}
+
+OutOfCoreSimulator::complex_type OutOfCoreSimulator::get_amplitude(std::vector<bool> const& bit_string,
+                                                                   std::vector<unsigned> const& ids)
+{
+    run();
+    std::size_t chk = 0;
+    std::size_t index = 0;
+    for (unsigned i = 0; i < ids.size(); ++i) {
+        if (map_.count(ids[i]) == 0UL) {
+            break;
+        }
+        chk |= 1UL << map_[ids[i]];
+        index |= (bit_string[i] ? 1UL : 0UL) << map_[ids[i]];
+    }
+    if (chk + 1UL != (1UL << N_)) {
+        throw(
+            std::runtime_error("The second argument to get_amplitude() must be a permutation of all allocated "
+                               "qubits. Please make sure you have called eng.flush()."));
+    }
+    flush_pending();
+
+    const auto chunk = index >> local_bits();
+    auto& buffer = buffers_[0][0];
+    read_chunk(chunk, buffer, zero_[chunk]);
+    return buffer[index & (chunk_size() - 1)];
+}
+
+void OutOfCoreSimulator::collapse_wavefunction(std::vector<unsigned> const& ids, std::vector<bool> const& values)
+{
+    run();
+    if (ids.size() != values.size()) {
+        throw(std::length_error("collapse_wavefunction(): ids and values size mismatch"));
+    }
+    if (!check_ids(ids)) {
+        throw(
+            std::runtime_error("collapse_wavefunction(): Unknown qubit id(s) provided. Try calling eng.flush() "
+                               "before invoking this function."));
+    }
+    std::size_t mask = 0;
+    std::size_t val = 0;
+    for (unsigned i = 0; i < ids.size(); ++i) {
+        mask |= (1UL << map_[ids[i]]);
+        val |= ((values[i] ? 1UL : 0UL) << map_[ids[i]]);
+    }
+    const auto N = norm_of(mask, val);
+    if (N < default_tol_) {
+        throw(std::runtime_error("collapse_wavefunction(): Invalid collapse! Probability is ~0."));
+    }
+    project(mask, val, 1. / std::sqrt(N));
+}
+
+void OutOfCoreSimulator::run()
+{
+    if (fused_gates_.size() < 1UL) {
+        return;
+    }
+
+    fusion::Fusion::Matrix m;
+    fusion::Fusion::IndexVector ids;
+    fusion::Fusion::IndexVector ctrls;
+
+    fused_gates_.perform_fusion(m, ids, ctrls);
+    fused_gates_ = fusion::Fusion();
+
+    if (ids.size() > max_qubit_num_) {
+        throw std::invalid_argument("Gates with more than 5 qubits are not supported!");
+    }
+
+    // Swap global target qubits with local ones that are not targeted by this gate
+    for (auto id: ids) {
+        if (map_[id] >= L_) {
+            auto victim = L_;
+            while (victim-- > 0) {
+                if (std::none_of(begin(ids), end(ids), [&](unsigned other) { return map_[other] == victim; })) {
+                    break;
+                }
+            }
+            swap_qubits(map_[id], victim);
+        }
+    }
+
+    PendingOp op{true, std::move(m), {}, static_cast<unsigned>(ids.size()), 0, 0, 0, 0, 1.};
+    for (auto id: ids) {
+        op.ids.push_back(map_[id]);
+    }
+    // Pad with zeros.
+    op.ids.resize(max_qubit_num_);
+
+    split_mask(get_control_mask(ctrls), op.mask, op.gmask);
+    op.gval = op.gmask;
+
+    pending_.push_back(std::move(op));
+    if (pending_.size() >= max_pending_) {
+        flush_pending();
+    }
+}
+
+OutOfCoreSimulator::IOStats OutOfCoreSimulator::get_io_stats() const
+{
+    const auto gates = static_cast<double>(std::max<std::uint64_t>(num_gates_, 1));
+    IOStats stats;
+    stats["bytes_read"] = static_cast<double>(bytes_read_);
+    stats["bytes_written"] = static_cast<double>(bytes_written_);
+    stats["bytes_read_per_gate"] = static_cast<double>(bytes_read_) / gates;
+    stats["bytes_written_per_gate"] = static_cast<double>(bytes_written_) / gates;
+    stats["gates"] = static_cast<double>(num_gates_);
+    stats["sweeps"] = static_cast<double>(num_sweeps_);
+    stats["swaps"] = static_cast<double>(num_swaps_);
+    return stats;
+}
+
+void OutOfCoreSimulator::reset_io_stats()
+{
+    bytes_read_ = 0;
+    bytes_written_ = 0;
+    num_gates_ = 0;
+    num_sweeps_ = 0;
+    num_swaps_ = 0;
+}
+
+// =============================================================================
+
+std::string OutOfCoreSimulator::chunk_path(std::size_t chunk) const
+{
+    return directory_ + "/" + tag_ + "_" + std::to_string(chunk) + ".bin";
+}
+
+void OutOfCoreSimulator::read_chunk(std::size_t chunk, StateVector& buffer, bool is_zero)
+{
+    buffer.resize(chunk_size());
+    if (is_zero) {
+        std::fill(begin(buffer), end(buffer), complex_type(0.));
+        return;
+    }
+
+    auto* file = std::fopen(chunk_path(chunk).c_str(), "rb");
+    if (file == nullptr) {
+        throw(std::runtime_error("OutOfCoreSimulator: unable to open chunk file " + chunk_path(chunk)));
+    }
+    const auto count = std::fread(buffer.data(), sizeof(complex_type), buffer.size(), file);
+    std::fclose(file);
+    if (count != buffer.size()) {
+        throw(std::runtime_error("OutOfCoreSimulator: unable to read chunk file " + chunk_path(chunk)));
+    }
+    bytes_read_ += count * sizeof(complex_type);
+}
+
+void OutOfCoreSimulator::write_chunk(std::size_t chunk, StateVector const& buffer)
+{
+    auto* file = std::fopen(chunk_path(chunk).c_str(), "wb");
+    if (file == nullptr) {
+        throw(std::runtime_error("OutOfCoreSimulator: unable to create chunk file " + chunk_path(chunk)));
+    }
+    const auto count = std::fwrite(buffer.data(), sizeof(complex_type), buffer.size(), file);
+    const auto status = std::fclose(file);
+    if (count != buffer.size() || status != 0) {
+        throw(std::runtime_error("OutOfCoreSimulator: unable to write chunk file " + chunk_path(chunk)));
+    }
+    bytes_written_ += count * sizeof(complex_type);
+}
+
+void OutOfCoreSimulator::apply_pending(std::size_t chunk, StateVector& buffer)
+{
+    for (auto const& op: pending_) {
+        if ((chunk & op.gmask) != op.gval) {
+            continue;
+        }
+        if (op.is_gate) {
+            backend_kernel_(buffer, op.matrix, op.mask, op.ids, op.nids);
+        }
+        else {
+#pragma omp parallel for schedule(static)
+            for (std::size_t i = 0; i < buffer.size(); ++i) {
+                if ((i & op.mask) != op.value) {
+                    buffer[i] = 0.;
+                }
+                else {
+                    buffer[i] *= op.scale;
+                }
+            }
+        }
+    }
+}
+
+void OutOfCoreSimulator::pipeline(std::vector<Group> const& groups, GroupVisitor const& visit)
+{
+    if (groups.empty()) {
+        return;
+    }
+    ++num_sweeps_;
+
+    using ZeroFlags = std::array<bool, max_group_size_>;
+    auto zero_flags = [this](Group const& group) {
+        ZeroFlags flags{};
+        for (std::size_t i = 0; i < group.size(); ++i) {
+            flags[i] = zero_[group[i]];
+        }
+        return flags;
+    };
+    auto load = [this](Group const& group, ZeroFlags flags, GroupBuffers& buffers) {
+        for (std::size_t i = 0; i < group.size(); ++i) {
+            read_chunk(group[i], buffers[i], flags[i]);
+        }
+    };
+    auto store = [this](Group const& group, GroupBuffers const& buffers) {
+        for (std::size_t i = 0; i < group.size(); ++i) {
+            write_chunk(group[i], buffers[i]);
+        }
+    };
+
+    // While group k is being processed, group k+1 is read and group k-1 is written back.
+    std::array<std::future<void>, num_slots_> reads;
+    std::array<std::future<void>, num_slots_> writes;
+    reads[0] = std::async(std::launch::async, load, std::cref(groups[0]), zero_flags(groups[0]),
+                          std::ref(buffers_[0]));
+    for (std::size_t k = 0; k < groups.size(); ++k) {
+        const auto slot = k % num_slots_;
+        reads[slot].get();
+        if (k + 1 < groups.size()) {
+            const auto next = (k + 1) % num_slots_;
+            if (writes[next].valid()) {
+                writes[next].get();
+            }
+            reads[next] = std::async(std::launch::async, load, std::cref(groups[k + 1]), zero_flags(groups[k + 1]),
+                                     std::ref(buffers_[next]));
+        }
+
+        auto const& group = groups[k];
+        auto& buffers = buffers_[slot];
+        for (std::size_t i = 0; i < group.size(); ++i) {
+            apply_pending(group[i], buffers[i]);
+        }
+        const bool modified = visit(group, buffers) || !pending_.empty();
+        if (modified) {
+            for (auto chunk: group) {
+                zero_[chunk] = false;
+            }
+            writes[slot] = std::async(std::launch::async, store, std::cref(group), std::cref(buffers));
+        }
+    }
+    for (auto& write: writes) {
+        if (write.valid()) {
+            write.get();
+        }
+    }
+}
+
+void OutOfCoreSimulator::sweep(ChunkVisitor const& visit, std::size_t gmask, std::size_t gval)
+{
+    std::vector<Group> groups;
+    for (std::size_t chunk = 0; chunk < num_chunks(); ++chunk) {
+        // pending operations need to be applied to all the chunks
+        if (!zero_[chunk] && (!pending_.empty() || (chunk & gmask) == gval)) {
+            groups.push_back({chunk});
+        }
+    }
+    pipeline(groups, [&](Group const& group, GroupBuffers& buffers) {
+        if (!visit || (group[0] & gmask) != gval) {
+            return false;
+        }
+        return visit(group[0], buffers[0]);
+    });
+    pending_.clear();
+}
+
+void OutOfCoreSimulator::sweep_pairs(std::size_t partner, PairVisitor const& visit)
+{
+    std::size_t top = 1;
+    while ((top << 1U) <= partner) {
+        top <<= 1U;
+    }
+
+    std::vector<Group> groups;
+    for (std::size_t chunk = 0; chunk < num_chunks(); ++chunk) {
+        if ((chunk & top) == 0 && !(zero_[chunk] && zero_[chunk ^ partner])) {
+            groups.push_back({chunk, chunk ^ partner});
+        }
+    }
+    pipeline(groups, [&](Group const& group, GroupBuffers& buffers) {
+        return visit(group[0], buffers[0], group[1], buffers[1]);
+    });
+    pending_.clear();
+}
+
+void OutOfCoreSimulator::flush_pending()
+{
+    if (!pending_.empty()) {
+        sweep(nullptr);
+    }
+}
+
+void OutOfCoreSimulator::swap_qubits(unsigned global_pos, unsigned local_pos)
+{
+    ++num_swaps_;
+    const auto lbit = 1UL << local_pos;
+
+    // Amplitudes with the local bit set in the lower chunk are exchanged with the ones without it in the upper chunk
+    sweep_pairs(1UL << (global_pos - L_), [lbit](std::size_t, StateVector& lower, std::size_t, StateVector& upper) {
+#pragma omp parallel for schedule(static)
+        for (std::size_t i = 0; i < lower.size(); ++i) {
+            if ((i & lbit) != 0) {
+                std::swap(lower[i], upper[i ^ lbit]);
+            }
+        }
+        return true;
+    });
+
+    for (auto& p: map_) {
+        if (p.second == global_pos) {
+            p.second = local_pos;
+        }
+        else if (p.second == local_pos) {
+            p.second = global_pos;
+        }
+    }
+}
+
+void OutOfCoreSimulator::split_mask(std::size_t mask, std::size_t& local, std::size_t& global) const
+{
+    local = mask & (chunk_size() - 1);
+    global = mask >> local_bits();
+}
+
+OutOfCoreSimulator::calc_type OutOfCoreSimulator::norm_of(std::size_t mask, std::size_t value)
+{
+    std::size_t lmask = 0;
+    std::size_t gmask = 0;
+    std::size_t lval = 0;
+    std::size_t gval = 0;
+    split_mask(mask, lmask, gmask);
+    split_mask(value, lval, gval);
+
+    calc_type N = 0.;
+    sweep(
+        [&N, lmask, lval](std::size_t, StateVector& buffer) {
+            calc_type nrm = 0.;
+#pragma omp parallel for reduction(+ : nrm) schedule(static)
+            for (std::size_t i = 0; i < buffer.size(); ++i) {
+                if ((i & lmask) == lval) {
+                    nrm += std::norm(buffer[i]);
+                }
+            }
+            N += nrm;
+            return false;
+        },
+        gmask, gval);
+    return N;
+}
+
+void OutOfCoreSimulator::project(std::size_t mask, std::size_t value, calc_type scale)
+{
+    std::size_t lmask = 0;
+    std::size_t gmask = 0;
+    std::size_t lval = 0;
+    std::size_t gval = 0;
+    split_mask(mask, lmask, gmask);
+    split_mask(value, lval, gval);
+
+    // Chunks not matching the global part of the projection are dropped right away
+    for (std::size_t chunk = 0; chunk < num_chunks(); ++chunk) {
+        if ((chunk & gmask) != gval && !zero_[chunk]) {
+            zero_[chunk] = true;
+            std::remove(chunk_path(chunk).c_str());
+        }
+    }
+    pending_.push_back(PendingOp{false, {}, {}, 0, lmask, lval, 0, 0, scale});
+}
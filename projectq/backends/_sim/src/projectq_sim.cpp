@@ -0,0 +1,196 @@
+//   Copyright 2021 <Huawei Technologies Co., Ltd>
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#include "projectq_sim.h"
+
+#include "simbackends.hpp"
+#include "simulator.hpp"
+
+#include <exception>
+#include <stdexcept>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+struct pqsim_simulator
+{
+    explicit pqsim_simulator(unsigned seed) : simulator(seed)
+    {}
+
+    Simulator simulator;
+    std::unordered_set<unsigned> qubits;  // the Simulator does not check the ids of gates (done by Python otherwise)
+};
+
+namespace
+{
+    thread_local std::string last_error;  // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+
+    // Call f, turning exceptions into PQSIM_ERROR
+    template <class F>
+    int guarded(pqsim_simulator* sim, F&& f)
+    {
+        if (sim == nullptr) {
+            last_error = "Invalid simulator (NULL)";
+            return PQSIM_ERROR;
+        }
+        try {
+            f(sim->simulator);
+            return PQSIM_OK;
+        }
+        catch (std::exception const& ex) {
+            last_error = ex.what();
+        }
+        catch (...) {
+            last_error = "Unknown error";
+        }
+        return PQSIM_ERROR;
+    }
+
+    // Copy of the ids, checking that all the qubits have been allocated
+    std::vector<unsigned> checked_ids(pqsim_simulator const* sim, const unsigned* ids, size_t size)
+    {
+        std::vector<unsigned> result;
+        for (std::size_t i = 0; i < size; ++i) {
+            if (sim->qubits.count(ids[i]) == 0) {
+                throw std::invalid_argument("Unknown qubit id " + std::to_string(ids[i]));
+            }
+            result.push_back(ids[i]);
+        }
+        return result;
+    }
+}  // namespace
+
+const char* pqsim_last_error()
+{
+    return last_error.c_str();
+}
+
+pqsim_simulator* pqsim_create(unsigned seed)
+{
+    try {
+        return new pqsim_simulator(seed);
+    }
+    catch (std::exception const& ex) {
+        last_error = ex.what();
+    }
+    catch (...) {
+        last_error = "Unknown error";
+    }
+    return nullptr;
+}
+
+void pqsim_destroy(pqsim_simulator* sim)
+{
+    delete sim;
+}
+
+int pqsim_select_backend(pqsim_simulator* sim, int backend)
+{
+    return guarded(sim, [backend](Simulator& simulator) {
+        if (backend < PQSIM_BACKEND_AUTO || backend > PQSIM_BACKEND_VECTOR_THREADED) {
+            throw std::invalid_argument("pqsim_select_backend(): invalid backend");
+        }
+        simulator.select_backend(static_cast<backends::SimBackend>(backend));
+    });
+}
+
+int pqsim_allocate_qubit(pqsim_simulator* sim, unsigned id)
+{
+    return guarded(sim, [sim, id](Simulator& simulator) {
+        simulator.allocate_qubit(id);
+        sim->qubits.insert(id);
+    });
+}
+
+int pqsim_allocate_qureg(pqsim_simulator* sim, const unsigned* ids, size_t num_ids)
+{
+    return guarded(sim, [=](Simulator& simulator) {
+        simulator.allocate_qureg(std::vector<unsigned>(ids, ids + num_ids));
+        sim->qubits.insert(ids, ids + num_ids);
+    });
+}
+
+int pqsim_deallocate_qubit(pqsim_simulator* sim, unsigned id)
+{
+    return guarded(sim, [sim, id](Simulator& simulator) {
+        simulator.deallocate_qubit(id);
+        sim->qubits.erase(id);
+    });
+}
+
+int pqsim_apply_gate(pqsim_simulator* sim, const double* matrix, const unsigned* ids, size_t num_ids,
+                     const unsigned* ctrls, size_t num_ctrls)
+{
+    return guarded(sim, [=](Simulator& simulator) {
+        if (num_ids < 1 || num_ids > 5) {
+            throw std::invalid_argument("pqsim_apply_gate(): gates must act on 1 to 5 qubits");
+        }
+        const auto size = std::size_t(1) << (2 * num_ids);
+        types::M m(size);
+        for (std::size_t i = 0; i < size; ++i) {
+            m[i] = {matrix[2 * i], matrix[2 * i + 1]};
+        }
+        simulator.apply_controlled_gate(m, checked_ids(sim, ids, num_ids), checked_ids(sim, ctrls, num_ctrls));
+    });
+}
+
+int pqsim_run(pqsim_simulator* sim)
+{
+    return guarded(sim, [](Simulator& simulator) { simulator.run(); });
+}
+
+int pqsim_measure(pqsim_simulator* sim, const unsigned* ids, size_t num_ids, int* results)
+{
+    return guarded(sim, [=](Simulator& simulator) {
+        const auto outcomes = simulator.measure_qubits_return(checked_ids(sim, ids, num_ids));
+        for (std::size_t i = 0; i < num_ids; ++i) {
+            results[i] = outcomes[i] ? 1 : 0;
+        }
+    });
+}
+
+int pqsim_get_probability(pqsim_simulator* sim, const int* bits, const unsigned* ids, size_t num_ids,
+                          double* probability)
+{
+    return guarded(sim, [=](Simulator& simulator) {
+        std::vector<bool> bit_string(num_ids);
+        for (std::size_t i = 0; i < num_ids; ++i) {
+            bit_string[i] = bits[i] != 0;
+        }
+        *probability = simulator.get_probability(bit_string, checked_ids(sim, ids, num_ids));
+    });
+}
+
+int pqsim_get_expectation_value(pqsim_simulator* sim, const pqsim_pauli_term* terms, size_t num_terms, double* value)
+{
+    return guarded(sim, [=](Simulator& simulator) {
+        // The Simulator expects terms acting on positions in a list of qubit ids
+        Simulator::TermsDict td;
+        std::vector<unsigned> ids;
+        for (std::size_t t = 0; t < num_terms; ++t) {
+            Simulator::Term term;
+            for (std::size_t i = 0; i < terms[t].num_qubits; ++i) {
+                const auto pauli = terms[t].paulis[i];
+                if (pauli != 'X' && pauli != 'Y' && pauli != 'Z') {
+                    throw std::invalid_argument("pqsim_get_expectation_value(): Pauli operators must be X, Y or Z");
+                }
+                term.emplace_back(static_cast<unsigned>(ids.size()), pauli);
+                ids.push_back(terms[t].qubits[i]);
+            }
+            td.emplace_back(std::move(term), terms[t].coefficient);
+        }
+        *value = simulator.get_expectation_value(td, checked_ids(sim, ids.data(), ids.size()));
+    });
+}
@@ -14,9 +14,14 @@
 
 #include "simbackends.hpp"
 
-#include "debug_info.hpp"
 #include "instrset.hpp"
+#include "thread_pool.hpp"
 
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <mutex>
+#include <stdexcept>
 #include <string>
 #ifdef HIQ_WITH_CUDA
 #    include <cuda_runtime_api.h>
@@ -60,7 +65,8 @@ backends::SimBackend backends::SimBackendGetEnv()
 backends::SimBackend backends::SimBackendGetAuto()
 {
     // If NVIDIA GPU is available, select SimBackend::OffloadNVIDIA
-    // TODO(dmitry) Make the selection to actually depend on the problem size (need to propagate it here).
+    // NB: for the CPU backends, the Simulator switches to the serial counterpart of the selected backend (see
+    // SimBackendSerial()) as long as the problem size is below SimBackendGetThresholds().
     if (SimBackendIsAvailable(SimBackend::OffloadNVIDIA)) {
         return SimBackend::OffloadNVIDIA;
     }
@@ -74,6 +80,142 @@ backends::SimBackend backends::SimBackendGetAuto()
     return SimBackend::ScalarThreaded;
 }
 
+// Single-threaded counterpart of a multi-threaded CPU backend (SimBackend::Unknown if there is none).
+backends::SimBackend backends::SimBackendSerial(SimBackend backend)
+{
+    switch (backend) {
+        case SimBackend::ScalarThreaded:
+            return SimBackend::ScalarSerial;
+        case SimBackend::VectorThreaded:
+            return SimBackend::VectorSerial;
+        default:
+            return SimBackend::Unknown;
+    }
+}
+
+namespace
+{
+    // Conservative defaults (about 256 KB of state vector per thread); run SimBackendCalibrate() to adapt them to the
+    // current machine.
+    constexpr auto default_threaded_min_qubits = 14U;
+    constexpr auto default_qubits_per_thread = 12U;
+
+    // Largest state vector used by SimBackendCalibrate() (16 MB)
+    constexpr auto calibration_max_qubits = 20U;
+
+    unsigned threshold_from_env(const char* name, unsigned default_value)
+    {
+        const char* cenv = getenv(name);  // NOLINT(concurrency-mt-unsafe)
+        if (cenv == nullptr) {
+            return default_value;
+        }
+        try {
+            return static_cast<unsigned>(std::stoul(cenv));
+        }
+        catch (std::exception const&) {
+            return default_value;
+        }
+    }
+
+    std::atomic<unsigned>& threaded_min_qubits()
+    {
+        static std::atomic<unsigned> value(threshold_from_env("SIM_THREADED_MIN_QUBITS", default_threaded_min_qubits));
+        return value;
+    }
+
+    std::atomic<unsigned>& qubits_per_thread()
+    {
+        static std::atomic<unsigned> value(threshold_from_env("SIM_QUBITS_PER_THREAD", default_qubits_per_thread));
+        return value;
+    }
+
+    // The multi-threaded kernels of all the backends use the thread pool of the simulator (if it runs its own loops on
+    // a pool) or else of the first of them to be loaded (if they use a thread pool, see src/kernels.cpp), so that their
+    // workers do not compete for the CPUs
+    void share_thread_pool(backends::SimBackend backend)
+    {
+        using ShareFunction = void*(void*);
+        static std::mutex mutex;
+#if PARALLEL_THREAD_POOL
+        static void* pool = &parallel::ThreadPool::instance();
+#else
+        static void* pool = nullptr;
+#endif  // PARALLEL_THREAD_POOL
+
+        if (void* symbol = backends::SimBackendLoadSymbol(backend, "share_thread_pool")) {
+            std::lock_guard<std::mutex> lock(mutex);
+            pool = reinterpret_cast<ShareFunction*>(symbol)(pool);  // NOLINT
+        }
+    }
+
+    // Wall time of one application of a Hadamard gate to the state vector by the kernel
+    double time_kernel(backends::KernelFunction* kernel, types::V& psi)
+    {
+        using clock = std::chrono::steady_clock;
+        constexpr auto min_time = 2e-3;
+
+        const auto h = types::complex_type(1. / std::sqrt(2.));
+        const types::M m = {h, h, h, -h};
+        const fusion::Fusion::IndexVector ids(5, 0);
+
+        kernel(psi, m, 0, ids, 1);  // warm-up (thread creation, page faults)
+        auto calls = 0UL;
+        const auto start = clock::now();
+        double elapsed = 0.;
+        do {
+            kernel(psi, m, 0, ids, 1);
+            ++calls;
+            elapsed = std::chrono::duration<double>(clock::now() - start).count();
+        } while (elapsed < min_time);
+        return elapsed / static_cast<double>(calls);
+    }
+}  // namespace
+
+backends::AutoThresholds backends::SimBackendGetThresholds()
+{
+    return {threaded_min_qubits().load(), qubits_per_thread().load()};
+}
+
+void backends::SimBackendSetThresholds(AutoThresholds thresholds)
+{
+    threaded_min_qubits() = thresholds.threaded_min_qubits;
+    qubits_per_thread() = thresholds.qubits_per_thread;
+}
+
+// The multi-threaded kernels (using all the threads) are used from the smallest problem size at which they beat the
+// single-threaded ones. At that size, two threads are assumed to be worth it, hence one thread per
+// 2^(threaded_min_qubits - 1) amplitudes.
+backends::AutoThresholds backends::SimBackendCalibrate()
+{
+    const auto threaded = SimBackendGetAuto();
+    const auto serial = SimBackendSerial(threaded);
+    if (serial == SimBackend::Unknown) {
+        return SimBackendGetThresholds();
+    }
+
+    auto* serial_kernel = SimBackendLoadKernel(serial);
+    auto* threaded_kernel = SimBackendLoadKernel(threaded);
+    auto* set_num_threads = SimBackendLoadThreads(threaded);
+    const auto max_threads = set_num_threads != nullptr ? SimBackendSetThreads(set_num_threads, 0) : 0;
+
+    // Multi-threading is never worth it with a single thread
+    auto threshold = calibration_max_qubits + 1;
+    if (max_threads != 1) {
+        for (auto n = 4U; n <= calibration_max_qubits; ++n) {
+            types::V psi(1UL << n, 0.);
+            psi[0] = 1.;
+            if (time_kernel(threaded_kernel, psi) < time_kernel(serial_kernel, psi)) {
+                threshold = n;
+                break;
+            }
+        }
+    }
+
+    const AutoThresholds thresholds = {threshold, threshold - 1};
+    SimBackendSetThresholds(thresholds);
+    return thresholds;
+}
+
 // Check whether the SIM backend is actually supported by the current version.
 bool backends::SimBackendIsSupported(SimBackend backend)
 {
@@ -114,52 +256,62 @@ bool backends::SimBackendIsAvailable(SimBackend backend)
     return SimBackendIsSupported(backend);
 }
 
-// Acquire the Python module for the given backend
-pybind11::module_ backends::SimBackendAcquire(SimBackend backend)  // NOLINT(misc-no-recursion)
+// Name of the backend (e.g. "vector_threaded"), used to locate its kernels.
+std::string backends::SimBackendName(SimBackend backend)  // NOLINT(misc-no-recursion)
 {
-    std::string backendName;
     switch (backend) {
         case SimBackend::Auto:
-            return SimBackendAcquire(SimBackendGetAuto());
+            return SimBackendName(SimBackendGetAuto());
         case SimBackend::ScalarSerial:
-            backendName = "_cppsim_scalar_serial";
-            break;
+            return "scalar_serial";
         case SimBackend::ScalarThreaded:
-            backendName = "_cppsim_scalar_threaded";
-            break;
+            return "scalar_threaded";
         case SimBackend::VectorSerial:
-            backendName = "_cppsim_vector_serial";
-            break;
+            return "vector_serial";
         case SimBackend::VectorThreaded:
-            backendName = "_cppsim_vector_threaded";
-            break;
+            return "vector_threaded";
         case SimBackend::OffloadNVIDIA:
 #ifdef HIQ_WITH_CUDA
-            backendName = "_cppsim_offload_nvidia";
+            return "offload_nvidia";
 #else
-            throw pybind11::value_error("Python module was not compiled with CUDA support enabled!");
+            throw std::invalid_argument("The simulator was not compiled with CUDA support enabled!");
 #endif
-            break;
         case SimBackend::OffloadIntel:
-            throw pybind11::value_error("Python module was not compiled with DPC++ support enabled!");
+            throw std::invalid_argument("The simulator was not compiled with DPC++ support enabled!");
 
         case SimBackend::Unknown:
         default:
-            throw pybind11::value_error("Could not acquire an unsupported _sim backend");
+            throw std::invalid_argument("Could not acquire an unsupported _sim backend");
     }
+}
 
-    debug::printf("Using '%s' backend\n", backendName.c_str());
-
-    // Import backend as a python module (to avoid platform-specific dlopen() stuff)
-    try {
-        return pybind11::module_::import(backendName.c_str());
+backends::KernelFunction* backends::SimBackendLoadKernel(SimBackend backend)
+{
+    share_thread_pool(backend);
+    if (void* symbol = SimBackendLoadSymbol(backend, "kernel")) {
+        return reinterpret_cast<KernelFunction*>(symbol);  // NOLINT
     }
-    catch (pybind11::error_already_set& ex) {
-        if (!ex.matches(PyExc_ImportError)) {
-            throw;
-        }
-        backendName = "projectq.backends._sim." + backendName;
-        debug::printf("Using '%s' backend\n", backendName.c_str());
-        return pybind11::module_::import(backendName.c_str());
+    throw std::runtime_error("The kernels of the " + SimBackendName(backend) + " backend do not export kernel()");
+}
+
+backends::ThreadsFunction* backends::SimBackendLoadThreads(SimBackend backend)
+{
+    share_thread_pool(backend);
+    return reinterpret_cast<ThreadsFunction*>(SimBackendLoadSymbol(backend, "set_num_threads"));  // NOLINT
+}
+
+int backends::SimBackendSetThreads(ThreadsFunction* set_num_threads, int num_threads)
+{
+    // Per thread, as the OpenMP setting is
+    struct LastCall
+    {
+        ThreadsFunction* function;
+        int num_threads;
+        int result;
+    };
+    thread_local LastCall last = {nullptr, 0, 0};
+    if (set_num_threads != last.function || num_threads != last.num_threads) {
+        last = {set_num_threads, num_threads, set_num_threads(num_threads)};
     }
+    return last.result;
 }
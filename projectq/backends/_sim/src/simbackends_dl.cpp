@@ -0,0 +1,122 @@
+//   Copyright 2021 <Huawei Technologies Co., Ltd>
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#include "debug_info.hpp"
+#include "simbackends.hpp"
+
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#    include <windows.h>
+#else
+#    include <dlfcn.h>
+#endif  // _WIN32
+
+#ifndef KERNELS_LIBRARY_PREFIX
+#    ifdef _WIN32
+#        define KERNELS_LIBRARY_PREFIX "projectq_sim_kernels_"
+#    else
+#        define KERNELS_LIBRARY_PREFIX "libprojectq_sim_kernels_"
+#    endif  // _WIN32
+#endif      // !KERNELS_LIBRARY_PREFIX
+
+#ifndef KERNELS_LIBRARY_SUFFIX
+#    ifdef _WIN32
+#        define KERNELS_LIBRARY_SUFFIX ".dll"
+#    else
+#        define KERNELS_LIBRARY_SUFFIX ".so"
+#    endif  // _WIN32
+#endif      // !KERNELS_LIBRARY_SUFFIX
+
+namespace
+{
+    // Directory containing this library (or executable if linked statically), with a trailing separator
+    std::string this_directory()
+    {
+        std::string path;
+#ifdef _WIN32
+        HMODULE handle = nullptr;
+        if (GetModuleHandleExA(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
+                               reinterpret_cast<LPCSTR>(&this_directory), &handle)) {  // NOLINT
+            std::vector<char> buffer(MAX_PATH);
+            path.assign(buffer.data(), GetModuleFileNameA(handle, buffer.data(), MAX_PATH));
+        }
+#else
+        Dl_info info;
+        if (dladdr(reinterpret_cast<void*>(&this_directory), &info) != 0 && info.dli_fname != nullptr) {  // NOLINT
+            path = info.dli_fname;
+        }
+#endif  // _WIN32
+        const auto pos = path.find_last_of("/\\");
+        return pos == std::string::npos ? std::string() : path.substr(0, pos + 1);
+    }
+
+    void* open_library(std::string const& path)
+    {
+#ifdef _WIN32
+        return reinterpret_cast<void*>(LoadLibraryA(path.c_str()));  // NOLINT
+#else
+        return dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+#endif  // _WIN32
+    }
+
+    void* find_symbol(void* library, char const* name)
+    {
+#ifdef _WIN32
+        return reinterpret_cast<void*>(GetProcAddress(reinterpret_cast<HMODULE>(library), name));  // NOLINT
+#else
+        return dlsym(library, name);
+#endif  // _WIN32
+    }
+}  // namespace
+
+// Find the function in the shared library of the given backend (e.g. libprojectq_sim_kernels_vector_threaded.so).
+// The library is looked up in $PROJECTQ_SIM_KERNELS_DIR, then next to libprojectq_sim and finally in the default
+// search path of the dynamic loader. Libraries are never unloaded.
+void* backends::SimBackendLoadSymbol(SimBackend backend, char const* name)
+{
+    static std::mutex mutex;
+    static std::map<std::string, void*> libraries;
+
+    const auto filename = KERNELS_LIBRARY_PREFIX + SimBackendName(backend) + KERNELS_LIBRARY_SUFFIX;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = libraries.find(filename);
+    if (it != libraries.end()) {
+        return find_symbol(it->second, name);
+    }
+
+    std::vector<std::string> candidates;
+    if (const char* dir = std::getenv("PROJECTQ_SIM_KERNELS_DIR")) {  // NOLINT(concurrency-mt-unsafe)
+        candidates.push_back(std::string(dir) + "/" + filename);
+    }
+    candidates.push_back(this_directory() + filename);
+    candidates.push_back(filename);
+
+    for (auto const& path: candidates) {
+        if (void* library = open_library(path)) {
+            if (find_symbol(library, "kernel") != nullptr) {
+                debug::printf("Using '%s' backend\n", path.c_str());
+                libraries[filename] = library;
+                return find_symbol(library, name);
+            }
+        }
+    }
+    throw std::runtime_error("Could not load the kernels of the simulator backend (" + filename + ")");
+}
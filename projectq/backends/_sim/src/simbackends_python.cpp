@@ -0,0 +1,45 @@
+//   Copyright 2021 <Huawei Technologies Co., Ltd>
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#include "debug_info.hpp"
+#include "simbackends.hpp"
+
+#include <pybind11/pybind11.h>
+
+#include <string>
+
+// Functions are exported by the Python module of the given backend as functions returning their address
+void* backends::SimBackendLoadSymbol(SimBackend backend, char const* name)
+{
+    std::string backendName = "_cppsim_" + SimBackendName(backend);
+    debug::printf("Using '%s' backend\n", backendName.c_str());
+
+    // Import backend as a python module (to avoid platform-specific dlopen() stuff)
+    pybind11::module_ module;
+    try {
+        module = pybind11::module_::import(backendName.c_str());
+    }
+    catch (pybind11::error_already_set& ex) {
+        if (!ex.matches(PyExc_ImportError)) {
+            throw;
+        }
+        backendName = "projectq.backends._sim." + backendName;
+        debug::printf("Using '%s' backend\n", backendName.c_str());
+        module = pybind11::module_::import(backendName.c_str());
+    }
+    if (!pybind11::hasattr(module, name)) {
+        return nullptr;
+    }
+    return pybind11::cast<void*>(module.attr(name)());
+}
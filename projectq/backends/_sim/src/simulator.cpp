@@ -16,14 +16,19 @@
 
 #include "simbackends.hpp"
 
+#include <limits>
+
 Simulator::Simulator(unsigned seed)
     : N_(0)
+    , num_stored_(0)
     , vec_(1, 0.)
     , fusion_qubits_min_(4)
     , fusion_qubits_max_(max_qubit_num_)
     , rnd_eng_(seed)
     , backend_type_(backends::SimBackend::Unknown)
     , backend_kernel_(nullptr)
+    , backend_threads_(nullptr)
+    , num_threads_(0)
 {
     vec_[0] = 1.;  // all-zero initial state
     std::uniform_real_distribution<double> dist(0., 1.);
@@ -34,12 +39,90 @@ Simulator::Simulator(unsigned seed)
 
 void Simulator::select_backend(backends::SimBackend backend)
 {
-    pybind11::module_ module = backends::SimBackendAcquire(backend);
-    backend_kernel_ = reinterpret_cast<backend_kernel_t*>(pybind11::cast<void*>(module.attr("kernel")()));
+    auto_kernels_.reset();
+    num_threads_ = 0;
+    if (backend == backends::SimBackend::Auto) {
+        const auto threaded = backends::SimBackendGetAuto();
+        const auto serial = backends::SimBackendSerial(threaded);
+        if (serial != backends::SimBackend::Unknown) {
+            auto_kernels_ = AutoKernels{backends::SimBackendLoadKernel(serial),
+                                        backends::SimBackendLoadKernel(threaded),
+                                        backends::SimBackendLoadThreads(threaded)};
+            backend_type_ = backend;
+            update_backend_kernel();
+            return;
+        }
+    }
+    backend_kernel_ = backends::SimBackendLoadKernel(backend);
+    backend_threads_ = backends::SimBackendLoadThreads(backend);
     backend_type_ = backend;
 }
 
+void Simulator::update_backend_kernel()
+{
+    if (!auto_kernels_) {
+        return;
+    }
+    const auto thresholds = backends::SimBackendGetThresholds();
+    if (num_stored_ < thresholds.threaded_min_qubits) {
+        backend_kernel_ = auto_kernels_->serial;
+        backend_threads_ = nullptr;
+    }
+    else {
+        backend_kernel_ = auto_kernels_->threaded;
+        backend_threads_ = auto_kernels_->threads;
+        const auto n = num_stored_;
+        const auto log_threads = n > thresholds.qubits_per_thread ? n - thresholds.qubits_per_thread : 0U;
+        num_threads_ = log_threads < 16U ? 1 << log_threads : 0;
+    }
+}
+
+void Simulator::set_auto_backend_thresholds(unsigned threaded_min_qubits, unsigned qubits_per_thread)
+{
+    backends::SimBackendSetThresholds({threaded_min_qubits, qubits_per_thread});
+    update_backend_kernel();
+}
+
+std::pair<unsigned, unsigned> Simulator::get_auto_backend_thresholds() const
+{
+    const auto thresholds = backends::SimBackendGetThresholds();
+    return {thresholds.threaded_min_qubits, thresholds.qubits_per_thread};
+}
+
+std::pair<unsigned, unsigned> Simulator::calibrate_auto_backend()
+{
+    const auto thresholds = backends::SimBackendCalibrate();
+    update_backend_kernel();
+    return {thresholds.threaded_min_qubits, thresholds.qubits_per_thread};
+}
+
 void Simulator::run()
+{
+    if (!planner_.empty()) {
+        run_fused();
+        std::vector<fusion::Fusion> clusters;
+        {
+            stats::ScopedTimer timer(stats_, stats::Phase::fusion);
+            clusters = planner_.plan();
+        }
+        for (auto& cluster: clusters) {
+            fused_gates_ = std::move(cluster);
+            run_fused();
+        }
+    }
+    run_fused();
+}
+
+void Simulator::set_fusion_planner(unsigned window, unsigned max_qubits)
+{
+    if (max_qubits < 1 || max_qubits > max_qubit_num_) {
+        throw std::invalid_argument("set_fusion_planner(): max_qubits must be between 1 and 5.");
+    }
+    run();
+    planner_.configure(window, max_qubits);
+}
+
+void Simulator::run_fused()
 {
     if (fused_gates_.size() < 1UL) {
         return;
@@ -48,8 +131,21 @@ void Simulator::run()
     fusion::Fusion::Matrix m;
     fusion::Fusion::IndexVector ids;
     fusion::Fusion::IndexVector ctrls;
+    auto const* matrix = &m;
 
-    fused_gates_.perform_fusion(m, ids, ctrls);
+    {
+        stats::ScopedTimer timer(stats_, stats::Phase::fusion);
+        // Single gates are not worth caching (their fused matrix is the gate matrix itself)
+        if (fused_gates_.size() > 1UL && fusion_cache_.capacity() > 0) {
+            auto const& entry = fusion_cache_.fuse(fused_gates_);
+            matrix = &entry.matrix;
+            ids = entry.ids;
+            ctrls = entry.ctrls;
+        }
+        else {
+            fused_gates_.perform_fusion(m, ids, ctrls);
+        }
+    }
 
     if (ids.size() > max_qubit_num_) {
         throw std::invalid_argument("Gates with more than 5 qubits are not supported!");
@@ -65,10 +161,45 @@ void Simulator::run()
 
     auto ctrlmask = get_control_mask(ctrls);
 
-    backend_kernel_(vec_, m, ctrlmask, ids, nids);
+    // The number of threads is shared with the other simulators using the same kernels
+    if (backend_threads_ != nullptr) {
+        backends::SimBackendSetThreads(backend_threads_, num_threads_);
+    }
+
+    if (stats_.enabled()) {
+        const auto start = stats::Clock::now();
+        backend_kernel_(vec_, *matrix, ctrlmask, ids, nids);
+        const auto seconds = std::chrono::duration<double>(stats::Clock::now() - start).count();
+        stats_.record_kernel(nids, ctrls.size(), num_stored_, seconds);
+        stats_.record_flush(fused_gates_.size());
+    }
+    else {
+        backend_kernel_(vec_, *matrix, ctrlmask, ids, nids);
+    }
 
     fused_gates_ = fusion::Fusion();
 }
 
-Simulator::StateVector Simulator::tmpBuff1_;  // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
-Simulator::StateVector Simulator::tmpBuff2_;  // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+std::map<std::string, double> Simulator::get_fusion_cache_stats() const
+{
+    std::map<std::string, double> stats;
+    stats["hits"] = static_cast<double>(fusion_cache_.hits());
+    stats["misses"] = static_cast<double>(fusion_cache_.misses());
+    stats["size"] = static_cast<double>(fusion_cache_.size());
+    stats["capacity"] = static_cast<double>(fusion_cache_.capacity());
+    return stats;
+}
+
+std::map<std::string, double> Simulator::get_scratch_stats() const
+{
+    std::map<std::string, double> stats;
+    stats["buffers"] = static_cast<double>(scratch_.num_buffers());
+    stats["bytes"] = static_cast<double>(scratch_.retained_bytes());
+    stats["max_buffers"] = static_cast<double>(scratch_.max_buffers());
+    stats["max_bytes"] = scratch_.max_bytes() == memory::ScratchArena::unlimited
+                             ? std::numeric_limits<double>::infinity()
+                             : static_cast<double>(scratch_.max_bytes());
+    stats["allocations"] = static_cast<double>(scratch_.allocations());
+    stats["reuses"] = static_cast<double>(scratch_.reuses());
+    return stats;
+}
@@ -0,0 +1,417 @@
+//   Copyright 2021 <Huawei Technologies Co., Ltd>
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#include "stabilizer.hpp"
+
+#include <algorithm>
+#include <bitset>
+#include <stdexcept>
+
+namespace
+{
+    using word_t = StabilizerSimulator::word_t;
+
+    inline int popcount(word_t w)
+    {
+        return static_cast<int>(std::bitset<64>(w).count());
+    }
+
+    // Below this number of qubits, the row operations of a measurement are not worth distributing over threads
+    constexpr auto parallel_threshold = 512U;
+}  // namespace
+
+StabilizerSimulator::StabilizerSimulator(unsigned seed)
+    : N_(0), capacity_(0), words_(0), x_(0), z_(0), r_(1, 0), rnd_eng_(seed)
+{}
+
+// =============================================================================
+
+void StabilizerSimulator::reserve(std::size_t num_qubits)
+{
+    if (num_qubits <= capacity_) {
+        return;
+    }
+    auto capacity = std::max<std::size_t>(capacity_, bits_per_word_);
+    while (capacity < num_qubits) {
+        capacity *= 2;
+    }
+    const auto words = capacity / bits_per_word_;
+
+    Row x(words * (2 * capacity + 1), 0);
+    Row z(words * (2 * capacity + 1), 0);
+    std::vector<std::uint8_t> r(2 * capacity + 1, 0);
+    auto move_row = [&](std::size_t row, std::size_t new_row) {
+        std::copy_n(x_.begin() + row * words_, words_, x.begin() + new_row * words);
+        std::copy_n(z_.begin() + row * words_, words_, z.begin() + new_row * words);
+        r[new_row] = r_[row];
+    };
+    for (std::size_t i = 0; i < N_; ++i) {
+        move_row(destabilizer(i), i);
+        move_row(stabilizer(i), capacity + i);
+    }
+    std::swap(x_, x);
+    std::swap(z_, z);
+    std::swap(r_, r);
+    capacity_ = capacity;
+    words_ = words;
+}
+
+void StabilizerSimulator::rowsum(std::size_t h, std::size_t i)
+{
+    // Exponent of i picked up when multiplying the single-qubit Paulis of row i with those of row h (g function of the
+    // CHP paper), counted 64 qubits at a time: +1 for XY, YZ, ZX and -1 for XZ, YX, ZY.
+    auto* xh = x(h);
+    auto* zh = z(h);
+    auto const* xi = x(i);
+    auto const* zi = z(i);
+    int sum = 0;
+    for (std::size_t w = 0; w < words_; ++w) {
+        const auto x1 = xi[w];
+        const auto z1 = zi[w];
+        const auto x2 = xh[w];
+        const auto z2 = zh[w];
+        const auto plus = (x1 & z1 & z2 & ~x2) | (x1 & ~z1 & x2 & z2) | (~x1 & z1 & x2 & ~z2);
+        const auto minus = (x1 & z1 & x2 & ~z2) | (x1 & ~z1 & ~x2 & z2) | (~x1 & z1 & x2 & z2);
+        sum += popcount(plus) - popcount(minus);
+        xh[w] = x2 ^ x1;
+        zh[w] = z2 ^ z1;
+    }
+    sum += 2 * (r_[h] + r_[i]);
+    r_[h] = static_cast<std::uint8_t>(((sum % 4) + 4) % 4 == 2);
+}
+
+void StabilizerSimulator::rowcopy(std::size_t h, std::size_t i)
+{
+    std::copy_n(x(i), words_, x(h));
+    std::copy_n(z(i), words_, z(h));
+    r_[h] = r_[i];
+}
+
+void StabilizerSimulator::rowclear(std::size_t h)
+{
+    std::fill_n(x(h), words_, 0);
+    std::fill_n(z(h), words_, 0);
+    r_[h] = 0;
+}
+
+template <class F>
+void StabilizerSimulator::for_each_row(unsigned pos, F&& f)
+{
+    const auto w = pos / bits_per_word_;
+    const auto mask = word_t(1) << (pos % bits_per_word_);
+    for (std::size_t i = 0; i < N_; ++i) {
+        for (auto row: {destabilizer(i), stabilizer(i)}) {
+            auto& xw = x_[row * words_ + w];
+            auto& zw = z_[row * words_ + w];
+            bool xb = (xw & mask) != 0U;
+            bool zb = (zw & mask) != 0U;
+            bool r = r_[row] != 0U;
+            f(xb, zb, r);
+            xw = xb ? (xw | mask) : (xw & ~mask);
+            zw = zb ? (zw | mask) : (zw & ~mask);
+            r_[row] = static_cast<std::uint8_t>(r);
+        }
+    }
+}
+
+unsigned StabilizerSimulator::position(unsigned id, char const* function_name) const
+{
+    const auto it = map_.find(id);
+    if (it == map_.end()) {
+        throw(std::runtime_error(std::string(function_name)
+                                 + "(): Unknown qubit id. Please make sure you have called eng.flush()."));
+    }
+    return it->second;
+}
+
+// =============================================================================
+
+void StabilizerSimulator::allocate_qubit(unsigned id)
+{
+    if (map_.count(id) != 0U) {
+        throw(std::runtime_error("AllocateQubit: ID already exists. Qubit IDs should be unique."));
+    }
+    if (!free_positions_.empty()) {
+        // Already in |0> (see deallocate_qubit)
+        map_[id] = free_positions_.back();
+        free_positions_.pop_back();
+        return;
+    }
+
+    reserve(N_ + 1);
+    const auto pos = N_++;
+    const auto mask = word_t(1) << (pos % bits_per_word_);
+    x(destabilizer(pos))[pos / bits_per_word_] |= mask;
+    z(stabilizer(pos))[pos / bits_per_word_] |= mask;
+    map_[id] = pos;
+}
+
+void StabilizerSimulator::deallocate_qubit(unsigned id)
+{
+    const auto pos = position(id, "deallocate_qubit");
+    for (std::size_t i = 0; i < N_; ++i) {
+        if (x_bit(stabilizer(i), pos)) {
+            throw(std::runtime_error(
+                "Error: Qubit has not been measured / uncomputed! There is most likely a bug in your code."));
+        }
+    }
+
+    // Reset the qubit to |0> so that its position can be reused as is
+    if (measure(pos).first) {
+        pauli_x(id);
+    }
+    map_.erase(id);
+    free_positions_.push_back(pos);
+
+    if (map_.empty()) {
+        N_ = 0;
+        free_positions_.clear();
+        std::fill(begin(x_), end(x_), 0);
+        std::fill(begin(z_), end(z_), 0);
+        std::fill(begin(r_), end(r_), 0);
+    }
+}
+
+std::pair<bool, bool> StabilizerSimulator::measure(unsigned pos, int forced)
+{
+    std::size_t p = 0;
+    while (p < N_ && !x_bit(stabilizer(p), pos)) {
+        ++p;
+    }
+
+    if (p < N_) {
+        // Random outcome: stabilizer p anticommutes with Z. Make all the other rows commute with Z by multiplying them
+        // with stabilizer p (independent row operations), then replace stabilizer p by +/-Z.
+        const auto sp = stabilizer(p);
+        const std::size_t num_rows = 2 * N_;
+#pragma omp parallel for schedule(static) if (N_ > parallel_threshold)
+        for (std::size_t k = 0; k < num_rows; ++k) {
+            const auto row = k < N_ ? destabilizer(k) : stabilizer(k - N_);
+            if (row != sp && x_bit(row, pos)) {
+                rowsum(row, sp);
+            }
+        }
+        rowcopy(destabilizer(p), sp);
+        rowclear(sp);
+        z(sp)[pos / bits_per_word_] |= word_t(1) << (pos % bits_per_word_);
+
+        bool outcome = forced == 1;
+        if (forced < 0) {
+            outcome = std::bernoulli_distribution(0.5)(rnd_eng_);
+        }
+        r_[sp] = static_cast<std::uint8_t>(outcome);
+        return {outcome, true};
+    }
+
+    // Deterministic outcome: +/-Z is the product of the stabilizers whose destabilizer anticommutes with Z
+    rowclear(scratch());
+    for (std::size_t i = 0; i < N_; ++i) {
+        if (x_bit(destabilizer(i), pos)) {
+            rowsum(scratch(), stabilizer(i));
+        }
+    }
+    return {r_[scratch()] != 0U, false};
+}
+
+std::vector<bool> StabilizerSimulator::measure_qubits(std::vector<unsigned> const& ids)
+{
+    std::vector<bool> res;
+    res.reserve(ids.size());
+    for (auto const& id: ids) {
+        res.push_back(measure(position(id, "measure_qubits")).first);
+    }
+    return res;
+}
+
+// =============================================================================
+
+void StabilizerSimulator::hadamard(unsigned id)
+{
+    for_each_row(position(id, "hadamard"), [](bool& x, bool& z, bool& r) {
+        r ^= x && z;
+        std::swap(x, z);
+    });
+}
+
+void StabilizerSimulator::phase(unsigned id)
+{
+    for_each_row(position(id, "phase"), [](bool& x, bool& z, bool& r) {
+        r ^= x && z;
+        z ^= x;
+    });
+}
+
+void StabilizerSimulator::phase_dagger(unsigned id)
+{
+    for_each_row(position(id, "phase_dagger"), [](bool& x, bool& z, bool& r) {
+        r ^= x && !z;
+        z ^= x;
+    });
+}
+
+void StabilizerSimulator::pauli_x(unsigned id)
+{
+    for_each_row(position(id, "pauli_x"), [](bool& /* x */, bool& z, bool& r) { r ^= z; });
+}
+
+void StabilizerSimulator::pauli_y(unsigned id)
+{
+    for_each_row(position(id, "pauli_y"), [](bool& x, bool& z, bool& r) { r ^= x != z; });
+}
+
+void StabilizerSimulator::pauli_z(unsigned id)
+{
+    for_each_row(position(id, "pauli_z"), [](bool& x, bool& /* z */, bool& r) { r ^= x; });
+}
+
+void StabilizerSimulator::cnot(unsigned control, unsigned target)
+{
+    const auto a = position(control, "cnot");
+    const auto b = position(target, "cnot");
+    const auto wa = a / bits_per_word_;
+    const auto wb = b / bits_per_word_;
+    const auto sa = a % bits_per_word_;
+    const auto sb = b % bits_per_word_;
+    for (std::size_t i = 0; i < N_; ++i) {
+        for (auto row: {destabilizer(i), stabilizer(i)}) {
+            auto* xr = x(row);
+            auto* zr = z(row);
+            const auto xa = (xr[wa] >> sa) & 1U;
+            const auto za = (zr[wa] >> sa) & 1U;
+            const auto xb = (xr[wb] >> sb) & 1U;
+            const auto zb = (zr[wb] >> sb) & 1U;
+            r_[row] ^= static_cast<std::uint8_t>(xa & zb & (xb ^ za ^ 1U));
+            xr[wb] ^= xa << sb;
+            zr[wa] ^= zb << sa;
+        }
+    }
+}
+
+void StabilizerSimulator::cz(unsigned id1, unsigned id2)
+{
+    hadamard(id2);
+    cnot(id1, id2);
+    hadamard(id2);
+}
+
+void StabilizerSimulator::swap(unsigned id1, unsigned id2)
+{
+    // Relabelling the positions is enough
+    const auto a = position(id1, "swap");
+    const auto b = position(id2, "swap");
+    map_[id1] = b;
+    map_[id2] = a;
+}
+
+// =============================================================================
+
+double StabilizerSimulator::get_expectation_value(TermsDict const& td, std::vector<unsigned> const& ids)
+{
+    std::vector<unsigned> positions;
+    positions.reserve(ids.size());
+    for (auto const& id: ids) {
+        positions.push_back(position(id, "get_expectation_value"));
+    }
+
+    double expectation = 0.;
+    Row px(words_);
+    Row pz(words_);
+    for (auto const& [term, coefficient]: td) {
+        std::fill(begin(px), end(px), 0);
+        std::fill(begin(pz), end(pz), 0);
+        for (auto const& [index, op]: term) {
+            const auto pos = positions.at(index);
+            const auto mask = word_t(1) << (pos % bits_per_word_);
+            if (op == 'X' || op == 'Y') {
+                px[pos / bits_per_word_] ^= mask;
+            }
+            if (op == 'Z' || op == 'Y') {
+                pz[pos / bits_per_word_] ^= mask;
+            }
+        }
+        auto anticommutes = [this, &px, &pz](std::size_t row) {
+            int count = 0;
+            for (std::size_t w = 0; w < words_; ++w) {
+                count += popcount((x_[row * words_ + w] & pz[w]) ^ (z_[row * words_ + w] & px[w]));
+            }
+            return (count & 1) == 1;
+        };
+
+        // A Pauli string not in the stabilizer group (up to a sign) has expectation value 0. Otherwise it is the
+        // product of the stabilizers whose destabilizer anticommutes with it.
+        bool in_group = true;
+        for (std::size_t i = 0; i < N_ && in_group; ++i) {
+            in_group = !anticommutes(stabilizer(i));
+        }
+        if (!in_group) {
+            continue;
+        }
+        rowclear(scratch());
+        for (std::size_t i = 0; i < N_; ++i) {
+            if (anticommutes(destabilizer(i))) {
+                rowsum(scratch(), stabilizer(i));
+            }
+        }
+        expectation += r_[scratch()] != 0U ? -coefficient : coefficient;
+    }
+    return expectation;
+}
+
+double StabilizerSimulator::get_probability(std::vector<bool> const& bit_string, std::vector<unsigned> const& ids)
+{
+    if (bit_string.size() != ids.size()) {
+        throw(std::length_error("get_probability(): ids and bit_string size mismatch"));
+    }
+    std::vector<unsigned> positions;
+    positions.reserve(ids.size());
+    for (auto const& id: ids) {
+        positions.push_back(position(id, "get_probability"));
+    }
+
+    // Measure a copy of the tableau, forcing the random outcomes
+    const auto x = x_;
+    const auto z = z_;
+    const auto r = r_;
+    double probability = 1.;
+    for (std::size_t i = 0; i < ids.size() && probability > 0.; ++i) {
+        const auto [outcome, random] = measure(positions[i], bit_string[i]);
+        if (random) {
+            probability /= 2.;
+        }
+        else if (outcome != bit_string[i]) {
+            probability = 0.;
+        }
+    }
+    x_ = x;
+    z_ = z;
+    r_ = r;
+    return probability;
+}
+
+std::tuple<StabilizerSimulator::Map, std::vector<std::string>> StabilizerSimulator::cheat() const
+{
+    std::vector<std::string> stabilizers;
+    stabilizers.reserve(N_);
+    for (std::size_t i = 0; i < N_; ++i) {
+        const auto row = stabilizer(i);
+        std::string pauli(1, r_[row] != 0U ? '-' : '+');
+        for (unsigned pos = 0; pos < N_; ++pos) {
+            const auto xb = x_bit(row, pos);
+            const auto zb = z_bit(row, pos);
+            pauli += xb ? (zb ? 'Y' : 'X') : (zb ? 'Z' : 'I');
+        }
+        stabilizers.push_back(std::move(pauli));
+    }
+    return std::make_tuple(map_, stabilizers);
+}
@@ -0,0 +1,563 @@
+//   Copyright 2021 <Huawei Technologies Co., Ltd>
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#include "transport.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+#ifndef _WIN32
+#    include <arpa/inet.h>
+#    include <fcntl.h>
+#    include <netinet/in.h>
+#    include <netinet/tcp.h>
+#    include <poll.h>
+#    include <sys/mman.h>
+#    include <sys/socket.h>
+#    include <sys/stat.h>
+#    include <sys/wait.h>
+#    include <unistd.h>
+
+#    include <array>
+#    include <atomic>
+#    include <cerrno>
+#    include <chrono>
+#    include <cstdint>
+#    include <cstring>
+#    include <random>
+#    include <sstream>
+#    include <thread>
+#    include <utility>
+#endif  // !_WIN32
+
+distributed::TransportType distributed::TransportTypeFromString(std::string const& name)
+{
+    if (name == "shm") {
+        return TransportType::SharedMemory;
+    }
+    if (name == "tcp") {
+        return TransportType::TCP;
+    }
+    throw std::invalid_argument("Unknown transport '" + name + "' (valid values are 'shm' and 'tcp')");
+}
+
+#ifdef _WIN32
+std::unique_ptr<distributed::Transport> distributed::create_transport(TransportType /* type */, unsigned /* size */)
+{
+    throw std::runtime_error("Distributed simulation is not supported on this platform");
+}
+
+std::unique_ptr<distributed::Transport> distributed::join_transport(std::string const& /* endpoint */,
+                                                                    unsigned /* rank */)
+{
+    throw std::runtime_error("Distributed simulation is not supported on this platform");
+}
+#else
+namespace
+{
+    // Spin for a while, then yield and finally sleep while waiting for another process.
+    class Backoff
+    {
+    public:
+        // Returns true every time the waiting process went to sleep (good time to check whether the peer is alive)
+        bool wait()
+        {
+            ++count_;
+            if (count_ < spin_count_) {
+                return false;
+            }
+            if (count_ < yield_count_) {
+                std::this_thread::yield();
+                return false;
+            }
+            std::this_thread::sleep_for(std::chrono::microseconds(sleep_us_));
+            return true;
+        }
+
+    private:
+        static constexpr unsigned spin_count_ = 1000U;
+        static constexpr unsigned yield_count_ = 10000U;
+        static constexpr unsigned sleep_us_ = 100U;
+        unsigned count_ = 0;
+    };
+
+    // Base class keeping track of the other processes to avoid waiting forever on a process that died.
+    class ProcessTransport : public distributed::Transport
+    {
+    public:
+        ProcessTransport(unsigned size, unsigned rank) : size_(size), rank_(rank), parent_(getppid())
+        {}
+
+        void set_pids(std::vector<int> pids) override
+        {
+            pids_ = std::move(pids);
+        }
+
+        [[nodiscard]] unsigned rank() const override
+        {
+            return rank_;
+        }
+        [[nodiscard]] unsigned size() const override
+        {
+            return size_;
+        }
+
+    protected:
+        // Throw if the peer process (rank 0) or the main process (other ranks) died.
+        void check_alive(unsigned peer) const
+        {
+            if (rank_ != 0 && getppid() != parent_) {
+                throw std::runtime_error("Transport: the main process died");
+            }
+            if (rank_ == 0 && peer < pids_.size() && pids_[peer] > 0 && waitpid(pids_[peer], nullptr, WNOHANG) != 0) {
+                throw std::runtime_error("Transport: worker process " + std::to_string(peer) + " died");
+            }
+        }
+
+        void check_all_alive() const
+        {
+            for (unsigned peer = 0; peer < size_; ++peer) {
+                if (peer != rank_) {
+                    check_alive(peer);
+                }
+            }
+        }
+
+        unsigned size_;  // NOLINT(misc-non-private-member-variables-in-classes)
+        unsigned rank_;  // NOLINT(misc-non-private-member-variables-in-classes)
+
+    private:
+        pid_t parent_;
+        std::vector<int> pids_;
+    };
+
+    // -------------------------------------------------------------------------
+
+    // One single-producer/single-consumer ring buffer per ordered pair of processes in a named shared memory
+    // segment. The name is removed as soon as all the processes have mapped the segment.
+    class SharedMemoryTransport : public ProcessTransport
+    {
+        static constexpr std::size_t capacity_ = 1UL << 20U;
+        static constexpr std::size_t cache_line_ = 64;
+
+        struct Header
+        {
+            alignas(cache_line_) std::atomic<std::uint32_t> joined;  // number of processes that mapped the segment
+        };
+
+        struct Channel
+        {
+            alignas(cache_line_) std::atomic<std::uint64_t> head;  // total number of bytes written
+            alignas(cache_line_) std::atomic<std::uint64_t> tail;  // total number of bytes read
+            alignas(cache_line_) char data[capacity_];             // NOLINT
+        };
+
+    public:
+        // Create the segment (rank 0)
+        explicit SharedMemoryTransport(unsigned size) : ProcessTransport(size, 0)
+        {
+            std::random_device rd;
+            std::ostringstream name;
+            name << "/projectq_" << getpid() << "_" << std::hex << rd();
+            name_ = name.str();
+
+            const int fd = shm_open(name_.c_str(), O_CREAT | O_EXCL | O_RDWR, S_IRUSR | S_IWUSR);
+            if (fd < 0) {
+                throw std::runtime_error("SharedMemoryTransport: unable to create shared memory segment");
+            }
+            linked_ = true;
+            if (ftruncate(fd, static_cast<off_t>(segment_bytes())) != 0) {
+                close(fd);
+                shm_unlink(name_.c_str());
+                throw std::runtime_error("SharedMemoryTransport: unable to resize shared memory segment");
+            }
+            map(fd);
+
+            new (&header_->joined) std::atomic<std::uint32_t>(1);  // NOLINT
+            for (std::size_t i = 0; i < std::size_t(size_) * size_; ++i) {
+                new (&channels_[i].head) std::atomic<std::uint64_t>(0);  // NOLINT
+                new (&channels_[i].tail) std::atomic<std::uint64_t>(0);  // NOLINT
+            }
+        }
+
+        // Map the segment created by rank 0 (other ranks)
+        SharedMemoryTransport(unsigned size, unsigned rank, std::string name)
+            : ProcessTransport(size, rank), name_(std::move(name))
+        {
+            const int fd = shm_open(name_.c_str(), O_RDWR, S_IRUSR | S_IWUSR);
+            if (fd < 0) {
+                throw std::runtime_error("SharedMemoryTransport: unable to open shared memory segment " + name_);
+            }
+            map(fd);
+            header_->joined.fetch_add(1, std::memory_order_acq_rel);
+        }
+
+        ~SharedMemoryTransport() override
+        {
+            munmap(segment_, segment_bytes());
+            if (linked_) {
+                shm_unlink(name_.c_str());
+            }
+        }
+
+        SharedMemoryTransport(const SharedMemoryTransport&) = delete;
+        SharedMemoryTransport& operator=(const SharedMemoryTransport&) = delete;
+        SharedMemoryTransport(SharedMemoryTransport&&) = delete;
+        SharedMemoryTransport& operator=(SharedMemoryTransport&&) = delete;
+
+        [[nodiscard]] std::string endpoint() const override
+        {
+            return "shm:" + std::to_string(size_) + ":" + name_;
+        }
+
+        void connect() override
+        {
+            if (rank_ != 0) {
+                return;
+            }
+            Backoff backoff;
+            while (header_->joined.load(std::memory_order_acquire) < size_) {
+                if (backoff.wait()) {
+                    check_all_alive();
+                }
+            }
+            shm_unlink(name_.c_str());
+            linked_ = false;
+        }
+
+        void send(unsigned dest, const void* data, std::size_t bytes) override
+        {
+            auto& channel = channels_[rank_ * size_ + dest];
+            const auto* src = static_cast<const char*>(data);
+            Backoff backoff;
+            while (bytes > 0) {
+                const auto head = channel.head.load(std::memory_order_relaxed);
+                const auto tail = channel.tail.load(std::memory_order_acquire);
+                const auto available = capacity_ - static_cast<std::size_t>(head - tail);
+                if (available == 0) {
+                    if (backoff.wait()) {
+                        check_alive(dest);
+                    }
+                    continue;
+                }
+                const auto n = std::min(available, bytes);
+                const auto offset = static_cast<std::size_t>(head % capacity_);
+                const auto first = std::min(n, capacity_ - offset);
+                std::memcpy(&channel.data[offset], src, first);
+                std::memcpy(&channel.data[0], src + first, n - first);
+                channel.head.store(head + n, std::memory_order_release);
+                src += n;
+                bytes -= n;
+            }
+        }
+
+        void recv(unsigned src, void* data, std::size_t bytes) override
+        {
+            auto& channel = channels_[src * size_ + rank_];
+            auto* dst = static_cast<char*>(data);
+            Backoff backoff;
+            while (bytes > 0) {
+                const auto tail = channel.tail.load(std::memory_order_relaxed);
+                const auto head = channel.head.load(std::memory_order_acquire);
+                const auto available = static_cast<std::size_t>(head - tail);
+                if (available == 0) {
+                    if (backoff.wait()) {
+                        check_alive(src);
+                    }
+                    continue;
+                }
+                const auto n = std::min(available, bytes);
+                const auto offset = static_cast<std::size_t>(tail % capacity_);
+                const auto first = std::min(n, capacity_ - offset);
+                std::memcpy(dst, &channel.data[offset], first);
+                std::memcpy(dst + first, &channel.data[0], n - first);
+                channel.tail.store(tail + n, std::memory_order_release);
+                dst += n;
+                bytes -= n;
+            }
+        }
+
+    private:
+        [[nodiscard]] std::size_t segment_bytes() const
+        {
+            return sizeof(Header) + sizeof(Channel) * size_ * size_;
+        }
+
+        void map(int fd)
+        {
+            segment_ = mmap(nullptr, segment_bytes(), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            close(fd);
+            if (segment_ == MAP_FAILED) {  // NOLINT
+                if (linked_) {
+                    shm_unlink(name_.c_str());
+                }
+                throw std::runtime_error("SharedMemoryTransport: unable to map shared memory segment");
+            }
+            header_ = static_cast<Header*>(segment_);
+            channels_ = reinterpret_cast<Channel*>(header_ + 1);  // NOLINT
+        }
+
+        std::string name_;
+        bool linked_ = false;
+        void* segment_ = nullptr;
+        Header* header_ = nullptr;
+        Channel* channels_ = nullptr;
+    };
+
+    // -------------------------------------------------------------------------
+
+    // Fully connected mesh of localhost TCP sockets. The other ranks first connect to rank 0, which then sends them
+    // the ports of all the ranks.
+    class TcpTransport : public ProcessTransport
+    {
+        static constexpr int poll_timeout_ms_ = 100;
+
+    public:
+        // Rank 0
+        explicit TcpTransport(unsigned size) : ProcessTransport(size, 0), ports_(size, 0), fds_(size, -1)
+        {
+            ports_[0] = listen_localhost();
+        }
+
+        // Other ranks
+        TcpTransport(unsigned size, unsigned rank, std::uint32_t port0)
+            : ProcessTransport(size, rank), ports_(size, 0), fds_(size, -1)
+        {
+            ports_[0] = port0;
+            ports_[rank_] = listen_localhost();
+            fds_[0] = connect_localhost(port0);
+            const std::array<std::uint32_t, 2> hello = {rank_, ports_[rank_]};
+            send(0, hello.data(), sizeof(hello));
+        }
+
+        ~TcpTransport() override
+        {
+            for (auto fd: fds_) {
+                if (fd >= 0) {
+                    close(fd);
+                }
+            }
+            if (listener_ >= 0) {
+                close(listener_);
+            }
+        }
+
+        TcpTransport(const TcpTransport&) = delete;
+        TcpTransport& operator=(const TcpTransport&) = delete;
+        TcpTransport(TcpTransport&&) = delete;
+        TcpTransport& operator=(TcpTransport&&) = delete;
+
+        [[nodiscard]] std::string endpoint() const override
+        {
+            return "tcp:" + std::to_string(size_) + ":" + std::to_string(ports_[0]);
+        }
+
+        void connect() override
+        {
+            if (rank_ == 0) {
+                // Collect the ports of all the other ranks, then distribute them
+                for (unsigned i = 1; i < size_; ++i) {
+                    const int fd = accept_localhost();
+                    std::array<std::uint32_t, 2> hello{};
+                    read_all(fd, hello.data(), sizeof(hello));
+                    if (hello[0] == 0 || hello[0] >= size_ || fds_[hello[0]] >= 0) {
+                        close(fd);
+                        throw std::runtime_error("TcpTransport: unexpected connection");
+                    }
+                    fds_[hello[0]] = fd;
+                    ports_[hello[0]] = hello[1];
+                }
+                for (unsigned r = 1; r < size_; ++r) {
+                    send(r, ports_.data(), ports_.size() * sizeof(std::uint32_t));
+                }
+            }
+            else {
+                recv(0, ports_.data(), ports_.size() * sizeof(std::uint32_t));
+
+                // Connect to all higher ranks (the connections complete in the listen backlog)...
+                for (unsigned r = rank_ + 1; r < size_; ++r) {
+                    fds_[r] = connect_localhost(ports_[r]);
+                    const auto me = static_cast<std::uint32_t>(rank_);
+                    send(r, &me, sizeof(me));
+                }
+                // ... then accept the connections from all lower ranks (except rank 0)
+                for (unsigned i = 1; i < rank_; ++i) {
+                    const int fd = accept_localhost();
+                    std::uint32_t peer = 0;
+                    read_all(fd, &peer, sizeof(peer));
+                    if (peer == 0 || peer >= rank_ || fds_[peer] >= 0) {
+                        close(fd);
+                        throw std::runtime_error("TcpTransport: unexpected connection");
+                    }
+                    fds_[peer] = fd;
+                }
+            }
+            close(listener_);
+            listener_ = -1;
+        }
+
+        void send(unsigned dest, const void* data, std::size_t bytes) override
+        {
+            const auto* src = static_cast<const char*>(data);
+            while (bytes > 0) {
+#    ifdef MSG_NOSIGNAL
+                const auto n = ::send(fds_[dest], src, bytes, MSG_NOSIGNAL);
+#    else
+                const auto n = ::send(fds_[dest], src, bytes, 0);
+#    endif  // MSG_NOSIGNAL
+                if (n < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (n <= 0) {
+                    throw std::runtime_error("TcpTransport: unable to send data to rank " + std::to_string(dest));
+                }
+                src += n;
+                bytes -= static_cast<std::size_t>(n);
+            }
+        }
+
+        void recv(unsigned src, void* data, std::size_t bytes) override
+        {
+            read_all(fds_[src], data, bytes);
+        }
+
+    private:
+        std::uint32_t listen_localhost()
+        {
+            listener_ = socket(AF_INET, SOCK_STREAM, 0);
+            if (listener_ < 0) {
+                throw std::runtime_error("TcpTransport: unable to create socket");
+            }
+            sockaddr_in addr{};
+            addr.sin_family = AF_INET;
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            addr.sin_port = 0;
+            socklen_t len = sizeof(addr);
+            // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+            if (bind(listener_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0
+                || listen(listener_, static_cast<int>(size_)) != 0
+                // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+                || getsockname(listener_, reinterpret_cast<sockaddr*>(&addr), &len) != 0) {
+                throw std::runtime_error("TcpTransport: unable to listen on localhost");
+            }
+            return ntohs(addr.sin_port);
+        }
+
+        static int connect_localhost(std::uint32_t port)
+        {
+            const int fd = socket(AF_INET, SOCK_STREAM, 0);
+            sockaddr_in addr{};
+            addr.sin_family = AF_INET;
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            addr.sin_port = htons(static_cast<std::uint16_t>(port));
+            // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+            if (fd < 0 || ::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+                if (fd >= 0) {
+                    close(fd);
+                }
+                throw std::runtime_error("TcpTransport: unable to connect to port " + std::to_string(port));
+            }
+            configure(fd);
+            return fd;
+        }
+
+        [[nodiscard]] int accept_localhost() const
+        {
+            pollfd pfd{listener_, POLLIN, 0};
+            while (true) {
+                const auto ready = poll(&pfd, 1, poll_timeout_ms_);
+                if (ready > 0) {
+                    break;
+                }
+                if (ready < 0 && errno != EINTR) {
+                    throw std::runtime_error("TcpTransport: unable to wait for connections");
+                }
+                check_all_alive();
+            }
+            const int fd = accept(listener_, nullptr, nullptr);
+            if (fd < 0) {
+                throw std::runtime_error("TcpTransport: unable to accept connection");
+            }
+            configure(fd);
+            return fd;
+        }
+
+        static void configure(int fd)
+        {
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+#    ifdef SO_NOSIGPIPE
+            setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#    endif  // SO_NOSIGPIPE
+        }
+
+        static void read_all(int fd, void* data, std::size_t bytes)
+        {
+            auto* dst = static_cast<char*>(data);
+            while (bytes > 0) {
+                const auto n = ::recv(fd, dst, bytes, 0);
+                if (n < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (n <= 0) {
+                    throw std::runtime_error("TcpTransport: connection closed");
+                }
+                dst += n;
+                bytes -= static_cast<std::size_t>(n);
+            }
+        }
+
+        int listener_ = -1;
+        std::vector<std::uint32_t> ports_;
+        std::vector<int> fds_;
+    };
+}  // namespace
+
+std::unique_ptr<distributed::Transport> distributed::create_transport(TransportType type, unsigned size)
+{
+    switch (type) {
+        case TransportType::SharedMemory:
+            return std::make_unique<SharedMemoryTransport>(size);
+        case TransportType::TCP:
+            return std::make_unique<TcpTransport>(size);
+        default:
+            throw std::invalid_argument("Unsupported transport type");
+    }
+}
+
+std::unique_ptr<distributed::Transport> distributed::join_transport(std::string const& endpoint, unsigned rank)
+{
+    // Endpoints have the form <type>:<size>:<address>
+    const auto first = endpoint.find(':');
+    const auto second = endpoint.find(':', first + 1);
+    if (first == std::string::npos || second == std::string::npos) {
+        throw std::invalid_argument("Invalid transport endpoint '" + endpoint + "'");
+    }
+    const auto type = TransportTypeFromString(endpoint.substr(0, first));
+    const auto size = static_cast<unsigned>(std::stoul(endpoint.substr(first + 1, second - first - 1)));
+    const auto address = endpoint.substr(second + 1);
+    if (rank == 0 || rank >= size) {
+        throw std::invalid_argument("Invalid rank " + std::to_string(rank) + " for transport endpoint " + endpoint);
+    }
+
+    switch (type) {
+        case TransportType::SharedMemory:
+            return std::make_unique<SharedMemoryTransport>(size, rank, address);
+        case TransportType::TCP:
+            return std::make_unique<TcpTransport>(size, rank, static_cast<std::uint32_t>(std::stoul(address)));
+        default:
+            throw std::invalid_argument("Unsupported transport type");
+    }
+}
+#endif  // _WIN32
@@ -0,0 +1,117 @@
+//   Copyright 2021 <Huawei Technologies Co., Ltd>
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+// Test of the C API of the standalone simulator library (include/projectq_sim.h)
+//
+// The kernel libraries are looked up in PROJECTQ_SIM_KERNELS_DIR (set by CTest). Returns the number of failed checks.
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#include "projectq_sim.h"
+
+namespace
+{
+int failures = 0;
+
+void check(bool condition, const char* what, int line)
+{
+    if (!condition) {
+        std::printf("line %d: check failed: %s\n", line, what);
+        ++failures;
+    }
+}
+
+// Failed calls must return PQSIM_ERROR with a description of the error
+void check_error(int rc, const char* what, int line)
+{
+    check(rc == PQSIM_ERROR, what, line);
+    check(std::strlen(pqsim_last_error()) > 0, "pqsim_last_error() is empty", line);
+}
+}  // namespace
+
+#define CHECK(x) check((x), #x, __LINE__)
+#define CHECK_OK(x) check((x) == PQSIM_OK, #x, __LINE__)
+#define CHECK_ERROR(x) check_error((x), #x, __LINE__)
+
+int main()
+{
+    const double s = 1. / std::sqrt(2.);
+    const double h[] = {s, 0, s, 0, s, 0, -s, 0};
+    const double x[] = {0, 0, 1, 0, 1, 0, 0, 0};
+    const double eps = 1e-12;
+
+    CHECK_ERROR(pqsim_allocate_qubit(nullptr, 0));
+
+    pqsim_simulator* sim = pqsim_create(1);
+    CHECK(sim != nullptr);
+    if (sim == nullptr) {
+        std::printf("pqsim_create(): %s\n", pqsim_last_error());
+        return 1;
+    }
+
+    CHECK_ERROR(pqsim_select_backend(sim, 9));
+    CHECK_OK(pqsim_select_backend(sim, PQSIM_BACKEND_SCALAR_SERIAL));
+
+    // Bell pair on qubits 0 and 5 (qubit 3 is allocated but never touched)
+    const unsigned ids[] = {0, 3, 5};
+    const unsigned q0 = 0;
+    const unsigned q5 = 5;
+    const unsigned pair[] = {0, 5};
+    CHECK_OK(pqsim_allocate_qureg(sim, ids, 3));
+    CHECK_OK(pqsim_apply_gate(sim, h, &q0, 1, nullptr, 0));
+    CHECK_OK(pqsim_apply_gate(sim, x, &q5, 1, &q0, 1));
+    CHECK_OK(pqsim_run(sim));
+
+    double probability = -1;
+    const int bits00[] = {0, 0};
+    const int bits01[] = {0, 1};
+    CHECK_OK(pqsim_get_probability(sim, bits00, pair, 2, &probability));
+    CHECK(std::abs(probability - 0.5) < eps);
+    CHECK_OK(pqsim_get_probability(sim, bits01, pair, 2, &probability));
+    CHECK(std::abs(probability) < eps);
+
+    double value = 0;
+    const pqsim_pauli_term terms[] = {{1.0, "ZZ", pair, 2}, {0.5, "X", &q0, 1}};
+    CHECK_OK(pqsim_get_expectation_value(sim, terms, 2, &value));
+    CHECK(std::abs(value - 1.) < eps);
+
+    // Invalid arguments
+    const unsigned unknown = 4;
+    const pqsim_pauli_term bad_term = {1.0, "Q", &q0, 1};
+    CHECK_ERROR(pqsim_allocate_qubit(sim, 0));
+    CHECK_ERROR(pqsim_apply_gate(sim, x, &unknown, 1, nullptr, 0));
+    CHECK_ERROR(pqsim_apply_gate(sim, x, &q0, 0, nullptr, 0));
+    CHECK_ERROR(pqsim_get_probability(sim, bits00, &unknown, 1, &probability));
+    CHECK_ERROR(pqsim_get_expectation_value(sim, &bad_term, 1, &value));
+    CHECK_ERROR(pqsim_deallocate_qubit(sim, 0));
+
+    // Measuring collapses the pair: both outcomes agree and the qubits can then be deallocated
+    int results[] = {-1, -1};
+    CHECK_OK(pqsim_measure(sim, pair, 2, results));
+    CHECK(results[0] == 0 || results[0] == 1);
+    CHECK(results[0] == results[1]);
+    CHECK_OK(pqsim_deallocate_qubit(sim, 0));
+    CHECK_OK(pqsim_deallocate_qubit(sim, 3));
+    CHECK_OK(pqsim_deallocate_qubit(sim, 5));
+    CHECK_ERROR(pqsim_deallocate_qubit(sim, 5));
+
+    pqsim_destroy(sim);
+
+    if (failures != 0) {
+        std::printf("%d check(s) failed\n", failures);
+    }
+    return failures;
+}
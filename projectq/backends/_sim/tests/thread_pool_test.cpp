@@ -0,0 +1,131 @@
+//   Copyright 2021 <Huawei Technologies Co., Ltd>
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+// Test of the parallel loops of include/thread_pool.hpp, built with the thread pool (ENABLE_MULTITHREADING and
+// USE_THREAD_POOL). Returns the number of failed checks.
+
+#include "thread_pool.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#if !PARALLEL_THREAD_POOL
+#    error "The loops of thread_pool.hpp must run on the thread pool"
+#endif  // !PARALLEL_THREAD_POOL
+
+namespace
+{
+int failures = 0;
+
+void check(bool condition, const char* what, int line)
+{
+    if (!condition) {
+        std::printf("line %d: check failed: %s\n", line, what);
+        ++failures;
+    }
+}
+
+// Sum of 0, 1, ..., size - 1
+std::uint64_t parallel_sum(std::size_t size)
+{
+    return parallel::sum<std::uint64_t>(size, [](std::size_t i) { return static_cast<std::uint64_t>(i); });
+}
+
+// Whether f(i) was called exactly once for each i in [0, size)
+template <class Loop>
+bool covers_once(std::size_t size, Loop&& loop)
+{
+    std::vector<std::atomic<unsigned>> calls(size);
+    loop(calls);
+    for (auto const& count: calls) {
+        if (count != 1) {
+            return false;
+        }
+    }
+    return true;
+}
+}  // namespace
+
+#define CHECK(x) check((x), #x, __LINE__)
+
+int main()
+{
+    const std::size_t large = std::size_t(1) << 20U;
+    const std::size_t small = parallel::min_parallel_size / 2;
+
+    // Reductions, below and above the size of the serial loops
+    for (auto size: {std::size_t(0), std::size_t(1), small, large}) {
+        CHECK(parallel_sum(size) == size * (size - (size > 0 ? 1 : 0)) / 2);
+    }
+
+    for (auto size: {small, large}) {
+        CHECK(covers_once(size, [size](auto& calls) {
+            parallel::for_range(size, [&](std::size_t i) { ++calls[i]; });
+        }));
+        CHECK(covers_once(size, [size](auto& calls) {
+            parallel::for_chunks(size, [&](std::size_t begin, std::size_t end) {
+                for (auto i = begin; i < end; ++i) {
+                    ++calls[i];
+                }
+            });
+        }));
+    }
+
+    // Nested loops run serially in the threads of the outer one
+    {
+        const std::size_t outer = parallel::min_parallel_size;
+        std::vector<std::uint64_t> sums(outer, 0);
+        parallel::for_range(outer, [&](std::size_t i) { sums[i] = parallel_sum(parallel::min_parallel_size); });
+        auto correct = true;
+        for (auto value: sums) {
+            correct = correct && value == parallel_sum(parallel::min_parallel_size);
+        }
+        CHECK(correct);
+    }
+
+    // Concurrent loops: only one of them runs on the pool at a time, the others run serially
+    {
+        std::atomic<unsigned> errors{0};
+        std::vector<std::thread> threads;
+        for (auto t = 0; t < 4; ++t) {
+            threads.emplace_back([&errors, large] {
+                for (auto k = 0; k < 20; ++k) {
+                    if (parallel_sum(large) != large * (large - 1) / 2) {
+                        ++errors;
+                    }
+                }
+            });
+        }
+        for (auto& thread: threads) {
+            thread.join();
+        }
+        CHECK(errors == 0);
+    }
+
+    // Fewer threads than the pool has
+    parallel::ThreadPool::instance().set_num_threads(1);
+    CHECK(parallel::ThreadPool::instance().num_threads() == 1);
+    CHECK(parallel_sum(large) == large * (large - 1) / 2);
+    parallel::ThreadPool::instance().set_num_threads(0);
+    CHECK(parallel::ThreadPool::instance().num_threads() == parallel::ThreadPool::instance().max_threads());
+    CHECK(parallel_sum(large) == large * (large - 1) / 2);
+
+    if (failures != 0) {
+        std::printf("%d check(s) failed\n", failures);
+    }
+    return failures;
+}